@@ -0,0 +1,157 @@
+//=========================================================================
+//Runs the microbenchmarks (see Benchmarks.h) on the host, printing the results, and checks them against a baseline.
+//
+//The benchmarks are built with -fsanitize-coverage=trace-pc (see CMakeLists.txt), and the cycle counter counts
+//the basic blocks of the firmware's code that are run (see hostCycleCountIsBlocks in Shim/HostShim.h) rather than
+//time. So the costs aren't the actual costs on the controller, but are the same on every run and every machine,
+//and a change that makes a benchmark do more work shows up however small it is and however busy the machine is.
+//
+//  host_benchmarks [<baseline file> [--update]]
+//
+//With a baseline file, the mean and max cost of every benchmark is checked against it, and the exit code is 1 if
+//any is more than BASELINE_TOLERANCE_PERCENT over its baseline cost (or has no baseline). When a change is meant
+//to change the costs, update the baseline with --update and check in the new baseline along with the change.
+
+#include "Arduino.h"
+#include "TurnadoController.ino"
+#include "HostShim.h"
+#include "../Tests/HostTest.h"
+#include <fstream>
+#include <map>
+#include <sstream>
+
+const uint32_t BASELINE_TOLERANCE_PERCENT = 2;
+
+struct BenchmarkCost
+{
+  uint32_t mean;
+  uint32_t max;
+};
+
+//=========================================================================
+std::vector<std::pair<std::string, BenchmarkCost>> getBenchmarkCosts()
+{
+  //Reads the costs from the lines printed by benchmarkRun(), of the form "<name>: min <n>, mean <n>, max <n> cycles..."
+  std::vector<std::pair<std::string, BenchmarkCost>> costs;
+  std::istringstream output (hostSerialOutput);
+  std::string line;
+
+  while (std::getline (output, line))
+  {
+    size_t pos = line.rfind (": min ");
+    uint32_t min;
+    BenchmarkCost cost;
+
+    if (pos != std::string::npos && sscanf (line.c_str() + pos, ": min %u, mean %u, max %u", &min, &cost.mean, &cost.max) == 3)
+      costs.push_back ({line.substr (0, pos), cost});
+  }
+
+  return costs;
+}
+
+//=========================================================================
+bool readBaseline (const char *fileName, std::map<std::string, BenchmarkCost> &baseline)
+{
+  std::ifstream file (fileName);
+  std::string line;
+
+  if (!file)
+    return false;
+
+  while (std::getline (file, line))
+  {
+    BenchmarkCost cost;
+    int nameStart;
+
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    if (sscanf (line.c_str(), "%u %u %n", &cost.mean, &cost.max, &nameStart) == 2)
+      baseline[line.substr (nameStart)] = cost;
+  }
+
+  return true;
+}
+
+//=========================================================================
+bool writeBaseline (const char *fileName, const std::vector<std::pair<std::string, BenchmarkCost>> &costs)
+{
+  std::ofstream file (fileName);
+
+  file << "#Baseline basic block counts of the benchmarks (see Benchmarks/HostBenchmarks.cpp) as <mean> <max> <name>\n";
+  file << "#Regenerate with: host_benchmarks <this file> --update\n";
+
+  for (const auto &cost : costs)
+  {
+    char line[128];
+    snprintf (line, sizeof (line), "%8u %8u %s\n", cost.second.mean, cost.second.max, cost.first.c_str());
+    file << line;
+  }
+
+  return file.good();
+}
+
+//=========================================================================
+bool isWithinBaseline (uint32_t cost, uint32_t baselineCost)
+{
+  return (uint64_t)cost * 100 <= (uint64_t)baselineCost * (100 + BASELINE_TOLERANCE_PERCENT);
+}
+
+//=========================================================================
+int main (int argc, char *argv[])
+{
+  hostSerialEcho = true;
+  hostCycleCountIsBlocks = true;
+
+  //the benchmarks run from setup()
+  setup();
+
+  auto costs = getBenchmarkCosts();
+  HOST_CHECK (costs.size() > 0);
+
+  if (argc < 2)
+    return hostTestResult ("Benchmarks");
+
+  if (argc > 2 && strcmp (argv[2], "--update") == 0)
+  {
+    HOST_CHECK (writeBaseline (argv[1], costs));
+    printf ("%s: %u baseline costs written\n", argv[1], (unsigned)costs.size());
+    return hostTestResult ("Benchmarks");
+  }
+
+  std::map<std::string, BenchmarkCost> baseline;
+
+  if (!readBaseline (argv[1], baseline))
+  {
+    printf ("can't read %s\n", argv[1]);
+    return 1;
+  }
+
+  for (const auto &cost : costs)
+  {
+    const std::string &name = cost.first;
+
+    if (baseline.count (name) == 0)
+    {
+      printf ("%s: no baseline cost\n", name.c_str());
+      HOST_CHECK (baseline.count (name) > 0);
+      continue;
+    }
+
+    const BenchmarkCost &baselineCost = baseline[name];
+
+    if (!HOST_CHECK (isWithinBaseline (cost.second.mean, baselineCost.mean) && isWithinBaseline (cost.second.max, baselineCost.max)))
+    {
+      printf ("%s: mean %u, max %u is over its baseline of mean %u, max %u\n", name.c_str(),
+              cost.second.mean, cost.second.max, baselineCost.mean, baselineCost.max);
+    }
+    else if (!isWithinBaseline (baselineCost.mean, cost.second.mean) || !isWithinBaseline (baselineCost.max, cost.second.max))
+    {
+      //(not a failure, but the baseline should be updated so that it catches the next regression)
+      printf ("%s: mean %u, max %u is under its baseline of mean %u, max %u - update the baseline\n", name.c_str(),
+              cost.second.mean, cost.second.max, baselineCost.mean, baselineCost.max);
+    }
+  }
+
+  return hostTestResult ("Benchmarks");
+}
@@ -0,0 +1,24 @@
+//=========================================================================
+//Runs the firmware on the host for a number of seconds of simulated time (1 if not given), printing
+//its USB serial output - a quick check that it starts up and runs, without any inputs.
+//
+//  host_firmware [<seconds>]
+
+#include "Arduino.h"
+#include "TurnadoController.ino"
+#include "HostShim.h"
+
+//=========================================================================
+int main (int argc, char **argv)
+{
+  uint32_t runTimeS = (argc > 1) ? atoi (argv[1]) : 1;
+
+  hostSerialEcho = true;
+
+  setup();
+  hostRunLoop (runTimeS * 1000000);
+
+  printf ("\nRan for %us: %u MIDI packets sent\n", runTimeS, (uint32_t)hostMidiOut.size());
+
+  return 0;
+}
@@ -0,0 +1,319 @@
+/*
+  Arduino.h - The parts of the Teensy 3.6 core that the controller firmware uses, for building and
+  running the firmware on a desktop machine (see HostShim.h for controlling the simulated hardware).
+*/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HOST_BUILD 1
+
+//=========================================================================
+//Types and constants
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define FALLING 2
+#define RISING 3
+#define CHANGE 4
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define PI 3.1415926535897932384626433832795
+
+//The cycle counter counts nanoseconds of host time (see ARM_DWT_CYCCNT below, and hostCycleCountIsBlocks
+//in HostShim.h for the alternative), so that the code that converts cycles to time works unchanged
+#define F_CPU 1000000000
+
+//Teensy 3.6 analog pins
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+#define A8 22
+#define A9 23
+#define A10 64
+#define A11 65
+#define A12 31
+#define A13 32
+#define A14 33
+#define A15 34
+#define A16 35
+#define A17 36
+#define A18 37
+#define A19 38
+#define A20 39
+#define A21 66
+#define A22 67
+#define A23 49
+#define A24 50
+#define A25 68
+#define A26 69
+
+#define CORE_NUM_TOTAL_PINS 70
+
+//=========================================================================
+//Time - micros() and millis() read the simulated clock, which is moved on by delay(), delayMicroseconds()
+//and the functions in HostShim.h
+
+uint32_t micros();
+uint32_t millis();
+void delay (uint32_t msec);
+void delayMicroseconds (uint32_t usec);
+
+//=========================================================================
+//Pins
+
+void pinMode (uint8_t pin, uint8_t mode);
+void digitalWrite (uint8_t pin, uint8_t value);
+uint8_t digitalRead (uint8_t pin);
+
+//each pin has its own input register with the level in bit 0
+extern volatile uint32_t hostPinInputRegisters[CORE_NUM_TOTAL_PINS];
+#define portInputRegister(pin) (&hostPinInputRegisters[(pin)])
+#define digitalPinToBitMask(pin) (1)
+
+int analogRead (uint8_t pin);
+void analogReadResolution (unsigned int bits);
+void analogReadAveraging (unsigned int num);
+
+//=========================================================================
+//Interrupts - the simulated timers only run between calls into the firmware (see hostAdvanceMicros()),
+//and pin interrupts only when a pin is set (see hostSetPin()), so never interrupt it part way through anything
+
+void attachInterrupt (uint8_t pin, void (*function)(), int mode);
+void detachInterrupt (uint8_t pin);
+
+#define noInterrupts() do {} while (0)
+#define interrupts() do {} while (0)
+#define __disable_irq() do {} while (0)
+#define __enable_irq() do {} while (0)
+
+//=========================================================================
+//DWT cycle counter
+
+uint32_t hostCycleCount();
+extern volatile uint32_t hostArmDemcr;
+extern volatile uint32_t hostArmDwtCtrl;
+
+#define ARM_DWT_CYCCNT (hostCycleCount())
+#define ARM_DEMCR hostArmDemcr
+#define ARM_DEMCR_TRCENA (1 << 24)
+#define ARM_DWT_CTRL hostArmDwtCtrl
+#define ARM_DWT_CTRL_CYCCNTENA (1 << 0)
+
+//=========================================================================
+//Maths
+
+template <class A, class B>
+constexpr auto min (const A &a, const B &b) -> decltype (a < b ? a : b)
+{
+  return (a < b) ? a : b;
+}
+
+template <class A, class B>
+constexpr auto max (const A &a, const B &b) -> decltype (a > b ? a : b)
+{
+  return (a > b) ? a : b;
+}
+
+template <class T, class L, class H>
+constexpr auto constrain (const T &amt, const L &low, const H &high) -> decltype (amt < low ? low : (amt > high ? high : amt))
+{
+  return (amt < low) ? low : ((amt > high) ? high : amt);
+}
+
+//the Teensy version, which rounds better than the traditional one when mapping to a smaller range
+template <class T, class A, class B, class C, class D>
+long map (T _x, A _in_min, B _in_max, C _out_min, D _out_max)
+{
+  long x = _x, in_min = _in_min, in_max = _in_max, out_min = _out_min, out_max = _out_max;
+
+  if ((in_max - in_min) > (out_max - out_min))
+    return (x - in_min) * (out_max - out_min + 1) / (in_max - in_min + 1) + out_min;
+  else
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+//=========================================================================
+//Print and Stream
+
+class __FlashStringHelper;
+#define F(string_literal) ((const __FlashStringHelper*)(string_literal))
+
+class Print
+{
+  public:
+
+    virtual size_t write (uint8_t b) = 0;
+    virtual size_t write (const uint8_t *buffer, size_t size);
+    size_t write (const char *str) { return write ((const uint8_t*)str, strlen (str)); }
+
+    size_t print (const char *str) { return write (str); }
+    size_t print (const __FlashStringHelper *str) { return write ((const char*)str); }
+    size_t print (char c) { return write ((uint8_t)c); }
+    size_t print (uint8_t n, int base = DEC) { return printUnsigned (n, base); }
+    size_t print (int n, int base = DEC) { return printSigned (n, base); }
+    size_t print (unsigned int n, int base = DEC) { return printUnsigned (n, base); }
+    size_t print (long n, int base = DEC) { return printSigned (n, base); }
+    size_t print (unsigned long n, int base = DEC) { return printUnsigned (n, base); }
+    size_t print (long long n, int base = DEC) { return printSigned (n, base); }
+    size_t print (unsigned long long n, int base = DEC) { return printUnsigned (n, base); }
+    size_t print (double n, int digits = 2);
+
+    size_t println() { return write ((const uint8_t*)"\r\n", 2); }
+    template <typename T> size_t println (T value) { return print (value) + println(); }
+    template <typename T> size_t println (T value, int format) { return print (value, format) + println(); }
+
+  private:
+
+    size_t printSigned (long long n, int base);
+    size_t printUnsigned (unsigned long long n, int base);
+};
+
+class Stream : public Print
+{
+  public:
+
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+//=========================================================================
+//USB serial - output is captured (and optionally echoed to stdout), and input is fed in with hostSerialInput()
+
+class usb_serial_class : public Stream
+{
+  public:
+
+    void begin (long baud) {}
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write (uint8_t b) override;
+    size_t write (const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    int availableForWrite();
+    void send_now() {}
+    operator bool() { return true; }
+};
+
+extern usb_serial_class Serial;
+
+//=========================================================================
+//USB MIDI - sent packets are captured, and received packets are fed in with hostMidiIn()
+
+//the number of virtual cables of the USB type ("Serial + MIDIx4" by default)
+#ifndef MIDI_NUM_CABLES
+#define MIDI_NUM_CABLES 4
+#endif
+
+//the longest SysEx message that can be received, as on the Teensy
+#define USB_MIDI_SYSEX_MAX 290
+
+void usb_midi_write_packed (uint32_t n);
+
+class usb_midi_class
+{
+  public:
+
+    enum MidiTypes
+    {
+      InvalidType = 0x00,
+      NoteOff = 0x80,
+      NoteOn = 0x90,
+      AfterTouchPoly = 0xA0,
+      ControlChange = 0xB0,
+      ProgramChange = 0xC0,
+      AfterTouchChannel = 0xD0,
+      PitchBend = 0xE0,
+      SystemExclusive = 0xF0,
+      Clock = 0xF8,
+      Start = 0xFA,
+      Continue = 0xFB,
+      Stop = 0xFC
+    };
+
+    bool read (uint8_t channel = 0);
+    void send_now() {}
+
+    void sendNoteOff (uint8_t note, uint8_t velocity, uint8_t channel, uint8_t cable = 0) { sendChannelMessage (NoteOff, channel, note, velocity, cable); }
+    void sendNoteOn (uint8_t note, uint8_t velocity, uint8_t channel, uint8_t cable = 0) { sendChannelMessage (NoteOn, channel, note, velocity, cable); }
+    void sendControlChange (uint8_t control, uint8_t value, uint8_t channel, uint8_t cable = 0) { sendChannelMessage (ControlChange, channel, control, value, cable); }
+    void sendProgramChange (uint8_t program, uint8_t channel, uint8_t cable = 0) { sendChannelMessage (ProgramChange, channel, program, 0, cable); }
+    void sendAfterTouch (uint8_t pressure, uint8_t channel, uint8_t cable = 0) { sendChannelMessage (AfterTouchChannel, channel, pressure, 0, cable); }
+
+    //value is -8192 to 8191
+    void sendPitchBend (int value, uint8_t channel, uint8_t cable = 0)
+    {
+      value += 8192;
+      sendChannelMessage (PitchBend, channel, value & 0x7F, (value >> 7) & 0x7F, cable);
+    }
+
+    uint8_t getType() { return msgType; }
+    uint8_t getCable() { return msgCable; }
+    uint8_t getChannel() { return msgChannel; }
+    uint8_t getData1() { return msgData1; }
+    uint8_t getData2() { return msgData2; }
+
+    void setHandleControlChange (void (*fptr) (uint8_t channel, uint8_t control, uint8_t value)) { handleControlChange = fptr; }
+    void setHandleClock (void (*fptr) (void)) { handleClock = fptr; }
+    void setHandleStart (void (*fptr) (void)) { handleStart = fptr; }
+    void setHandleContinue (void (*fptr) (void)) { handleContinue = fptr; }
+    void setHandleStop (void (*fptr) (void)) { handleStop = fptr; }
+    void setHandleSystemExclusive (void (*fptr) (uint8_t *data, unsigned int size)) { handleSysExComplete = fptr; }
+
+  private:
+
+    void sendChannelMessage (uint8_t type, uint8_t channel, uint8_t data1, uint8_t data2, uint8_t cable)
+    {
+      usb_midi_write_packed ((type >> 4) | ((cable & 0xF) << 4) | ((type | ((channel - 1) & 0xF)) << 8) |
+                             ((uint32_t)(data1 & 0x7F) << 16) | ((uint32_t)(data2 & 0x7F) << 24));
+    }
+
+    uint8_t msgType = InvalidType;
+    uint8_t msgCable = 0;
+    uint8_t msgChannel = 0;
+    uint8_t msgData1 = 0;
+    uint8_t msgData2 = 0;
+
+    uint8_t sysExData[USB_MIDI_SYSEX_MAX];
+    uint16_t sysExLength = 0;
+
+    void addSysExByte (uint8_t b);
+
+    void (*handleControlChange) (uint8_t channel, uint8_t control, uint8_t value) = NULL;
+    void (*handleClock) (void) = NULL;
+    void (*handleStart) (void) = NULL;
+    void (*handleContinue) (void) = NULL;
+    void (*handleStop) (void) = NULL;
+    void (*handleSysExComplete) (uint8_t *data, unsigned int size) = NULL;
+};
+
+extern usb_midi_class usbMIDI;
+
+#include "IntervalTimer.h"
+
+#endif //Arduino_h
@@ -0,0 +1,23 @@
+#include "Bounce.h"
+
+Bounce::Bounce (uint8_t pin, unsigned long interval_millis)
+{
+  this->interval_millis = interval_millis;
+  this->pin = pin;
+  previous_millis = millis();
+  state = digitalRead (pin);
+}
+
+int Bounce::update()
+{
+  uint8_t newState = digitalRead (pin);
+
+  if (state != newState && millis() - previous_millis >= interval_millis)
+  {
+    previous_millis = millis();
+    state = newState;
+    return stateChanged = 1;
+  }
+
+  return stateChanged = 0;
+}
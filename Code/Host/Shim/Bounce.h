@@ -0,0 +1,35 @@
+/*
+  Bounce.h - The Teensy Bounce (version 1) switch debouncer, reading the simulated pins of a host build.
+*/
+
+#ifndef Bounce_h
+#define Bounce_h
+
+#include "Arduino.h"
+
+class Bounce
+{
+  public:
+
+    /** Debounces a pin, ignoring any change of state within interval_millis of the last one
+    */
+    Bounce (uint8_t pin, unsigned long interval_millis);
+
+    /** Reads the pin, returning true if its debounced state has changed
+    */
+    int update();
+
+    int read() { return state; }
+    bool risingEdge() { return stateChanged && state; }
+    bool fallingEdge() { return stateChanged && !state; }
+
+  private:
+
+    unsigned long previous_millis;
+    unsigned long interval_millis;
+    uint8_t state;
+    uint8_t pin;
+    uint8_t stateChanged = 0;
+};
+
+#endif //Bounce_h
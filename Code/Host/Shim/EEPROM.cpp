@@ -0,0 +1,51 @@
+#include "HostShim.h"
+
+EEPROMClass EEPROM;
+
+uint8_t hostEepromData[HOST_EEPROM_SIZE];
+uint32_t hostEepromWriteCounts[HOST_EEPROM_SIZE] = {0};
+uint32_t hostEepromWriteMicros = 0;
+int32_t hostEepromWritesBeforePowerCut = -1;
+
+//EEPROM that has never been written reads as erased
+static bool hostEepromErased = []
+{
+  memset (hostEepromData, 0xFF, sizeof (hostEepromData));
+  return true;
+}();
+
+uint8_t eeprom_read_byte (const uint8_t *addr)
+{
+  uint32_t offset = (uintptr_t)addr;
+
+  return (offset < HOST_EEPROM_SIZE) ? hostEepromData[offset] : 0;
+}
+
+void eeprom_write_byte (uint8_t *addr, uint8_t value)
+{
+  uint32_t offset = (uintptr_t)addr;
+
+  if (offset >= HOST_EEPROM_SIZE || hostEepromData[offset] == value || hostEepromWritesBeforePowerCut == 0)
+    return;
+
+  if (hostEepromWritesBeforePowerCut > 0)
+    hostEepromWritesBeforePowerCut--;
+
+  hostEepromData[offset] = value;
+  hostEepromWriteCounts[offset]++;
+
+  if (hostEepromWriteMicros > 0)
+    hostAdvanceMicros (hostEepromWriteMicros);
+}
+
+void eeprom_read_block (void *buf, const void *addr, uint32_t len)
+{
+  for (uint32_t i = 0; i < len; i++)
+    ((uint8_t*)buf)[i] = eeprom_read_byte ((const uint8_t*)addr + i);
+}
+
+void eeprom_write_block (const void *buf, void *addr, uint32_t len)
+{
+  for (uint32_t i = 0; i < len; i++)
+    eeprom_write_byte ((uint8_t*)addr + i, ((const uint8_t*)buf)[i]);
+}
@@ -0,0 +1,34 @@
+/*
+  EEPROM.h - The Teensy EEPROM API, backed by a byte array in a host build.
+*/
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <stdint.h>
+
+//Teensy 3.6 EEPROM size - 4096 bytes
+#define E2END 0xFFF
+
+uint8_t eeprom_read_byte (const uint8_t *addr);
+void eeprom_write_byte (uint8_t *addr, uint8_t value);
+void eeprom_read_block (void *buf, const void *addr, uint32_t len);
+void eeprom_write_block (const void *buf, void *addr, uint32_t len);
+
+/**
+    As on the Teensy, writing a byte that already holds the value being written is skipped, so
+    write() and update() only differ in name.
+*/
+class EEPROMClass
+{
+  public:
+
+    uint8_t read (int idx) { return eeprom_read_byte ((const uint8_t*)(uintptr_t)idx); }
+    void write (int idx, uint8_t val) { eeprom_write_byte ((uint8_t*)(uintptr_t)idx, val); }
+    void update (int idx, uint8_t val) { eeprom_write_byte ((uint8_t*)(uintptr_t)idx, val); }
+    uint16_t length() { return E2END + 1; }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif //EEPROM_h
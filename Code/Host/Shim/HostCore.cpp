@@ -0,0 +1,533 @@
+#include "HostShim.h"
+#include "IntervalTimer.h"
+#include <chrono>
+#include <deque>
+#include <stdio.h>
+
+void loop();
+
+//=========================================================================
+//Time
+
+static uint64_t hostTime = 0;
+static bool hostInTimer = false;
+
+uint32_t hostLoopPeriodUs = 20;
+
+IntervalTimer *IntervalTimer::runningTimers[IntervalTimer::NUM_OF_TIMERS] = {nullptr};
+
+uint64_t hostGetTime()
+{
+  return hostTime;
+}
+
+uint32_t micros()
+{
+  return (uint32_t)hostTime;
+}
+
+uint32_t millis()
+{
+  return (uint32_t)(hostTime / 1000);
+}
+
+void hostAdvanceMicros (uint32_t us)
+{
+  uint64_t endTime = hostTime + us;
+
+  //a timer function isn't interrupted by another, but anything it does that takes time still moves the clock on
+  if (hostInTimer)
+  {
+    hostTime = endTime;
+    return;
+  }
+
+  while (true)
+  {
+    IntervalTimer *dueTimer = nullptr;
+
+    for (uint8_t i = 0; i < IntervalTimer::NUM_OF_TIMERS; i++)
+    {
+      IntervalTimer *timer = IntervalTimer::runningTimers[i];
+
+      if (timer == nullptr || timer->nextTime > endTime)
+        continue;
+
+      if (dueTimer == nullptr || timer->nextTime < dueTimer->nextTime ||
+          (timer->nextTime == dueTimer->nextTime && timer->nvicPriority < dueTimer->nvicPriority))
+        dueTimer = timer;
+    }
+
+    if (dueTimer == nullptr)
+      break;
+
+    if (dueTimer->nextTime > hostTime)
+      hostTime = dueTimer->nextTime;
+
+    dueTimer->nextTime += dueTimer->period;
+
+    hostInTimer = true;
+    dueTimer->function();
+    hostInTimer = false;
+
+  } //while (true)
+
+  if (endTime > hostTime)
+    hostTime = endTime;
+}
+
+void hostRunLoop (uint32_t us)
+{
+  uint64_t endTime = hostTime + us;
+
+  while (hostTime < endTime)
+  {
+    loop();
+    hostAdvanceMicros (hostLoopPeriodUs);
+  }
+}
+
+void delay (uint32_t msec)
+{
+  while (msec--)
+    hostAdvanceMicros (1000);
+}
+
+void delayMicroseconds (uint32_t usec)
+{
+  hostAdvanceMicros (usec);
+}
+
+bool IntervalTimer::begin (void (*function)(), unsigned int period)
+{
+  if (period == 0)
+    return false;
+
+  if (channel < 0)
+  {
+    for (uint8_t i = 0; i < NUM_OF_TIMERS && channel < 0; i++)
+    {
+      if (runningTimers[i] == nullptr)
+        channel = i;
+    }
+
+    if (channel < 0)
+      return false;
+
+    runningTimers[channel] = this;
+  }
+
+  this->function = function;
+  this->period = period;
+  nextTime = hostTime + period;
+
+  return true;
+}
+
+void IntervalTimer::end()
+{
+  if (channel >= 0)
+  {
+    runningTimers[channel] = nullptr;
+    channel = -1;
+  }
+}
+
+//=========================================================================
+//DWT cycle counter - nanoseconds of host time, or basic blocks run
+
+volatile uint32_t hostArmDemcr = 0;
+volatile uint32_t hostArmDwtCtrl = 0;
+
+bool hostCycleCountIsBlocks = false;
+static uint32_t hostNumOfBlocks = 0;
+
+//called at the start of every basic block of code built with -fsanitize-coverage=trace-pc
+//(the shim itself isn't, so only the firmware's code is counted)
+extern "C" void __sanitizer_cov_trace_pc()
+{
+  hostNumOfBlocks++;
+}
+
+uint32_t hostCycleCount()
+{
+  if (hostCycleCountIsBlocks)
+    return hostNumOfBlocks;
+
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//=========================================================================
+//Pins
+
+volatile uint32_t hostPinInputRegisters[CORE_NUM_TOTAL_PINS];
+static int hostAnalogValues[CORE_NUM_TOTAL_PINS];
+static unsigned int hostAnalogResolution = 10;
+
+struct HostPinInterrupt
+{
+  void (*function)();
+  int mode;
+};
+
+static HostPinInterrupt hostPinInterrupts[CORE_NUM_TOTAL_PINS];
+
+//pins are pulled up, and analog pins read mid range, until set
+static bool hostPinsReset = []
+{
+  for (uint8_t pin = 0; pin < CORE_NUM_TOTAL_PINS; pin++)
+  {
+    hostPinInputRegisters[pin] = HIGH;
+    hostAnalogValues[pin] = -1;
+  }
+
+  return true;
+}();
+
+void pinMode (uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite (uint8_t pin, uint8_t value)
+{
+}
+
+uint8_t digitalRead (uint8_t pin)
+{
+  return (pin < CORE_NUM_TOTAL_PINS) ? (hostPinInputRegisters[pin] & 1) : LOW;
+}
+
+void hostSetPin (uint8_t pin, uint8_t level)
+{
+  if (pin >= CORE_NUM_TOTAL_PINS)
+    return;
+
+  uint8_t prevLevel = hostPinInputRegisters[pin] & 1;
+  hostPinInputRegisters[pin] = level ? HIGH : LOW;
+
+  const HostPinInterrupt &pinInterrupt = hostPinInterrupts[pin];
+
+  if (pinInterrupt.function == nullptr || hostPinInputRegisters[pin] == prevLevel)
+    return;
+
+  if (pinInterrupt.mode == CHANGE || (pinInterrupt.mode == RISING && prevLevel == LOW) ||
+      (pinInterrupt.mode == FALLING && prevLevel == HIGH))
+  {
+    hostInTimer = true;
+    pinInterrupt.function();
+    hostInTimer = false;
+  }
+}
+
+void attachInterrupt (uint8_t pin, void (*function)(), int mode)
+{
+  if (pin < CORE_NUM_TOTAL_PINS)
+    hostPinInterrupts[pin] = {function, mode};
+}
+
+void detachInterrupt (uint8_t pin)
+{
+  if (pin < CORE_NUM_TOTAL_PINS)
+    hostPinInterrupts[pin] = {nullptr, 0};
+}
+
+int analogRead (uint8_t pin)
+{
+  if (pin >= CORE_NUM_TOTAL_PINS)
+    return 0;
+
+  if (hostAnalogValues[pin] < 0)
+    return (1 << hostAnalogResolution) / 2;
+
+  return hostAnalogValues[pin];
+}
+
+void analogReadResolution (unsigned int bits)
+{
+  hostAnalogResolution = constrain (bits, 1U, 16U);
+}
+
+void analogReadAveraging (unsigned int num)
+{
+}
+
+void hostSetAnalog (uint8_t pin, int value)
+{
+  if (pin < CORE_NUM_TOTAL_PINS)
+    hostAnalogValues[pin] = constrain (value, 0, (1 << hostAnalogResolution) - 1);
+}
+
+void hostStepEncoder (uint8_t pinA, uint8_t pinB, int8_t direction)
+{
+  //the pin states in the order counting up, as (B << 1) | A
+  static const uint8_t upSequence[4] = {0, 2, 3, 1};
+
+  uint8_t pinState = (digitalRead (pinB) << 1) | digitalRead (pinA);
+  uint8_t pos = 0;
+
+  while (upSequence[pos] != pinState)
+    pos++;
+
+  pinState = upSequence[(pos + ((direction > 0) ? 1 : 3)) % 4];
+
+  hostSetPin (pinA, pinState & 1);
+  hostSetPin (pinB, pinState >> 1);
+}
+
+void hostTurnEncoder (uint8_t pinA, uint8_t pinB, int16_t numOfSteps, uint32_t stepUs)
+{
+  for (int16_t i = 0; i < abs (numOfSteps); i++)
+  {
+    hostStepEncoder (pinA, pinB, (numOfSteps > 0) ? 1 : -1);
+    hostRunLoop (stepUs);
+  }
+}
+
+//=========================================================================
+//Print
+
+size_t Print::write (const uint8_t *buffer, size_t size)
+{
+  size_t count = 0;
+
+  while (size--)
+    count += write (*buffer++);
+
+  return count;
+}
+
+size_t Print::printUnsigned (unsigned long long n, int base)
+{
+  char digits[65];
+  uint8_t pos = sizeof (digits);
+
+  if (base < 2)
+    base = DEC;
+
+  do
+  {
+    uint8_t digit = n % base;
+    digits[--pos] = (digit < 10) ? ('0' + digit) : ('A' + digit - 10);
+    n /= base;
+  }
+  while (n > 0);
+
+  return write ((const uint8_t*)&digits[pos], sizeof (digits) - pos);
+}
+
+size_t Print::printSigned (long long n, int base)
+{
+  //as on the Teensy, only decimal numbers are printed with a sign, and other bases as 32 bit two's complement
+  if (n >= 0)
+    return printUnsigned (n, base);
+  else if (base == DEC)
+    return write ((uint8_t)'-') + printUnsigned (-(unsigned long long)n, base);
+  else
+    return printUnsigned ((uint32_t)n, base);
+}
+
+size_t Print::print (double n, int digits)
+{
+  char text[64];
+  snprintf (text, sizeof (text), "%.*f", digits, n);
+
+  return write (text);
+}
+
+//=========================================================================
+//USB serial
+
+usb_serial_class Serial;
+
+std::string hostSerialOutput;
+bool hostSerialEcho = false;
+
+static std::deque<uint8_t> hostSerialInputBuffer;
+
+//free space in the Teensy's USB serial transmit buffer when empty (8 packets of 64 bytes), which
+//is always the case here as output is taken straight away
+static const int HOST_SERIAL_TX_BUFFER_SIZE = 512;
+
+int usb_serial_class::available()
+{
+  return hostSerialInputBuffer.size();
+}
+
+int usb_serial_class::read()
+{
+  if (hostSerialInputBuffer.empty())
+    return -1;
+
+  uint8_t c = hostSerialInputBuffer.front();
+  hostSerialInputBuffer.pop_front();
+
+  return c;
+}
+
+int usb_serial_class::peek()
+{
+  return hostSerialInputBuffer.empty() ? -1 : hostSerialInputBuffer.front();
+}
+
+size_t usb_serial_class::write (uint8_t b)
+{
+  return write (&b, 1);
+}
+
+size_t usb_serial_class::write (const uint8_t *buffer, size_t size)
+{
+  hostSerialOutput.append ((const char*)buffer, size);
+
+  if (hostSerialEcho)
+    fwrite (buffer, 1, size, stdout);
+
+  return size;
+}
+
+int usb_serial_class::availableForWrite()
+{
+  return HOST_SERIAL_TX_BUFFER_SIZE;
+}
+
+void hostSerialInput (const char *text)
+{
+  while (*text)
+    hostSerialInputBuffer.push_back (*text++);
+}
+
+//=========================================================================
+//USB MIDI
+
+usb_midi_class usbMIDI;
+
+std::vector<HostMidiPacket> hostMidiOut;
+
+static std::deque<uint32_t> hostMidiInPackets;
+
+void usb_midi_write_packed (uint32_t n)
+{
+  hostMidiOut.push_back ({hostTime, n});
+}
+
+void hostMidiIn (uint32_t packet)
+{
+  hostMidiInPackets.push_back (packet);
+}
+
+void hostMidiInMessage (uint8_t cable, uint8_t status, uint8_t data1, uint8_t data2)
+{
+  //the code index number is the status nibble for channel messages, or 0xF for a single byte system message
+  uint8_t codeIndex = (status < 0xF0) ? (status >> 4) : 0xF;
+
+  hostMidiIn (codeIndex | ((cable & 0xF) << 4) | (status << 8) | ((uint32_t)data1 << 16) | ((uint32_t)data2 << 24));
+}
+
+bool usb_midi_class::read (uint8_t channel)
+{
+  //Reads a single packet, calling its handler (as the Teensy does), and returns
+  //whether it was a message (on the channel, if given)
+  if (hostMidiInPackets.empty())
+    return false;
+
+  uint32_t n = hostMidiInPackets.front();
+  hostMidiInPackets.pop_front();
+
+  uint8_t codeIndex = n & 0xF;
+  uint8_t status = (n >> 8) & 0xFF;
+
+  msgCable = (n >> 4) & 0xF;
+  msgData1 = (n >> 16) & 0x7F;
+  msgData2 = (n >> 24) & 0x7F;
+
+  if (codeIndex >= 0x8 && codeIndex <= 0xE)
+  {
+    msgType = status & 0xF0;
+    msgChannel = (status & 0xF) + 1;
+
+    if (channel != 0 && channel != msgChannel)
+      return false;
+
+    if (msgType == ControlChange && handleControlChange != NULL)
+      handleControlChange (msgChannel, msgData1, msgData2);
+
+    return true;
+  }
+
+  else if (codeIndex == 0x4)
+  {
+    //SysEx start or continue
+    addSysExByte (status);
+    addSysExByte (n >> 16);
+    addSysExByte (n >> 24);
+
+    return false;
+  }
+
+  else if (codeIndex >= 0x5 && codeIndex <= 0x7)
+  {
+    //SysEx end, with 1-3 bytes
+    for (uint8_t i = 0; i < codeIndex - 0x4; i++)
+      addSysExByte (n >> ((i + 1) * 8));
+
+    msgType = SystemExclusive;
+    msgChannel = 0;
+    msgData1 = sysExLength & 0xFF;
+    msgData2 = sysExLength >> 8;
+
+    if (handleSysExComplete != NULL)
+      handleSysExComplete (sysExData, sysExLength);
+
+    sysExLength = 0;
+
+    return true;
+  }
+
+  else if (codeIndex == 0xF && status >= 0xF8)
+  {
+    msgType = status;
+    msgChannel = 0;
+
+    if (status == Clock && handleClock != NULL)
+      handleClock();
+    else if (status == Start && handleStart != NULL)
+      handleStart();
+    else if (status == Continue && handleContinue != NULL)
+      handleContinue();
+    else if (status == Stop && handleStop != NULL)
+      handleStop();
+
+    return true;
+  }
+
+  return false;
+}
+
+void usb_midi_class::addSysExByte (uint8_t b)
+{
+  //as on the Teensy, anything past USB_MIDI_SYSEX_MAX is dropped
+  if (sysExLength < USB_MIDI_SYSEX_MAX)
+    sysExData[sysExLength++] = b;
+}
+
+void hostMidiInSysEx (uint8_t cable, const uint8_t *data, uint16_t length)
+{
+  for (uint16_t pos = 0; pos < length; pos += 3)
+  {
+    uint8_t numOfBytes = min (length - pos, 3);
+    uint32_t packet = ((pos + 3 < length) ? 0x4 : (0x4 + numOfBytes)) | ((cable & 0xF) << 4);
+
+    for (uint8_t i = 0; i < numOfBytes; i++)
+      packet |= (uint32_t)data[pos + i] << ((i + 1) * 8);
+
+    hostMidiIn (packet);
+  }
+}
+
+//=========================================================================
+//Linker symbols read by the RAM stats. The top of the heap is put above everything else, so that
+//memoryPaintStack() finds no free RAM to paint (the host's stack isn't the firmware's to paint).
+
+unsigned long _sdata;
+unsigned long _ebss;
+unsigned long _estack;
+char *__brkval = (char*)(UINTPTR_MAX - 0xFFFF);
@@ -0,0 +1,124 @@
+/*
+  HostShim.h - Control of the simulated Teensy hardware that the controller firmware runs on in a host build.
+*/
+
+#ifndef HostShim_h
+#define HostShim_h
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include <string>
+#include <vector>
+
+//=========================================================================
+//Time.
+//
+//Everything runs on a simulated clock which only moves on when told to - the firmware's code itself takes no
+//time at all - so a run is exactly repeatable. The IntervalTimer functions are run as the clock passes each of
+//their due times, and loop() is run by hostRunLoop().
+
+/** Moves the clock on, running the IntervalTimer functions that fall due on the way, in time order
+    (and highest priority first when due at the same time)
+*/
+void hostAdvanceMicros (uint32_t us);
+
+/** Runs loop() over and over for a length of time, moving the clock on by hostLoopPeriodUs after each run
+*/
+void hostRunLoop (uint32_t us);
+
+/** The time each loop() is taken to run for by hostRunLoop()
+*/
+extern uint32_t hostLoopPeriodUs;
+
+/** Returns the time since startup in microseconds, which unlike micros() doesn't wrap
+*/
+uint64_t hostGetTime();
+
+/** Whether the DWT cycle counter counts the basic blocks run by code built with -fsanitize-coverage=trace-pc
+    rather than nanoseconds of host time. Unlike the time, the count for a piece of code is the same on every
+    run and every machine, so can be checked against a baseline (see Benchmarks/HostBenchmarks.cpp).
+*/
+extern bool hostCycleCountIsBlocks;
+
+//=========================================================================
+//Inputs
+
+/** Sets the level of a digital pin, running its pin interrupt if the change is one it's attached to.
+    Pins are high until set, as all of the controller's inputs have pullups.
+*/
+void hostSetPin (uint8_t pin, uint8_t level);
+
+/** Sets the value read from an analog pin, at the resolution set by analogReadResolution().
+    Until set, an analog pin reads the middle of the range (a centred joystick).
+*/
+void hostSetAnalog (uint8_t pin, int value);
+
+/** Moves a quadrature encoder's pins on a single step up (direction 1) or down (-1), where counting up
+    is B leading A
+*/
+void hostStepEncoder (uint8_t pinA, uint8_t pinB, int8_t direction);
+
+/** Turns a quadrature encoder a number of steps (negative to turn down), running the loop
+    for stepUs between each step
+*/
+void hostTurnEncoder (uint8_t pinA, uint8_t pinB, int16_t numOfSteps, uint32_t stepUs = 500);
+
+/** Adds text to the USB serial input
+*/
+void hostSerialInput (const char *text);
+
+/** Adds a USB MIDI event packet (in the format of usb_midi_write_packed()) to the USB MIDI input
+*/
+void hostMidiIn (uint32_t packet);
+
+/** Adds a 1-3 byte MIDI message to the USB MIDI input on a cable
+*/
+void hostMidiInMessage (uint8_t cable, uint8_t status, uint8_t data1 = 0, uint8_t data2 = 0);
+
+/** Adds a complete SysEx message (including the 0xF0 and 0xF7) to the USB MIDI input on a cable
+*/
+void hostMidiInSysEx (uint8_t cable, const uint8_t *data, uint16_t length);
+
+//=========================================================================
+//Outputs
+
+/** Everything written to USB serial since startup (or since last cleared)
+*/
+extern std::string hostSerialOutput;
+
+/** Whether USB serial output is also written to stdout
+*/
+extern bool hostSerialEcho;
+
+struct HostMidiPacket
+{
+  uint64_t time; //microseconds since startup
+  uint32_t packet;
+};
+
+/** Every USB MIDI event packet sent since startup (or since last cleared)
+*/
+extern std::vector<HostMidiPacket> hostMidiOut;
+
+//=========================================================================
+//EEPROM
+
+const uint16_t HOST_EEPROM_SIZE = E2END + 1;
+
+extern uint8_t hostEepromData[HOST_EEPROM_SIZE];
+
+/** The number of times each byte has been written (writes that don't change a byte are skipped,
+    as on the Teensy, so aren't counted)
+*/
+extern uint32_t hostEepromWriteCounts[HOST_EEPROM_SIZE];
+
+/** The time taken by each byte written, which moves the clock on (running any timers that fall due)
+*/
+extern uint32_t hostEepromWriteMicros;
+
+/** If not negative, the number of bytes that can be written before the power is cut, after which
+    every write is lost (until it is set back to -1)
+*/
+extern int32_t hostEepromWritesBeforePowerCut;
+
+#endif //HostShim_h
@@ -0,0 +1,343 @@
+#include "ILI9341_t3.h"
+#include "FnvHash.h"
+#include <stdio.h>
+
+//Bytes sent to set the address window (CASET + 4, PASET + 4) followed by RAMWR, before each run of pixels
+static const uint8_t SPI_BYTES_ADDR_WINDOW = 11;
+
+//The library's 5x7 font (glcdfont) for the printable ASCII characters, a byte per column with the top row in bit 0
+static const uint8_t FONT_FIRST_CHAR = ' ';
+static const uint8_t FONT_LAST_CHAR = '~';
+
+static const uint8_t font[(FONT_LAST_CHAR - FONT_FIRST_CHAR + 1) * 5] =
+{
+  0x00, 0x00, 0x00, 0x00, 0x00, // ' '
+  0x00, 0x00, 0x5F, 0x00, 0x00, // !
+  0x00, 0x07, 0x00, 0x07, 0x00, // "
+  0x14, 0x7F, 0x14, 0x7F, 0x14, // #
+  0x24, 0x2A, 0x7F, 0x2A, 0x12, // $
+  0x23, 0x13, 0x08, 0x64, 0x62, // %
+  0x36, 0x49, 0x56, 0x20, 0x50, // &
+  0x00, 0x08, 0x07, 0x03, 0x00, // '
+  0x00, 0x1C, 0x22, 0x41, 0x00, // (
+  0x00, 0x41, 0x22, 0x1C, 0x00, // )
+  0x2A, 0x1C, 0x7F, 0x1C, 0x2A, // *
+  0x08, 0x08, 0x3E, 0x08, 0x08, // +
+  0x00, 0x80, 0x70, 0x30, 0x00, // ,
+  0x08, 0x08, 0x08, 0x08, 0x08, // -
+  0x00, 0x00, 0x60, 0x60, 0x00, // .
+  0x20, 0x10, 0x08, 0x04, 0x02, // /
+  0x3E, 0x51, 0x49, 0x45, 0x3E, // 0
+  0x00, 0x42, 0x7F, 0x40, 0x00, // 1
+  0x72, 0x49, 0x49, 0x49, 0x46, // 2
+  0x21, 0x41, 0x49, 0x4D, 0x33, // 3
+  0x18, 0x14, 0x12, 0x7F, 0x10, // 4
+  0x27, 0x45, 0x45, 0x45, 0x39, // 5
+  0x3C, 0x4A, 0x49, 0x49, 0x31, // 6
+  0x41, 0x21, 0x11, 0x09, 0x07, // 7
+  0x36, 0x49, 0x49, 0x49, 0x36, // 8
+  0x46, 0x49, 0x49, 0x29, 0x1E, // 9
+  0x00, 0x00, 0x14, 0x00, 0x00, // :
+  0x00, 0x40, 0x34, 0x00, 0x00, // ;
+  0x00, 0x08, 0x14, 0x22, 0x41, // <
+  0x14, 0x14, 0x14, 0x14, 0x14, // =
+  0x00, 0x41, 0x22, 0x14, 0x08, // >
+  0x02, 0x01, 0x59, 0x09, 0x06, // ?
+  0x3E, 0x41, 0x5D, 0x59, 0x4E, // @
+  0x7C, 0x12, 0x11, 0x12, 0x7C, // A
+  0x7F, 0x49, 0x49, 0x49, 0x36, // B
+  0x3E, 0x41, 0x41, 0x41, 0x22, // C
+  0x7F, 0x41, 0x41, 0x41, 0x3E, // D
+  0x7F, 0x49, 0x49, 0x49, 0x41, // E
+  0x7F, 0x09, 0x09, 0x09, 0x01, // F
+  0x3E, 0x41, 0x41, 0x51, 0x73, // G
+  0x7F, 0x08, 0x08, 0x08, 0x7F, // H
+  0x00, 0x41, 0x7F, 0x41, 0x00, // I
+  0x20, 0x40, 0x41, 0x3F, 0x01, // J
+  0x7F, 0x08, 0x14, 0x22, 0x41, // K
+  0x7F, 0x40, 0x40, 0x40, 0x40, // L
+  0x7F, 0x02, 0x1C, 0x02, 0x7F, // M
+  0x7F, 0x04, 0x08, 0x10, 0x7F, // N
+  0x3E, 0x41, 0x41, 0x41, 0x3E, // O
+  0x7F, 0x09, 0x09, 0x09, 0x06, // P
+  0x3E, 0x41, 0x51, 0x21, 0x5E, // Q
+  0x7F, 0x09, 0x19, 0x29, 0x46, // R
+  0x26, 0x49, 0x49, 0x49, 0x32, // S
+  0x03, 0x01, 0x7F, 0x01, 0x03, // T
+  0x3F, 0x40, 0x40, 0x40, 0x3F, // U
+  0x1F, 0x20, 0x40, 0x20, 0x1F, // V
+  0x3F, 0x40, 0x38, 0x40, 0x3F, // W
+  0x63, 0x14, 0x08, 0x14, 0x63, // X
+  0x03, 0x04, 0x78, 0x04, 0x03, // Y
+  0x61, 0x59, 0x49, 0x4D, 0x43, // Z
+  0x00, 0x7F, 0x41, 0x41, 0x41, // [
+  0x02, 0x04, 0x08, 0x10, 0x20, // backslash
+  0x00, 0x41, 0x41, 0x41, 0x7F, // ]
+  0x04, 0x02, 0x01, 0x02, 0x04, // ^
+  0x40, 0x40, 0x40, 0x40, 0x40, // _
+  0x00, 0x03, 0x07, 0x08, 0x00, // `
+  0x20, 0x54, 0x54, 0x78, 0x40, // a
+  0x7F, 0x28, 0x44, 0x44, 0x38, // b
+  0x38, 0x44, 0x44, 0x44, 0x28, // c
+  0x38, 0x44, 0x44, 0x28, 0x7F, // d
+  0x38, 0x54, 0x54, 0x54, 0x18, // e
+  0x00, 0x08, 0x7E, 0x09, 0x02, // f
+  0x18, 0xA4, 0xA4, 0x9C, 0x78, // g
+  0x7F, 0x08, 0x04, 0x04, 0x78, // h
+  0x00, 0x44, 0x7D, 0x40, 0x00, // i
+  0x20, 0x40, 0x40, 0x3D, 0x00, // j
+  0x7F, 0x10, 0x28, 0x44, 0x00, // k
+  0x00, 0x41, 0x7F, 0x40, 0x00, // l
+  0x7C, 0x04, 0x78, 0x04, 0x78, // m
+  0x7C, 0x08, 0x04, 0x04, 0x78, // n
+  0x38, 0x44, 0x44, 0x44, 0x38, // o
+  0xFC, 0x18, 0x24, 0x24, 0x18, // p
+  0x18, 0x24, 0x24, 0x18, 0xFC, // q
+  0x7C, 0x08, 0x04, 0x04, 0x08, // r
+  0x48, 0x54, 0x54, 0x54, 0x24, // s
+  0x04, 0x04, 0x3F, 0x44, 0x24, // t
+  0x3C, 0x40, 0x40, 0x20, 0x7C, // u
+  0x1C, 0x20, 0x40, 0x20, 0x1C, // v
+  0x3C, 0x40, 0x30, 0x40, 0x3C, // w
+  0x44, 0x28, 0x10, 0x28, 0x44, // x
+  0x4C, 0x90, 0x90, 0x90, 0x7C, // y
+  0x44, 0x64, 0x54, 0x4C, 0x44, // z
+  0x00, 0x08, 0x36, 0x41, 0x00, // {
+  0x00, 0x00, 0x77, 0x00, 0x00, // |
+  0x00, 0x41, 0x36, 0x08, 0x00, // }
+  0x02, 0x01, 0x02, 0x04, 0x02  // ~
+};
+
+//The display's memory, and what has been sent to it
+static uint16_t hostFramebuffer[ILI9341_TFTHEIGHT][ILI9341_TFTWIDTH];
+static uint32_t hostNumOfPixels = 0;
+static uint32_t hostNumOfSpiBytes = 0;
+
+ILI9341_t3::ILI9341_t3 (uint8_t _CS, uint8_t _DC, uint8_t _RST, uint8_t _MOSI, uint8_t _SCLK, uint8_t _MISO)
+{
+}
+
+void ILI9341_t3::begin()
+{
+}
+
+void ILI9341_t3::setRotation (uint8_t r)
+{
+  rotation = r % 4;
+
+  if (rotation % 2)
+  {
+    _width = ILI9341_TFTHEIGHT;
+    _height = ILI9341_TFTWIDTH;
+  }
+  else
+  {
+    _width = ILI9341_TFTWIDTH;
+    _height = ILI9341_TFTHEIGHT;
+  }
+}
+
+void ILI9341_t3::fillScreen (uint16_t color)
+{
+  fillRect (0, 0, _width, _height, color);
+}
+
+void ILI9341_t3::fillRect (int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  //clipped as the library does, which sends the rect as a single window
+  if (x >= _width || y >= _height)
+    return;
+  if ((x + w - 1) >= _width)
+    w = _width - x;
+  if ((y + h - 1) >= _height)
+    h = _height - y;
+  if (w <= 0 || h <= 0)
+    return;
+
+  hostFillRect (x, y, w, h, color);
+
+  hostNumOfPixels += (uint32_t)w * h;
+  hostNumOfSpiBytes += SPI_BYTES_ADDR_WINDOW + ((uint32_t)w * h * 2);
+}
+
+void ILI9341_t3::setCursor (int16_t x, int16_t y)
+{
+  cursor_x = x;
+  cursor_y = y;
+}
+
+void ILI9341_t3::setTextColor (uint16_t c)
+{
+  //the same text and background colour draws text transparently
+  textcolor = c;
+  textbgcolor = c;
+}
+
+void ILI9341_t3::setTextColor (uint16_t c, uint16_t bg)
+{
+  textcolor = c;
+  textbgcolor = bg;
+}
+
+void ILI9341_t3::setTextSize (uint8_t s)
+{
+  textsize = (s > 0) ? s : 1;
+}
+
+size_t ILI9341_t3::write (uint8_t c)
+{
+  if (c == '\n')
+  {
+    cursor_y += textsize * 8;
+    cursor_x = 0;
+  }
+  else if (c != '\r')
+  {
+    hostDrawChar (cursor_x, cursor_y, c, textcolor, textbgcolor, textsize);
+
+    cursor_x += textsize * 6;
+
+    if (wrap && (cursor_x > (_width - textsize * 6)))
+    {
+      cursor_y += textsize * 8;
+      cursor_x = 0;
+    }
+  }
+
+  return 1;
+}
+
+//=========================================================================
+//Host build only
+
+void ILI9341_t3::hostSetPixel (int16_t x, int16_t y, uint16_t color)
+{
+  if (x < 0 || y < 0 || x >= _width || y >= _height)
+    return;
+
+  //from the rotation's coordinates to the display memory's
+  switch (rotation)
+  {
+    case 0: hostFramebuffer[y][x] = color; break;
+    case 1: hostFramebuffer[x][ILI9341_TFTWIDTH - 1 - y] = color; break;
+    case 2: hostFramebuffer[ILI9341_TFTHEIGHT - 1 - y][ILI9341_TFTWIDTH - 1 - x] = color; break;
+    default: hostFramebuffer[ILI9341_TFTHEIGHT - 1 - x][y] = color; break;
+  }
+}
+
+uint16_t ILI9341_t3::hostGetPixel (int16_t x, int16_t y)
+{
+  if (x < 0 || y < 0 || x >= _width || y >= _height)
+    return 0;
+
+  switch (rotation)
+  {
+    case 0: return hostFramebuffer[y][x];
+    case 1: return hostFramebuffer[x][ILI9341_TFTWIDTH - 1 - y];
+    case 2: return hostFramebuffer[ILI9341_TFTHEIGHT - 1 - y][ILI9341_TFTWIDTH - 1 - x];
+    default: return hostFramebuffer[ILI9341_TFTHEIGHT - 1 - x][y];
+  }
+}
+
+void ILI9341_t3::hostFillRect (int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  for (int16_t row = y; row < y + h; row++)
+  {
+    for (int16_t col = x; col < x + w; col++)
+      hostSetPixel (col, row, color);
+  }
+}
+
+void ILI9341_t3::hostDrawChar (int16_t x, int16_t y, uint8_t c, uint16_t color, uint16_t bg, uint8_t size)
+{
+  if (x >= _width || y >= _height || (x + (6 * size) - 1) < 0 || (y + (8 * size) - 1) < 0)
+    return;
+
+  const uint8_t *glyph = (c >= FONT_FIRST_CHAR && c <= FONT_LAST_CHAR) ? &font[(c - FONT_FIRST_CHAR) * 5] : nullptr;
+
+  //An opaque character is sent as a single window of its 6x8 cell (including the gap to the next character),
+  //whereas a transparent one is sent a set cell at a time
+  if (color != bg)
+  {
+    hostNumOfPixels += 6 * 8 * size * size;
+    hostNumOfSpiBytes += SPI_BYTES_ADDR_WINDOW + (6 * 8 * size * size * 2);
+  }
+
+  for (uint8_t col = 0; col < 6; col++)
+  {
+    uint8_t bits = (glyph != nullptr && col < 5) ? glyph[col] : 0;
+
+    for (uint8_t row = 0; row < 8; row++)
+    {
+      bool isSet = bits & (1 << row);
+
+      if (isSet || color != bg)
+        hostFillRect (x + (col * size), y + (row * size), size, size, isSet ? color : bg);
+
+      if (isSet && color == bg)
+      {
+        hostNumOfPixels += size * size;
+        hostNumOfSpiBytes += SPI_BYTES_ADDR_WINDOW + (size * size * 2);
+      }
+    }
+  }
+}
+
+uint32_t ILI9341_t3::hostGetFrameHash()
+{
+  uint32_t hash = FNV_HASH_INIT;
+
+  for (int16_t y = 0; y < _height; y++)
+  {
+    for (int16_t x = 0; x < _width; x++)
+    {
+      uint16_t pixel = hostGetPixel (x, y);
+      hash = fnvHash (hash, &pixel, sizeof (pixel));
+    }
+  }
+
+  return hash;
+}
+
+bool ILI9341_t3::hostWritePpm (const char *fileName)
+{
+  FILE *file = fopen (fileName, "wb");
+
+  if (file == nullptr)
+    return false;
+
+  fprintf (file, "P6\n%d %d\n255\n", _width, _height);
+
+  for (int16_t y = 0; y < _height; y++)
+  {
+    for (int16_t x = 0; x < _width; x++)
+    {
+      //RGB565 to 8 bits per colour, repeating the top bits into the bottom ones
+      uint16_t pixel = hostGetPixel (x, y);
+      uint8_t r = (pixel >> 11) & 0x1F;
+      uint8_t g = (pixel >> 5) & 0x3F;
+      uint8_t b = pixel & 0x1F;
+      uint8_t rgb[3] = {(uint8_t)((r << 3) | (r >> 2)), (uint8_t)((g << 2) | (g >> 4)), (uint8_t)((b << 3) | (b >> 2))};
+
+      fwrite (rgb, 1, 3, file);
+    }
+  }
+
+  return fclose (file) == 0;
+}
+
+uint32_t ILI9341_t3::hostGetNumOfPixels()
+{
+  return hostNumOfPixels;
+}
+
+uint32_t ILI9341_t3::hostGetNumOfSpiBytes()
+{
+  return hostNumOfSpiBytes;
+}
+
+void ILI9341_t3::hostResetCounts()
+{
+  hostNumOfPixels = 0;
+  hostNumOfSpiBytes = 0;
+}
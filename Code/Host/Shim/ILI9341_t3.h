@@ -0,0 +1,106 @@
+/*
+  ILI9341_t3.h - The parts of the ILI9341_t3 display library API that the controller firmware uses,
+  for a host build.
+*/
+
+#ifndef ILI9341_t3_h
+#define ILI9341_t3_h
+
+#include "Arduino.h"
+
+#define ILI9341_TFTWIDTH 240
+#define ILI9341_TFTHEIGHT 320
+
+#define ILI9341_BLACK 0x0000
+#define ILI9341_NAVY 0x000F
+#define ILI9341_DARKGREEN 0x03E0
+#define ILI9341_DARKCYAN 0x03EF
+#define ILI9341_MAROON 0x7800
+#define ILI9341_PURPLE 0x780F
+#define ILI9341_OLIVE 0x7BE0
+#define ILI9341_LIGHTGREY 0xC618
+#define ILI9341_DARKGREY 0x7BEF
+#define ILI9341_BLUE 0x001F
+#define ILI9341_GREEN 0x07E0
+#define ILI9341_CYAN 0x07FF
+#define ILI9341_RED 0xF800
+#define ILI9341_MAGENTA 0xF81F
+#define ILI9341_YELLOW 0xFFE0
+#define ILI9341_WHITE 0xFFFF
+#define ILI9341_ORANGE 0xFD20
+#define ILI9341_GREENYELLOW 0xAFE5
+#define ILI9341_PINK 0xF81F
+
+/**
+    Draws into an RGB565 framebuffer of the display's memory, as the library would draw to the display, with
+    text in the library's 5x7 font (printable ASCII only - other characters are drawn as blank cells).
+    The pixels and SPI bytes that the library would send to the display for the drawing are counted.
+    There is only the one display, so the framebuffer is kept outside of the class, which stays the size it was.
+*/
+class ILI9341_t3 : public Print
+{
+  public:
+
+    ILI9341_t3 (uint8_t _CS, uint8_t _DC, uint8_t _RST = 255, uint8_t _MOSI = 11, uint8_t _SCLK = 13, uint8_t _MISO = 12);
+
+    void begin();
+    void setRotation (uint8_t r);
+    void fillScreen (uint16_t color);
+    void fillRect (int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
+    void setCursor (int16_t x, int16_t y);
+    void setTextColor (uint16_t c);
+    void setTextColor (uint16_t c, uint16_t bg);
+    void setTextSize (uint8_t s);
+    void setTextWrap (boolean w) { wrap = w; }
+
+    int16_t width() { return _width; }
+    int16_t height() { return _height; }
+    uint8_t getRotation() { return rotation; }
+
+    virtual size_t write (uint8_t c);
+    using Print::write;
+
+    //=========================================================================
+    //Host build only
+
+    /** Returns a pixel as seen at the current rotation
+    */
+    uint16_t hostGetPixel (int16_t x, int16_t y);
+
+    /** Returns an FNV-1a hash of the whole display as seen at the current rotation, which can be kept
+        as a golden reference for what should be displayed
+    */
+    uint32_t hostGetFrameHash();
+
+    /** Writes the display as seen at the current rotation to a PPM image file, returning whether it was written
+    */
+    bool hostWritePpm (const char *fileName);
+
+    /** The pixels and SPI bytes sent for drawing (not including begin() and setRotation()) since the last reset
+    */
+    uint32_t hostGetNumOfPixels();
+    uint32_t hostGetNumOfSpiBytes();
+    void hostResetCounts();
+
+  protected:
+
+    int16_t _width = ILI9341_TFTWIDTH;
+    int16_t _height = ILI9341_TFTHEIGHT;
+    int16_t cursor_x = 0;
+    int16_t cursor_y = 0;
+    uint16_t textcolor = 0xFFFF;
+    uint16_t textbgcolor = 0xFFFF;
+    uint8_t textsize = 1;
+    uint8_t rotation = 0;
+    boolean wrap = true;
+
+  private:
+
+    void hostSetPixel (int16_t x, int16_t y, uint16_t color);
+    void hostFillRect (int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void hostDrawChar (int16_t x, int16_t y, uint8_t c, uint16_t color, uint16_t bg, uint8_t size);
+
+};
+
+#endif //ILI9341_t3_h
@@ -0,0 +1,50 @@
+/*
+  IntervalTimer.h - Periodic timer interrupts run from the simulated clock of a host build.
+*/
+
+#ifndef IntervalTimer_h
+#define IntervalTimer_h
+
+#include <stdint.h>
+
+/**
+    The Teensy IntervalTimer API, with the timer functions run by hostAdvanceMicros() as the simulated clock
+    passes each of their due times. There are 4 timers, as on the Teensy 3.6 (its 4 PIT channels).
+
+    As the firmware's code takes no time on the simulated clock, a timer function can only run between calls
+    into the firmware (or within a call that moves the clock on, such as delay() or an EEPROM write), and never
+    interrupts another timer function.
+*/
+class IntervalTimer
+{
+    //=====================================================
+  public:
+
+    IntervalTimer() {}
+    ~IntervalTimer() { end(); }
+
+    /** Starts calling a function every period microseconds, returning false if all of the timers are in use
+    */
+    bool begin (void (*function)(), unsigned int period);
+    void end();
+
+    /** Sets the priority, 0 (highest) to 255. Timers that are due at the same time are run highest priority first.
+    */
+    void priority (uint8_t n) { nvicPriority = n; }
+
+    //=====================================================
+  private:
+
+    friend void hostAdvanceMicros (uint32_t us);
+
+    static const uint8_t NUM_OF_TIMERS = 4;
+    static IntervalTimer *runningTimers[NUM_OF_TIMERS];
+
+    void (*function)() = nullptr;
+    uint32_t period = 0;
+    uint64_t nextTime = 0;
+    uint8_t nvicPriority = 128;
+    int8_t channel = -1;
+};
+
+#endif //IntervalTimer_h
@@ -0,0 +1,235 @@
+//=========================================================================
+//Tests the settings journal's EEPROM writer (see settingsJournalWriteStep() in SettingsJournal.h):
+//- The power is cut after every byte written by a compaction of a full bank, and by a delta save. Reloading
+//  must give either the settings from before the save or the settings from after it, never anything else.
+//- With each EEPROM byte write taking 3ms, as on the Teensy, the longest a write step stalls the main loop
+//  for is printed, along with the time the same compaction takes when written in one go.
+
+#include "Arduino.h"
+#include "TurnadoController.ino"
+#include "HostShim.h"
+#include "HostTest.h"
+
+const uint32_t EEPROM_WRITE_MICROS = 3000;
+
+//=========================================================================
+struct SavedSettings
+{
+  uint8_t values[SETTINGS_NUM_OF_PARAMS];
+  uint8_t numOfPresets;
+  uint16_t presetsLength;
+  uint8_t presets[PRESETS_STORE_SIZE];
+};
+
+//=========================================================================
+SavedSettings getSettings()
+{
+  SavedSettings settings;
+
+  memcpy (settings.values, settingsValues, SETTINGS_NUM_OF_PARAMS);
+  settings.numOfPresets = presetsNumOfPresets;
+  settings.presetsLength = presetsStoreLength;
+  memcpy (settings.presets, presetsStore, sizeof (settings.presets));
+
+  return settings;
+}
+
+//=========================================================================
+bool settingsMatch (const SavedSettings &settings)
+{
+  return (memcmp (settings.values, settingsValues, SETTINGS_NUM_OF_PARAMS) == 0 &&
+          settings.numOfPresets == presetsNumOfPresets &&
+          settings.presetsLength == presetsStoreLength &&
+          memcmp (settings.presets, presetsStore, settings.presetsLength) == 0);
+}
+
+//=========================================================================
+uint32_t writeToEeprom()
+{
+  //Runs the journal writer a step at a time until all queued writing is done, as settingsUpdateEeprom() does,
+  //returning the number of steps
+  uint32_t numOfSteps = 0;
+
+  while (settingsJournalWriteStep (true))
+    numOfSteps++;
+
+  return numOfSteps;
+}
+
+//=========================================================================
+void reloadSettings()
+{
+  //as at boot
+  journalWriterState = JOURNAL_WRITER_IDLE;
+  journalCompactionRequested = false;
+  presetsNumOfPresets = 0;
+  presetsActivePreset = PRESET_NONE;
+
+  settingsLoadDefaults();
+  joystickCalibrationLoadDefaults();
+  settingsLoadAllFromEeprom();
+}
+
+//=========================================================================
+uint32_t getNumOfEepromWrites()
+{
+  uint32_t numOfWrites = 0;
+
+  for (uint16_t i = 0; i < HOST_EEPROM_SIZE; i++)
+    numOfWrites += hostEepromWriteCounts[i];
+
+  return numOfWrites;
+}
+
+//=========================================================================
+void fillJournal()
+{
+  //Appends records until both banks have had their journals filled, so that a compaction has to erase
+  //a full journal and leaves the active bank full
+  uint16_t startNumOfCompactions = journalNumOfCompactions;
+
+  while (journalNumOfCompactions == startNumOfCompactions || journalWritePos + JOURNAL_RECORD_SIZE <= JOURNAL_BANK_SIZE)
+  {
+    uint8_t channel = settingsGetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN);
+    settingsSetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN, (channel % 16) + 1);
+
+    settingsSaveToEeprom (true);
+    writeToEeprom();
+  }
+}
+
+//=========================================================================
+void testPowerCuts (const char *name, void (*changeSettings)())
+{
+  //Makes the change to the settings saved in EEPROM, cutting the power after each byte written in turn
+  std::vector<uint8_t> eepromData (hostEepromData, hostEepromData + HOST_EEPROM_SIZE);
+
+  reloadSettings();
+  SavedSettings oldSettings = getSettings();
+
+  changeSettings();
+  SavedSettings newSettings = getSettings();
+
+  uint32_t startNumOfWrites = getNumOfEepromWrites();
+  writeToEeprom();
+  uint32_t numOfWrites = getNumOfEepromWrites() - startNumOfWrites;
+
+  uint32_t numOfOldSettings = 0;
+  uint32_t numOfNewSettings = 0;
+
+  for (uint32_t numOfWritesBeforeCut = 0; numOfWritesBeforeCut < numOfWrites; numOfWritesBeforeCut++)
+  {
+    std::copy (eepromData.begin(), eepromData.end(), hostEepromData);
+
+    reloadSettings();
+    changeSettings();
+
+    hostEepromWritesBeforePowerCut = numOfWritesBeforeCut;
+    writeToEeprom();
+    hostEepromWritesBeforePowerCut = -1;
+
+    reloadSettings();
+
+    if (settingsMatch (oldSettings))
+    {
+      numOfOldSettings++;
+    }
+    else if (settingsMatch (newSettings))
+    {
+      numOfNewSettings++;
+    }
+    else
+    {
+      printf ("%s: power cut after %u of %u bytes written gave neither the old nor the new settings\n",
+              name, numOfWritesBeforeCut, numOfWrites);
+      HOST_CHECK (false);
+    }
+
+  } //for (uint32_t numOfWritesBeforeCut = 0; numOfWritesBeforeCut < numOfWrites; numOfWritesBeforeCut++)
+
+  printf ("%-20s power cut after each of %4u bytes written: %4u reloaded the old settings, %4u the new settings\n",
+          name, numOfWrites, numOfOldSettings, numOfNewSettings);
+
+  HOST_CHECK (numOfOldSettings > 0);
+
+  //and with the power left on
+  std::copy (eepromData.begin(), eepromData.end(), hostEepromData);
+
+  reloadSettings();
+  changeSettings();
+  writeToEeprom();
+  reloadSettings();
+
+  HOST_CHECK (settingsMatch (newSettings));
+}
+
+//=========================================================================
+void savePreset()
+{
+  settingsSetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN, 12);
+  settingsSetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM, 90);
+
+  HOST_CHECK (presetsSaveCurrentSettings());
+}
+
+//=========================================================================
+void saveDelta()
+{
+  //(a single param, as the records of a delta save of several params are each written on their own)
+  settingsSetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM, 91);
+  settingsSaveToEeprom (true);
+}
+
+//=========================================================================
+void testWriteStall()
+{
+  //Compacts a full bank a step at a time, and then the same compaction in one go
+  std::vector<uint8_t> eepromData (hostEepromData, hostEepromData + HOST_EEPROM_SIZE);
+
+  hostEepromWriteMicros = EEPROM_WRITE_MICROS;
+
+  reloadSettings();
+  journalMaxWriteStepTime = 0;
+  uint32_t startNumOfWrites = getNumOfEepromWrites();
+
+  settingsSaveToEeprom (false);
+  uint32_t numOfSteps = writeToEeprom();
+
+  uint32_t numOfWrites = getNumOfEepromWrites() - startNumOfWrites;
+  uint32_t maxStepTime = journalMaxWriteStepTime;
+
+  std::copy (eepromData.begin(), eepromData.end(), hostEepromData);
+
+  reloadSettings();
+  uint32_t startTime = micros();
+  settingsJournalCompact();
+  uint32_t blockingTime = micros() - startTime;
+
+  hostEepromWriteMicros = 0;
+
+  printf ("compaction of a full bank: %u bytes written at %uus each, in %u steps - worst step %uus, or %ums written in one go\n",
+          numOfWrites, EEPROM_WRITE_MICROS, numOfSteps, maxStepTime, blockingTime / 1000);
+
+  //a step never writes more than one byte
+  HOST_CHECK_EQUAL (maxStepTime, EEPROM_WRITE_MICROS);
+  HOST_CHECK_EQUAL (blockingTime, numOfWrites * EEPROM_WRITE_MICROS);
+}
+
+//=========================================================================
+int main()
+{
+  setupSettings();
+
+  //a preset, so that the image holds preset data
+  settingsSetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM, 80);
+  HOST_CHECK (presetsSaveCurrentSettings());
+  writeToEeprom();
+
+  fillJournal();
+
+  testPowerCuts ("compaction", savePreset);
+  testPowerCuts ("delta save", saveDelta);
+  testWriteStall();
+
+  return hostTestResult ("EEPROM power cut");
+}
@@ -0,0 +1,52 @@
+/*
+  HostTest.h - Checks for the tests of the host build, each of which is an executable that
+  includes the sketch and returns hostTestResult() from main().
+*/
+
+#ifndef HostTest_h
+#define HostTest_h
+
+#include <stdio.h>
+
+static int hostTestNumOfChecks = 0;
+static int hostTestNumOfFailures = 0;
+
+#define HOST_CHECK(condition) hostTestCheck ((condition), #condition, __FILE__, __LINE__)
+#define HOST_CHECK_EQUAL(actual, expected) hostTestCheckEqual ((long long)(actual), (long long)(expected), #actual, __FILE__, __LINE__)
+
+inline bool hostTestCheck (bool passed, const char *condition, const char *file, int line)
+{
+  hostTestNumOfChecks++;
+
+  if (!passed)
+  {
+    printf ("%s:%d: check failed: %s\n", file, line, condition);
+    hostTestNumOfFailures++;
+  }
+
+  return passed;
+}
+
+inline bool hostTestCheckEqual (long long actual, long long expected, const char *name, const char *file, int line)
+{
+  hostTestNumOfChecks++;
+
+  if (actual != expected)
+  {
+    printf ("%s:%d: check failed: %s is %lld, expected %lld\n", file, line, name, actual, expected);
+    hostTestNumOfFailures++;
+  }
+
+  return actual == expected;
+}
+
+/** Prints the number of checks that failed, and returns the exit code for main()
+*/
+inline int hostTestResult (const char *testName)
+{
+  printf ("%s: %d of %d checks failed\n", testName, hostTestNumOfFailures, hostTestNumOfChecks);
+
+  return (hostTestNumOfFailures == 0) ? 0 : 1;
+}
+
+#endif //HostTest_h
@@ -0,0 +1,197 @@
+//=========================================================================
+//Tests the input trace recorder (see InputTrace.h) with two traces, each of which must replay to match the
+//recording and leave the live state as it was:
+//- Encoder turns, joystick moves, button presses and MIDI-in CCs, checked against the live control state
+//- A trace that writes over the program cache and a gesture looper lane, checked against the live program
+//  cache and looper lanes (which are saved a block at a time rather than as part of the control state). It runs
+//  with a modulated knob, MIDI clock and a hold up of the realtime tasks, and the modulation and looper ticks
+//  are replayed from the time deltas rather than recorded every millisecond.
+//
+//The second trace is then dumped to input_trace.dump, which the input_trace_replay test replays in the host
+//replayer (see Tools/InputTraceReplay.cpp).
+
+#include "Arduino.h"
+#include "TurnadoController.ino"
+#include "HostShim.h"
+#include "HostTest.h"
+#include <fstream>
+
+//=========================================================================
+void pressButton (uint8_t pin)
+{
+  hostSetPin (pin, LOW);
+  hostRunLoop (30000);
+  hostSetPin (pin, HIGH);
+  hostRunLoop (30000);
+}
+
+//=========================================================================
+void moveJoystick (uint8_t index, int16_t amount)
+{
+  for (uint8_t i = 0; i < 20; i++)
+  {
+    hostSetAnalog (PINS_KNOB_CTRL_JOYSTICKS[index], 2048 + ((i % 10) * amount));
+    hostRunLoop (20000);
+  }
+
+  hostSetAnalog (PINS_KNOB_CTRL_JOYSTICKS[index], 2048);
+  hostRunLoop (20000);
+}
+
+//=========================================================================
+void toggleLooperLane (uint8_t index)
+{
+  hostSetPin (PIN_RANDOMISE_BUTTON, LOW);
+  hostRunLoop (30000);
+  pressButton (PINS_KNOB_CTRL_ENCS[index].pinSwitch);
+  hostSetPin (PIN_RANDOMISE_BUTTON, HIGH);
+  hostRunLoop (30000);
+}
+
+//=========================================================================
+void recordGesture (uint8_t index, int16_t amount)
+{
+  toggleLooperLane (index);
+  moveJoystick (index, amount);
+  toggleLooperLane (index);
+}
+
+//=========================================================================
+void runCommand (const char *command)
+{
+  hostSerialOutput.clear();
+  hostSerialInput (command);
+  hostRunLoop (20000);
+}
+
+//=========================================================================
+void testControlInputs()
+{
+  runCommand ("t");
+  HOST_CHECK (hostSerialOutput.find ("recording started") != std::string::npos);
+
+  hostTurnEncoder (PINS_KNOB_CTRL_ENCS[1].pinA, PINS_KNOB_CTRL_ENCS[1].pinB, 20);
+  hostRunLoop (50000);
+  moveJoystick (0, 150);
+  pressButton (PIN_PRESET_UP_BUTTON);
+  hostMidiInMessage (0, 0xB0, 20, 90);
+  hostRunLoop (50000);
+  pressButton (PIN_RANDOMISE_BUTTON);
+
+  runCommand ("s");
+  HOST_CHECK (hostSerialOutput.find ("recording stopped") != std::string::npos);
+  HOST_CHECK (inputTraceNumOfRecords > 0);
+
+  //then change the live state again
+  hostTurnEncoder (PINS_KNOB_CTRL_ENCS[1].pinA, PINS_KNOB_CTRL_ENCS[1].pinB, -7);
+  hostRunLoop (50000);
+  pressButton (PIN_PRESET_DOWN_BUTTON);
+  pressButton (PIN_PRESET_DOWN_BUTTON);
+
+  uint32_t liveStateHash = inputTraceGetStateHash();
+
+  static KnobControllerData liveKnobControllerData[NUM_OF_KNOB_CONTROLLERS];
+  memcpy (liveKnobControllerData, knobControllerData, sizeof (knobControllerData));
+
+  runCommand ("x");
+  HOST_CHECK (hostSerialOutput.find ("replay: PASS") != std::string::npos);
+
+  HOST_CHECK_EQUAL (inputTraceGetStateHash(), liveStateHash);
+  HOST_CHECK (memcmp (liveKnobControllerData, knobControllerData, sizeof (knobControllerData)) == 0);
+}
+
+//=========================================================================
+void testProgramCacheAndLooper()
+{
+  //live state before the trace: a modulated knob, a cached program and a playing gesture loop
+  settingsSetValue (SETTINGS_KNOB_2, PARAM_INDEX_MOD_SOURCE, MOD_SOURCE_SINE);
+  settingsSetValue (SETTINGS_KNOB_2, PARAM_INDEX_MOD_RATE, 100);
+  settingsSetValue (SETTINGS_KNOB_2, PARAM_INDEX_MOD_DEPTH, 100);
+
+  pressButton (PIN_PRESET_UP_BUTTON);
+  pressButton (PIN_PRESET_DOWN_BUTTON);
+  recordGesture (0, 100);
+
+  HOST_CHECK_EQUAL (gestureLooperLanes[0].state, GESTURE_LOOPER_PLAYING);
+
+  //a trace that caches both programs again and records over the gesture loop
+  runCommand ("t");
+  HOST_CHECK (hostSerialOutput.find ("recording started") != std::string::npos);
+
+  pressButton (PIN_PRESET_UP_BUTTON);
+  hostTurnEncoder (PINS_KNOB_CTRL_ENCS[1].pinA, PINS_KNOB_CTRL_ENCS[1].pinB, 20);
+  pressButton (PIN_PRESET_DOWN_BUTTON);
+  toggleLooperLane (0);
+
+  for (uint8_t i = 0; i < 24; i++)
+  {
+    hostMidiInMessage (MIDI_CABLE_FEEDBACK, 0xF8);
+    hostRunLoop (5000);
+  }
+
+  //the realtime tasks held up for a few ticks, which they then catch up on
+  scheduler.suspendRealtimeTasks (true);
+  hostRunLoop (3500);
+  scheduler.suspendRealtimeTasks (false);
+
+  recordGesture (0, -150);
+
+  runCommand ("s");
+  HOST_CHECK (hostSerialOutput.find ("recording stopped") != std::string::npos);
+  HOST_CHECK_EQUAL (inputTraceNumOfStartBlocks, 3);
+
+  //only the inputs and the irregular ticks are recorded, rather than a tick record a millisecond
+  HOST_CHECK (inputTraceNumOfRecords < inputTraceDuration / 4);
+
+  //then change the live state again
+  pressButton (PIN_PRESET_UP_BUTTON);
+  hostTurnEncoder (PINS_KNOB_CTRL_ENCS[1].pinA, PINS_KNOB_CTRL_ENCS[1].pinB, -7);
+  pressButton (PIN_PRESET_DOWN_BUTTON);
+  toggleLooperLane (0);
+  recordGesture (0, 60);
+
+  static ProgramCache liveProgramCache;
+  static GestureLooperLane liveLooperLanes[NUM_OF_KNOB_CONTROLLERS];
+  memcpy (&liveProgramCache, &programCache, sizeof (programCache));
+  memcpy (liveLooperLanes, gestureLooperLanes, sizeof (gestureLooperLanes));
+
+  runCommand ("x");
+  HOST_CHECK (hostSerialOutput.find ("replay: PASS") != std::string::npos);
+
+  HOST_CHECK (memcmp (&liveProgramCache, &programCache, sizeof (programCache)) == 0);
+
+  //(the loops have played on since, so only the recordings are compared)
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    HOST_CHECK_EQUAL (gestureLooperLanes[i].state, liveLooperLanes[i].state);
+    HOST_CHECK_EQUAL (gestureLooperLanes[i].lengthInTicks, liveLooperLanes[i].lengthInTicks);
+
+    if (HOST_CHECK_EQUAL (gestureLooperLanes[i].length, liveLooperLanes[i].length))
+      HOST_CHECK (memcmp (gestureLooperLanes[i].data, liveLooperLanes[i].data, liveLooperLanes[i].length) == 0);
+  }
+
+  //dump the trace, for the host replayer
+  runCommand ("d");
+
+  while (inputTraceDumpStage != INPUT_TRACE_DUMP_IDLE)
+    hostRunLoop (1000);
+
+  HOST_CHECK (hostSerialOutput.find ("Input trace: ") != std::string::npos);
+
+  std::ofstream ("input_trace.dump") << hostSerialOutput;
+}
+
+//=========================================================================
+int main()
+{
+  setup();
+  hostRunLoop (500000);
+
+  testControlInputs();
+  testProgramCacheAndLooper();
+
+  if (hostTestNumOfFailures > 0)
+    printf ("%s", hostSerialOutput.c_str());
+
+  return hostTestResult ("Input trace");
+}
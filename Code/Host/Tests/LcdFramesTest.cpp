@@ -0,0 +1,206 @@
+//=========================================================================
+//Tests what is drawn on the LCD (see Lcd.h), in the host's LCD framebuffer (see Shim/ILI9341_t3.h):
+//- Each display state drawn, through the controls and in full, must match its golden frame hash
+//  (kept in LcdFrames.golden)
+//- The controls and menu displays drawn a change at a time by updateLcd() must match the same state drawn in full
+//- The drawing metered by MeteredLcd must be no less than the drawing actually sent
+//
+//The pixels, SPI bytes and host time of each full frame are printed, as a benchmark of the drawing code.
+//
+//  test_lcd_frames <golden file> [--update] [--ppm <directory>]
+//
+//--update rewrites the golden file with the frames drawn (check the frames first - --ppm writes each one as an image).
+
+#include "Arduino.h"
+#include "TurnadoController.ino"
+#include "HostShim.h"
+#include "HostTest.h"
+#include <fstream>
+#include <map>
+
+std::map<std::string, uint32_t> goldenHashes;
+std::map<std::string, uint32_t> frameHashes;
+bool updateGoldenHashes = false;
+const char *ppmDirectory = nullptr;
+
+//=========================================================================
+void pressButton (uint8_t pin)
+{
+  hostSetPin (pin, LOW);
+  hostRunLoop (30000);
+  hostSetPin (pin, HIGH);
+  hostRunLoop (30000);
+}
+
+//=========================================================================
+void checkFrame (const std::string &name)
+{
+  uint32_t hash = lcd.hostGetFrameHash();
+  frameHashes[name] = hash;
+
+  if (ppmDirectory != nullptr)
+    HOST_CHECK (lcd.hostWritePpm ((std::string (ppmDirectory) + "/" + name + ".ppm").c_str()));
+
+  if (updateGoldenHashes)
+    return;
+
+  if (goldenHashes.count (name) == 0)
+  {
+    printf ("%s: no golden frame hash\n", name.c_str());
+    HOST_CHECK (goldenHashes.count (name) > 0);
+  }
+  else if (!HOST_CHECK_EQUAL (hash, goldenHashes[name]))
+  {
+    printf ("%s: frame doesn't match its golden frame hash\n", name.c_str());
+  }
+}
+
+//=========================================================================
+void drawFullFrame (const char *name)
+{
+  //Redraws the current display in full, printing the cost of drawing it
+  lcd.hostResetCounts();
+  uint32_t startCycles = ARM_DWT_CYCCNT;
+
+  if (lcdDisplayMode == LCD_DISPLAY_MODE_CONTROLS)
+    lcdDisplayControls();
+  else
+    lcdDisplayCompleteMenu (lcdCurrentlySelectedMenu, lcdCurrentSelectedMenuParam);
+
+  uint32_t drawTime = (ARM_DWT_CYCCNT - startCycles) / (F_CPU / 1000000);
+
+  printf ("%-20s %6u pixels, %6u SPI bytes (%6u metered), %4uus on the host\n", name,
+          lcd.hostGetNumOfPixels(), lcd.hostGetNumOfSpiBytes(), lcd.getFrameStats().spiBytes, drawTime);
+
+  HOST_CHECK (lcd.getFrameStats().spiBytes >= lcd.hostGetNumOfSpiBytes());
+}
+
+//=========================================================================
+void checkDisplay (const char *name)
+{
+  //Checks the display as drawn a change at a time by updateLcd(), and then drawn in full
+  checkFrame (name);
+  uint32_t hash = lcd.hostGetFrameHash();
+
+  drawFullFrame (name);
+
+  if (!HOST_CHECK_EQUAL (lcd.hostGetFrameHash(), hash))
+    printf ("%s: frame doesn't match the same state drawn in full\n", name);
+}
+
+//=========================================================================
+bool readGoldenHashes (const char *fileName)
+{
+  std::ifstream file (fileName);
+  std::string line;
+
+  if (!file)
+    return false;
+
+  while (std::getline (file, line))
+  {
+    char name[64];
+    uint32_t hash;
+
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    if (sscanf (line.c_str(), "%63s %x", name, &hash) == 2)
+      goldenHashes[name] = hash;
+  }
+
+  return true;
+}
+
+//=========================================================================
+bool writeGoldenHashes (const char *fileName)
+{
+  std::ofstream file (fileName);
+
+  file << "#Golden LCD frame hashes for Tests/LcdFramesTest.cpp - regenerate with: test_lcd_frames <this file> --update\n";
+
+  for (const auto &frame : frameHashes)
+  {
+    char line[80];
+    snprintf (line, sizeof (line), "%s %08X\n", frame.first.c_str(), frame.second);
+    file << line;
+  }
+
+  return file.good();
+}
+
+//=========================================================================
+int main (int argc, char *argv[])
+{
+  if (argc < 2)
+  {
+    printf ("usage: test_lcd_frames <golden file> [--update] [--ppm <directory>]\n");
+    return 1;
+  }
+
+  for (int arg = 2; arg < argc; arg++)
+  {
+    if (strcmp (argv[arg], "--update") == 0)
+      updateGoldenHashes = true;
+    else if (strcmp (argv[arg], "--ppm") == 0 && arg + 1 < argc)
+      ppmDirectory = argv[++arg];
+  }
+
+  if (!updateGoldenHashes && !readGoldenHashes (argv[1]))
+  {
+    printf ("can't read %s\n", argv[1]);
+    return 1;
+  }
+
+  setup();
+  hostRunLoop (500000);
+
+  //controls display
+  checkDisplay ("controls");
+
+  hostTurnEncoder (PINS_KNOB_CTRL_ENCS[0].pinA, PINS_KNOB_CTRL_ENCS[0].pinB, 40);
+  hostTurnEncoder (PINS_KNOB_CTRL_ENCS[5].pinA, PINS_KNOB_CTRL_ENCS[5].pinB, 90);
+  hostRunLoop (100000);
+  hostTurnEncoder (PINS_KNOB_CTRL_ENCS[5].pinA, PINS_KNOB_CTRL_ENCS[5].pinB, -30);
+  hostRunLoop (100000);
+  checkDisplay ("controls_sliders");
+
+  pressButton (PIN_PRESET_UP_BUTTON);
+  hostRunLoop (100000);
+  checkDisplay ("controls_preset");
+
+  //settings menu display, a change at a time
+  pressButton (PINS_LCD_ENCS[LCD_ENC_CTRL].pinSwitch);
+  hostRunLoop (100000);
+  checkDisplay ("menu");
+
+  hostTurnEncoder (PINS_LCD_ENCS[LCD_ENC_CTRL].pinA, PINS_LCD_ENCS[LCD_ENC_CTRL].pinB, 12);
+  hostTurnEncoder (PINS_LCD_ENCS[LCD_ENC_PARAM].pinA, PINS_LCD_ENCS[LCD_ENC_PARAM].pinB, 4);
+  hostTurnEncoder (PINS_LCD_ENCS[LCD_ENC_VAL].pinA, PINS_LCD_ENCS[LCD_ENC_VAL].pinB, 5);
+  hostRunLoop (100000);
+  checkDisplay ("menu_edit");
+
+  //every menu in full
+  for (uint8_t menu = 0; menu < SETTINGS_NUM_OF_CATS; menu++)
+  {
+    std::string name = "menu_" + std::to_string (menu);
+
+    lcdCurrentlySelectedMenu = menu;
+    lcdCurrentSelectedMenuParam = 0;
+    drawFullFrame (name.c_str());
+    checkFrame (name);
+  }
+
+  //and back to the controls display
+  pressButton (PINS_LCD_ENCS[LCD_ENC_CTRL].pinSwitch);
+  hostRunLoop (100000);
+  checkDisplay ("controls_return");
+
+  if (updateGoldenHashes)
+  {
+    HOST_CHECK (writeGoldenHashes (argv[1]));
+    printf ("%s: %u golden frame hashes written\n", argv[1], (unsigned)frameHashes.size());
+  }
+
+  return hostTestResult ("LCD frames");
+}
@@ -0,0 +1,45 @@
+//=========================================================================
+//Checks the static RAM of each module (see MemoryStats.h) against its budget, and the total against
+//MEMORY_STATIC_RAM_BUDGET, with the debug trace and input trace built in as the largest build has them.
+//
+//The sizes here are the host's, where pointers are 8 bytes rather than the Teensy's 4, so they are at least
+//the Teensy's - a module that is within budget here is within budget on the Teensy, where the same limits are
+//also checked at compile time.
+
+#include "Arduino.h"
+#include "TurnadoController.ino"
+#include "HostShim.h"
+#include "HostTest.h"
+
+//=========================================================================
+int main()
+{
+  for (uint8_t i = 0; i < MEMORY_NUM_OF_MODULES; i++)
+  {
+    const MemoryModuleSize &module = memoryModuleSizes[i];
+
+    printf ("%-20s %6u/%6u bytes\n", module.name, module.size, module.budget);
+
+    if (!HOST_CHECK (module.size <= module.budget))
+      printf ("%s is over its budget\n", module.name);
+  }
+
+  printf ("%-20s %6u/%6u bytes\n", "Total", memoryGetStaticRamTotal(), MEMORY_STATIC_RAM_BUDGET);
+  HOST_CHECK (memoryGetStaticRamTotal() <= MEMORY_STATIC_RAM_BUDGET);
+  HOST_CHECK (memoryModulesAreWithinBudget());
+
+  //and the stats are printed on request
+  setup();
+  hostSerialOutput.clear();
+  hostSerialInput ("m");
+  hostRunLoop (20000);
+
+  //(a line per run of the serial commands task)
+  while (serialCommandsReport != SERIAL_COMMANDS_REPORT_NONE)
+    hostRunLoop (10000);
+
+  HOST_CHECK (hostSerialOutput.find ("Static RAM:") != std::string::npos);
+  HOST_CHECK (hostSerialOutput.find ("Stack: ") != std::string::npos);
+
+  return hostTestResult ("Memory budget");
+}
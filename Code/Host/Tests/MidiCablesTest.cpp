@@ -0,0 +1,191 @@
+//=========================================================================
+//Tests the USB MIDI cables (see MidiIO.h):
+//- Knob feedback CCs and MIDI clock are only taken from the feedback cable
+//- A settings dump is only sent in answer to a request on the bulk cable, and holds the current settings
+//  and every preset
+//- The dump is sent a few packets per millisecond, while the performance messages sent at the same time
+//  go out in order, in the realtime tick they were sent in
+//
+//Also built with a single cable USB type (MIDI_NUM_CABLES=1), where everything is on the one cable.
+
+#include "Arduino.h"
+#include "TurnadoController.ino"
+#include "HostShim.h"
+#include "HostTest.h"
+
+const bool multipleCables = (MIDI_NUM_CABLES >= NUM_OF_MIDI_CABLES);
+
+//the cable that messages sent on a cable actually arrive on
+uint8_t actualCable (uint8_t cable)
+{
+  return multipleCables ? cable : 0;
+}
+
+uint8_t packetCable (uint32_t packet)
+{
+  return (packet >> 4) & 0xF;
+}
+
+//=========================================================================
+void testFeedbackInput()
+{
+  //wait out the loopback timeout since startup, so that knob CCs are taken
+  hostRunLoop ((MIDI_CC_LOOPBACK_TIMEOUT + 50) * 1000);
+
+  uint8_t channel = deviceParamChannelIndex[0] + 1;
+  uint8_t value = deviceParamValue (0);
+
+  for (uint8_t cable = 0; cable < NUM_OF_MIDI_CABLES; cable++)
+  {
+    value = (value + 10) & 0x7F;
+    uint8_t prevValue = deviceParamValue (0);
+
+    hostMidiInMessage (actualCable (cable), 0xB0 | (channel - 1), 1, value);
+    hostRunLoop (2000);
+
+    if (!multipleCables || cable == MIDI_CABLE_FEEDBACK)
+      HOST_CHECK_EQUAL (deviceParamValue (0), value);
+    else
+      HOST_CHECK_EQUAL (deviceParamValue (0), prevValue);
+
+    //MIDI clock, read straight from usbMIDI so that the modulation and gesture looper tasks don't take the pulse first
+    modulationPendingClockPulses = 0;
+    gestureLooperPendingClockPulses = 0;
+    hostMidiInMessage (actualCable (cable), 0xF8);
+    usbMIDI.read();
+
+    HOST_CHECK_EQUAL (modulationPendingClockPulses, (!multipleCables || cable == MIDI_CABLE_FEEDBACK) ? 1 : 0);
+    HOST_CHECK_EQUAL (gestureLooperPendingClockPulses, (!multipleCables || cable == MIDI_CABLE_FEEDBACK) ? 1 : 0);
+  }
+}
+
+//=========================================================================
+void testSettingsDump()
+{
+  //enough presets that the dump doesn't fit in the bulk queue in one go
+  const uint8_t numOfPresets = 20;
+
+  for (uint8_t i = 0; i < numOfPresets; i++)
+  {
+    presetsActivePreset = PRESET_NONE;
+    settingsSetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM, 20 + i);
+    HOST_CHECK (presetsSaveCurrentSettings());
+  }
+
+  presetsActivePreset = PRESET_NONE;
+  settingsSetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM, 100);
+
+  const uint8_t dumpRequest[] = {0xF0, MIDI_SYSEX_MANUFACTURER_ID, MIDI_SYSEX_DEVICE_ID, MIDI_SYSEX_DUMP_REQUEST, 0xF7};
+
+  //a request on the performance cable isn't answered (with multiple cables - with one cable, wait for the dump
+  //to finish)
+  hostMidiOut.clear();
+  hostMidiInSysEx (actualCable (MIDI_CABLE_PERFORMANCE), dumpRequest, sizeof (dumpRequest));
+  hostRunLoop (200000);
+
+  if (multipleCables)
+    HOST_CHECK_EQUAL (hostMidiOut.size(), 0);
+
+  //a request on the bulk cable, while turning knob 1 up the whole time
+  hostMidiOut.clear();
+  midiOutResetStats();
+  hostMidiInSysEx (actualCable (MIDI_CABLE_BULK), dumpRequest, sizeof (dumpRequest));
+
+  for (uint16_t i = 0; i < 500; i++)
+    hostTurnEncoder (PINS_KNOB_CTRL_ENCS[0].pinA, PINS_KNOB_CTRL_ENCS[0].pinB, 1, 500);
+
+  hostRunLoop (200000);
+
+  //pick the dump messages and the performance CCs out of the output
+  std::vector<std::vector<uint8_t>> dumpMessages;
+  std::vector<uint8_t> message;
+  std::vector<uint8_t> knobValues;
+  uint64_t windowStartTime = 0;
+  uint16_t windowNumOfBulkPackets = 0;
+  uint16_t maxBulkPacketsPerMs = 0;
+
+  for (const HostMidiPacket &sent : hostMidiOut)
+  {
+    uint8_t codeIndex = sent.packet & 0xF;
+
+    if (codeIndex >= 0x4 && codeIndex <= 0x7)
+    {
+      HOST_CHECK_EQUAL (packetCable (sent.packet), actualCable (MIDI_CABLE_BULK));
+
+      uint8_t numOfBytes = (codeIndex == 0x4) ? 3 : (codeIndex - 0x4);
+
+      for (uint8_t i = 0; i < numOfBytes; i++)
+        message.push_back (sent.packet >> ((i + 1) * 8));
+
+      if (codeIndex != 0x4)
+      {
+        dumpMessages.push_back (message);
+        message.clear();
+      }
+
+      if (sent.time / 1000 != windowStartTime)
+      {
+        windowStartTime = sent.time / 1000;
+        windowNumOfBulkPackets = 0;
+      }
+
+      windowNumOfBulkPackets++;
+      maxBulkPacketsPerMs = max (maxBulkPacketsPerMs, windowNumOfBulkPackets);
+    }
+
+    else if (codeIndex == 0xB)
+    {
+      HOST_CHECK_EQUAL (packetCable (sent.packet), actualCable (MIDI_CABLE_PERFORMANCE));
+
+      if (((sent.packet >> 16) & 0x7F) == settingsGetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM))
+        knobValues.push_back (sent.packet >> 24);
+    }
+
+  } //for (const HostMidiPacket &sent : hostMidiOut)
+
+  HOST_CHECK (message.empty());
+  HOST_CHECK_EQUAL (dumpMessages.size(), presetsNumOfPresets + 1);
+  HOST_CHECK_EQUAL (maxBulkPacketsPerMs, MIDI_OUT_BULK_PACKETS_PER_TICK);
+
+  for (uint8_t i = 0; i < dumpMessages.size(); i++)
+  {
+    const std::vector<uint8_t> &dump = dumpMessages[i];
+    uint8_t values[SETTINGS_NUM_OF_PARAMS];
+
+    if (i == 0)
+      memcpy (values, settingsValues, SETTINGS_NUM_OF_PARAMS);
+    else
+      HOST_CHECK (presetsGetValues (i - 1, values));
+
+    if (!HOST_CHECK_EQUAL (dump.size(), MIDI_SYSEX_DUMP_SIZE))
+      continue;
+
+    HOST_CHECK_EQUAL (dump[0], 0xF0);
+    HOST_CHECK_EQUAL (dump[1], MIDI_SYSEX_MANUFACTURER_ID);
+    HOST_CHECK_EQUAL (dump[2], MIDI_SYSEX_DEVICE_ID);
+    HOST_CHECK_EQUAL (dump[3], MIDI_SYSEX_DUMP);
+    HOST_CHECK_EQUAL (dump[4], (i == 0) ? MIDI_SYSEX_DUMP_SLOT_CURRENT_SETTINGS : i - 1);
+    HOST_CHECK_EQUAL (dump[5], SETTINGS_LAYOUT_VERSION);
+    HOST_CHECK (memcmp (&dump[MIDI_SYSEX_DUMP_HEADER_SIZE], values, SETTINGS_NUM_OF_PARAMS) == 0);
+    HOST_CHECK_EQUAL (dump[MIDI_SYSEX_DUMP_SIZE - 1], 0xF7);
+  }
+
+  //the knob CCs went out in order, each in the realtime tick it was sent in
+  HOST_CHECK (knobValues.size() > 10);
+
+  for (uint16_t i = 1; i < knobValues.size(); i++)
+    HOST_CHECK (knobValues[i] >= knobValues[i - 1]);
+
+  HOST_CHECK (midiOutQueues[MIDI_OUT_QUEUE_PERFORMANCE].maxLatency < TASK_TIMER_PERIOD_US);
+}
+
+//=========================================================================
+int main()
+{
+  setup();
+
+  testFeedbackInput();
+  testSettingsDump();
+
+  return hostTestResult (multipleCables ? "MIDI cables" : "MIDI cables (single cable)");
+}
@@ -0,0 +1,333 @@
+//=========================================================================
+//Tests loading the settings from EEPROM (see SettingsJournal.h) with images and journals that have been corrupted,
+//and with the original layout that is migrated from:
+//- A blank EEPROM, or one where both banks are corrupted, keeps the default values
+//- A corrupted active image falls back to the previous image
+//- Journal records that are out of range, or were only part written, are skipped
+//- Presets are stored in the image, and one that has been corrupted falls back to the previous image
+//- The joystick calibration is stored in the image, and one that isn't valid keeps the default calibration
+//- The original fixed address layout is migrated, keeping the defaults of the params added since, and is then
+//  rewritten as an image
+
+#include "Arduino.h"
+#include "TurnadoController.ino"
+#include "HostShim.h"
+#include "HostTest.h"
+
+const uint8_t GLOBAL_CHANNEL_ID = SETTINGS_PARAM_ID (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN);
+const uint8_t KNOB_1_CC_NUM_ID = SETTINGS_PARAM_ID (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM);
+
+//=========================================================================
+void eraseEeprom()
+{
+  memset (hostEepromData, 0xFF, sizeof (hostEepromData));
+}
+
+//=========================================================================
+void saveSettings (bool deltaSave)
+{
+  //runs the journal writer until all queued writing is done, as settingsUpdateEeprom() does a step per loop
+  settingsSaveToEeprom (deltaSave);
+
+  while (settingsJournalWriteStep (true))
+  {
+  }
+}
+
+//=========================================================================
+void reloadSettings()
+{
+  //as at boot
+  journalWriterState = JOURNAL_WRITER_IDLE;
+  journalCompactionRequested = false;
+  presetsNumOfPresets = 0;
+  presetsActivePreset = PRESET_NONE;
+
+  settingsLoadDefaults();
+  joystickCalibrationLoadDefaults();
+  settingsLoadAllFromEeprom();
+}
+
+//=========================================================================
+bool valuesAreDefaults()
+{
+  for (uint8_t i = 0; i < SETTINGS_NUM_OF_PARAMS; i++)
+  {
+    if (settingsValues[i] != settingsParamSchema[i].defaultValue)
+      return false;
+  }
+
+  return true;
+}
+
+//=========================================================================
+uint8_t getTestValue (uint8_t index)
+{
+  //a value other than the default
+  const ParamSchema &schema = settingsParamSchema[index];
+  return (schema.defaultValue < schema.maxVal) ? schema.defaultValue + 1 : schema.minVal;
+}
+
+//=========================================================================
+void testBlankEeprom()
+{
+  eraseEeprom();
+  reloadSettings();
+
+  HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_LOADED_DEFAULTS);
+  HOST_CHECK (valuesAreDefaults());
+
+  //which is then written as an image
+  reloadSettings();
+  HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_LOADED_FROM_IMAGE);
+  HOST_CHECK (valuesAreDefaults());
+
+  //a cleared EEPROM is blank too
+  memset (hostEepromData, 0, sizeof (hostEepromData));
+  reloadSettings();
+
+  HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_LOADED_DEFAULTS);
+  HOST_CHECK (valuesAreDefaults());
+}
+
+//=========================================================================
+void testCorruptedImage()
+{
+  eraseEeprom();
+  reloadSettings();
+
+  //the previous image holds channel 5, and the active bank's journal channel 6
+  settingsSetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN, 5);
+  saveSettings (true);
+  saveSettings (false);
+  settingsSetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN, 6);
+  saveSettings (true);
+
+  reloadSettings();
+  HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_LOADED_FROM_IMAGE);
+  HOST_CHECK_EQUAL (settingsGetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN), 6);
+
+  uint16_t activeBankAddr = settingsJournalBankAddr (journalActiveBank);
+  uint16_t otherBankAddr = settingsJournalBankAddr ((journalActiveBank + 1) % JOURNAL_NUM_OF_BANKS);
+
+  //each part of the active image, falling back to the previous image
+  const uint16_t corruptPositions[] = {0, 1, offsetof (SettingsImageHeader, layoutVersion), offsetof (SettingsImageHeader, values) + 10,
+                                       sizeof (SettingsImageHeader)};
+
+  //(the recovered settings are written as a new image, so the EEPROM is put back as it was after each)
+  std::vector<uint8_t> eepromData (hostEepromData, hostEepromData + HOST_EEPROM_SIZE);
+
+  for (uint16_t pos : corruptPositions)
+  {
+    hostEepromData[activeBankAddr + pos] ^= 0x5A;
+
+    reloadSettings();
+
+    if (!HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_RECOVERED_FROM_PREVIOUS_IMAGE))
+      printf ("with image byte %u corrupted\n", pos);
+
+    HOST_CHECK_EQUAL (settingsGetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN), 5);
+
+    std::copy (eepromData.begin(), eepromData.end(), hostEepromData);
+  }
+
+  //both images, keeping the defaults (the active bank's magic is kept, so it isn't taken as the original layout)
+  hostEepromData[activeBankAddr + offsetof (SettingsImageHeader, values)] ^= 0x5A;
+  hostEepromData[otherBankAddr + offsetof (SettingsImageHeader, values)] ^= 0x5A;
+
+  reloadSettings();
+  HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_LOADED_DEFAULTS);
+  HOST_CHECK (valuesAreDefaults());
+}
+
+//=========================================================================
+void testCorruptedJournal()
+{
+  eraseEeprom();
+  reloadSettings();
+
+  settingsSetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN, 7);
+  saveSettings (true);
+
+  uint16_t bankAddr = settingsJournalBankAddr (journalActiveBank);
+  uint16_t writePos = journalWritePos;
+
+  //an out of range value, which is skipped
+  hostEepromData[bankAddr + writePos] = GLOBAL_CHANNEL_ID;
+  hostEepromData[bankAddr + writePos + 1] = 17;
+
+  //an ID that isn't a param, which is skipped
+  hostEepromData[bankAddr + writePos + 2] = SETTINGS_PARAM_ID (SETTINGS_NUM_OF_CATS, 0);
+  hostEepromData[bankAddr + writePos + 3] = 1;
+
+  //a record after them is still read
+  hostEepromData[bankAddr + writePos + 4] = KNOB_1_CC_NUM_ID;
+  hostEepromData[bankAddr + writePos + 5] = 50;
+
+  reloadSettings();
+  HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_LOADED_FROM_IMAGE);
+  HOST_CHECK_EQUAL (settingsGetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN), 7);
+  HOST_CHECK_EQUAL (settingsGetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM), 50);
+  HOST_CHECK_EQUAL (journalWritePos, writePos + 6);
+
+  //a record where the power was lost after writing the value but before the ID, which isn't applied
+  writePos = journalWritePos;
+  hostEepromData[bankAddr + writePos + 1] = 60;
+
+  reloadSettings();
+  HOST_CHECK_EQUAL (settingsGetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM), 50);
+  HOST_CHECK_EQUAL (journalWritePos, writePos);
+
+  //and is written over by the next record
+  settingsSetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM, 70);
+  saveSettings (true);
+
+  reloadSettings();
+  HOST_CHECK_EQUAL (settingsGetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM), 70);
+  HOST_CHECK_EQUAL (settingsGetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN), 7);
+}
+
+//=========================================================================
+uint8_t getPresetValue (uint8_t preset, uint8_t cat, uint8_t param)
+{
+  uint8_t values[SETTINGS_NUM_OF_PARAMS];
+  HOST_CHECK (presetsGetValues (preset, values));
+
+  return values[settingsGetParamIndex (cat, param)];
+}
+
+//=========================================================================
+void testPresets()
+{
+  eraseEeprom();
+  reloadSettings();
+
+  //preset 1 with channel 3, and preset 2 with channel 9 and a different knob CC
+  settingsSetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN, 3);
+  HOST_CHECK (presetsSaveCurrentSettings());
+  saveSettings (true);
+
+  presetsActivePreset = PRESET_NONE;
+  settingsSetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN, 9);
+  settingsSetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM, 80);
+  HOST_CHECK (presetsSaveCurrentSettings());
+  saveSettings (true);
+
+  //(encoded as preset 1 in full and preset 2 as its two changed values)
+  HOST_CHECK_EQUAL (presetsGetTotalEncodedSize(), SETTINGS_NUM_OF_PARAMS + PRESET_DELTA_MASK_SIZE + 2);
+
+  memset (presetsStore, 0, sizeof (presetsStore));
+
+  reloadSettings();
+  HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_LOADED_FROM_IMAGE);
+  HOST_CHECK_EQUAL (presetsNumOfPresets, 2);
+  HOST_CHECK_EQUAL (getPresetValue (0, SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN), 3);
+  HOST_CHECK_EQUAL (getPresetValue (1, SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN), 9);
+  HOST_CHECK_EQUAL (getPresetValue (0, SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM), settingsGetParamSchema (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM).defaultValue);
+  HOST_CHECK_EQUAL (getPresetValue (1, SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM), 80);
+
+  //the preset data of the active image, falling back to the previous image that only holds preset 1
+  uint16_t bankAddr = settingsJournalBankAddr (journalActiveBank);
+  hostEepromData[bankAddr + sizeof (SettingsImageHeader) + SETTINGS_NUM_OF_PARAMS + 1] ^= 0x5A;
+
+  reloadSettings();
+  HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_RECOVERED_FROM_PREVIOUS_IMAGE);
+  HOST_CHECK_EQUAL (presetsNumOfPresets, 1);
+  HOST_CHECK_EQUAL (getPresetValue (0, SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN), 3);
+
+  //saving preset 1 with preset 2's knob CC re-encodes preset 2 with only its channel changed
+  presetsActivePreset = PRESET_NONE;
+  settingsSetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN, 9);
+  settingsSetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM, 80);
+  HOST_CHECK (presetsSaveCurrentSettings());
+
+  presetsActivePreset = 0;
+  settingsSetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN, 3);
+  HOST_CHECK (presetsSaveCurrentSettings());
+  saveSettings (true);
+
+  reloadSettings();
+  HOST_CHECK_EQUAL (presetsGetTotalEncodedSize(), SETTINGS_NUM_OF_PARAMS + PRESET_DELTA_MASK_SIZE + 1);
+  HOST_CHECK_EQUAL (getPresetValue (0, SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM), 80);
+  HOST_CHECK_EQUAL (getPresetValue (1, SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN), 9);
+  HOST_CHECK_EQUAL (getPresetValue (1, SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM), 80);
+}
+
+//=========================================================================
+void testJoystickCalibration()
+{
+  eraseEeprom();
+  reloadSettings();
+
+  const ThumbJoystick::Calibration calibration = {310, 2070, 3905};
+  joystickCalibration[3] = calibration;
+  joystickCalibrationSave();
+  saveSettings (true);
+
+  joystickCalibrationLoadDefaults();
+  reloadSettings();
+  HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_LOADED_FROM_IMAGE);
+  HOST_CHECK_EQUAL (joystickCalibration[3].minValue, calibration.minValue);
+  HOST_CHECK_EQUAL (joystickCalibration[3].centreValue, calibration.centreValue);
+  HOST_CHECK_EQUAL (joystickCalibration[3].maxValue, calibration.maxValue);
+  HOST_CHECK_EQUAL (joystickCalibration[4].centreValue, ThumbJoystick::DEFAULT_CALIBRATION.centreValue);
+
+  //a calibration with its centre outside of its range, written as a valid image, keeps the default
+  joystickCalibration[3].centreValue = 4000;
+  joystickCalibrationSave();
+  saveSettings (true);
+
+  reloadSettings();
+  HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_LOADED_FROM_IMAGE);
+  HOST_CHECK_EQUAL (joystickCalibration[3].centreValue, ThumbJoystick::DEFAULT_CALIBRATION.centreValue);
+}
+
+//=========================================================================
+void testMigration()
+{
+  //the original layout - each value at the fixed address of its ID (including the addresses of the
+  //params added since, which the original layout didn't use)
+  eraseEeprom();
+
+  for (uint8_t i = 0; i < SETTINGS_NUM_OF_PARAMS; i++)
+    hostEepromData[settingsParamSchema[i].eepromId] = getTestValue (i);
+
+  //with an out of range value, which keeps its default
+  hostEepromData[GLOBAL_CHANNEL_ID] = 0;
+
+  reloadSettings();
+  HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_MIGRATED_FROM_LAYOUT_VERSION_0);
+
+  for (uint8_t i = 0; i < SETTINGS_NUM_OF_PARAMS; i++)
+  {
+    uint8_t id = settingsParamSchema[i].eepromId;
+    bool isLegacyParam = (id % SETTINGS_MAX_NUM_PARAMS < settingsLayoutVersion0CatNumOfParams[id / SETTINGS_MAX_NUM_PARAMS]);
+
+    uint8_t expectedValue = (id == GLOBAL_CHANNEL_ID || !isLegacyParam) ? settingsParamSchema[i].defaultValue : getTestValue (i);
+
+    if (!HOST_CHECK_EQUAL (settingsValues[i], expectedValue))
+      printf ("param index %u\n", i);
+  }
+
+  //and is then written as an image
+  uint8_t knobCcNum = settingsGetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM);
+
+  reloadSettings();
+  HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_LOADED_FROM_IMAGE);
+  HOST_CHECK_EQUAL (settingsGetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM), knobCcNum);
+}
+
+//=========================================================================
+int main()
+{
+  setupSettings();
+
+  testBlankEeprom();
+  testCorruptedImage();
+  testCorruptedJournal();
+  testPresets();
+  testJoystickCalibration();
+  testMigration();
+
+  return hostTestResult ("Settings image");
+}
@@ -0,0 +1,157 @@
+//=========================================================================
+//Simulates the EEPROM wear of the settings journal (see SettingsJournal.h) over a long synthetic session, and
+//compares it with the original scheme of writing each param value to its fixed address of (cat * 16) + param.
+//
+//The session is 4 hours of playing with a delta save every 10 seconds, each after the global channel has been
+//changed by the randomise + preset chord, with a knob's CC number changed every minute and the preset saved
+//every half hour. The writes to each EEPROM cell are counted by the host EEPROM (see Shim/EEPROM.cpp), which,
+//as on the Teensy, doesn't write a byte that already holds the value.
+
+#include "Arduino.h"
+#include "TurnadoController.ino"
+#include "HostShim.h"
+#include "HostTest.h"
+
+const uint32_t SESSION_LENGTH_S = 4 * 60 * 60;
+const uint32_t SAVE_PERIOD_S = 10;
+const uint32_t KNOB_CHANGE_PERIOD_S = 60;
+const uint32_t PRESET_SAVE_PERIOD_S = 30 * 60;
+
+const uint32_t EEPROM_ENDURANCE = 100000; //guaranteed writes per cell
+
+//=========================================================================
+struct CellWriteStats
+{
+  uint32_t max = 0;
+  uint32_t numOfCellsWritten = 0;
+  uint64_t total = 0;
+};
+
+//=========================================================================
+CellWriteStats getCellWriteStats (const uint32_t *writeCounts, uint16_t numOfCells)
+{
+  CellWriteStats stats;
+
+  for (uint16_t i = 0; i < numOfCells; i++)
+  {
+    stats.max = max (stats.max, writeCounts[i]);
+    stats.total += writeCounts[i];
+
+    if (writeCounts[i] > 0)
+      stats.numOfCellsWritten++;
+  }
+
+  return stats;
+}
+
+//=========================================================================
+void printCellWriteStats (const char *name, const CellWriteStats &stats, uint16_t numOfCells)
+{
+  //(the lifetime is how long the most written cell lasts if played like this every hour of every day)
+  uint32_t lifetimeDays = (stats.max > 0) ? (EEPROM_ENDURANCE / (stats.max * 24.0 / (SESSION_LENGTH_S / 3600))) : 0;
+
+  printf ("%-22s %7llu writes to %4u cells, max %5u writes per cell, mean %6.2f over %u cells, lifetime %u days\n", name,
+          (unsigned long long)stats.total, stats.numOfCellsWritten, stats.max, (double)stats.total / numOfCells,
+          numOfCells, lifetimeDays);
+}
+
+//=========================================================================
+void writeToEeprom()
+{
+  //runs the journal writer until all queued writing is done, as settingsUpdateEeprom() does a step per loop
+  while (settingsJournalWriteStep (true))
+  {
+  }
+}
+
+//=========================================================================
+void reloadSettings()
+{
+  //as at boot
+  journalWriterState = JOURNAL_WRITER_IDLE;
+  presetsNumOfPresets = 0;
+  presetsActivePreset = PRESET_NONE;
+
+  settingsLoadDefaults();
+  joystickCalibrationLoadDefaults();
+  settingsLoadAllFromEeprom();
+}
+
+//=========================================================================
+int main()
+{
+  setupSettings();
+
+  //the journal written by the first boot isn't part of the session
+  memset (hostEepromWriteCounts, 0, sizeof (hostEepromWriteCounts));
+
+  //the original scheme, where a save updated the fixed address of every param
+  uint8_t legacyData[SETTINGS_NUM_OF_CATS * SETTINGS_MAX_NUM_PARAMS];
+  uint32_t legacyWriteCounts[SETTINGS_NUM_OF_CATS * SETTINGS_MAX_NUM_PARAMS] = {0};
+
+  memset (legacyData, 0xFF, sizeof (legacyData));
+
+  for (uint8_t i = 0; i < SETTINGS_NUM_OF_PARAMS; i++)
+    legacyData[settingsParamSchema[i].eepromId] = settingsValues[i];
+
+  uint32_t numOfSaves = 0;
+
+  for (uint32_t time = SAVE_PERIOD_S; time <= SESSION_LENGTH_S; time += SAVE_PERIOD_S)
+  {
+    uint8_t channel = settingsGetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN);
+    settingsSetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN, (channel % 16) + 1);
+
+    if (time % KNOB_CHANGE_PERIOD_S == 0)
+    {
+      uint8_t cat = SETTINGS_KNOB_1 + ((time / KNOB_CHANGE_PERIOD_S) % NUM_OF_KNOB_CONTROLLERS);
+      settingsSetValue (cat, PARAM_INDEX_CC_NUM, (settingsGetValue (cat, PARAM_INDEX_CC_NUM) + 1) & 0x7F);
+    }
+
+    if (time % PRESET_SAVE_PERIOD_S == 0)
+      HOST_CHECK (presetsSaveCurrentSettings());
+
+    //the original scheme had no presets, so only saves the params
+    for (uint8_t i = 0; i < SETTINGS_NUM_OF_PARAMS; i++)
+    {
+      uint8_t &cell = legacyData[settingsParamSchema[i].eepromId];
+
+      if (cell != settingsValues[i])
+      {
+        cell = settingsValues[i];
+        legacyWriteCounts[settingsParamSchema[i].eepromId]++;
+      }
+    }
+
+    settingsSaveToEeprom (true);
+    writeToEeprom();
+    numOfSaves++;
+
+  } //for (uint32_t time = SAVE_PERIOD_S; time <= SESSION_LENGTH_S; time += SAVE_PERIOD_S)
+
+  CellWriteStats legacyStats = getCellWriteStats (legacyWriteCounts, sizeof (legacyData));
+  CellWriteStats journalStats = getCellWriteStats (hostEepromWriteCounts, HOST_EEPROM_SIZE);
+
+  printf ("%u hour session: %u saves, %u journal records, %u compactions\n", SESSION_LENGTH_S / 3600, numOfSaves,
+          journalNumOfRecordWrites, journalNumOfCompactions);
+  printCellWriteStats ("fixed address per param", legacyStats, sizeof (legacyData));
+  printCellWriteStats ("journal", journalStats, HOST_EEPROM_SIZE);
+
+  //the global channel's cell took every save under the original scheme
+  HOST_CHECK_EQUAL (legacyStats.max, numOfSaves);
+
+  //whereas the journal spreads the writes over the cells of both banks
+  HOST_CHECK (journalStats.numOfCellsWritten > legacyStats.numOfCellsWritten * 100);
+  HOST_CHECK (journalStats.max * 100 < legacyStats.max);
+
+  //and nothing is lost doing so
+  uint8_t savedValues[SETTINGS_NUM_OF_PARAMS];
+  memcpy (savedValues, settingsValues, SETTINGS_NUM_OF_PARAMS);
+
+  reloadSettings();
+
+  HOST_CHECK_EQUAL (settingsLoadSource, SETTINGS_LOADED_FROM_IMAGE);
+  HOST_CHECK (memcmp (settingsValues, savedValues, SETTINGS_NUM_OF_PARAMS) == 0);
+  HOST_CHECK_EQUAL (presetsNumOfPresets, 1);
+
+  return hostTestResult ("Settings wear");
+}
@@ -0,0 +1,203 @@
+//=========================================================================
+//Tests the TaskScheduler class with synthetic tasks, each of which moves the host clock on by a set cost when run,
+//with the controller's periods and budgets, and the costs the scheduler was designed around (MIDI IO 50us,
+//controls 200us, LCD 600us, and EEPROM 100us with a 3ms flash erase every 200th step):
+//- Run cooperatively from loop() (tick()), the realtime tasks are run at their period, late by no more than a
+//  loop pass, other than when a background task overruns its budget (only then missing a deadline), and the
+//  background tasks share the time left over without any of them waiting for longer than the max background wait
+//- Run preemptively from a timer (tickRealtime(), as the controller does), the realtime tasks never miss a deadline,
+//  even while the EEPROM erases
+//
+//Each task's stats are printed.
+
+#include "Arduino.h"
+#include "HostShim.h"
+#include "HostTest.h"
+#include "TaskScheduler.h"
+#include "IntervalTimer.h"
+
+const uint32_t RUN_TIME_US = 10000000;
+const uint32_t TIMER_PERIOD_US = 100;
+const uint32_t MAX_BACKGROUND_WAIT_US = 20000; //as TaskScheduler::MAX_BACKGROUND_WAIT_US
+
+struct SyntheticTask
+{
+  const char *name;
+  uint32_t period;
+  uint8_t priority;
+  uint32_t budget;
+  uint32_t cost;
+  uint32_t slowCost; //the cost of every slowRunInterval'th run, if not 0
+  uint32_t slowRunInterval;
+
+  uint32_t numOfRuns;
+  uint32_t lastRunTime;
+  uint32_t maxWait;
+};
+
+enum SyntheticTasks
+{
+  TASK_MIDI_IO = 0,
+  TASK_CONTROLS,
+  TASK_LCD,
+  TASK_EEPROM,
+  NUM_OF_TASKS
+};
+
+SyntheticTask syntheticTasks[NUM_OF_TASKS] =
+{
+  {"MIDI IO", 1000, TaskScheduler::TASK_PRIORITY_REALTIME, 250, 50, 0, 0},
+  {"Controls", 1000, TaskScheduler::TASK_PRIORITY_REALTIME, 500, 200, 0, 0},
+  {"LCD", 0, TaskScheduler::TASK_PRIORITY_BACKGROUND, 700, 600, 0, 0},
+  {"EEPROM", 0, TaskScheduler::TASK_PRIORITY_BACKGROUND, 500, 100, 3000, 200}
+};
+
+TaskScheduler *scheduler = nullptr;
+bool preemptive = false;
+IntervalTimer taskTimer;
+
+//=========================================================================
+template <uint8_t index>
+void runSyntheticTask (uint32_t tickTime)
+{
+  SyntheticTask &task = syntheticTasks[index];
+
+  if (task.numOfRuns > 0)
+    task.maxWait = max (task.maxWait, tickTime - task.lastRunTime);
+
+  task.numOfRuns++;
+  task.lastRunTime = tickTime;
+
+  bool slowRun = (task.slowCost > 0 && task.numOfRuns % task.slowRunInterval == 0);
+  hostAdvanceMicros (slowRun ? task.slowCost : task.cost);
+}
+
+const TaskScheduler::TaskFunction syntheticTaskFunctions[NUM_OF_TASKS] =
+{
+  runSyntheticTask<TASK_MIDI_IO>,
+  runSyntheticTask<TASK_CONTROLS>,
+  runSyntheticTask<TASK_LCD>,
+  runSyntheticTask<TASK_EEPROM>
+};
+
+//=========================================================================
+void taskTimerTick()
+{
+  scheduler->tickRealtime();
+}
+
+//=========================================================================
+void setup()
+{
+}
+
+//=========================================================================
+void loop()
+{
+  if (preemptive)
+    scheduler->tickBackground();
+  else
+    scheduler->tick();
+}
+
+//=========================================================================
+void runTasks (TaskScheduler &taskScheduler, bool withSlowEepromSteps, bool runPreemptively)
+{
+  //Runs the synthetic tasks for RUN_TIME_US, returning with the stats of each in the scheduler
+  scheduler = &taskScheduler;
+  preemptive = runPreemptively;
+
+  for (uint8_t i = 0; i < NUM_OF_TASKS; i++)
+  {
+    SyntheticTask &task = syntheticTasks[i];
+
+    task.numOfRuns = 0;
+    task.maxWait = 0;
+
+    //(the scheduler's task index is the same, as the realtime tasks are added first)
+    HOST_CHECK_EQUAL (scheduler->addTask (task.name, syntheticTaskFunctions[i], task.period, task.priority, task.budget), i);
+  }
+
+  syntheticTasks[TASK_EEPROM].slowCost = withSlowEepromSteps ? 3000 : 0;
+
+  if (preemptive)
+    taskTimer.begin (taskTimerTick, TIMER_PERIOD_US);
+
+  hostRunLoop (RUN_TIME_US);
+
+  taskTimer.end();
+
+  printf ("%s, %s:\n", preemptive ? "preemptive" : "cooperative", withSlowEepromSteps ? "with EEPROM erases" : "without EEPROM erases");
+
+  for (uint8_t i = 0; i < NUM_OF_TASKS; i++)
+  {
+    const TaskScheduler::TaskStats &stats = scheduler->getTaskStats (i);
+    const SyntheticTask &task = syntheticTasks[i];
+
+    printf ("  %-8s %6u runs (%4.1f%% of the time), max %4uus (budget %3uus, %3u overruns)", task.name, stats.runs,
+            (100.0 * stats.runs * task.cost) / RUN_TIME_US, stats.maxRunTime, task.budget, stats.overruns);
+
+    if (task.priority == TaskScheduler::TASK_PRIORITY_REALTIME)
+      printf (", max late %4uus, %3u missed deadlines\n", stats.maxLateness, stats.missedDeadlines);
+    else
+      printf (", max wait %5uus\n", task.maxWait);
+  }
+}
+
+//=========================================================================
+void checkRealtimeTasks (TaskScheduler &taskScheduler, uint32_t maxNumOfMissedDeadlines)
+{
+  for (uint8_t i = TASK_MIDI_IO; i <= TASK_CONTROLS; i++)
+  {
+    const TaskScheduler::TaskStats &stats = taskScheduler.getTaskStats (i);
+
+    HOST_CHECK (stats.missedDeadlines <= maxNumOfMissedDeadlines);
+
+    //with no deadlines missed, every run is on time, so the rate holds
+    if (stats.missedDeadlines == 0)
+    {
+      HOST_CHECK (stats.runs >= RUN_TIME_US / syntheticTasks[i].period);
+      HOST_CHECK (stats.maxLateness < syntheticTasks[i].period);
+    }
+  }
+}
+
+//=========================================================================
+void checkBackgroundTasks()
+{
+  //each gets a share of the time left over by the realtime tasks, and none is starved
+  for (uint8_t i = TASK_LCD; i <= TASK_EEPROM; i++)
+  {
+    HOST_CHECK (syntheticTasks[i].numOfRuns > RUN_TIME_US / MAX_BACKGROUND_WAIT_US);
+    HOST_CHECK (syntheticTasks[i].maxWait <= MAX_BACKGROUND_WAIT_US + syntheticTasks[TASK_LCD].cost + syntheticTasks[TASK_EEPROM].slowCost);
+  }
+}
+
+//=========================================================================
+int main()
+{
+  TaskScheduler cooperativeScheduler;
+  runTasks (cooperativeScheduler, false, false);
+  checkRealtimeTasks (cooperativeScheduler, 0);
+  checkBackgroundTasks();
+
+  //a background task is only run when it fits before the next realtime tick, so never holds one up
+  for (uint8_t i = TASK_MIDI_IO; i <= TASK_CONTROLS; i++)
+    HOST_CHECK (cooperativeScheduler.getTaskStats (i).maxLateness <= hostLoopPeriodUs);
+
+  //a realtime task can only miss a deadline when the EEPROM overran its budget
+  TaskScheduler erasingCooperativeScheduler;
+  runTasks (erasingCooperativeScheduler, true, false);
+  checkRealtimeTasks (erasingCooperativeScheduler, erasingCooperativeScheduler.getTaskStats (TASK_EEPROM).overruns);
+  checkBackgroundTasks();
+
+  TaskScheduler preemptiveScheduler;
+  runTasks (preemptiveScheduler, true, true);
+  checkRealtimeTasks (preemptiveScheduler, 0);
+  checkBackgroundTasks();
+
+  for (uint8_t i = TASK_MIDI_IO; i <= TASK_CONTROLS; i++)
+    HOST_CHECK (preemptiveScheduler.getTaskStats (i).maxLateness <= TIMER_PERIOD_US + syntheticTasks[TASK_MIDI_IO].cost);
+
+  return hostTestResult ("Task scheduler");
+}
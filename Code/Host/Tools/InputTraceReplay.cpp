@@ -0,0 +1,294 @@
+//=========================================================================
+//Replays input traces (see InputTrace.h) on the host.
+//
+//  input_trace_replay <dump file>...
+//
+//Each file holds the output of the 'd' serial command - one or more traces, as dumped by the controller
+//or by a host build. Each trace is loaded into the recorder and replayed through the control logic, which must
+//give the same MIDI output and display state as it did when recorded. The replay rate of each trace and of all of
+//them together is printed. Exits with 1 if any trace fails to load or doesn't match, so that it can be run as a test.
+//
+//The host build must be built with the same flags in Globals.h as the controller that recorded the traces,
+//as the start state is loaded as raw bytes (the dump's state size is checked against the build's).
+
+#include "Arduino.h"
+#include "TurnadoController.ino"
+#include "HostShim.h"
+#include <fstream>
+#include <iostream>
+
+//A trace as read from a dump
+struct DumpedTrace
+{
+  uint32_t numOfRecords = 0;
+  uint32_t duration = 0;
+  uint32_t midiOutHash = 0;
+  uint32_t stateHash = 0;
+  uint32_t startTime = 0;
+  uint32_t midiOutNumOfMessages = 0;
+  uint32_t stateSize = 0;
+  uint32_t numOfBlocks = 0;
+  uint32_t looperLanesWrittenMask = 0;
+
+  std::vector<uint8_t> state;
+  std::vector<InputTraceSavedBlock> blocks;
+  std::vector<std::vector<uint8_t>> blockData;
+  std::vector<InputTraceRecord> records;
+};
+
+//=========================================================================
+bool readHexBytes (const std::string &hex, std::vector<uint8_t> &bytes)
+{
+  if (hex.size() % 2 != 0)
+    return false;
+
+  for (size_t i = 0; i < hex.size(); i += 2)
+  {
+    char *end;
+    std::string digits = hex.substr (i, 2);
+    bytes.push_back (strtoul (digits.c_str(), &end, 16));
+
+    if (*end != 0)
+      return false;
+  }
+
+  return true;
+}
+
+//=========================================================================
+bool readRecords (const std::string &line, std::vector<InputTraceRecord> &records)
+{
+  //each record is 12 hex digits - time delta, type, id and value, big-endian
+  size_t pos = 0;
+
+  while ((pos = line.find_first_not_of (' ', pos)) != std::string::npos)
+  {
+    std::vector<uint8_t> bytes;
+
+    if (!readHexBytes (line.substr (pos, 12), bytes) || bytes.size() != sizeof (InputTraceRecord))
+      return false;
+
+    InputTraceRecord record;
+    record.timeDelta = (bytes[0] << 8) | bytes[1];
+    record.type = bytes[2];
+    record.id = bytes[3];
+    record.value = (int16_t)((bytes[4] << 8) | bytes[5]);
+    records.push_back (record);
+
+    pos += 12;
+  }
+
+  return true;
+}
+
+//=========================================================================
+bool readDump (const char *fileName, std::vector<DumpedTrace> &traces)
+{
+  std::ifstream file (fileName);
+
+  if (!file)
+  {
+    std::cout << fileName << ": can't open" << std::endl;
+    return false;
+  }
+
+  std::string line;
+  uint32_t lineNum = 0;
+
+  while (std::getline (file, line))
+  {
+    lineNum++;
+
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+
+    DumpedTrace trace;
+    bool valid = true;
+
+    //(other serial output in the file is skipped)
+    if (sscanf (line.c_str(), "Input trace: %u records, %ums, MIDI hash %x, state hash %x",
+                &trace.numOfRecords, &trace.duration, &trace.midiOutHash, &trace.stateHash) == 4)
+    {
+      traces.push_back (trace);
+    }
+
+    else if (traces.empty())
+    {
+      continue;
+    }
+
+    else if (line.compare (0, 19, "Input trace start: ") == 0)
+    {
+      DumpedTrace &current = traces.back();
+
+      valid = (sscanf (line.c_str(), "Input trace start: time %u, %u MIDI messages, %u state bytes, %u saved blocks, looper lanes %x",
+                       &current.startTime, &current.midiOutNumOfMessages, &current.stateSize,
+                       &current.numOfBlocks, &current.looperLanesWrittenMask) == 5);
+    }
+
+    else if (line.compare (0, 2, "S ") == 0)
+    {
+      valid = readHexBytes (line.substr (2), traces.back().state);
+    }
+
+    else if (line.compare (0, 2, "B ") == 0)
+    {
+      DumpedTrace &current = traces.back();
+      int looperLane;
+      unsigned channelIndex, program, size;
+
+      valid = (sscanf (line.c_str(), "B %d %u %u %u", &looperLane, &channelIndex, &program, &size) == 4 &&
+               looperLane < NUM_OF_KNOB_CONTROLLERS && channelIndex < NUM_OF_MIDI_CHANNELS &&
+               program < PROGRAM_CACHE_NUM_OF_PROGRAMS);
+
+      if (valid)
+      {
+        InputTraceSavedBlock block;
+        block.data = (looperLane >= 0) ? gestureLooperLanes[looperLane].data : programCache.deviceParamValues[channelIndex][program];
+        block.size = size;
+        block.poolPos = 0;
+        block.looperLane = looperLane;
+
+        valid = (size <= ((looperLane >= 0) ? GESTURE_LOOPER_LANE_SIZE : NUM_OF_DEVICE_PARAMS));
+
+        current.blocks.push_back (block);
+        current.blockData.emplace_back();
+      }
+    }
+
+    else if (line.compare (0, 2, "D ") == 0)
+    {
+      valid = !traces.back().blockData.empty() && readHexBytes (line.substr (2), traces.back().blockData.back());
+    }
+
+    else if (line.compare (0, 2, "R ") == 0)
+    {
+      valid = readRecords (line.substr (2), traces.back().records);
+    }
+
+    if (!valid)
+    {
+      std::cout << fileName << ":" << lineNum << ": can't read '" << line << "'" << std::endl;
+      return false;
+    }
+
+  } //while (std::getline (file, line))
+
+  return true;
+}
+
+//=========================================================================
+bool loadTrace (const DumpedTrace &trace)
+{
+  //Puts a trace into the recorder, as it was when recording stopped
+  if (trace.stateSize != sizeof (InputTraceControlState) || trace.state.size() != sizeof (InputTraceControlState))
+  {
+    std::cout << "the start state is " << trace.state.size() << " bytes rather than " << sizeof (InputTraceControlState)
+              << " - was the trace recorded with the same flags in Globals.h?" << std::endl;
+    return false;
+  }
+
+  if (trace.records.size() != trace.numOfRecords || trace.records.size() > INPUT_TRACE_MAX_NUM_OF_RECORDS ||
+      trace.blocks.size() != trace.numOfBlocks || trace.blocks.size() > INPUT_TRACE_MAX_NUM_OF_SAVED_BLOCKS)
+  {
+    std::cout << "the dump is incomplete" << std::endl;
+    return false;
+  }
+
+  memcpy (&inputTraceStartState, trace.state.data(), sizeof (InputTraceControlState));
+
+  inputTraceSavePoolSize = 0;
+  inputTraceLooperLanesSavedMask = 0;
+
+  for (uint8_t i = 0; i < trace.blocks.size(); i++)
+  {
+    if (trace.blockData[i].size() != trace.blocks[i].size || inputTraceSavePoolSize + trace.blocks[i].size > INPUT_TRACE_SAVE_POOL_SIZE)
+    {
+      std::cout << "saved block " << (int)i << " is incomplete" << std::endl;
+      return false;
+    }
+
+    inputTraceStartBlocks[i] = trace.blocks[i];
+    inputTraceStartBlocks[i].poolPos = inputTraceSavePoolSize;
+    memcpy (&inputTraceSavePool[inputTraceSavePoolSize], trace.blockData[i].data(), trace.blocks[i].size);
+    inputTraceSavePoolSize += trace.blocks[i].size;
+
+    if (trace.blocks[i].looperLane >= 0)
+      inputTraceLooperLanesSavedMask |= (1 << trace.blocks[i].looperLane);
+  }
+
+  inputTraceNumOfStartBlocks = trace.blocks.size();
+  inputTraceLooperLanesWrittenMask = trace.looperLanesWrittenMask;
+
+  std::copy (trace.records.begin(), trace.records.end(), inputTraceRecords);
+  inputTraceNumOfRecords = trace.records.size();
+
+  inputTraceStartTime = trace.startTime;
+  inputTraceDuration = trace.duration;
+  inputTraceMidiOutHash = trace.midiOutHash;
+  inputTraceStateHash = trace.stateHash;
+  inputTraceMidiOutNumOfMessages = trace.midiOutNumOfMessages;
+
+  return true;
+}
+
+//=========================================================================
+int main (int argc, char *argv[])
+{
+  if (argc < 2)
+  {
+    std::cout << "usage: input_trace_replay <dump file>..." << std::endl;
+    return 1;
+  }
+
+  hostSerialEcho = true;
+
+  setup();
+
+  uint32_t numOfTraces = 0;
+  uint32_t numOfPasses = 0;
+  uint64_t totalNumOfRecords = 0;
+  uint64_t totalDuration = 0;
+  uint64_t totalReplayTime = 0;
+
+  for (int arg = 1; arg < argc; arg++)
+  {
+    std::vector<DumpedTrace> traces;
+
+    if (!readDump (argv[arg], traces))
+    {
+      numOfTraces++;
+      continue;
+    }
+
+    for (const DumpedTrace &trace : traces)
+    {
+      numOfTraces++;
+      std::cout << argv[arg] << ": trace " << numOfTraces << ", " << trace.numOfRecords << " records, " << trace.duration << "ms" << std::endl;
+
+      if (!loadTrace (trace))
+        continue;
+
+      //(timed here as well as by the replay, for the totals)
+      uint32_t replayStartCycles = ARM_DWT_CYCCNT;
+
+      if (inputTraceReplay())
+        numOfPasses++;
+
+      totalReplayTime += (ARM_DWT_CYCCNT - replayStartCycles) / (F_CPU / 1000000);
+      totalNumOfRecords += trace.numOfRecords * INPUT_TRACE_NUM_OF_REPLAYS;
+      totalDuration += (uint64_t)trace.duration * INPUT_TRACE_NUM_OF_REPLAYS;
+    }
+  }
+
+  std::cout << numOfPasses << "/" << numOfTraces << " traces passed, " << totalNumOfRecords << " records and "
+            << totalDuration << "ms of input replayed in " << totalReplayTime << "us";
+
+  if (totalReplayTime > 0)
+    std::cout << " (" << (totalNumOfRecords * 1000000) / totalReplayTime << " records/s, "
+              << (totalDuration * 1000) / totalReplayTime << "x realtime)";
+
+  std::cout << std::endl;
+
+  return (numOfTraces > 0 && numOfPasses == numOfTraces) ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""Decodes a capture of the controller's USB serial output into a readable log.
+
+With DEBUG defined, the controller writes its debug trace over USB serial as binary records
+(see TurnadoController/Trace.h), mixed in with the usual text output. This passes the text
+through and turns each record into a line of text, using the event formats given in the
+comments of the TraceEvents enum in Trace.h.
+
+Usage:
+    decode_trace.py [capture file]
+
+The capture is read from stdin if no file is given, so it can be piped straight from the
+serial port, e.g. (after sending a 'g' or an 'l' to the controller):
+    cat /dev/ttyACM0 | decode_trace.py
+"""
+
+import os
+import re
+import struct
+import sys
+
+TRACE_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "TurnadoController", "Trace.h")
+
+RECORD_SYNC_BYTE = 0xFF
+RECORD_FORMAT = "<IBBhi"  # time, event, a, b, c - see TraceRecord in Trace.h
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+
+def load_event_formats(path):
+    """Returns the format of each trace event, in order of the event's value."""
+    with open(path) as header:
+        source = header.read()
+
+    enum_body = re.search(r"enum TraceEvents\s*\{(.*?)\};", source, re.DOTALL).group(1)
+    formats = []
+
+    for line in enum_body.splitlines():
+        match = re.match(r"\s*(TRACE_\w+)\s*(?:=\s*\d+)?\s*,\s*//(.*)$", line)
+        if match:
+            formats.append((match.group(1), match.group(2).strip()))
+
+    return formats
+
+
+def decode_record(record, formats, prev_time):
+    time, event, a, b, c = struct.unpack(RECORD_FORMAT, record)
+
+    if event < len(formats):
+        text = formats[event][1].format(a=a, b=b, c=c)
+    else:
+        text = "Unknown event {} ({}, {}, {})".format(event, a, b, c)
+
+    delta = "" if prev_time is None else " (+{}us)".format((time - prev_time) & 0xFFFFFFFF)
+
+    return "[{:>12}us{}] {}".format(time, delta, text), time
+
+
+def decode(data, formats, out):
+    prev_time = None
+    text = bytearray()
+    pos = 0
+
+    while pos < len(data):
+        byte = data[pos]
+
+        if byte == RECORD_SYNC_BYTE:
+            record = data[pos + 1:pos + 1 + RECORD_SIZE]
+
+            if len(record) < RECORD_SIZE:
+                break  # the capture ended part way through a record
+
+            if text:
+                out.write(text.decode("ascii", "replace"))
+                text.clear()
+
+            line, prev_time = decode_record(record, formats, prev_time)
+            out.write(line + "\n")
+            pos += 1 + RECORD_SIZE
+        else:
+            text.append(byte)
+            pos += 1
+
+    if text:
+        out.write(text.decode("ascii", "replace"))
+
+
+def main():
+    formats = load_event_formats(TRACE_HEADER)
+
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], "rb") as capture:
+            data = capture.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    decode(data, formats, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,497 @@
+//=========================================================================
+//Microbenchmarks of the hot code paths.
+//
+//Runs each path many times at startup, timing every run with the DWT cycle counter, and prints the
+//min, mean and max cost of each over USB serial. This is so that the effect of a change on performance
+//can be measured on an actual unit. The benchmarks also run in the host build (see Code/Host), where the cycle
+//counter counts the basic blocks of code run rather than cycles, which shows a change's relative cost (exactly the
+//same on every run) but not its cost on the Teensy.
+//
+//MIDI messages are sent to the null MIDI-out sink while benchmarking, and any state changed by the
+//benchmarks is put back before the controller starts running normally.
+//
+//The worst case input-to-MIDI paths are also checked against a budget, with each printed as PASS or FAIL
+//and a summary line at the end, so that a change that makes any of them slower shows up as a regression.
+//The budgets are for the Teensy, so the host build instead checks every benchmark against a baseline
+//(see Code/Host/Benchmarks/HostBenchmarks.cpp).
+//
+//Define RUN_BENCHMARKS (see Globals.h) to run the benchmarks.
+
+#ifdef RUN_BENCHMARKS
+
+#define BENCHMARK_NUM_OF_RUNS 1000
+
+//the worst case cost allowed for each input-to-MIDI path, in microseconds
+const uint32_t BENCHMARK_BUDGET_KNOB_TURN_US = 10;
+const uint32_t BENCHMARK_BUDGET_KNOB_RESET_US = 20;
+const uint32_t BENCHMARK_BUDGET_GLOBAL_CHANNEL_CHANGE_US = 60;
+const uint32_t BENCHMARK_BUDGET_ALL_JOYSTICKS_US = 60;
+
+uint8_t benchmarkNumOfFailures = 0;
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+template <typename BenchmarkFunction>
+uint32_t benchmarkRun (const char *name, BenchmarkFunction function, uint32_t *worstCycles = NULL)
+{
+  //Runs a benchmark function BENCHMARK_NUM_OF_RUNS times, passing it the run number,
+  //and returns its mean cost in cycles (and its max cost in worstCycles, if given)
+  uint32_t minCycles = UINT32_MAX;
+  uint32_t maxCycles = 0;
+  uint64_t totalCycles = 0;
+
+  for (uint16_t run = 0; run < BENCHMARK_NUM_OF_RUNS; run++)
+  {
+    uint32_t startCycles = ARM_DWT_CYCCNT;
+    function (run);
+    uint32_t cycles = ARM_DWT_CYCCNT - startCycles;
+
+    totalCycles += cycles;
+
+    if (cycles < minCycles)
+      minCycles = cycles;
+    if (cycles > maxCycles)
+      maxCycles = cycles;
+  }
+
+  uint32_t meanCycles = totalCycles / BENCHMARK_NUM_OF_RUNS;
+
+  Serial.print (name);
+  Serial.print (": min ");
+  Serial.print (minCycles);
+  Serial.print (", mean ");
+  Serial.print (meanCycles);
+  Serial.print (", max ");
+  Serial.print (maxCycles);
+  Serial.print (" cycles (mean ");
+  Serial.print ((meanCycles * 1000) / (F_CPU / 1000000));
+  Serial.println ("ns)");
+
+  if (worstCycles != NULL)
+    *worstCycles = maxCycles;
+
+  return meanCycles;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+template <typename BenchmarkFunction>
+void benchmarkWorstCase (const char *name, uint8_t numOfEvents, uint32_t budgetUs, BenchmarkFunction function)
+{
+  //Runs a benchmark of a worst case path made up of numOfEvents control events or MIDI messages,
+  //printing its cost per event and (on the Teensy) whether its max cost is within budgetUs
+  uint32_t maxCycles;
+  benchmarkRun (name, function, &maxCycles);
+
+  Serial.print ("  ");
+  Serial.print (maxCycles / numOfEvents);
+  Serial.print (" cycles per event (max)");
+
+#ifndef HOST_BUILD
+  uint32_t budgetCycles = budgetUs * (F_CPU / 1000000);
+  bool passed = maxCycles <= budgetCycles;
+
+  if (!passed)
+    benchmarkNumOfFailures++;
+
+  Serial.print (", budget ");
+  Serial.print (budgetCycles);
+  Serial.print (" cycles: ");
+  Serial.println (passed ? "PASS" : "FAIL");
+#else
+  Serial.println();
+#endif
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void benchmarkMidiInPresetBurst (uint16_t run, bool applyEachCc)
+{
+  //Sends each of the 8 knobs a ramp of CCs (interleaved, as Turnado sends them) up to 127 on even runs
+  //and down to 0 on odd runs, so that every CC changes a value
+  const uint8_t numOfSteps = 8;
+
+  for (uint8_t step = 1; step <= numOfSteps; step++)
+  {
+    uint8_t value = (step * 127) / numOfSteps;
+
+    if (run % 2)
+      value = 127 - value;
+
+    for (uint8_t i = 0; i < NUM_OF_ACTUAL_KNOB_CONTROLLERS; i++)
+    {
+      ProcessMidiControlChange (deviceParamChannelIndex[i] + 1, i + 1, value);
+
+      if (applyEachCc)
+        midiInApplyPendingCcs();
+    }
+  }
+
+  midiInApplyPendingCcs();
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void runBenchmarks()
+{
+  //the benchmarks are printed rather than just being debug output, so make sure serial is running
+  Serial.begin (9600);
+  delay (500);
+
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+
+  midiOutSink = MIDI_OUT_SINK_NULL;
+
+  uint64_t prevDirtyMask;
+
+  Serial.print ("Benchmarks (");
+  Serial.print (BENCHMARK_NUM_OF_RUNS);
+  Serial.println (" runs each):");
+
+  //=========================================================================
+  //Inputs (with nothing moving, which is the usual case)
+
+  benchmarkRun ("Encoder update", [] (uint16_t run)
+  {
+    knobControllersEncoders[0]->update();
+  });
+
+  //the encoder decoder timer interrupt, which has a fixed cost however many encoders are turning
+  //(interrupts are disabled so that the timer doesn't sample at the same time)
+  uint32_t encoderSampleCycles = benchmarkRun ("Encoder sample (all encoders)", [] (uint16_t run)
+  {
+    noInterrupts();
+    encoderDecoder.sample();
+    interrupts();
+  });
+
+  Serial.print ("Encoder sampling CPU load: ");
+  Serial.print ((float)encoderSampleCycles * 100.0f / ((F_CPU / 1000000) * ENCODER_SAMPLE_PERIOD_US));
+  Serial.println ("%");
+
+#ifndef DISABLE_JOYSTICKS
+  benchmarkRun ("Joystick update", [] (uint16_t run)
+  {
+    knobControllersJoysticks[0]->update();
+  });
+
+  //mapping a moving joystick's samples through its calibration
+  benchmarkRun ("Joystick sample (moving)", [] (uint16_t run)
+  {
+    knobControllersJoysticks[0]->processYAxisSample ((run % 2) ? ThumbJoystick::MAX_SAMPLE_VALUE / 4 : (ThumbJoystick::MAX_SAMPLE_VALUE * 3) / 4);
+  });
+
+  knobControllersJoysticks[0]->resetProcessingState();
+  knobControllerData[0].joystickValue = 0;
+#endif
+
+  benchmarkRun ("All controls update", [] (uint16_t run)
+  {
+    updateControls (micros());
+  });
+
+  //=========================================================================
+  //Control logic and MIDI out
+
+  benchmarkRun ("Knob combined value", [] (uint16_t run)
+  {
+    //alternate the relative value so that the combined value changes (and is sent) on every run
+    knobControllerData[0].relativeValue = (run % 2) ? 64 : -64;
+    setKnobControllerCombinedMidiValue (0, true);
+  });
+
+  benchmarkRun ("MIDI CC send", [] (uint16_t run)
+  {
+    sendMidiCcMessage (1, 1, run & 0x7F, -1);
+  });
+
+  //the knob send as it was before the message map, looking up the settings on every send
+  benchmarkRun ("Knob send (hardwired)", [] (uint16_t run)
+  {
+    byte channel = settingsGetValue (SETTINGS_KNOB_1, PARAM_INDEX_MIDI_CHAN);
+    if (channel == 0)
+      channel = settingsGetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN);
+    byte control = settingsGetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM);
+    sendMidiCcMessage (channel, control, run & 0x7F, 0);
+  });
+
+  benchmarkRun ("Knob send (message map)", [] (uint16_t run)
+  {
+    messageMapSend (0, run & 0x7F);
+  });
+
+  benchmarkRun ("Message map compile", [] (uint16_t run)
+  {
+    messageMapCompile();
+  });
+
+  //=========================================================================
+  //Worst case input-to-MIDI paths, through the same callbacks as the actual controls
+
+  MidiChannelState prevMidiChannelState = midiChannelState;
+  uint8_t prevGlobalChannel = settingsGetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN);
+  prevDirtyMask = settingsDirtyMask;
+
+  benchmarkWorstCase ("Knob turn (encoder to MIDI)", 1, BENCHMARK_BUDGET_KNOB_TURN_US, [] (uint16_t run)
+  {
+    knobControllersEncoders[0]->processEncoderCount ((run % 2) ? -4 : 4, 0);
+  });
+
+  //the knob switch resetting the base value, which sends two CCs (see processEncoderSwitchChange())
+  benchmarkWorstCase ("Knob reset (double send)", 2, BENCHMARK_BUDGET_KNOB_RESET_US, [] (uint16_t run)
+  {
+    knobControllersEncoders[0]->processSwitchState (1);
+    knobControllersEncoders[0]->processSwitchState (0);
+  });
+
+  //changing the global channel back and forth between two channels where every device param has a
+  //different value, so that all of them are recomputed and redisplayed (channel 16 can only step down)
+  static int8_t channelStep;
+  channelStep = (prevGlobalChannel == NUM_OF_MIDI_CHANNELS) ? -1 : 1;
+
+  for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
+  {
+    midiChannelState.deviceParamValues[prevGlobalChannel - 1][i] = 0;
+    midiChannelState.deviceParamValues[prevGlobalChannel - 1 + channelStep][i] = 127;
+  }
+
+  benchmarkWorstCase ("Global channel change (all params)", NUM_OF_DEVICE_PARAMS, BENCHMARK_BUDGET_GLOBAL_CHANNEL_CHANGE_US, [] (uint16_t run)
+  {
+    setGlobalMidiChannel ((run % 2) ? -channelStep : channelStep);
+  });
+
+#ifndef DISABLE_JOYSTICKS
+  benchmarkWorstCase ("All joysticks moving", NUM_OF_KNOB_CONTROLLERS, BENCHMARK_BUDGET_ALL_JOYSTICKS_US, [] (uint16_t run)
+  {
+    for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+      knobControllersJoysticks[i]->processYAxisSample ((run % 2) ? knobControllersJoysticks[i]->getCalibration().minValue : knobControllersJoysticks[i]->getCalibration().maxValue);
+  });
+
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    knobControllersJoysticks[i]->resetProcessingState();
+    knobControllerData[i].joystickValue = 0;
+    setKnobControllerRelativeValue (i);
+  }
+#endif
+
+  //=========================================================================
+  //MIDI-in - a synthetic Turnado preset load, where each of the 8 knobs is sent a ramp of CCs to its new value,
+  //processed a CC at a time (as it was before MIDI-in was coalesced) and as a single drain
+
+  uint32_t prevMidiSendTimes[NUM_OF_KNOB_CONTROLLERS];
+  memcpy (prevMidiSendTimes, prevKnobControllerMidiSendTime, sizeof (prevMidiSendTimes));
+
+  //so that none of the CCs are taken as looped back
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+    prevKnobControllerMidiSendTime[i] = controlTime - MIDI_CC_LOOPBACK_TIMEOUT - 1;
+
+  uint32_t prevNumOfKnobCcChanges = midiInNumOfKnobCcChanges;
+  uint32_t prevNumOfParamUpdates = midiInNumOfParamUpdates;
+
+  benchmarkRun ("MIDI-in preset burst (per CC)", [] (uint16_t run)
+  {
+    benchmarkMidiInPresetBurst (run, true);
+  });
+
+  uint32_t numOfKnobCcChanges = midiInNumOfKnobCcChanges;
+  uint32_t numOfParamUpdates = midiInNumOfParamUpdates;
+
+  benchmarkRun ("MIDI-in preset burst (coalesced)", [] (uint16_t run)
+  {
+    benchmarkMidiInPresetBurst (run, false);
+  });
+
+  numOfKnobCcChanges = midiInNumOfKnobCcChanges - numOfKnobCcChanges;
+  numOfParamUpdates = midiInNumOfParamUpdates - numOfParamUpdates;
+
+  Serial.print ("MIDI-in preset burst: ");
+  Serial.print (numOfKnobCcChanges / BENCHMARK_NUM_OF_RUNS);
+  Serial.print (" knob CC changes, ");
+  Serial.print (numOfParamUpdates / BENCHMARK_NUM_OF_RUNS);
+  Serial.println (" knob updates when coalesced");
+
+  memcpy (prevKnobControllerMidiSendTime, prevMidiSendTimes, sizeof (prevMidiSendTimes));
+  midiInNumOfKnobCcChanges = prevNumOfKnobCcChanges;
+  midiInNumOfParamUpdates = prevNumOfParamUpdates;
+
+  settingsSetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN, prevGlobalChannel);
+  settingsDirtyMask = prevDirtyMask;
+  midiChannelState = prevMidiChannelState;
+  updateMidiChannelViews (true);
+
+  //=========================================================================
+  //Modulation - every knob controller running a full depth sine at the fastest rate, so that most ticks send
+
+  uint8_t prevSettingsValues[SETTINGS_NUM_OF_PARAMS];
+  memcpy (prevSettingsValues, settingsValues, SETTINGS_NUM_OF_PARAMS);
+
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    settingsValues[settingsGetParamIndex (i + 1, PARAM_INDEX_MOD_SOURCE)] = MOD_SOURCE_SINE;
+    settingsValues[settingsGetParamIndex (i + 1, PARAM_INDEX_MOD_RATE)] = MODULATION_NUM_OF_RATES - 1;
+    settingsValues[settingsGetParamIndex (i + 1, PARAM_INDEX_MOD_DEPTH)] = 127;
+  }
+
+  benchmarkRun ("Modulation tick (all sources)", [] (uint16_t run)
+  {
+    modulationTick (1, 0);
+  });
+
+  //turning the sources back off takes the modulation back out of the knob controllers
+  memcpy (settingsValues, prevSettingsValues, SETTINGS_NUM_OF_PARAMS);
+  modulationTick (0, 0);
+
+  //=========================================================================
+  //Gesture looper - every lane playing a recording of a joystick sweeping up and down, which changes
+  //value on every tick (the worst case for both the size of a recording and the cost of playing it)
+
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    gestureLooperStartRecording (i);
+
+    for (int16_t value = -128; value < 128; value++)
+      gestureLooperRecord (gestureLooperLanes[i], value, 1);
+    for (int16_t value = 127; value >= -128; value--)
+      gestureLooperRecord (gestureLooperLanes[i], value, 1);
+
+    gestureLooperStopRecording (i);
+  }
+
+  Serial.print ("Gesture loop size: ");
+  Serial.print (gestureLooperLanes[0].length);
+  Serial.print (" bytes for ");
+  Serial.print (gestureLooperLanes[0].lengthInTicks);
+  Serial.println (" ticks");
+
+  benchmarkRun ("Gesture looper tick (all lanes)", [] (uint16_t run)
+  {
+    gestureLooperTick (1, 0);
+  });
+
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+    gestureLooperToggle (i);
+
+  //=========================================================================
+  //Scene morph - the morph kernel on its own against the scalar version, and a whole morph update
+  //between two scenes that are opposite in every device param, so that every step sends
+
+  for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
+  {
+    sceneMorphScenes[0][i] = 0;
+    sceneMorphScenes[1][i] = 127;
+  }
+
+  sceneMorphCapturedMask = 0x03;
+  sceneMorphPackScenes();
+
+  uint32_t morphKernelCycles = benchmarkRun ("Scene morph kernel (SIMD)", [] (uint16_t run)
+  {
+    uint8_t values[NUM_OF_DEVICE_PARAMS];
+    sceneMorphKernel (sceneMorphPairs[0], run % (SCENE_MORPH_WEIGHT_ONE + 1), values);
+    asm volatile ("" : : "r" (values) : "memory");
+  });
+
+  uint32_t morphKernelScalarCycles = benchmarkRun ("Scene morph kernel (scalar)", [] (uint16_t run)
+  {
+    uint8_t values[NUM_OF_DEVICE_PARAMS];
+    sceneMorphKernelScalar (sceneMorphScenes[0], sceneMorphScenes[1], run % (SCENE_MORPH_WEIGHT_ONE + 1), values);
+    asm volatile ("" : : "r" (values) : "memory");
+  });
+
+  Serial.print ("Scene morph kernel: ");
+  Serial.print (F_CPU / max (morphKernelCycles, (uint32_t)1));
+  Serial.print (" updates/s (SIMD), ");
+  Serial.print (F_CPU / max (morphKernelScalarCycles, (uint32_t)1));
+  Serial.println (" updates/s (scalar)");
+
+  uint8_t prevDeviceParamValues[NUM_OF_DEVICE_PARAMS];
+
+  for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
+    prevDeviceParamValues[i] = deviceParamValue (i);
+
+  sceneMorphToggle();
+
+  benchmarkRun ("Scene morph update (all params)", [] (uint16_t run)
+  {
+    sceneMorphSetPosition ((run % 2) ? 127 : -128);
+  });
+
+  sceneMorphToggle();
+  sceneMorphCapturedMask = 0;
+  sceneMorphPackScenes();
+
+  for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
+    deviceParamValue (i) = prevDeviceParamValues[i];
+
+  updateMidiChannelViews (true);
+
+  //=========================================================================
+  //Settings - only changing a value and queuing the save, as the EEPROM writes themselves
+  //are timed while running (see journalMaxWriteStepTime).
+
+  uint8_t prevCcNum = settingsGetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM);
+  prevDirtyMask = settingsDirtyMask;
+  bool prevSaveRequested = settingsSaveRequested;
+
+  benchmarkRun ("Settings change and delta save", [] (uint16_t run)
+  {
+    settingsSetValue (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM, run & 0x7F);
+    settingsSaveToEeprom (true);
+  });
+
+  settingsValues[settingsGetParamIndex (SETTINGS_KNOB_1, PARAM_INDEX_CC_NUM)] = prevCcNum;
+  settingsDirtyMask = prevDirtyMask;
+  settingsSaveRequested = prevSaveRequested;
+
+  //=========================================================================
+  //LCD - drawing straight from the LCD task's copy of the display state
+
+  benchmarkRun ("Slider draw (1 step)", [] (uint16_t run)
+  {
+    lcdDrawState.sliderValues[0] = (run % 2) ? 65 : 64;
+    lcdDrawSliderValueChange (0);
+  });
+
+  benchmarkRun ("Slider draw (full range)", [] (uint16_t run)
+  {
+    lcdDrawState.sliderValues[0] = (run % 2) ? 127 : 0;
+    lcdDrawSliderValueChange (0);
+  });
+
+  //=========================================================================
+  //put things back as they were
+
+  knobControllerData[0].relativeValue = 0;
+  setKnobControllerCombinedMidiValue (0, false);
+
+  lcdPublishDisplayState();
+  lcdRequestRedraw();
+
+  midiOutSink = MIDI_OUT_SINK_USB;
+  midiOutNumOfMessages = 0;
+
+#ifndef HOST_BUILD
+  Serial.print ("Worst case paths: ");
+
+  if (benchmarkNumOfFailures == 0)
+  {
+    Serial.println ("PASS");
+  }
+  else
+  {
+    Serial.print ("FAIL (");
+    Serial.print (benchmarkNumOfFailures);
+    Serial.println (" over budget)");
+  }
+#endif
+
+  Serial.println();
+}
+
+#endif //RUN_BENCHMARKS
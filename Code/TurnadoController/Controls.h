@@ -1,3 +1,4 @@
+#include "QuadratureDecoder.h"
 #include "RotaryEncoder.h"
 #include "SwitchControl.h"
 #include "ThumbJoystick.h"
@@ -7,6 +8,17 @@
 //#define DISABLE_JOYSTICKS 1
 
 //=========================================================================
+//All of the encoders are decoded by sampling their pins from a timer interrupt every ENCODER_SAMPLE_PERIOD_US,
+//which gives a fixed CPU load however many encoders are turning (rather than an interrupt on every pin change).
+//At 50us a count is missed only if an encoder is turned faster than 5000 detents per second.
+//The timer has a higher priority than the task timer (so that the controls task can't delay a sample),
+//but lower than USB.
+const uint32_t ENCODER_SAMPLE_PERIOD_US = 50;
+const uint8_t ENCODER_SAMPLE_PRIORITY = 176;
+
+QuadratureDecoder encoderDecoder;
+IntervalTimer encoderDecoderTimer;
+
 RotaryEncoder* knobControllersEncoders[NUM_OF_KNOB_CONTROLLERS];
 ThumbJoystick* knobControllersJoysticks[NUM_OF_KNOB_CONTROLLERS];
 
@@ -19,30 +31,29 @@ SwitchControl* presetDownButton;
 
 SwitchControl* randomiseButton;
 
+//ADC conversions averaged for each joystick sample (1, 4, 8, 16 or 32) - each conversion takes a few microseconds,
+//and every joystick is sampled on each controls tick
+const uint8_t JOYSTICK_ADC_AVERAGING = 4;
+
+bool joysticksCalibrating = false; //see toggleJoystickCalibration()
+
 //=========================================================================
-//FIXME: could knobControllerData and mixControllerData be arrays for each MIDI channel and replace deviceParamValuesForMidiChannel?
+//The base value of each knob controller (and the mix value) is kept per MIDI channel in midiChannelState.
 
 struct KnobControllerData
 {
-  int16_t baseValue = 0;
-  uint8_t prevBaseValue = 0;
-  int16_t relativeValue = 0;
+  int16_t relativeValue = 0; //the joystick, modulation and gesture loop values combined
   int8_t prevRelativeValue = 0;
   int16_t combinedMidiValue = 0;
   uint8_t prevCombinedMidiValue = 0;
+  int16_t joystickValue = 0;
+  int8_t modulationValue = 0; //see Modulation.h
+  int8_t looperValue = 0; //see GestureLooper.h
 };
 
 KnobControllerData knobControllerData[NUM_OF_KNOB_CONTROLLERS];
 bool ignoreJsMessage[NUM_OF_KNOB_CONTROLLERS] = {false};
 
-struct MixControllerData
-{
-  int16_t midiValue = 127;
-  uint8_t prevMidiValue = 127;
-};
-
-MixControllerData mixControllerData;
-
 uint8_t randomiseButtonState = 0;
 bool ignoreNextRandomiseButtonRelease = false;
 
@@ -50,6 +61,10 @@ uint8_t presetUpButtonState = 0;
 uint8_t presetDownButtonState = 0;
 bool ignoreNextPresetButtonRelease = false;
 
+//the LCD control encoder switch is used with the preset and randomise buttons to select and save settings presets
+uint8_t lcdCtrlSwitchState = 0;
+bool ignoreNextLcdCtrlSwitchRelease = false;
+
 enum PresetButtonType
 {
   PRESET_BUTTON_TYPE_DOWN = 0,
@@ -62,33 +77,51 @@ void processEncoderSwitchChange (RotaryEncoder &enc);
 void processPushButtonChange (SwitchControl &switchControl);
 void processJoystickChange (ThumbJoystick &thumbJoystick, bool isYAxis);
 void setGlobalMidiChannel (int8_t incVal);
+void selectSettingsPreset (int8_t incVal);
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void encoderDecoderSample()
+{
+  encoderDecoder.sample();
+}
 
 //=========================================================================
 //=========================================================================
 //=========================================================================
 void setupControls()
 {
+  //Joystick samples are averaged by the ADC hardware, which takes JOYSTICK_ADC_AVERAGING conversions per sample
+  analogReadResolution (ThumbJoystick::SAMPLE_RESOLUTION);
+  analogReadAveraging (JOYSTICK_ADC_AVERAGING);
+
   for (auto i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
   {
-    knobControllersEncoders[i] = new RotaryEncoder (PINS_KNOB_CTRL_ENCS[i].pinA, PINS_KNOB_CTRL_ENCS[i].pinB, PINS_KNOB_CTRL_ENCS[i].pinSwitch);
+    knobControllersEncoders[i] = new RotaryEncoder (encoderDecoder, PINS_KNOB_CTRL_ENCS[i].pinA, PINS_KNOB_CTRL_ENCS[i].pinB, PINS_KNOB_CTRL_ENCS[i].pinSwitch);
     knobControllersEncoders[i]->onEncoderChange (processEncoderChange);
     knobControllersEncoders[i]->onSwitchChange (processEncoderSwitchChange);
 
+    //setupSettings() must be called before setupControls() for the joystick calibration to be loaded
     knobControllersJoysticks[i] = new ThumbJoystick (PINS_KNOB_CTRL_JOYSTICKS[i]);
     knobControllersJoysticks[i]->onJoystickChange (processJoystickChange);
+    knobControllersJoysticks[i]->setCalibration (joystickCalibration[i]);
+    knobControllersJoysticks[i]->resetProcessingState();
   }
 
-  mixEncoder = new RotaryEncoder (PINS_MIX_ENC.pinA, PINS_MIX_ENC.pinB, PINS_MIX_ENC.pinSwitch);
+  mixEncoder = new RotaryEncoder (encoderDecoder, PINS_MIX_ENC.pinA, PINS_MIX_ENC.pinB, PINS_MIX_ENC.pinSwitch);
   mixEncoder->onEncoderChange (processEncoderChange);
-  lcdSetSliderValue (LCD_SLIDER_MIX_INDEX, mixControllerData.midiValue);
 
   for (auto i = 0; i < NUM_OF_LCD_ENCS; i++)
   {
-    lcdEncoders[i] = new RotaryEncoder (PINS_LCD_ENCS[i].pinA, PINS_LCD_ENCS[i].pinB, PINS_LCD_ENCS[i].pinSwitch);
+    lcdEncoders[i] = new RotaryEncoder (encoderDecoder, PINS_LCD_ENCS[i].pinA, PINS_LCD_ENCS[i].pinB, PINS_LCD_ENCS[i].pinSwitch);
     lcdEncoders[i]->onEncoderChange (processEncoderChange);
     lcdEncoders[i]->onSwitchChange (processEncoderSwitchChange);
   }
 
+  encoderDecoderTimer.priority (ENCODER_SAMPLE_PRIORITY);
+  encoderDecoderTimer.begin (encoderDecoderSample, ENCODER_SAMPLE_PERIOD_US);
+
   presetUpButton = new SwitchControl (PIN_PRESET_UP_BUTTON);
   presetUpButton->onSwitchStateChange (processPushButtonChange);
   presetDownButton = new SwitchControl (PIN_PRESET_DOWN_BUTTON);
@@ -98,28 +131,37 @@ void setupControls()
   randomiseButton->onSwitchStateChange (processPushButtonChange);
 
   //setupSettings() must be called before setupControls() for the below to be set correctly.
-  currentMidiProgramNumber = settingsData[SETTINGS_PRESET].paramData[PARAM_INDEX_START_NUM].value;
+  for (uint8_t chan = 0; chan < NUM_OF_MIDI_CHANNELS; chan++)
+  {
+    //assume mix value always starts at 127, and the rest start at 0.
+    midiChannelState.deviceParamValues[chan][DEVICE_PARAM_INDEX_MIX] = 127;
+    midiChannelState.programNumbers[chan] = settingsGetValue (SETTINGS_PRESET, PARAM_INDEX_START_NUM);
+  }
+
+  updateMidiChannelViews (true);
 }
 
 //=========================================================================
 //=========================================================================
 //=========================================================================
-void updateControls()
+void updateControls (uint32_t tickTime)
 {
+  PROFILE_SCOPE (PROFILE_TASK_CONTROLS);
+
   for (auto i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
   {
-    knobControllersEncoders[i]->update();
+    knobControllersEncoders[i]->update (controlTime);
 
 #ifndef DISABLE_JOYSTICKS
     knobControllersJoysticks[i]->update();
 #endif
   }
 
-  mixEncoder->update();
+  mixEncoder->update (controlTime);
 
   for (auto i = 0; i < NUM_OF_LCD_ENCS; i++)
   {
-    lcdEncoders[i]->update();
+    lcdEncoders[i]->update (controlTime);
   }
 
   presetUpButton->update();
@@ -130,48 +172,85 @@ void updateControls()
 //=========================================================================
 //=========================================================================
 //=========================================================================
-void setKnobControllerCombinedMidiValue (uint8_t index, bool sendToMidiOut)
+uint8_t getKnobControllerCombinedValue (uint8_t baseValue, int16_t relativeValue)
 {
-  if (knobControllerData[index].relativeValue > 0)
-    knobControllerData[index].combinedMidiValue = map (knobControllerData[index].relativeValue, 0, 127, knobControllerData[index].baseValue, 127);
-  else if (knobControllerData[index].relativeValue < 0)
-    knobControllerData[index].combinedMidiValue = map (knobControllerData[index].relativeValue, 0, -128, knobControllerData[index].baseValue, 0);
+  //a positive relative value moves the base value towards 127, and a negative one towards 0
+  if (relativeValue > 0)
+    return map (relativeValue, 0, 127, baseValue, 127);
+  else if (relativeValue < 0)
+    return map (relativeValue, 0, -128, baseValue, 0);
   else
-    knobControllerData[index].combinedMidiValue = knobControllerData[index].baseValue;
+    return baseValue;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+uint8_t getKnobControllerBaseValue (uint8_t combinedValue, int16_t relativeValue)
+{
+  //The inverse of getKnobControllerCombinedValue() - the base value that a relative value moves to a combined value.
+  //At the ends of the relative range the combined value is the same whatever the base value, so it is used as is.
+  if (relativeValue > 0 && relativeValue < 127)
+    return constrain ((127 * (combinedValue - relativeValue) + (127 - relativeValue) / 2) / (127 - relativeValue), 0, 127);
+  else if (relativeValue < 0 && relativeValue > -128)
+    return constrain ((128 * combinedValue + (128 + relativeValue) / 2) / (128 + relativeValue), 0, 127);
+  else
+    return combinedValue;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void setKnobControllerCombinedMidiValue (uint8_t index, bool sendToMidiOut)
+{
+  PROFILE_SCOPE (PROFILE_KNOB_COMBINED_MIDI_VALUE);
 
-  if (knobControllerData[index].combinedMidiValue != knobControllerData[index].prevCombinedMidiValue)
+  KnobControllerData &data = knobControllerData[index];
+
+  data.combinedMidiValue = getKnobControllerCombinedValue (deviceParamValue (index), data.relativeValue);
+
+  if (data.combinedMidiValue != data.prevCombinedMidiValue)
   {
     if (sendToMidiOut)
     {
       //send MIDI message
-      byte channel = settingsData[index + 1].paramData[PARAM_INDEX_MIDI_CHAN].value;
-      if (channel == 0)
-        channel = settingsData[SETTINGS_GLOBAL].paramData[PARAM_INDEX_MIDI_CHAN].value;
-      byte control = settingsData[index + 1].paramData[PARAM_INDEX_CC_NUM].value;
-      byte value = knobControllerData[index].combinedMidiValue;
-      sendMidiCcMessage (channel, control, value, index);
+      messageMapSend (index, data.combinedMidiValue);
 
     } //if (sendToMidiOut)
 
     //update LCD display
-    lcdSetSliderValue (index, knobControllerData[index].combinedMidiValue);
+    lcdSetSliderValue (index, data.combinedMidiValue);
 
-    knobControllerData[index].prevCombinedMidiValue = knobControllerData[index].combinedMidiValue;
+    data.prevCombinedMidiValue = data.combinedMidiValue;
 
-  } //if (knobControllerData[index].combinedMidiValue != knobControllerData[index].prevCombinedMidiValue)
+  } //if (data.combinedMidiValue != data.prevCombinedMidiValue)
 }
 
 //=========================================================================
 //=========================================================================
 //=========================================================================
-void setKnobControllerBaseValue (uint8_t index, uint8_t value, bool sendToMidiOut)
+void setKnobControllerRelativeValue (uint8_t index)
 {
-  knobControllerData[index].baseValue = value;
+  KnobControllerData &data = knobControllerData[index];
+
+  data.relativeValue = constrain (data.joystickValue + data.modulationValue + data.looperValue, -128, 127);
+
+  if (data.relativeValue != data.prevRelativeValue)
+  {
+    setKnobControllerCombinedMidiValue (index, true);
+    data.prevRelativeValue = data.relativeValue;
+  }
+}
 
-  if (knobControllerData[index].baseValue != knobControllerData[index].prevBaseValue)
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void setKnobControllerBaseValue (uint8_t index, uint8_t value, bool sendToMidiOut)
+{
+  if (value != deviceParamValue (index))
   {
+    deviceParamValue (index) = value;
     setKnobControllerCombinedMidiValue (index, sendToMidiOut);
-    knobControllerData[index].prevBaseValue = knobControllerData[index].baseValue;
   }
 }
 
@@ -180,28 +259,58 @@ void setKnobControllerBaseValue (uint8_t index, uint8_t value, bool sendToMidiOu
 //=========================================================================
 void setMixControllerValue (uint8_t value, bool sendToMidiOut)
 {
-  mixControllerData.midiValue = value;
-
-  if (mixControllerData.midiValue != mixControllerData.prevMidiValue)
+  if (value != deviceParamValue (DEVICE_PARAM_INDEX_MIX))
   {
+    deviceParamValue (DEVICE_PARAM_INDEX_MIX) = value;
+
     if (sendToMidiOut)
     {
       //send MIDI message
-      byte channel = settingsData[SETTINGS_MIX].paramData[PARAM_INDEX_MIDI_CHAN].value;
-      if (channel == 0)
-        channel = settingsData[SETTINGS_GLOBAL].paramData[PARAM_INDEX_MIDI_CHAN].value;
-      byte control = settingsData[SETTINGS_MIX].paramData[PARAM_INDEX_CC_NUM].value;
-      byte value = mixControllerData.midiValue;
-      sendMidiCcMessage (channel, control, value, DEVICE_PARAM_INDEX_MIX);
+      messageMapSend (MESSAGE_MAP_MIX, value);
 
     } //if (sendToMidiOut)
 
     //update LCD display
-    lcdSetSliderValue (LCD_SLIDER_MIX_INDEX, mixControllerData.midiValue);
+    lcdSetSliderValue (LCD_SLIDER_MIX_INDEX, value);
+
+  } //if (value != deviceParamValue (DEVICE_PARAM_INDEX_MIX))
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void updateDeviceParamView (uint8_t index)
+{
+  //Updates the control state and LCD display (but doesn't send any MIDI) for a
+  //device param whose value on its channel has been changed behind its back
+  if (index < DEVICE_PARAM_INDEX_MIX)
+    setKnobControllerCombinedMidiValue (index, false);
+  else
+    lcdSetSliderValue (LCD_SLIDER_MIX_INDEX, deviceParamValue (index));
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void updateMidiChannelViews (bool updateAll)
+{
+  //Points each device param, and the program change buttons, at the state of the MIDI channel they are
+  //now set to use, updating the display (but not sending any MIDI) for those that have changed channel.
+  //Must be called after any change to the MIDI channel settings.
+
+  for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
+  {
+    uint8_t channelIndex = settingsGetMidiChannel (i + 1) - 1;
+
+    if (channelIndex != deviceParamChannelIndex[i] || updateAll)
+    {
+      deviceParamChannelIndex[i] = channelIndex;
+      updateDeviceParamView (i);
+    }
 
-    mixControllerData.prevMidiValue = mixControllerData.midiValue;
+  } //for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
 
-  } //if (mixControllerData.midiValue != mixControllerData.prevMidiValue)
+  programChannelIndex = settingsGetMidiChannel (SETTINGS_PRESET) - 1;
 }
 
 //=========================================================================
@@ -213,19 +322,31 @@ void setCurrentMidiProgramNumber (int8_t incVal)
   //even if the new program number is the same as the previous one
   //(so that we can 'reset' the current MIDI program).
 
-  currentMidiProgramNumber = constrain (currentMidiProgramNumber + incVal, 0, 127);
+  uint8_t newProgram = constrain (currentMidiProgramNumber() + incVal, 0, 127);
 
-  //send MIDI message
-  byte channel = settingsData[SETTINGS_PRESET].paramData[PARAM_INDEX_MIDI_CHAN].value;
-  if (channel == 0)
-    channel = settingsData[SETTINGS_GLOBAL].paramData[PARAM_INDEX_MIDI_CHAN].value;
-  sendMidiProgramChangeMessage (channel, currentMidiProgramNumber);
+  //If changing program, set the device params on this channel to the values the new program had when last used
+  //(see ProgramCache.h). Resending the same program leaves them alone, as Turnado may reset its knobs to the saved
+  //program values which we don't know, however in both cases any knob values that Turnado sends back are applied.
+  if (newProgram != currentMidiProgramNumber())
+  {
+    programCacheStore (programChannelIndex);
+    currentMidiProgramNumber() = newProgram;
 
-  //flag to update program in LCD top bar display
-  lcdTopBarProgramChanged = true;
+    if (programCacheRecall (programChannelIndex))
+    {
+      for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
+      {
+        if (deviceParamChannelIndex[i] == programChannelIndex)
+          updateDeviceParamView (i);
+      }
+    }
+
+    TRACE (TRACE_PROGRAM_CHANGE, newProgram, programCacheNumOfMisses, programCacheNumOfHits);
 
-  //Do I need to do anything to the param values? If program change resets turnado knobs
-  //we should received MIDI-in CCs for these changes, but what about for dictator and mix params?
+  } //if (newProgram != currentMidiProgramNumber())
+
+  //send MIDI message
+  messageMapSend (MESSAGE_MAP_PROGRAM, currentMidiProgramNumber());
 }
 
 //=========================================================================
@@ -233,33 +354,65 @@ void setCurrentMidiProgramNumber (int8_t incVal)
 //=========================================================================
 void setGlobalMidiChannel (int8_t incVal)
 {
-  uint8_t prevChan = settingsData[SETTINGS_GLOBAL].paramData[PARAM_INDEX_MIDI_CHAN].value;
+  uint8_t prevChan = settingsGetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN);
   uint8_t newChan = constrain (prevChan + incVal, 1, 16);
 
   if (prevChan != newChan)
   {
-    settingsData[SETTINGS_GLOBAL].paramData[PARAM_INDEX_MIDI_CHAN].value = newChan;
-    settingsData[SETTINGS_GLOBAL].paramData[PARAM_INDEX_MIDI_CHAN].needsSavingToEeprom = true;
+    settingsSetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN, newChan);
 
-    //flag to update channel in LCD top bar display
-    lcdTopBarChannelChanged = true;
+    //update the LCD display with the values of the new channel for the controls that are set to use the global channel
+    updateMidiChannelViews (false);
 
-    //update the knob controller base values (and LCD display) with values of new channel
-    //for the knob controllers that are set to use the global channel
+  } //if (prevChan != newChan)
+}
 
-    for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
-    {
-      if (settingsData[i + 1].paramData[PARAM_INDEX_MIDI_CHAN].value == 0)
-      {
-        if (i < DEVICE_PARAM_INDEX_MIX)
-          setKnobControllerBaseValue (i, deviceParamValuesForMidiChannel[newChan - 1][i], false);
-        else
-          setMixControllerValue (deviceParamValuesForMidiChannel[newChan - 1][i], false);
-      }
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void recallSettingsPreset (uint8_t preset)
+{
+  //Recalling a preset only changes the settings values and the things on the display that depend on them,
+  //with any changed values being saved to EEPROM as part of the normal delta save.
 
-    } //for (uint8_t i = 0; i < NUM_OF_ACTUAL_KNOB_CONTROLLERS; i++)
+  uint32_t recallStartTime = micros();
+  uint8_t values[SETTINGS_NUM_OF_PARAMS];
 
-  } //if (prevChan != newChan)
+  if (!presetsGetValues (preset, values))
+    return;
+
+  for (uint8_t i = 0; i < SETTINGS_NUM_OF_PARAMS; i++)
+    settingsSetValueAtIndex (i, values[i]);
+
+  //update the LCD display for the controls that are now on a different channel
+  updateMidiChannelViews (false);
+
+  //if the menu is being displayed, just redraw the param values rather than the whole display
+  if (lcdDisplayMode == LCD_DISPLAY_MODE_SETTINGS_MENU)
+    lcdMenuValuesChanged();
+
+  presetsLastRecallTime = micros() - recallStartTime;
+
+  TRACE (TRACE_PRESET_RECALL, preset + 1, 0, presetsLastRecallTime);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void selectSettingsPreset (int8_t incVal)
+{
+  //Steps through the stored presets, where stepping down from the first preset selects
+  //no preset (so that the next save creates a new preset) without changing any settings.
+
+  int8_t newPreset = constrain (presetsActivePreset + incVal, PRESET_NONE, presetsNumOfPresets - 1);
+
+  if (newPreset != presetsActivePreset)
+  {
+    presetsActivePreset = newPreset;
+
+    if (presetsActivePreset != PRESET_NONE)
+      recallSettingsPreset (presetsActivePreset);
+  }
 }
 
 //=========================================================================
@@ -286,8 +439,19 @@ uint8_t handlePresetButtonInteraction (uint8_t buttonType, uint8_t newButtonStat
     //if a button release and we don't want to ignore it
     if (newButtonState == 0 && !ignoreNextPresetButtonRelease)
     {
+      //if the LCD control switch is being held down, select the next/previous settings preset
+      if (lcdCtrlSwitchState > 0)
+      {
+        if (buttonType == PRESET_BUTTON_TYPE_UP)
+          selectSettingsPreset (1);
+        else if (buttonType == PRESET_BUTTON_TYPE_DOWN)
+          selectSettingsPreset (-1);
+
+        ignoreNextLcdCtrlSwitchRelease = true;
+      }
+
       //if randomise button is not being held down
-      if (randomiseButtonState == 0)
+      else if (randomiseButtonState == 0)
       {
         //if preset up button release while preset down button isn't held, increment MIDI program number
         if (buttonType == PRESET_BUTTON_TYPE_UP && otherButtonTypeState == 0)
@@ -338,14 +502,9 @@ void processEncoderChange (RotaryEncoder &enc, int enc_value)
   {
     if (enc == *knobControllersEncoders[i])
     {
-#ifdef DEBUG
-      Serial.print ("Knob Controller ");
-      Serial.print (i + 1);
-      Serial.print (" encoder: ");
-      Serial.println (enc_value);
-#endif
+      TRACE (TRACE_KNOB_ENCODER, i + 1, enc_value);
 
-      setKnobControllerBaseValue (i, constrain (knobControllerData[i].baseValue + enc_value, 0, 127), true);
+      setKnobControllerBaseValue (i, constrain (deviceParamValue (i) + enc_value, 0, 127), true);
 
     } //if (enc == *knobControllersEncoders[i])
 
@@ -354,22 +513,16 @@ void processEncoderChange (RotaryEncoder &enc, int enc_value)
   //=========================================================================
   if (enc == *mixEncoder)
   {
-#ifdef DEBUG
-    Serial.print ("Mix encoder: ");
-    Serial.println (enc_value);
-#endif
+    TRACE (TRACE_MIX_ENCODER, 0, enc_value);
 
-    setMixControllerValue (constrain (mixControllerData.midiValue + enc_value, 0, 127), true);
+    setMixControllerValue (constrain (deviceParamValue (DEVICE_PARAM_INDEX_MIX) + enc_value, 0, 127), true);
 
   } //if (enc == *mixEncoder)
 
   //=========================================================================
   else if (enc == *lcdEncoders[LCD_ENC_CTRL])
   {
-#ifdef DEBUG
-    Serial.print ("LCD CTRL encoder: ");
-    Serial.println (enc_value);
-#endif
+    TRACE (TRACE_LCD_ENCODER, LCD_ENC_CTRL, enc_value);
 
     lcdSetSelectedMenu (enc_value);
   }
@@ -377,10 +530,7 @@ void processEncoderChange (RotaryEncoder &enc, int enc_value)
   //=========================================================================
   else if (enc == *lcdEncoders[LCD_ENC_PARAM])
   {
-#ifdef DEBUG
-    Serial.print ("LCD Param encoder: ");
-    Serial.println (enc_value);
-#endif
+    TRACE (TRACE_LCD_ENCODER, LCD_ENC_PARAM, enc_value);
 
     lcdSetSelectedParam (enc_value);
   }
@@ -388,10 +538,7 @@ void processEncoderChange (RotaryEncoder &enc, int enc_value)
   //=========================================================================
   else if (enc == *lcdEncoders[LCD_ENC_VAL])
   {
-#ifdef DEBUG
-    Serial.print ("LCD Value encoder: ");
-    Serial.println (enc_value);
-#endif
+    TRACE (TRACE_LCD_ENCODER, LCD_ENC_VAL, enc_value);
 
     lcdSetSelectedParamValue (enc_value);
   }
@@ -407,18 +554,46 @@ void processEncoderSwitchChange (RotaryEncoder &enc)
   {
     if (enc == *knobControllersEncoders[i])
     {
-#ifdef DEBUG
-      Serial.print ("Knob Controller ");
-      Serial.print (i + 1);
-      Serial.print (" encoder switch: ");
-      Serial.println (enc.getSwitchState());
-#endif
+      TRACE (TRACE_KNOB_ENCODER_SWITCH, i + 1, enc.getSwitchState());
 
       //if switch is being turned on
       if (enc.getSwitchState() > 0)
       {
+        //if the randomise button is being held down, step the knob controller's gesture looper lane
+        //(idle -> recording -> playing -> idle)
+        if (randomiseButtonState > 0)
+        {
+          gestureLooperToggle (i);
+          ignoreNextRandomiseButtonRelease = true;
+        }
+
+        //if the LCD control switch is being held down, capture a scene with knob controllers 1-4,
+        //or turn scene morphing on/off with the dictator
+        else if (lcdCtrlSwitchState > 0)
+        {
+          if (i == DICTATOR_KNOB_CONTROLLER_INDEX)
+          {
+            sceneMorphToggle();
+
+            //flag to ignore the dictator joystick until it is centred again, as it has changed what it controls
+            ignoreJsMessage[i] = true;
+          }
+          else if (i < SCENE_MORPH_MAX_NUM_OF_SCENES)
+          {
+            sceneMorphCapture (i);
+          }
+
+          ignoreNextLcdCtrlSwitchRelease = true;
+        }
+
+        //if the knob controller is modulated by an envelope, use the switch to trigger it
+        else if (settingsGetValue (i + 1, PARAM_INDEX_MOD_SOURCE) == MOD_SOURCE_ENVELOPE)
+        {
+          modulationTriggerEnvelope (i);
+        }
+
         //if knob controller joystick is currently centred
-        if (knobControllerData[i].relativeValue == 0)
+        else if (knobControllerData[i].joystickValue == 0)
         {
           //Use switch to reset base value...
 
@@ -430,18 +605,9 @@ void processEncoderSwitchChange (RotaryEncoder &enc)
           //therefore the workaround for this is to send two CCs to reset the knob value - 1 followed by 0.
 
           for (int8_t val = 1; val >= 0; val--)
-          {
-            knobControllerData[i].baseValue = val;
+            setKnobControllerBaseValue (i, val, true);
 
-            if (knobControllerData[i].baseValue != knobControllerData[i].prevBaseValue)
-            {
-              setKnobControllerCombinedMidiValue (i, true);
-              knobControllerData[i].prevBaseValue = knobControllerData[i].baseValue;
-            }
-
-          } //for (uint8_t val = 1; val >= 0; val--)
-
-        } // if (knobControllerData[i].relativeValue)
+        } // if (knobControllerData[i].joystickValue == 0)
 
         //if knob controller joystick is being used
         else
@@ -449,23 +615,26 @@ void processEncoderSwitchChange (RotaryEncoder &enc)
           //Use switch to set the current combined value as the base value...
           //(would be better if this behaviour could instead be triggered by the JS switches,
           //however these aren't wired on the current prototype).
+          KnobControllerData &data = knobControllerData[i];
 
-          //set the base values
-          knobControllerData[i].baseValue = knobControllerData[i].combinedMidiValue;
-          knobControllerData[i].prevBaseValue = knobControllerData[i].baseValue;
+          //reset the joystick value, leaving any modulation and gesture loop values, which carry on being applied
+          //on top of the base value (so mustn't be included in it, or they would be applied twice from their next tick)
+          data.joystickValue = 0;
+          data.relativeValue = constrain (data.modulationValue + data.looperValue, -128, 127);
+          data.prevRelativeValue = data.relativeValue;
 
-          //reset relative values
-          knobControllerData[i].relativeValue = 0;
-          knobControllerData[i].prevRelativeValue = knobControllerData[i].relativeValue;
+          //set the base value to the one that the remaining relative value moves to the current combined value
+          deviceParamValue (i) = getKnobControllerBaseValue (data.combinedMidiValue, data.relativeValue);
 
-          //Don't need to set combined MIDI value as this isn't changing (and therefore
-          //don't need to send a new MIDI message or update the LCD)
+          //The combined MIDI value is unchanged, other than by rounding or where the remaining relative value can't
+          //reach it from any base value, so this usually doesn't send a MIDI message or update the LCD
+          setKnobControllerCombinedMidiValue (i, true);
 
           //flag to ignore knob controller joystick until it is centred again
           //(otherwise the relative value will jump with the next joystick movement)
           ignoreJsMessage[i] = true;
 
-        } //else (relativeValue[i] != 0)
+        } //else (knobControllerData[i].joystickValue != 0)
 
       } //if (enc.getSwitchState() > 0)
 
@@ -476,23 +645,28 @@ void processEncoderSwitchChange (RotaryEncoder &enc)
   //=========================================================================
   if (enc == *lcdEncoders[LCD_ENC_CTRL])
   {
-#ifdef DEBUG
-    Serial.print ("LCD CTRL encoder swich: ");
-    Serial.println (enc.getSwitchState());
-#endif
+    TRACE (TRACE_LCD_CTRL_ENCODER_SWITCH, 0, enc.getSwitchState());
 
-    //if switch is being turned on
-    if (enc.getSwitchState() > 0)
+    //The display mode is toggled when the switch is released, unless the switch
+    //has been used with the other buttons to select or save a settings preset.
+
+    //if switch is being turned off, and we don't want to ignore it
+    if (enc.getSwitchState() == 0 && !ignoreNextLcdCtrlSwitchRelease)
     {
       lcdToggleDisplayMode();
 
-      //if switching away from menu display, do a delta save of settings
+      //if switching away from menu display, queue a delta save of settings
       if (lcdDisplayMode == LCD_DISPLAY_MODE_CONTROLS)
       {
         settingsSaveToEeprom (true);
       }
 
-    } //if (enc.getSwitchState() > 0)
+    } //if (enc.getSwitchState() == 0 && !ignoreNextLcdCtrlSwitchRelease)
+
+    if (enc.getSwitchState() == 0)
+      ignoreNextLcdCtrlSwitchRelease = false;
+
+    lcdCtrlSwitchState = enc.getSwitchState();
 
   } //if (enc == *lcdEncoders[LCD_ENC_CTRL])
 }
@@ -505,10 +679,7 @@ void processPushButtonChange (SwitchControl &switchControl)
   //=========================================================================
   if (switchControl == *presetUpButton)
   {
-#ifdef DEBUG
-    Serial.print ("Preset Up Button: ");
-    Serial.println (switchControl.getSwitchState());
-#endif
+    TRACE (TRACE_PRESET_UP_BUTTON, 0, switchControl.getSwitchState());
 
     presetUpButtonState = handlePresetButtonInteraction (PRESET_BUTTON_TYPE_UP, switchControl.getSwitchState());
 
@@ -517,10 +688,7 @@ void processPushButtonChange (SwitchControl &switchControl)
   //=========================================================================
   else if (switchControl == *presetDownButton)
   {
-#ifdef DEBUG
-    Serial.print ("Preset Down Button: ");
-    Serial.println (switchControl.getSwitchState());
-#endif
+    TRACE (TRACE_PRESET_DOWN_BUTTON, 0, switchControl.getSwitchState());
 
     presetDownButtonState = handlePresetButtonInteraction (PRESET_BUTTON_TYPE_DOWN, switchControl.getSwitchState());
 
@@ -529,26 +697,23 @@ void processPushButtonChange (SwitchControl &switchControl)
   //=========================================================================
   else if (switchControl == *randomiseButton)
   {
-#ifdef DEBUG
-    Serial.print ("Randomise Button: ");
-    Serial.println (switchControl.getSwitchState());
-#endif
+    TRACE (TRACE_RANDOMISE_BUTTON, 0, switchControl.getSwitchState());
 
     if (switchControl.getSwitchState() != randomiseButtonState)
     {
-      //if a button release that we don't want to ignore
-      if (switchControl.getSwitchState() == 0 && !ignoreNextRandomiseButtonRelease)
+      //if a button release while the LCD control switch is held, save the current settings as a preset
+      if (switchControl.getSwitchState() == 0 && lcdCtrlSwitchState > 0)
       {
-        //send MIDI message
-        byte channel = settingsData[SETTINGS_RANDOMISE].paramData[PARAM_INDEX_MIDI_CHAN].value;
-        if (channel == 0)
-          channel = settingsData[SETTINGS_GLOBAL].paramData[PARAM_INDEX_MIDI_CHAN].value;
-        byte control = settingsData[SETTINGS_RANDOMISE].paramData[PARAM_INDEX_CC_NUM].value;
+        presetsSaveCurrentSettings();
+
+        ignoreNextLcdCtrlSwitchRelease = true;
+      }
 
-        //The Turnado randomise button needs a CC value change to trigger it (sending the same CC value won't do anything).
-        //Therefore need to send two CC's here each with a different value.
-        sendMidiCcMessage (channel, control, 127, -1);
-        sendMidiCcMessage (channel, control, 0, -1);
+      //if a button release that we don't want to ignore
+      else if (switchControl.getSwitchState() == 0 && !ignoreNextRandomiseButtonRelease)
+      {
+        //send MIDI message(s) - by default a CC pair, as the Turnado randomise button needs a CC value change to trigger it
+        messageMapSend (MESSAGE_MAP_RANDOMISE, 127);
 
       } //if (switchControl.getSwitchState() == 0 && !ignoreNextRandomiseButtonRelease)
 
@@ -572,22 +737,22 @@ void processJoystickChange (ThumbJoystick &thumbJoystick, bool isYAxis)
     {
       if (thumbJoystick == *knobControllersJoysticks[i])
       {
-#ifdef DEBUG
-        Serial.print ("Knob Controller ");
-        Serial.print (i + 1);
-        Serial.print (" joystick: ");
-        Serial.println (thumbJoystick.getYAxisValue());
-#endif
+        TRACE (TRACE_KNOB_JOYSTICK, i + 1, thumbJoystick.getYAxisValue());
 
-        if (!ignoreJsMessage[i])
+        //when scene morphing, the dictator joystick morphs the scenes instead
+        if (i == DICTATOR_KNOB_CONTROLLER_INDEX && sceneMorphEnabled)
         {
-          knobControllerData[i].relativeValue = thumbJoystick.getYAxisValue();
+          if (!ignoreJsMessage[i])
+            sceneMorphSetPosition (thumbJoystick.getYAxisValue());
+          else if (thumbJoystick.getYAxisValue() == 0)
+            ignoreJsMessage[i] = false;
+        }
+
+        else if (!ignoreJsMessage[i])
+        {
+          knobControllerData[i].joystickValue = thumbJoystick.getYAxisValue();
+          setKnobControllerRelativeValue (i);
 
-          if (knobControllerData[i].relativeValue != knobControllerData[i].prevRelativeValue)
-          {
-            setKnobControllerCombinedMidiValue (i, true);
-            knobControllerData[i].prevRelativeValue = knobControllerData[i].relativeValue;
-          }
         } //if (!ignoreJsMessage[i])
 
         else
@@ -603,3 +768,58 @@ void processJoystickChange (ThumbJoystick &thumbJoystick, bool isYAxis)
 
   } //if (isYAxis)
 }
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void toggleJoystickCalibration()
+{
+  //Starts learning the calibration of every joystick (which must be at rest), or stops learning and saves the
+  //calibration of the joysticks that were moved to both ends (see JoystickCalibration.h).
+  //Called from the loop, so the realtime tasks are held off while the joysticks are changed, but not while
+  //printing (which can wait on USB serial).
+  bool calibrated[NUM_OF_KNOB_CONTROLLERS];
+
+  scheduler.suspendRealtimeTasks (true);
+
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    if (!joysticksCalibrating)
+    {
+      knobControllersJoysticks[i]->startCalibration();
+    }
+    else
+    {
+      calibrated[i] = knobControllersJoysticks[i]->stopCalibration();
+      joystickCalibration[i] = knobControllersJoysticks[i]->getCalibration();
+    }
+  }
+
+  joysticksCalibrating = !joysticksCalibrating;
+
+  scheduler.suspendRealtimeTasks (false);
+
+  if (joysticksCalibrating)
+  {
+    Serial.println ("Joystick calibration started - move each joystick to both ends, then send 'c' again");
+    return;
+  }
+
+  Serial.print ("Joystick calibration stopped: ");
+
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    const ThumbJoystick::Calibration &calibration = joystickCalibration[i];
+
+    Serial.print (calibration.minValue);
+    Serial.print ("/");
+    Serial.print (calibration.centreValue);
+    Serial.print ("/");
+    Serial.print (calibration.maxValue);
+    Serial.print (calibrated[i] ? " " : " (unchanged) ");
+  }
+
+  Serial.println();
+
+  joystickCalibrationSave();
+}
@@ -0,0 +1,25 @@
+/*
+  FnvHash.h - FNV-1a hash, for cheaply checking whether two runs produced
+  the same data (e.g. MIDI output or a drawn LCD frame).
+*/
+
+#ifndef FnvHash_h
+#define FnvHash_h
+
+#include <stdint.h>
+
+const uint32_t FNV_HASH_INIT = 2166136261UL;
+
+/** Returns the hash with the given data added to it a byte at a time (start with FNV_HASH_INIT)
+*/
+inline uint32_t fnvHash (uint32_t hash, const void *data, uint16_t length)
+{
+  const uint8_t *bytes = (const uint8_t*)data;
+
+  for (uint16_t i = 0; i < length; i++)
+    hash = (hash ^ bytes[i]) * 16777619UL;
+
+  return hash;
+}
+
+#endif
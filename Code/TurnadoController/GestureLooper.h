@@ -0,0 +1,390 @@
+//=========================================================================
+//Joystick gesture looper.
+//
+//Each knob controller (including the dictator) has a looper lane that can record a gesture made with its
+//joystick and then play it back in a loop, so that the gesture carries on while the joystick is let go.
+//Holding the randomise button and pressing a knob controller's encoder switch steps its lane from idle to
+//recording, from recording to playing, and from playing back to idle. The played back value is added to the
+//joystick and modulation values to give the knob controller's relative value (see setKnobControllerRelativeValue()).
+//
+//Lanes are run by their own task on a fixed rate tick of GESTURE_LOOPER_TICK_US, sampling the joystick value once
+//per tick while recording. If the task runs late the missed ticks are caught up in one go, as with modulation
+//(see Modulation.h), so loops keep their length. As the joystick value only changes when it gets past the
+//joystick hysteresis, samples are stored as run-length and delta codes, one byte each:
+//  0nnnnnnn - the previous value is held for n + 1 ticks
+//  1ddddddd - the value changes by d (-63 to 63) for one tick, where d = -64 is followed by the new value itself
+//
+//Size: a held joystick takes 1 byte per 128ms (8 bytes/s), and a joystick that is moving on every tick takes
+//1 byte per tick (1KB/s, or 2KB/s for jumps of more than 63). Each lane has a GESTURE_LOOPER_LANE_SIZE buffer,
+//so at least 4 seconds of constantly moving gesture and usually a lot more, and recording ends (with the loop
+//playing) when it is full. All 9 lanes take 36KB.
+//
+//When the global Mod Sync is set to MIDI clock, the length of a recorded loop is rounded to a 1/16 note of
+//the MIDI clock pulses received while recording, and the loop is then played back at the speed of the MIDI
+//clock, so it follows tempo changes, with a MIDI start playing every loop from the beginning.
+//
+//Playing back just steps through the codes, so a tick of 9 playing lanes has a small, fixed cost - see the
+//gesture looper benchmark (Benchmarks.h) and the gesture looper task profile stats.
+
+#define GESTURE_LOOPER_TICK_US 1000
+#define GESTURE_LOOPER_MAX_CATCH_UP_TICKS 1000
+#define GESTURE_LOOPER_LANE_SIZE 4096
+#define GESTURE_LOOPER_MAX_RUN 128
+#define GESTURE_LOOPER_DELTA_ESCAPE -64
+#define GESTURE_LOOPER_CLOCK_PULSES_PER_STEP 6 //synced loop lengths are rounded to 1/16 notes
+
+enum GestureLooperStates
+{
+  GESTURE_LOOPER_IDLE = 0,
+  GESTURE_LOOPER_RECORDING,
+  GESTURE_LOOPER_PLAYING
+};
+
+struct GestureLooperLane
+{
+  uint8_t data[GESTURE_LOOPER_LANE_SIZE];
+  uint16_t length; //in bytes
+  uint8_t state;
+
+  uint32_t lengthInTicks;
+  uint32_t lengthInClockPulses; //0 if not synced to MIDI clock
+
+  //recording state
+  int16_t recordValue;
+  uint8_t recordRun; //ticks of recordValue not yet written
+
+  //playback state
+  uint16_t playPos;
+  uint8_t playRun; //ticks left of the current code
+  int16_t playValue;
+  uint32_t playClockPhase; //in ticks x MIDI clock pulses, when synced to MIDI clock
+};
+
+GestureLooperLane gestureLooperLanes[NUM_OF_KNOB_CONTROLLERS];
+
+uint32_t gestureLooperPrevTickTime = 0;
+uint16_t gestureLooperPendingClockPulses = 0; //MIDI clock pulses received since the last tick
+
+//called before a lane starts recording over its data, and for every tick (used by the input trace, see InputTrace.h)
+void (*gestureLooperOnStartRecording) (uint8_t index) = nullptr;
+void (*gestureLooperOnTick) (uint16_t numOfTicks, uint8_t numOfClockPulses) = nullptr;
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void setupGestureLooper()
+{
+  gestureLooperPrevTickTime = micros();
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void gestureLooperWrite (GestureLooperLane &lane, uint8_t code)
+{
+  lane.data[lane.length++] = code;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void gestureLooperFlushRun (GestureLooperLane &lane)
+{
+  if (lane.recordRun > 0)
+  {
+    gestureLooperWrite (lane, lane.recordRun - 1);
+    lane.recordRun = 0;
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void gestureLooperRecord (GestureLooperLane &lane, int16_t value, uint32_t numOfTicks)
+{
+  //Adds a joystick value held for a number of ticks to a recording lane
+  if (value != lane.recordValue)
+  {
+    gestureLooperFlushRun (lane);
+
+    int16_t delta = value - lane.recordValue;
+
+    if (delta > GESTURE_LOOPER_DELTA_ESCAPE && delta < -GESTURE_LOOPER_DELTA_ESCAPE)
+    {
+      gestureLooperWrite (lane, 0x80 | (delta & 0x7F));
+    }
+    else
+    {
+      gestureLooperWrite (lane, 0x80 | (GESTURE_LOOPER_DELTA_ESCAPE & 0x7F));
+      gestureLooperWrite (lane, (uint8_t)value);
+    }
+
+    lane.recordValue = value;
+    lane.lengthInTicks++;
+    numOfTicks--;
+
+  } //if (value != lane.recordValue)
+
+  lane.lengthInTicks += numOfTicks;
+
+  while (numOfTicks > 0)
+  {
+    uint32_t run = min (numOfTicks, (uint32_t)(GESTURE_LOOPER_MAX_RUN - lane.recordRun));
+
+    lane.recordRun += run;
+    numOfTicks -= run;
+
+    if (lane.recordRun == GESTURE_LOOPER_MAX_RUN)
+      gestureLooperFlushRun (lane);
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+int16_t gestureLooperPlay (GestureLooperLane &lane, uint32_t numOfTicks)
+{
+  //Advances a playing lane by a number of ticks, returning its value
+  while (numOfTicks > 0)
+  {
+    if (lane.playRun > 0)
+    {
+      uint32_t run = min (numOfTicks, (uint32_t)lane.playRun);
+
+      lane.playRun -= run;
+      numOfTicks -= run;
+
+      continue;
+    }
+
+    //back to the start of the loop
+    if (lane.playPos >= lane.length)
+    {
+      lane.playPos = 0;
+      lane.playValue = 0;
+    }
+
+    uint8_t code = lane.data[lane.playPos++];
+
+    if (code & 0x80)
+    {
+      int8_t delta = (int8_t)(code << 1) >> 1; //sign extend the 7 bits
+
+      if (delta == GESTURE_LOOPER_DELTA_ESCAPE)
+        lane.playValue = (int8_t)lane.data[lane.playPos++];
+      else
+        lane.playValue += delta;
+
+      lane.playRun = 1;
+    }
+    else
+    {
+      lane.playRun = code + 1;
+    }
+
+  } //while (numOfTicks > 0)
+
+  return lane.playValue;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void gestureLooperRestart (GestureLooperLane &lane)
+{
+  lane.playPos = 0;
+  lane.playRun = 0;
+  lane.playValue = 0;
+  lane.playClockPhase = 0;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void gestureLooperRestartAll()
+{
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+    gestureLooperRestart (gestureLooperLanes[i]);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void gestureLooperSetValue (uint8_t index, int16_t value)
+{
+  if (value != knobControllerData[index].looperValue)
+  {
+    knobControllerData[index].looperValue = value;
+    setKnobControllerRelativeValue (index);
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void gestureLooperStartRecording (uint8_t index)
+{
+  GestureLooperLane &lane = gestureLooperLanes[index];
+
+  if (gestureLooperOnStartRecording)
+    gestureLooperOnStartRecording (index);
+
+  lane.length = 0;
+  lane.lengthInTicks = 0;
+  lane.lengthInClockPulses = 0;
+  lane.recordValue = 0;
+  lane.recordRun = 0;
+  lane.state = GESTURE_LOOPER_RECORDING;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void gestureLooperStopRecording (uint8_t index)
+{
+  //Ends a recording and starts playing it, unless nothing was recorded
+  GestureLooperLane &lane = gestureLooperLanes[index];
+
+  gestureLooperFlushRun (lane);
+
+  if (lane.lengthInTicks == 0)
+  {
+    lane.state = GESTURE_LOOPER_IDLE;
+    return;
+  }
+
+  //round the loop to a 1/16 note if it was recorded against MIDI clock
+  if (settingsGetValue (SETTINGS_GLOBAL, PARAM_INDEX_MOD_SYNC) == MOD_SYNC_MIDI_CLOCK && lane.lengthInClockPulses > 0)
+  {
+    uint32_t numOfSteps = (lane.lengthInClockPulses + (GESTURE_LOOPER_CLOCK_PULSES_PER_STEP / 2)) / GESTURE_LOOPER_CLOCK_PULSES_PER_STEP;
+    lane.lengthInClockPulses = max (numOfSteps, (uint32_t)1) * GESTURE_LOOPER_CLOCK_PULSES_PER_STEP;
+  }
+  else
+  {
+    lane.lengthInClockPulses = 0;
+  }
+
+  gestureLooperRestart (lane);
+  lane.state = GESTURE_LOOPER_PLAYING;
+
+  TRACE (TRACE_GESTURE_LOOP, index + 1, lane.length, lane.lengthInTicks);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void gestureLooperToggle (uint8_t index)
+{
+  //Steps a knob controller's lane from idle to recording to playing and back to idle
+  switch (gestureLooperLanes[index].state)
+  {
+    case GESTURE_LOOPER_IDLE:
+      gestureLooperStartRecording (index);
+      break;
+
+    case GESTURE_LOOPER_RECORDING:
+      gestureLooperStopRecording (index);
+      break;
+
+    case GESTURE_LOOPER_PLAYING:
+      gestureLooperLanes[index].state = GESTURE_LOOPER_IDLE;
+      gestureLooperSetValue (index, 0);
+      break;
+
+    default:
+      break;
+
+  } //switch (gestureLooperLanes[index].state)
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool gestureLooperTick (uint16_t numOfTicks, uint8_t numOfClockPulses)
+{
+  //Advances every recording and playing lane by a number of ticks, returning whether any lane is in use
+  bool isRunning = false;
+
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    GestureLooperLane &lane = gestureLooperLanes[i];
+
+    if (lane.state == GESTURE_LOOPER_RECORDING)
+    {
+      isRunning = true;
+
+      //end the recording if the worst case of this tick's codes won't fit
+      if (lane.length + 4 + (numOfTicks / GESTURE_LOOPER_MAX_RUN) > GESTURE_LOOPER_LANE_SIZE)
+      {
+        gestureLooperStopRecording (i);
+      }
+      else
+      {
+        gestureLooperRecord (lane, knobControllerData[i].joystickValue, numOfTicks);
+        lane.lengthInClockPulses += numOfClockPulses;
+      }
+    }
+
+    else if (lane.state == GESTURE_LOOPER_PLAYING)
+    {
+      isRunning = true;
+
+      uint32_t ticks = numOfTicks;
+
+      //when synced, play the whole loop over its length in MIDI clock pulses
+      if (lane.lengthInClockPulses > 0)
+      {
+        lane.playClockPhase += numOfClockPulses * lane.lengthInTicks;
+        ticks = lane.playClockPhase / lane.lengthInClockPulses;
+        lane.playClockPhase %= lane.lengthInClockPulses;
+      }
+
+      gestureLooperSetValue (i, gestureLooperPlay (lane, ticks));
+    }
+
+  } //for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+
+  return isRunning;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void gestureLooperProcessMidiClock()
+{
+  gestureLooperPendingClockPulses++;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void gestureLooperProcessMidiStart()
+{
+  gestureLooperPendingClockPulses = 0;
+
+  gestureLooperRestartAll();
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void updateGestureLooper (uint32_t tickTime)
+{
+  PROFILE_SCOPE (PROFILE_TASK_GESTURE_LOOPER);
+
+  uint32_t numOfTicks = (tickTime - gestureLooperPrevTickTime) / GESTURE_LOOPER_TICK_US;
+
+  if (numOfTicks == 0)
+    return;
+
+  gestureLooperPrevTickTime += numOfTicks * GESTURE_LOOPER_TICK_US;
+
+  numOfTicks = min (numOfTicks, (uint32_t)GESTURE_LOOPER_MAX_CATCH_UP_TICKS);
+  uint8_t numOfClockPulses = min (gestureLooperPendingClockPulses, (uint16_t)UINT8_MAX);
+  gestureLooperPendingClockPulses = 0;
+
+  gestureLooperTick (numOfTicks, numOfClockPulses);
+
+  if (gestureLooperOnTick)
+    gestureLooperOnTick (numOfTicks, numOfClockPulses);
+}
@@ -1,6 +1,10 @@
 //=========================================================================
 //DEV STUFF...
-//#define DEBUG 1
+//#define DEBUG 1 //trace debug events (see Trace.h)
+//#define DISABLE_PROFILER 1
+//#define RUN_BENCHMARKS 1
+//#define ENABLE_INPUT_TRACE 1
+//#define DISABLE_TIMER_TASKS 1 //run the realtime tasks from loop() as well, e.g. to compare the input jitter
 
 //=========================================================================
 #define NUM_OF_KNOB_CONTROLLERS 9 //Includes dictator mode controller
@@ -27,6 +31,8 @@ enum LcdDisplayModes
   LCD_DISPLAY_MODE_SETTINGS_MENU
 };
 
+#include "FnvHash.h" //fnvHash() and FNV_HASH_INIT, shared with MeteredLcd and the host LCD shim
+
 /*
    _TODO:_
    Comment / document code
@@ -34,13 +40,11 @@ enum LcdDisplayModes
    
    _Future version feature and changes ideas:_
    - Allow dictator encoder switch to 'stick' any current used knob joysticks if being used
-   - Implement knob and dictator control time quantisation, where the activating and deactivating of controls is quantised to a set MIDI time / clock ticks value (configurable globally and per control). This will involve the controller repsonding to MIDI clock messages and MIDI start messages. 
-   - Allow internal presets of settings that can be changed with a button combination (LCD ctrl switch + preset buttons?). Display preset number in controls display top bar.
+   - Implement knob and dictator control time quantisation, where the activating and deactivating of controls is quantised to a set MIDI time / clock ticks value (configurable globally and per control), using the received MIDI clock that the modulation already syncs to. 
    - Improve knob controller (and dictator) sliders on LCS to show the difference between the base value and relative value. E.g Base value shown with a bar, relative value shown as slider value starting at bar position.
    - Implement global setting for auto switching LCD display with control messages
    - Have a global settings option to set control settings to default settings
    - Consider improving LCD display general layouts, colours, etc...
-   - Allow device to be a fully assignable generic MIDI controller, where each control (except for the LCD controls) have completely configurable MIDI messages
    - Change LCD drawing code to use relative positions of the LCD size (as opposed to absolute values)
    - Consider drawing menu display from 'update' function rather than on control changes
 */
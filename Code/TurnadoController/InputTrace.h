@@ -0,0 +1,1187 @@
+//=========================================================================
+//Input trace recording and replay.
+//
+//Records the raw input stream into a RAM buffer - encoder counts, joystick samples, debounced switch
+//changes, MIDI-in CCs and MIDI clock and start - each with the time since the previous input, in 6 byte records.
+//Only joystick samples that get past the joystick hysteresis are recorded, as the rest have no effect.
+//The state of the control logic is copied when recording starts, and hashes of the MIDI output and of the
+//resulting display state are taken when it stops.
+//
+//The program cache (see ProgramCache.h) and the gesture looper lanes' data (see GestureLooper.h) are too big to
+//copy whole (57KB), and only a few programs and lanes are ever written over by a trace, so instead each block
+//of them is saved the first time the trace is about to write over it - a program's values when they are cached,
+//and a lane's data when it starts recording (or when recording starts, if the lane is already recording).
+//The saved blocks are kept in a pool, and recording ends when the pool might not have room for the next input.
+//
+//Replaying puts the control logic back into its starting state and feeds the recorded inputs back through
+//it as fast as it can, with MIDI sent to the null MIDI-out sink. If the replayed MIDI output and display state
+//hashes don't match those recorded then the control logic isn't deterministic for that trace (or has changed).
+//The replay time and rate are printed, and the controller is then put back to how it was before replaying.
+//
+//Replaying runs in one go, so holds up the rest of the loop while it runs - it is a dev tool.
+//
+//Modulation and gesture loops (see Modulation.h and GestureLooper.h) are driven by time rather than inputs.
+//Their tasks tick once a millisecond, straight after the inputs of that millisecond, so the replay runs those
+//ticks from the records' time deltas, and only ticks that don't fit that pattern (a task that ran late and caught
+//up) are recorded, along with where the last ticks were wherever ticks were missed, and when recording ended.
+//
+//Serial commands (see SerialCommands.h): 't' starts recording, 's' stops recording,
+//'x' replays the trace, and 'd' dumps the trace - the start state, saved blocks and records, as hex - which can
+//be replayed on a desktop machine by the host build's input trace replayer (see Code/Host).
+//
+//Define ENABLE_INPUT_TRACE (see Globals.h) to include the recorder.
+
+#ifdef ENABLE_INPUT_TRACE
+
+#define INPUT_TRACE_MAX_NUM_OF_RECORDS 4096 //24KB
+#define INPUT_TRACE_NUM_OF_REPLAYS 10 //number of times the trace is replayed, for timing
+#define INPUT_TRACE_RECORDS_PER_DUMP_LINE 4
+#define INPUT_TRACE_BYTES_PER_DUMP_LINE 24
+#define INPUT_TRACE_MIN_SERIAL_SPACE 64
+#define INPUT_TRACE_SAVE_POOL_SIZE (16 * 1024) //the saved blocks, from the start state and from the live state
+#define INPUT_TRACE_MAX_NUM_OF_SAVED_BLOCKS 64
+#define INPUT_TRACE_MAX_RECORDS_PER_INPUT 3 //a time gap, missed ticks and the input
+#define INPUT_TRACE_NUM_OF_END_RECORDS 2
+
+enum InputTraceTypes
+{
+  INPUT_TRACE_ENCODER_COUNT = 0, //id = encoder (see inputTraceGetEncoder()), value = count
+  INPUT_TRACE_ENCODER_SWITCH, //id = encoder, value = switch state
+  INPUT_TRACE_JOYSTICK, //id = knob controller, value = Y-axis sample
+  INPUT_TRACE_BUTTON, //id = button (see inputTraceGetButton()), value = switch state
+  INPUT_TRACE_MIDI_CC, //id = control, value = (channel << 8) | value
+  INPUT_TRACE_TIME, //a time gap too long for a single record, where value is the top 16 bits of the gap
+  INPUT_TRACE_MODULATION_TICK, //a tick that wasn't a single tick a millisecond after the last, id = MIDI clock pulses, value = ticks
+  INPUT_TRACE_GESTURE_LOOPER_TICK, //as for INPUT_TRACE_MODULATION_TICK
+  INPUT_TRACE_MIDI_CLOCK,
+  INPUT_TRACE_MIDI_START,
+  INPUT_TRACE_TICKS_MISSED, //ticks that should have run before the next record didn't (so are caught up in a later tick),
+                            //id = ms since the last modulation tick (up to 255), value = since the last looper tick
+  INPUT_TRACE_TICKS_END //the end of the trace, as for INPUT_TRACE_TICKS_MISSED
+};
+
+//The time driven tasks that are replayed from the time deltas, in the order that they are run in each millisecond,
+//where each source's tick records are of type INPUT_TRACE_MODULATION_TICK + source
+enum InputTraceTickSources
+{
+  INPUT_TRACE_TICK_MODULATION = 0,
+  INPUT_TRACE_TICK_GESTURE_LOOPER,
+
+  INPUT_TRACE_NUM_OF_TICK_SOURCES
+};
+
+enum InputTraceDumpStages
+{
+  INPUT_TRACE_DUMP_IDLE = 0,
+  INPUT_TRACE_DUMP_STATE,
+  INPUT_TRACE_DUMP_BLOCKS,
+  INPUT_TRACE_DUMP_RECORDS
+};
+
+enum InputTraceStates
+{
+  INPUT_TRACE_STATE_IDLE = 0,
+  INPUT_TRACE_STATE_RECORDING,
+  INPUT_TRACE_STATE_FULL, //recording has ended as the trace is full, and is stopped by the background task
+  INPUT_TRACE_STATE_REPLAYING
+};
+
+struct InputTraceRecord
+{
+  uint16_t timeDelta; //in milliseconds since the previous record
+  uint8_t type;
+  uint8_t id;
+  int16_t value;
+};
+
+static_assert (sizeof (InputTraceRecord) == 6, "Input trace records should be 6 bytes");
+
+//A block of the program cache or of a looper lane's data that the trace writes over, saved in the pool
+struct InputTraceSavedBlock
+{
+  uint8_t *data;
+  uint16_t size;
+  uint16_t poolPos;
+  int8_t looperLane; //the lane whose data this is, or -1 for a program's values in the program cache
+};
+
+//the start of a looper lane after its data, which is copied as part of the control state
+#define INPUT_TRACE_LOOPER_LANE_STATE_OFFSET offsetof (GestureLooperLane, length)
+#define INPUT_TRACE_LOOPER_LANE_STATE_SIZE (sizeof (GestureLooperLane) - INPUT_TRACE_LOOPER_LANE_STATE_OFFSET)
+
+//Everything that the control logic reads and changes while processing inputs
+struct InputTraceControlState
+{
+  decltype (::settingsValues) settingsValues;
+  decltype (::settingsDirtyMask) settingsDirtyMask;
+  decltype (::settingsSaveRequested) settingsSaveRequested;
+  decltype (::journalCompactionRequested) journalCompactionRequested;
+  decltype (::presetsStore) presetsStore;
+  decltype (::presetsStoreLength) presetsStoreLength;
+  decltype (::presetsNumOfPresets) presetsNumOfPresets;
+  decltype (::presetsActivePreset) presetsActivePreset;
+
+  decltype (::knobControllerData) knobControllerData;
+  decltype (::ignoreJsMessage) ignoreJsMessage;
+  decltype (::randomiseButtonState) randomiseButtonState;
+  decltype (::ignoreNextRandomiseButtonRelease) ignoreNextRandomiseButtonRelease;
+  decltype (::presetUpButtonState) presetUpButtonState;
+  decltype (::presetDownButtonState) presetDownButtonState;
+  decltype (::ignoreNextPresetButtonRelease) ignoreNextPresetButtonRelease;
+  decltype (::lcdCtrlSwitchState) lcdCtrlSwitchState;
+  decltype (::ignoreNextLcdCtrlSwitchRelease) ignoreNextLcdCtrlSwitchRelease;
+
+  decltype (::midiChannelState) midiChannelState;
+  decltype (::deviceParamChannelIndex) deviceParamChannelIndex;
+  decltype (::programChannelIndex) programChannelIndex;
+  decltype (ProgramCache::validBits) programCacheValidBits;
+  decltype (::prevKnobControllerMidiSendTime) prevKnobControllerMidiSendTime;
+  decltype (::modulationState) modulationState;
+  decltype (::modulationRandomState) modulationRandomState;
+  decltype (::modulationPendingClockPulses) modulationPendingClockPulses;
+  decltype (::gestureLooperPendingClockPulses) gestureLooperPendingClockPulses;
+  uint8_t gestureLooperLaneStates[NUM_OF_KNOB_CONTROLLERS][INPUT_TRACE_LOOPER_LANE_STATE_SIZE];
+  decltype (::sceneMorphScenes) sceneMorphScenes;
+  decltype (::sceneMorphCapturedMask) sceneMorphCapturedMask;
+  decltype (::sceneMorphEnabled) sceneMorphEnabled;
+  decltype (::sceneMorphPairs) sceneMorphPairs;
+  decltype (::sceneMorphNumOfScenes) sceneMorphNumOfScenes;
+  decltype (::sceneMorphValues) sceneMorphValues;
+
+  decltype (::lcdDisplayMode) lcdDisplayMode;
+  decltype (::lcdSliderValue) lcdSliderValue;
+  decltype (::lcdCurrentlySelectedMenu) lcdCurrentlySelectedMenu;
+  decltype (::lcdPrevSelectedMenu) lcdPrevSelectedMenu;
+  decltype (::lcdCurrentSelectedMenuParam) lcdCurrentSelectedMenuParam;
+  decltype (::lcdPrevSelectedMenuParam) lcdPrevSelectedMenuParam;
+};
+
+InputTraceRecord inputTraceRecords[INPUT_TRACE_MAX_NUM_OF_RECORDS];
+uint16_t inputTraceNumOfRecords = 0;
+volatile uint8_t inputTraceState = INPUT_TRACE_STATE_IDLE; //(set to full from the realtime tasks)
+
+InputTraceControlState inputTraceStartState;
+InputTraceControlState inputTraceLiveState; //the state before replaying, which is put back afterwards
+
+InputTraceSavedBlock inputTraceStartBlocks[INPUT_TRACE_MAX_NUM_OF_SAVED_BLOCKS];
+uint8_t inputTraceNumOfStartBlocks = 0;
+InputTraceSavedBlock inputTraceLiveBlocks[INPUT_TRACE_MAX_NUM_OF_SAVED_BLOCKS + NUM_OF_KNOB_CONTROLLERS];
+uint8_t inputTraceNumOfLiveBlocks = 0;
+uint8_t inputTraceSavePool[INPUT_TRACE_SAVE_POOL_SIZE]; //the start state's blocks, with the live state's after them
+uint16_t inputTraceSavePoolSize = 0;
+
+uint16_t inputTraceLooperLanesSavedMask = 0; //lanes whose data is in the start blocks
+uint16_t inputTraceLooperLanesWrittenMask = 0; //lanes that the trace records into
+uint32_t inputTraceStartTime = 0;
+uint32_t inputTracePrevRecordTime = 0;
+uint32_t inputTracePrevTickTimes[INPUT_TRACE_NUM_OF_TICK_SOURCES];
+uint32_t inputTraceDuration = 0;
+uint32_t inputTraceMidiOutHash = 0;
+uint32_t inputTraceStateHash = 0;
+uint32_t inputTraceMidiOutNumOfMessages = 0;
+
+uint8_t inputTraceDumpStage = INPUT_TRACE_DUMP_IDLE;
+uint8_t inputTraceDumpBlock = 0;
+int32_t inputTraceDumpPos = 0; //the next byte of the state or block (where -1 is the block's header), or the next record
+
+//=========================================================================
+void inputTraceRecordEncoderInput (RotaryEncoder &enc, uint8_t inputType, int value);
+void inputTraceRecordJoystickInput (ThumbJoystick &thumbJoystick, int16_t value);
+void inputTraceRecordButtonInput (SwitchControl &switchControl, uint8_t state);
+void inputTraceRecordMidiControlChange (byte channel, byte control, byte value);
+void inputTraceRecordMidiClock();
+void inputTraceRecordMidiStart();
+void inputTraceRecordModulationTick (uint16_t numOfTicks, uint8_t numOfClockPulses);
+void inputTraceRecordGestureLooperTick (uint16_t numOfTicks, uint8_t numOfClockPulses);
+void inputTraceSaveProgramCacheBlock (uint8_t channelIndex, uint8_t program);
+void inputTraceSaveLooperLaneBlock (uint8_t index);
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void setupInputTrace()
+{
+  //setupControls() must be called before setupInputTrace()
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    knobControllersEncoders[i]->onRawInput (inputTraceRecordEncoderInput);
+    knobControllersJoysticks[i]->onRawInput (inputTraceRecordJoystickInput);
+  }
+
+  mixEncoder->onRawInput (inputTraceRecordEncoderInput);
+
+  for (uint8_t i = 0; i < NUM_OF_LCD_ENCS; i++)
+    lcdEncoders[i]->onRawInput (inputTraceRecordEncoderInput);
+
+  presetUpButton->onRawInput (inputTraceRecordButtonInput);
+  presetDownButton->onRawInput (inputTraceRecordButtonInput);
+  randomiseButton->onRawInput (inputTraceRecordButtonInput);
+
+  modulationOnTick = inputTraceRecordModulationTick;
+  programCacheOnStore = inputTraceSaveProgramCacheBlock;
+  gestureLooperOnStartRecording = inputTraceSaveLooperLaneBlock;
+  gestureLooperOnTick = inputTraceRecordGestureLooperTick;
+
+#ifndef DISABLE_USB_MIDI
+  //record MIDI-in CCs on their way to ProcessMidiControlChange(), and MIDI clock and start
+  usbMIDI.setHandleControlChange (inputTraceRecordMidiControlChange);
+  usbMIDI.setHandleClock (inputTraceRecordMidiClock);
+  usbMIDI.setHandleStart (inputTraceRecordMidiStart);
+#endif
+
+  //the replay is timed with the cycle counter, which the profiler may not be there to start
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+RotaryEncoder* inputTraceGetEncoder (uint8_t id)
+{
+  //ids 0-8 are the knob controller encoders, 9 is the mix encoder, and 10-12 are the LCD encoders
+  if (id < NUM_OF_KNOB_CONTROLLERS)
+    return knobControllersEncoders[id];
+  else if (id == NUM_OF_KNOB_CONTROLLERS)
+    return mixEncoder;
+  else
+    return lcdEncoders[id - NUM_OF_KNOB_CONTROLLERS - 1];
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+SwitchControl* inputTraceGetButton (uint8_t id)
+{
+  if (id == 0)
+    return presetUpButton;
+  else if (id == 1)
+    return presetDownButton;
+  else
+    return randomiseButton;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+template <typename T>
+void inputTraceCopyValue (T &stateValue, T &value, bool saveToState)
+{
+  if (saveToState)
+    memcpy (&stateValue, &value, sizeof (T));
+  else
+    memcpy (&value, &stateValue, sizeof (T));
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceCopyControlState (InputTraceControlState &state, bool saveToState)
+{
+  inputTraceCopyValue (state.settingsValues, settingsValues, saveToState);
+  inputTraceCopyValue (state.settingsDirtyMask, settingsDirtyMask, saveToState);
+  inputTraceCopyValue (state.settingsSaveRequested, settingsSaveRequested, saveToState);
+  inputTraceCopyValue (state.journalCompactionRequested, journalCompactionRequested, saveToState);
+  inputTraceCopyValue (state.presetsStore, presetsStore, saveToState);
+  inputTraceCopyValue (state.presetsStoreLength, presetsStoreLength, saveToState);
+  inputTraceCopyValue (state.presetsNumOfPresets, presetsNumOfPresets, saveToState);
+  inputTraceCopyValue (state.presetsActivePreset, presetsActivePreset, saveToState);
+
+  inputTraceCopyValue (state.knobControllerData, knobControllerData, saveToState);
+  inputTraceCopyValue (state.ignoreJsMessage, ignoreJsMessage, saveToState);
+  inputTraceCopyValue (state.randomiseButtonState, randomiseButtonState, saveToState);
+  inputTraceCopyValue (state.ignoreNextRandomiseButtonRelease, ignoreNextRandomiseButtonRelease, saveToState);
+  inputTraceCopyValue (state.presetUpButtonState, presetUpButtonState, saveToState);
+  inputTraceCopyValue (state.presetDownButtonState, presetDownButtonState, saveToState);
+  inputTraceCopyValue (state.ignoreNextPresetButtonRelease, ignoreNextPresetButtonRelease, saveToState);
+  inputTraceCopyValue (state.lcdCtrlSwitchState, lcdCtrlSwitchState, saveToState);
+  inputTraceCopyValue (state.ignoreNextLcdCtrlSwitchRelease, ignoreNextLcdCtrlSwitchRelease, saveToState);
+
+  inputTraceCopyValue (state.midiChannelState, midiChannelState, saveToState);
+  inputTraceCopyValue (state.deviceParamChannelIndex, deviceParamChannelIndex, saveToState);
+  inputTraceCopyValue (state.programChannelIndex, programChannelIndex, saveToState);
+  inputTraceCopyValue (state.programCacheValidBits, programCache.validBits, saveToState);
+  inputTraceCopyValue (state.prevKnobControllerMidiSendTime, prevKnobControllerMidiSendTime, saveToState);
+  inputTraceCopyValue (state.modulationState, modulationState, saveToState);
+  inputTraceCopyValue (state.modulationRandomState, modulationRandomState, saveToState);
+  inputTraceCopyValue (state.modulationPendingClockPulses, modulationPendingClockPulses, saveToState);
+  inputTraceCopyValue (state.gestureLooperPendingClockPulses, gestureLooperPendingClockPulses, saveToState);
+
+  //the looper lanes without their data, which is in the saved blocks
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    uint8_t *laneState = (uint8_t*)&gestureLooperLanes[i] + INPUT_TRACE_LOOPER_LANE_STATE_OFFSET;
+
+    if (saveToState)
+      memcpy (state.gestureLooperLaneStates[i], laneState, INPUT_TRACE_LOOPER_LANE_STATE_SIZE);
+    else
+      memcpy (laneState, state.gestureLooperLaneStates[i], INPUT_TRACE_LOOPER_LANE_STATE_SIZE);
+  }
+
+  inputTraceCopyValue (state.sceneMorphScenes, sceneMorphScenes, saveToState);
+  inputTraceCopyValue (state.sceneMorphCapturedMask, sceneMorphCapturedMask, saveToState);
+  inputTraceCopyValue (state.sceneMorphEnabled, sceneMorphEnabled, saveToState);
+  inputTraceCopyValue (state.sceneMorphPairs, sceneMorphPairs, saveToState);
+  inputTraceCopyValue (state.sceneMorphNumOfScenes, sceneMorphNumOfScenes, saveToState);
+  inputTraceCopyValue (state.sceneMorphValues, sceneMorphValues, saveToState);
+
+  inputTraceCopyValue (state.lcdDisplayMode, lcdDisplayMode, saveToState);
+  inputTraceCopyValue (state.lcdSliderValue, lcdSliderValue, saveToState);
+  inputTraceCopyValue (state.lcdCurrentlySelectedMenu, lcdCurrentlySelectedMenu, saveToState);
+  inputTraceCopyValue (state.lcdPrevSelectedMenu, lcdPrevSelectedMenu, saveToState);
+  inputTraceCopyValue (state.lcdCurrentSelectedMenuParam, lcdCurrentSelectedMenuParam, saveToState);
+  inputTraceCopyValue (state.lcdPrevSelectedMenuParam, lcdPrevSelectedMenuParam, saveToState);
+
+  //the message map is compiled from the settings, so needs recompiling if they've been put back
+  if (!saveToState)
+    messageMapInvalidate();
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+uint32_t inputTraceGetStateHash()
+{
+  //Hash of what the display shows, plus the settings
+  uint32_t hash = FNV_HASH_INIT;
+
+  hash = fnvHash (hash, lcdSliderValue, sizeof (lcdSliderValue));
+  hash = fnvHash (hash, &lcdDisplayMode, sizeof (lcdDisplayMode));
+  hash = fnvHash (hash, &lcdCurrentlySelectedMenu, sizeof (lcdCurrentlySelectedMenu));
+  hash = fnvHash (hash, &lcdCurrentSelectedMenuParam, sizeof (lcdCurrentSelectedMenuParam));
+  hash = fnvHash (hash, &currentMidiProgramNumber(), sizeof (currentMidiProgramNumber()));
+  hash = fnvHash (hash, &presetsActivePreset, sizeof (presetsActivePreset));
+  hash = fnvHash (hash, settingsValues, sizeof (settingsValues));
+
+  return hash;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceResetInputProcessing()
+{
+  //so that the inputs are processed from the same state when recording and replaying
+  for (uint8_t i = 0; i <= NUM_OF_KNOB_CONTROLLERS + NUM_OF_LCD_ENCS; i++)
+    inputTraceGetEncoder (i)->resetProcessingState();
+
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+    knobControllersJoysticks[i]->resetProcessingState();
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool inputTraceSaveBlock (InputTraceSavedBlock *blocks, uint8_t &numOfBlocks, uint8_t maxNumOfBlocks,
+                          uint8_t *data, uint16_t size, int8_t looperLane)
+{
+  //Copies a block into the pool, returning false if there isn't room
+  if (numOfBlocks == maxNumOfBlocks || size > INPUT_TRACE_SAVE_POOL_SIZE - inputTraceSavePoolSize)
+    return false;
+
+  blocks[numOfBlocks++] = {data, size, inputTraceSavePoolSize, looperLane};
+  memcpy (&inputTraceSavePool[inputTraceSavePoolSize], data, size);
+  inputTraceSavePoolSize += size;
+
+  return true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceRestoreBlocks (const InputTraceSavedBlock *blocks, uint8_t numOfBlocks)
+{
+  for (uint8_t i = 0; i < numOfBlocks; i++)
+    memcpy (blocks[i].data, &inputTraceSavePool[blocks[i].poolPos], blocks[i].size);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceSaveProgramCacheBlock (uint8_t channelIndex, uint8_t program)
+{
+  //Called before a program's values are cached. While recording, the values are saved the first time,
+  //and inputTraceRecord() ends the recording while there's still room for them.
+  if (inputTraceState != INPUT_TRACE_STATE_RECORDING)
+    return;
+
+  uint8_t *data = programCache.deviceParamValues[channelIndex][program];
+
+  for (uint8_t i = 0; i < inputTraceNumOfStartBlocks; i++)
+  {
+    if (inputTraceStartBlocks[i].data == data)
+      return;
+  }
+
+  inputTraceSaveBlock (inputTraceStartBlocks, inputTraceNumOfStartBlocks, INPUT_TRACE_MAX_NUM_OF_SAVED_BLOCKS,
+                       data, NUM_OF_DEVICE_PARAMS, -1);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceSaveLooperLaneBlock (uint8_t index)
+{
+  //Called before a looper lane starts recording over its data. While recording, the data is saved the first time,
+  //and inputTraceRecord() ends the recording while there's still room for it.
+  if (inputTraceState != INPUT_TRACE_STATE_RECORDING || (inputTraceLooperLanesSavedMask & (1 << index)))
+    return;
+
+  GestureLooperLane &lane = gestureLooperLanes[index];
+
+  inputTraceSaveBlock (inputTraceStartBlocks, inputTraceNumOfStartBlocks, INPUT_TRACE_MAX_NUM_OF_SAVED_BLOCKS,
+                       lane.data, lane.length, index);
+
+  inputTraceLooperLanesSavedMask |= (1 << index);
+  inputTraceLooperLanesWrittenMask |= (1 << index);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool inputTraceSaveLiveBlocks()
+{
+  //Saves the live values of everything that replaying writes over, after the start state's blocks,
+  //returning false if there isn't room
+  inputTraceNumOfLiveBlocks = 0;
+  uint8_t maxNumOfBlocks = INPUT_TRACE_MAX_NUM_OF_SAVED_BLOCKS + NUM_OF_KNOB_CONTROLLERS;
+
+  for (uint8_t i = 0; i < inputTraceNumOfStartBlocks; i++)
+  {
+    const InputTraceSavedBlock &block = inputTraceStartBlocks[i];
+
+    if (block.looperLane < 0 &&
+        !inputTraceSaveBlock (inputTraceLiveBlocks, inputTraceNumOfLiveBlocks, maxNumOfBlocks, block.data, block.size, -1))
+      return false;
+  }
+
+  //(a lane that was recording when the trace started has its recording carried on, after its length at the start)
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    GestureLooperLane &lane = gestureLooperLanes[i];
+
+    if ((inputTraceLooperLanesWrittenMask & (1 << i)) &&
+        !inputTraceSaveBlock (inputTraceLiveBlocks, inputTraceNumOfLiveBlocks, maxNumOfBlocks, lane.data, lane.length, i))
+      return false;
+  }
+
+  return true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceStartRecording()
+{
+  if (inputTraceState != INPUT_TRACE_STATE_IDLE)
+    return;
+
+  //the start state is taken between realtime ticks, so that it is consistent
+  scheduler.suspendRealtimeTasks (true);
+
+  inputTraceResetInputProcessing();
+  inputTraceCopyControlState (inputTraceStartState, true);
+
+  inputTraceNumOfStartBlocks = 0;
+  inputTraceSavePoolSize = 0;
+  inputTraceLooperLanesSavedMask = 0;
+  inputTraceLooperLanesWrittenMask = 0;
+
+  //lanes that are already recording carry on after their data, so their data only needs saving if they restart
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    if (gestureLooperLanes[i].state == GESTURE_LOOPER_RECORDING)
+      inputTraceLooperLanesWrittenMask |= (1 << i);
+  }
+
+  inputTraceNumOfRecords = 0;
+  inputTraceStartTime = controlTime;
+  inputTracePrevRecordTime = controlTime;
+
+  //(if this millisecond's ticks have already run, the next ones are recorded as late)
+  for (uint8_t i = 0; i < INPUT_TRACE_NUM_OF_TICK_SOURCES; i++)
+    inputTracePrevTickTimes[i] = controlTime - 1;
+  inputTraceMidiOutNumOfMessages = midiOutNumOfMessages;
+  midiOutHash = FNV_HASH_INIT;
+
+  inputTraceState = INPUT_TRACE_STATE_RECORDING;
+
+  scheduler.suspendRealtimeTasks (false);
+
+  Serial.println ("Input trace recording started");
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceWriteRecord (uint32_t time, uint8_t type, uint8_t id, int16_t value)
+{
+  uint32_t timeDelta = time - inputTracePrevRecordTime;
+  inputTracePrevRecordTime = time;
+
+  if (timeDelta > UINT16_MAX)
+  {
+    inputTraceRecords[inputTraceNumOfRecords++] = {(uint16_t)(timeDelta & 0xFFFF), INPUT_TRACE_TIME, 0, (int16_t)(timeDelta >> 16)};
+    timeDelta = 0;
+  }
+
+  inputTraceRecords[inputTraceNumOfRecords++] = {(uint16_t)timeDelta, type, id, value};
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool inputTraceIsTick (uint8_t type)
+{
+  return type >= INPUT_TRACE_MODULATION_TICK && type < INPUT_TRACE_MODULATION_TICK + INPUT_TRACE_NUM_OF_TICK_SOURCES;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+uint32_t inputTraceGetTickDueTime (uint8_t source, uint8_t type, uint32_t time)
+{
+  //Returns the time of the last tick of a source that runs before a record of a given type and time -
+  //inputs are taken before the ticks of their millisecond, and the ticks of each millisecond are run in source order
+  if (inputTraceIsTick (type) && source < type - INPUT_TRACE_MODULATION_TICK)
+    return time;
+  else
+    return time - 1;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceWriteTicksRecord (uint8_t type)
+{
+  //Records where the ticks of each source have got to
+  inputTraceWriteRecord (controlTime, type,
+                         min (controlTime - inputTracePrevTickTimes[INPUT_TRACE_TICK_MODULATION], (uint32_t)UINT8_MAX),
+                         min (controlTime - inputTracePrevTickTimes[INPUT_TRACE_TICK_GESTURE_LOOPER], (uint32_t)INT16_MAX));
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceEndRecording()
+{
+  //Takes the stopping state that a replay is checked against, which must be taken straight after the last
+  //recorded input (so is also called from the realtime tasks when the trace is full).
+  //The ticks of the last few milliseconds may or may not have run yet, so where they got to is recorded.
+  inputTraceWriteTicksRecord (INPUT_TRACE_TICKS_END);
+
+  inputTraceDuration = controlTime - inputTraceStartTime;
+  inputTraceMidiOutHash = midiOutHash;
+  inputTraceStateHash = inputTraceGetStateHash();
+  inputTraceMidiOutNumOfMessages = midiOutNumOfMessages - inputTraceMidiOutNumOfMessages;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceStopRecording()
+{
+  //called from the loop, either by the stop command or by the background task once the trace is full
+  if (inputTraceState == INPUT_TRACE_STATE_RECORDING)
+  {
+    scheduler.suspendRealtimeTasks (true);
+
+    //(the trace may have filled up since the state was checked)
+    if (inputTraceState == INPUT_TRACE_STATE_RECORDING)
+      inputTraceEndRecording();
+
+    inputTraceState = INPUT_TRACE_STATE_IDLE;
+
+    scheduler.suspendRealtimeTasks (false);
+  }
+  else if (inputTraceState == INPUT_TRACE_STATE_FULL)
+  {
+    inputTraceState = INPUT_TRACE_STATE_IDLE;
+  }
+  else
+  {
+    return;
+  }
+
+  Serial.print ("Input trace recording stopped: ");
+  Serial.print (inputTraceNumOfRecords);
+  Serial.print (" records, ");
+  Serial.print (inputTraceDuration);
+  Serial.print ("ms, ");
+  Serial.print (inputTraceMidiOutNumOfMessages);
+  Serial.println (" MIDI messages");
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceRecord (uint8_t type, uint8_t id, int16_t value)
+{
+  if (inputTraceState != INPUT_TRACE_STATE_RECORDING)
+    return;
+
+  //Record where the ticks had got to if any that should have run before this record didn't (so will be caught up
+  //after it), as otherwise the replay would run them before it
+  bool ticksMissed = false;
+
+  for (uint8_t i = 0; i < INPUT_TRACE_NUM_OF_TICK_SOURCES; i++)
+  {
+    if (type != INPUT_TRACE_MODULATION_TICK + i &&
+        (int32_t)(inputTraceGetTickDueTime (i, type, controlTime) - inputTracePrevTickTimes[i]) > 0)
+      ticksMissed = true;
+  }
+
+  if (ticksMissed)
+  {
+    inputTraceWriteTicksRecord (INPUT_TRACE_TICKS_MISSED);
+
+    for (uint8_t i = 0; i < INPUT_TRACE_NUM_OF_TICK_SOURCES; i++)
+    {
+      uint32_t dueTime = inputTraceGetTickDueTime (i, type, controlTime);
+
+      if (type != INPUT_TRACE_MODULATION_TICK + i && (int32_t)(dueTime - inputTracePrevTickTimes[i]) > 0)
+        inputTracePrevTickTimes[i] = dueTime;
+    }
+  }
+
+  inputTraceWriteRecord (controlTime, type, id, value);
+
+  //End while there's still room for the records and the saved block (at most a looper lane's data) that
+  //an input can take, and for the end records. The input has already been processed, so the stopping state
+  //includes it. This is called from the realtime tasks, so the stop (which prints over USB serial, so can
+  //wait on it) is left to the background task.
+  if (inputTraceNumOfRecords > INPUT_TRACE_MAX_NUM_OF_RECORDS - INPUT_TRACE_MAX_RECORDS_PER_INPUT - INPUT_TRACE_NUM_OF_END_RECORDS ||
+      inputTraceNumOfStartBlocks == INPUT_TRACE_MAX_NUM_OF_SAVED_BLOCKS ||
+      inputTraceSavePoolSize > INPUT_TRACE_SAVE_POOL_SIZE - GESTURE_LOOPER_LANE_SIZE)
+  {
+    inputTraceEndRecording();
+    inputTraceState = INPUT_TRACE_STATE_FULL;
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceRecordEncoderInput (RotaryEncoder &enc, uint8_t inputType, int value)
+{
+  for (uint8_t i = 0; i <= NUM_OF_KNOB_CONTROLLERS + NUM_OF_LCD_ENCS; i++)
+  {
+    if (enc == *inputTraceGetEncoder (i))
+    {
+      inputTraceRecord (inputType == RotaryEncoder::RAW_INPUT_ENCODER_COUNT ? INPUT_TRACE_ENCODER_COUNT : INPUT_TRACE_ENCODER_SWITCH, i, value);
+      break;
+    }
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceRecordJoystickInput (ThumbJoystick &thumbJoystick, int16_t value)
+{
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    if (thumbJoystick == *knobControllersJoysticks[i])
+    {
+      inputTraceRecord (INPUT_TRACE_JOYSTICK, i, value);
+      break;
+    }
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceRecordButtonInput (SwitchControl &switchControl, uint8_t state)
+{
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    if (switchControl == *inputTraceGetButton (i))
+    {
+      inputTraceRecord (INPUT_TRACE_BUTTON, i, state);
+      break;
+    }
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceRecordMidiControlChange (byte channel, byte control, byte value)
+{
+  if (!midiInIsFromCable (MIDI_CABLE_FEEDBACK))
+    return;
+
+  ProcessMidiControlChange (channel, control, value);
+  inputTraceRecord (INPUT_TRACE_MIDI_CC, control, (channel << 8) | value);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceRecordMidiClock()
+{
+  midiInClock();
+
+  if (midiInIsFromCable (MIDI_CABLE_FEEDBACK))
+    inputTraceRecord (INPUT_TRACE_MIDI_CLOCK, 0, 0);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceRecordMidiStart()
+{
+  midiInStart();
+
+  if (midiInIsFromCable (MIDI_CABLE_FEEDBACK))
+    inputTraceRecord (INPUT_TRACE_MIDI_START, 0, 0);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceRecordTick (uint8_t source, uint16_t numOfTicks, uint8_t numOfClockPulses)
+{
+  //Called for every tick of the time driven tasks, where only a tick that isn't a single tick a millisecond
+  //after the last one is recorded (the rest are replayed from the time deltas)
+  if (inputTraceState != INPUT_TRACE_STATE_RECORDING)
+    return;
+
+  //(where this source's ticks had got to is recorded along with any missed ticks of the others)
+  if (numOfTicks != 1 || controlTime != inputTracePrevTickTimes[source] + 1)
+    inputTraceRecord (INPUT_TRACE_MODULATION_TICK + source, numOfClockPulses, numOfTicks);
+
+  inputTracePrevTickTimes[source] = controlTime;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceRecordModulationTick (uint16_t numOfTicks, uint8_t numOfClockPulses)
+{
+  inputTraceRecordTick (INPUT_TRACE_TICK_MODULATION, numOfTicks, numOfClockPulses);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceRecordGestureLooperTick (uint16_t numOfTicks, uint8_t numOfClockPulses)
+{
+  inputTraceRecordTick (INPUT_TRACE_TICK_GESTURE_LOOPER, numOfTicks, numOfClockPulses);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceReplayTick (uint8_t source, uint16_t numOfTicks, uint8_t numOfClockPulses)
+{
+  //(the ticks' MIDI clock pulses were taken by the task)
+  if (source == INPUT_TRACE_TICK_MODULATION)
+  {
+    modulationPendingClockPulses = 0;
+    modulationTick (numOfTicks, numOfClockPulses);
+  }
+  else
+  {
+    gestureLooperPendingClockPulses = 0;
+    gestureLooperTick (numOfTicks, numOfClockPulses);
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceReplayRegularTicks (uint32_t *prevTickTimes, const uint32_t *dueTimes)
+{
+  //Runs the ticks that weren't recorded - a single tick a millisecond for each source, with the sources in order
+  //within each millisecond - up to the due times
+  while (true)
+  {
+    int8_t source = -1;
+
+    for (uint8_t i = 0; i < INPUT_TRACE_NUM_OF_TICK_SOURCES; i++)
+    {
+      if ((int32_t)(dueTimes[i] - prevTickTimes[i]) > 0 &&
+          (source < 0 || (int32_t)(prevTickTimes[i] - prevTickTimes[source]) < 0))
+        source = i;
+    }
+
+    if (source < 0)
+      break;
+
+    controlTime = ++prevTickTimes[source];
+
+    uint16_t pendingClockPulses = (source == INPUT_TRACE_TICK_MODULATION) ? modulationPendingClockPulses : gestureLooperPendingClockPulses;
+    inputTraceReplayTick (source, 1, min (pendingClockPulses, (uint16_t)UINT8_MAX));
+
+  } //while (true)
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceReplayRecords()
+{
+  uint32_t time = inputTraceStartTime;
+  uint32_t prevTickTimes[INPUT_TRACE_NUM_OF_TICK_SOURCES];
+  uint32_t dueTimes[INPUT_TRACE_NUM_OF_TICK_SOURCES];
+
+  for (uint8_t i = 0; i < INPUT_TRACE_NUM_OF_TICK_SOURCES; i++)
+    prevTickTimes[i] = inputTraceStartTime - 1;
+
+  for (uint16_t i = 0; i < inputTraceNumOfRecords; i++)
+  {
+    const InputTraceRecord &record = inputTraceRecords[i];
+
+    time += record.timeDelta;
+
+    if (record.type == INPUT_TRACE_TIME)
+    {
+      time += (uint32_t)(uint16_t)record.value << 16;
+      continue;
+    }
+
+    //run the ticks that ran before this record
+    for (uint8_t source = 0; source < INPUT_TRACE_NUM_OF_TICK_SOURCES; source++)
+    {
+      if (record.type == INPUT_TRACE_TICKS_MISSED || record.type == INPUT_TRACE_TICKS_END)
+        dueTimes[source] = time - ((source == INPUT_TRACE_TICK_MODULATION) ? record.id : record.value);
+      else if (record.type == INPUT_TRACE_MODULATION_TICK + source)
+        dueTimes[source] = prevTickTimes[source]; //(any ticks since the last were caught up in this one)
+      else
+        dueTimes[source] = inputTraceGetTickDueTime (source, record.type, time);
+    }
+
+    inputTraceReplayRegularTicks (prevTickTimes, dueTimes);
+
+    controlTime = time;
+
+    switch (record.type)
+    {
+      case INPUT_TRACE_ENCODER_COUNT:
+        inputTraceGetEncoder (record.id)->processEncoderCount (record.value, controlTime);
+        break;
+
+      case INPUT_TRACE_ENCODER_SWITCH:
+        inputTraceGetEncoder (record.id)->processSwitchState (record.value);
+        break;
+
+      case INPUT_TRACE_JOYSTICK:
+        knobControllersJoysticks[record.id]->processYAxisSample (record.value);
+        break;
+
+      case INPUT_TRACE_BUTTON:
+        inputTraceGetButton (record.id)->processSwitchState (record.value);
+        break;
+
+      case INPUT_TRACE_MIDI_CC:
+        ProcessMidiControlChange (record.value >> 8, record.id, record.value & 0xFF);
+        midiInApplyPendingCcs();
+        break;
+
+      case INPUT_TRACE_MIDI_CLOCK:
+        modulationProcessMidiClock();
+        gestureLooperProcessMidiClock();
+        break;
+
+      case INPUT_TRACE_MIDI_START:
+        modulationProcessMidiStart();
+        gestureLooperProcessMidiStart();
+        break;
+
+      case INPUT_TRACE_MODULATION_TICK:
+      case INPUT_TRACE_GESTURE_LOOPER_TICK:
+        prevTickTimes[record.type - INPUT_TRACE_MODULATION_TICK] = time;
+        inputTraceReplayTick (record.type - INPUT_TRACE_MODULATION_TICK, record.value, record.id);
+        break;
+
+      case INPUT_TRACE_TICKS_MISSED:
+        //the ticks that were due before the next record were missed
+        for (uint8_t source = 0; source < INPUT_TRACE_NUM_OF_TICK_SOURCES && i + 1 < inputTraceNumOfRecords; source++)
+        {
+          uint32_t dueTime = inputTraceGetTickDueTime (source, inputTraceRecords[i + 1].type, time);
+
+          if ((int32_t)(dueTime - prevTickTimes[source]) > 0)
+            prevTickTimes[source] = dueTime;
+        }
+        break;
+
+      default:
+        break;
+
+    } //switch (record.type)
+
+  } //for (uint16_t i = 0; i < inputTraceNumOfRecords; i++)
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool inputTraceReplay()
+{
+  //Returns whether every replay matched the recording
+  if (inputTraceState != INPUT_TRACE_STATE_IDLE || inputTraceNumOfRecords == 0)
+    return false;
+
+  inputTraceState = INPUT_TRACE_STATE_REPLAYING;
+
+  //the replay runs the control logic from the loop, so the realtime tasks are held off until it is done
+  scheduler.suspendRealtimeTasks (true);
+
+  //keep the live state to put back afterwards
+  uint16_t startPoolSize = inputTraceSavePoolSize;
+
+  if (!inputTraceSaveLiveBlocks())
+  {
+    inputTraceSavePoolSize = startPoolSize;
+    inputTraceState = INPUT_TRACE_STATE_IDLE;
+
+    scheduler.suspendRealtimeTasks (false);
+
+    Serial.println ("Input trace replay: not enough room to keep the live gesture loops - stop them first");
+    return false;
+  }
+
+  inputTraceCopyControlState (inputTraceLiveState, true);
+
+  uint32_t liveMidiOutHash = midiOutHash;
+  uint32_t liveMidiOutNumOfMessages = midiOutNumOfMessages;
+  midiOutSink = MIDI_OUT_SINK_NULL;
+
+  uint32_t totalReplayTime = 0;
+  uint8_t numOfMatches = 0;
+
+  for (uint8_t replay = 0; replay < INPUT_TRACE_NUM_OF_REPLAYS; replay++)
+  {
+    inputTraceResetInputProcessing();
+    inputTraceCopyControlState (inputTraceStartState, false);
+    inputTraceRestoreBlocks (inputTraceStartBlocks, inputTraceNumOfStartBlocks);
+    controlTime = inputTraceStartTime;
+    midiOutHash = FNV_HASH_INIT;
+
+    uint32_t replayStartCycles = ARM_DWT_CYCCNT;
+    inputTraceReplayRecords();
+    totalReplayTime += (ARM_DWT_CYCCNT - replayStartCycles) / (F_CPU / 1000000);
+
+    if (midiOutHash == inputTraceMidiOutHash && inputTraceGetStateHash() == inputTraceStateHash)
+      numOfMatches++;
+  }
+
+  //put everything back as it was
+  inputTraceResetInputProcessing();
+  inputTraceCopyControlState (inputTraceLiveState, false);
+  inputTraceRestoreBlocks (inputTraceLiveBlocks, inputTraceNumOfLiveBlocks);
+  inputTraceSavePoolSize = startPoolSize;
+  controlTime = millis();
+  midiOutHash = liveMidiOutHash;
+  midiOutNumOfMessages = liveMidiOutNumOfMessages;
+  midiOutSink = MIDI_OUT_SINK_USB;
+
+  lcdPublishDisplayState();
+  lcdRequestRedraw();
+
+  inputTraceState = INPUT_TRACE_STATE_IDLE;
+
+  scheduler.suspendRealtimeTasks (false);
+
+  uint32_t replayTime = totalReplayTime / INPUT_TRACE_NUM_OF_REPLAYS;
+
+  Serial.print ("Input trace replay: ");
+  Serial.print (numOfMatches == INPUT_TRACE_NUM_OF_REPLAYS ? "PASS" : "FAIL");
+  Serial.print (" (");
+  Serial.print (numOfMatches);
+  Serial.print ("/");
+  Serial.print (INPUT_TRACE_NUM_OF_REPLAYS);
+  Serial.print (" matched), ");
+  Serial.print (inputTraceNumOfRecords);
+  Serial.print (" records in ");
+  Serial.print (replayTime);
+  Serial.print ("us (");
+  Serial.print (replayTime > 0 ? (uint32_t)(((uint64_t)inputTraceNumOfRecords * 1000000) / replayTime) : 0);
+  Serial.print (" records/s, ");
+  Serial.print (replayTime > 0 ? (uint32_t)(((uint64_t)inputTraceDuration * 1000) / replayTime) : 0);
+  Serial.println ("x realtime)");
+
+  return numOfMatches == INPUT_TRACE_NUM_OF_REPLAYS;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceStartDump()
+{
+  if (inputTraceState != INPUT_TRACE_STATE_IDLE || inputTraceDumpStage != INPUT_TRACE_DUMP_IDLE)
+    return;
+
+  Serial.print ("Input trace: ");
+  Serial.print (inputTraceNumOfRecords);
+  Serial.print (" records, ");
+  Serial.print (inputTraceDuration);
+  Serial.print ("ms, MIDI hash ");
+  Serial.print (inputTraceMidiOutHash, HEX);
+  Serial.print (", state hash ");
+  Serial.println (inputTraceStateHash, HEX);
+
+  Serial.print ("Input trace start: time ");
+  Serial.print (inputTraceStartTime);
+  Serial.print (", ");
+  Serial.print (inputTraceMidiOutNumOfMessages);
+  Serial.print (" MIDI messages, ");
+  Serial.print (sizeof (InputTraceControlState));
+  Serial.print (" state bytes, ");
+  Serial.print (inputTraceNumOfStartBlocks);
+  Serial.print (" saved blocks, looper lanes ");
+  Serial.println (inputTraceLooperLanesWrittenMask, HEX);
+
+  inputTraceDumpStage = INPUT_TRACE_DUMP_STATE;
+  inputTraceDumpPos = 0;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceDumpBytes (char tag, const uint8_t *data, uint16_t size)
+{
+  //Prints a line of bytes as hex, from inputTraceDumpPos
+  const char hexDigits[] = "0123456789ABCDEF";
+  char line[2 + (INPUT_TRACE_BYTES_PER_DUMP_LINE * 2) + 1] = {tag, ' '};
+  uint8_t linePos = 2;
+
+  for (uint8_t i = 0; i < INPUT_TRACE_BYTES_PER_DUMP_LINE && inputTraceDumpPos < size; i++)
+  {
+    line[linePos++] = hexDigits[data[inputTraceDumpPos] >> 4];
+    line[linePos++] = hexDigits[data[inputTraceDumpPos++] & 0x0F];
+  }
+
+  line[linePos] = 0;
+
+  Serial.println (line);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceDumpBlockHeader (const InputTraceSavedBlock &block)
+{
+  //Prints the looper lane (or -1), MIDI channel index, program and size of a saved block
+  uint8_t channelIndex = 0;
+  uint8_t program = 0;
+
+  if (block.looperLane < 0)
+  {
+    uint16_t offset = block.data - &programCache.deviceParamValues[0][0][0];
+
+    channelIndex = offset / (PROGRAM_CACHE_NUM_OF_PROGRAMS * NUM_OF_DEVICE_PARAMS);
+    program = (offset / NUM_OF_DEVICE_PARAMS) % PROGRAM_CACHE_NUM_OF_PROGRAMS;
+  }
+
+  Serial.print ("B ");
+  Serial.print (block.looperLane);
+  Serial.print (" ");
+  Serial.print (channelIndex);
+  Serial.print (" ");
+  Serial.print (program);
+  Serial.print (" ");
+  Serial.println (block.size);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceDumpRecords()
+{
+  //Prints a line of records, each as 12 hex digits - time delta, type, id, value
+  const char hexDigits[] = "0123456789ABCDEF";
+  char line[2 + (INPUT_TRACE_RECORDS_PER_DUMP_LINE * 13) + 1] = {'R', ' '};
+  uint8_t linePos = 2;
+
+  for (uint8_t i = 0; i < INPUT_TRACE_RECORDS_PER_DUMP_LINE && inputTraceDumpPos < inputTraceNumOfRecords; i++)
+  {
+    const uint8_t *recordBytes = (const uint8_t*)&inputTraceRecords[inputTraceDumpPos++];
+
+    //bytes in the order of the record fields, as big-endian values
+    const uint8_t byteOrder[sizeof (InputTraceRecord)] = {1, 0, 2, 3, 5, 4};
+
+    for (uint8_t b = 0; b < sizeof (InputTraceRecord); b++)
+    {
+      line[linePos++] = hexDigits[recordBytes[byteOrder[b]] >> 4];
+      line[linePos++] = hexDigits[recordBytes[byteOrder[b]] & 0x0F];
+    }
+
+    line[linePos++] = ' ';
+  }
+
+  line[linePos] = 0;
+
+  Serial.println (line);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void inputTraceUpdate (uint32_t tickTime)
+{
+  if (inputTraceState == INPUT_TRACE_STATE_FULL)
+    inputTraceStopRecording();
+
+  //Dumps the trace a line at a time, and only if it will fit in the USB serial buffer without waiting:
+  //the start state ('S' lines), then each saved block ('B' header and 'D' lines), then the records ('R' lines)
+  if (inputTraceDumpStage == INPUT_TRACE_DUMP_IDLE || Serial.availableForWrite() < INPUT_TRACE_MIN_SERIAL_SPACE)
+    return;
+
+  switch (inputTraceDumpStage)
+  {
+    case INPUT_TRACE_DUMP_STATE:
+      inputTraceDumpBytes ('S', (const uint8_t*)&inputTraceStartState, sizeof (InputTraceControlState));
+
+      if (inputTraceDumpPos >= (int32_t)sizeof (InputTraceControlState))
+      {
+        inputTraceDumpStage = INPUT_TRACE_DUMP_BLOCKS;
+        inputTraceDumpBlock = 0;
+        inputTraceDumpPos = -1;
+      }
+      break;
+
+    case INPUT_TRACE_DUMP_BLOCKS:
+      if (inputTraceDumpBlock < inputTraceNumOfStartBlocks)
+      {
+        const InputTraceSavedBlock &block = inputTraceStartBlocks[inputTraceDumpBlock];
+
+        if (inputTraceDumpPos < 0)
+        {
+          inputTraceDumpBlockHeader (block);
+          inputTraceDumpPos = 0;
+        }
+        else
+        {
+          inputTraceDumpBytes ('D', &inputTraceSavePool[block.poolPos], block.size);
+        }
+
+        if (inputTraceDumpPos >= block.size)
+        {
+          inputTraceDumpBlock++;
+          inputTraceDumpPos = -1;
+        }
+      }
+      else
+      {
+        inputTraceDumpStage = INPUT_TRACE_DUMP_RECORDS;
+        inputTraceDumpPos = 0;
+      }
+      break;
+
+    case INPUT_TRACE_DUMP_RECORDS:
+      if (inputTraceDumpPos < inputTraceNumOfRecords)
+        inputTraceDumpRecords();
+      else
+        inputTraceDumpStage = INPUT_TRACE_DUMP_IDLE;
+      break;
+
+    default:
+      break;
+
+  } //switch (inputTraceDumpStage)
+}
+
+#endif //ENABLE_INPUT_TRACE
@@ -0,0 +1,86 @@
+#include "ThumbJoystick.h"
+
+//=========================================================================
+//Joystick calibration storage.
+//
+//The calibration of each knob controller joystick (the min, centre and max of its 12-bit samples - see
+//ThumbJoystick) is kept in RAM here, and is stored in EEPROM as part of the settings image (see SettingsJournal.h),
+//with the 12-bit values packed end to end, least significant bits first:
+//  [joystick 1 min][joystick 1 centre][joystick 1 max][joystick 2 min]...
+//
+//Calibration is learnt by sending a 'c' over USB serial with the joysticks at rest, moving each joystick to both
+//ends, and then sending another 'c' (see toggleJoystickCalibration()). A joystick that wasn't moved far enough keeps
+//its previous calibration, and a stored calibration that isn't valid is replaced with the default.
+
+#define JOYSTICK_CALIBRATION_NUM_OF_VALUES (NUM_OF_KNOB_CONTROLLERS * 3)
+#define JOYSTICK_CALIBRATION_STORE_SIZE (((JOYSTICK_CALIBRATION_NUM_OF_VALUES * ThumbJoystick::SAMPLE_RESOLUTION) + 7) / 8)
+
+ThumbJoystick::Calibration joystickCalibration[NUM_OF_KNOB_CONTROLLERS];
+
+//=========================================================================
+void settingsJournalRequestCompaction();
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void joystickCalibrationLoadDefaults()
+{
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+    joystickCalibration[i] = ThumbJoystick::DEFAULT_CALIBRATION;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void joystickCalibrationEncode (uint8_t *store)
+{
+  memset (store, 0, JOYSTICK_CALIBRATION_STORE_SIZE);
+
+  for (uint8_t i = 0; i < JOYSTICK_CALIBRATION_NUM_OF_VALUES; i++)
+  {
+    const ThumbJoystick::Calibration &calibration = joystickCalibration[i / 3];
+    uint16_t value = (i % 3 == 0) ? calibration.minValue : (i % 3 == 1) ? calibration.centreValue : calibration.maxValue;
+
+    uint16_t bitPos = i * ThumbJoystick::SAMPLE_RESOLUTION;
+    uint32_t bits = (uint32_t)value << (bitPos % 8);
+
+    store[bitPos / 8] |= bits;
+    store[(bitPos / 8) + 1] |= bits >> 8;
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void joystickCalibrationDecode (const uint8_t *store)
+{
+  for (uint8_t i = 0; i < JOYSTICK_CALIBRATION_NUM_OF_VALUES; i++)
+  {
+    ThumbJoystick::Calibration &calibration = joystickCalibration[i / 3];
+
+    uint16_t bitPos = i * ThumbJoystick::SAMPLE_RESOLUTION;
+    uint16_t value = ((store[bitPos / 8] | (store[(bitPos / 8) + 1] << 8)) >> (bitPos % 8)) & ThumbJoystick::MAX_SAMPLE_VALUE;
+
+    if (i % 3 == 0)
+      calibration.minValue = value;
+    else if (i % 3 == 1)
+      calibration.centreValue = value;
+    else
+      calibration.maxValue = value;
+  }
+
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    if (!ThumbJoystick::isCalibrationValid (joystickCalibration[i]))
+      joystickCalibration[i] = ThumbJoystick::DEFAULT_CALIBRATION;
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void joystickCalibrationSave()
+{
+  //The calibration is only stored in the settings image, so is saved by a compaction
+  settingsJournalRequestCompaction();
+}
@@ -1,13 +1,19 @@
-#include "ILI9341_t3.h"
+#include "MeteredLcd.h"
 
-//For LCD use hardware SPI (#13, #12, #11) and the custom allocated for CS/DC
-ILI9341_t3 lcd = ILI9341_t3 (PIN_LCD_CS, PIN_LCD_DC);
+//For LCD use hardware SPI (#13, #12, #11) and the custom allocated for CS/DC.
+//MeteredLcd is an ILI9341_t3 that also counts the pixels and SPI bytes of everything drawn.
+MeteredLcd lcd = MeteredLcd (PIN_LCD_CS, PIN_LCD_DC);
 
 //=========================================================================
 //global LCD stuff...
 
-const int LCD_FRAME_RATE = 30;
-long lcdPreviousMillis = 0;
+//Frame pacing - see updateLcd()
+const uint32_t LCD_MIN_FRAME_INTERVAL_US = 10000; //max of 100 fps
+const uint32_t LCD_FRAME_BUDGET_US = 500; //draw time after which the rest of a frame is left to the next frame (see TASK_BUDGET_LCD_US)
+const uint8_t LCD_MAX_DRAW_DUTY_PERCENT = 25; //max share of loop time used for drawing while controls are moving
+uint32_t lcdPreviousFrameTime = 0;
+uint32_t lcdFrameInterval = LCD_MIN_FRAME_INTERVAL_US;
+uint32_t lcdDrawCost = 0;
 
 const int LCD_COLOUR_BCKGND = ILI9341_BLACK;
 const int LCD_COLOUR_TEXT = ILI9341_GREEN;
@@ -16,7 +22,8 @@ const int LCD_COLOUR_SLIDERS_BCKGND = ILI9341_DARKGREY;
 
 #define LCD_TEXT_LINE_SPACING 18
 
-uint8_t lcdDisplayMode = LCD_DISPLAY_MODE_CONTROLS;
+uint8_t lcdDisplayMode = LCD_DISPLAY_MODE_CONTROLS; //the display mode as set by the controls
+uint8_t lcdDrawnDisplayMode = LCD_DISPLAY_MODE_CONTROLS; //the display mode currently drawn
 
 //=========================================================================
 //controls display stuff...
@@ -38,14 +45,62 @@ const uint8_t LCD_SLIDER_MIX_INDEX = DEVICE_PARAM_INDEX_MIX;
 
 //below arrays store values as midi / 7-bit values.
 uint8_t lcdSliderValue[LCD_NUM_OF_SLIDERS] = {0};
-uint8_t lcdPrevSliderValue[LCD_NUM_OF_SLIDERS] = {0};
 
 const uint8_t LCD_TOP_BAR_TEXT_CHAN_X_POS = 1;
+const uint8_t LCD_TOP_BAR_TEXT_PRESET_X_POS = 118;
 const uint8_t LCD_TOP_BAR_TEXT_PRGM_X_POS = 235;
 const uint8_t LCD_TOP_BAR_TEXT_Y_POS = 1;
 
-bool lcdTopBarChannelChanged = false;
-bool lcdTopBarProgramChanged = false;
+uint8_t lcdNextSliderToDraw = 0;
+
+//=========================================================================
+//display state handoff...
+
+//The controls run in the realtime timer interrupt, so can change what is displayed part way through drawing
+//a frame. The state that the controls display is drawn from is therefore published as a whole once per realtime
+//tick (see lcdPublishDisplayState()) through a seqlock - the sequence is odd while the state is being written,
+//and the LCD task copies the state and tries again if the sequence was odd or changed while copying. The
+//publisher is an interrupt, so never waits for the LCD.
+struct LcdDisplayState
+{
+  uint8_t sliderValues[LCD_NUM_OF_SLIDERS];
+  uint8_t channel;
+  uint8_t program;
+  int8_t preset;
+};
+
+LcdDisplayState lcdPublishedState;
+volatile uint32_t lcdPublishedStateSequence = 0;
+
+LcdDisplayState lcdDrawState; //the latest copy of the published state (LCD task only)
+LcdDisplayState lcdDrawnState; //what is currently on the display (LCD task only)
+
+//The menu display is drawn a change at a time, so menu changes are instead passed to the LCD task as events,
+//through a single producer, single consumer queue. If the queue fills up the whole display is redrawn instead.
+enum LcdEventTypes
+{
+  LCD_EVENT_SHOW_CONTROLS = 0,
+  LCD_EVENT_SHOW_MENU,
+  LCD_EVENT_MENU_SELECTED, //prev = previously selected menu
+  LCD_EVENT_PARAM_SELECTED, //prev = previously selected param
+  LCD_EVENT_VALUE_CHANGED,
+  LCD_EVENT_MENU_VALUES_CHANGED
+};
+
+struct LcdEvent
+{
+  uint8_t type;
+  int8_t menu; //the selected menu and param when the event was queued
+  int8_t param;
+  int8_t prev;
+};
+
+#define LCD_EVENT_QUEUE_SIZE 16 //must be a power of 2
+
+LcdEvent lcdEventQueue[LCD_EVENT_QUEUE_SIZE];
+volatile uint8_t lcdEventQueueHead = 0; //only changed by the controls
+volatile uint8_t lcdEventQueueTail = 0; //only changed by the LCD task
+volatile bool lcdRedrawRequested = false;
 
 //=========================================================================
 //menu display stuff...
@@ -60,8 +115,19 @@ int8_t lcdPrevSelectedMenuParam = 0;
 
 //=========================================================================
 void lcdDisplayControls();
-void lcdDisplayCompleteMenu();
+bool lcdControlsDisplayNeedsUpdating();
+void lcdDrawSliderValueChange (uint8_t sliderNum);
+void lcdDisplayCompleteMenu (int8_t menu, int8_t param);
 void lcdPrintParamValueToDisplay (uint8_t menu, uint8_t param);
+void lcdTraceFrameStats (uint8_t displayMode);
+void lcdPrintTopBarPreset (int8_t preset);
+void lcdPublishDisplayState();
+void lcdReadDisplayState (LcdDisplayState &state);
+bool lcdProcessEvents (uint32_t frameStartTime);
+void lcdUpdateMenusDisplay (int8_t prevMenu, int8_t menu, int8_t param);
+void lcdUpdateMenuParamsAndValuesDisplay (int8_t menu, int8_t prevParam, int8_t param);
+void lcdUpdateMenuSelectedValue (int8_t menu, int8_t param);
+void lcdDisplayMenuParamsAndValues (int8_t menu, int8_t param);
 
 //=========================================================================
 //=========================================================================
@@ -72,142 +138,369 @@ void setupLcd()
   lcd.setRotation (3);
   lcd.fillScreen (LCD_COLOUR_BCKGND);
 
+  lcdPublishDisplayState();
+  lcdReadDisplayState (lcdDrawState);
+
   if (lcdDisplayMode == LCD_DISPLAY_MODE_CONTROLS)
     lcdDisplayControls();
   else
-    lcdDisplayCompleteMenu();
+    lcdDisplayCompleteMenu (lcdCurrentlySelectedMenu, lcdCurrentSelectedMenuParam);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+inline void lcdMemoryBarrier()
+{
+  //stops the compiler moving memory accesses across this point (the Teensy only has one core)
+  asm volatile ("" : : : "memory");
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void lcdPublishDisplayState()
+{
+  //Publishes the state that the controls display is drawn from. Called by the controls after each realtime tick.
+  lcdPublishedStateSequence++;
+  lcdMemoryBarrier();
+
+  memcpy (lcdPublishedState.sliderValues, lcdSliderValue, LCD_NUM_OF_SLIDERS);
+  lcdPublishedState.channel = settingsGetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN);
+  lcdPublishedState.program = currentMidiProgramNumber();
+  lcdPublishedState.preset = presetsActivePreset;
+
+  lcdMemoryBarrier();
+  lcdPublishedStateSequence++;
 }
 
 //=========================================================================
 //=========================================================================
 //=========================================================================
-void updateLcd()
+void lcdReadDisplayState (LcdDisplayState &state)
 {
-  //update the LCD display at the set frame rate
-  if ((millis() - lcdPreviousMillis) > (1000.0 / (float)LCD_FRAME_RATE))
+  uint32_t sequence;
+
+  do
   {
-    //FIXME: should I be doing menu drawing here too? Current it is just drawn as control changes are made.
+    sequence = lcdPublishedStateSequence;
+    lcdMemoryBarrier();
 
-    //if in control display mode, update the controls display if needed
-    if (lcdDisplayMode == LCD_DISPLAY_MODE_CONTROLS)
+    memcpy (&state, &lcdPublishedState, sizeof (LcdDisplayState));
+
+    lcdMemoryBarrier();
+
+  } while ((sequence & 1) || sequence != lcdPublishedStateSequence);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void lcdQueueEvent (uint8_t type, int8_t prev = 0)
+{
+  //Queues a menu display change for the LCD task, along with the currently selected menu and param
+  uint8_t head = lcdEventQueueHead;
+
+  if ((uint8_t)(head - lcdEventQueueTail) >= LCD_EVENT_QUEUE_SIZE)
+  {
+    lcdRedrawRequested = true;
+    return;
+  }
+
+  lcdEventQueue[head % LCD_EVENT_QUEUE_SIZE] = {type, lcdCurrentlySelectedMenu, lcdCurrentSelectedMenuParam, prev};
+
+  lcdMemoryBarrier();
+  lcdEventQueueHead = head + 1;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void lcdRequestRedraw()
+{
+  //Redraws the whole display in the current display mode, e.g. after the controls state has been put back
+  lcdRedrawRequested = true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void lcdMenuValuesChanged()
+{
+  //Redraws the values of the selected menu, e.g. after a preset has been recalled
+  lcdQueueEvent (LCD_EVENT_MENU_VALUES_CHANGED);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void updateLcd (uint32_t tickTime)
+{
+  PROFILE_SCOPE (PROFILE_TASK_LCD);
+
+  //any display mode and menu changes are drawn first, as they are drawn in full
+  if (!lcdProcessEvents (micros()))
+    return;
+
+  lcdReadDisplayState (lcdDrawState);
+
+  //if nothing has changed there is nothing to do
+  if (lcdDrawnDisplayMode != LCD_DISPLAY_MODE_CONTROLS || !lcdControlsDisplayNeedsUpdating())
+    return;
+
+  //Frames are paced by change events rather than a fixed frame rate - the first change after the display
+  //has been idle is drawn straight away, whereas continuous changes (e.g. a moving joystick) are drawn no more
+  //often than the frame interval, which is based on the measured cost of drawing.
+  if ((tickTime - lcdPreviousFrameTime) < lcdFrameInterval)
+    return;
+
+  uint32_t frameStartTime = micros();
+
+  lcd.beginFrame();
+
+  //=========================================================================
+  //update any changed sliders, starting from where the last frame finished.
+  //Stop once the frame budget has been used up so that a busy frame doesn't hold up the input controls -
+  //any remaining sliders will be drawn in the next frame.
+
+  bool frameBudgetUsed = false;
+
+  for (uint8_t count = 0; count < LCD_NUM_OF_SLIDERS; count++)
+  {
+    uint8_t i = lcdNextSliderToDraw;
+    lcdNextSliderToDraw = (lcdNextSliderToDraw + 1) % LCD_NUM_OF_SLIDERS;
+
+    if (lcdDrawState.sliderValues[i] != lcdDrawnState.sliderValues[i])
     {
-      for (uint8_t i = 0; i < LCD_NUM_OF_SLIDERS; i++)
-      {
-        //if the slider value needs updating
-        if (lcdSliderValue[i] != lcdPrevSliderValue[i])
-        {
-          //=========================================================================
-          //if one of the vertical knob controller sliders
-          if (i < LCD_SLIDER_DICTATOR_INDEX)
-          {
-            //if slider value has increased
-            if (lcdSliderValue[i] > lcdPrevSliderValue[i])
-            {
-              //increase the 'value' of the slider by drawing the value difference on the top
-              lcd.fillRect (i * LCD_VERT_SLIDER_SPACING,
-                            (lcd.height() - lcdSliderValue[i]) - (LCD_TEXT_LINE_SPACING + 2),
-                            LCD_SLIDER_WIDTH,
-                            lcdSliderValue[i] - lcdPrevSliderValue[i],
-                            LCD_COLOUR_SLIDERS_VALUE);
-            }
-            //if slider value has decreased
-            else
-            {
-              //decrease the 'value' of the slider by 'clearing' the value difference from the top
-              lcd.fillRect (i * LCD_VERT_SLIDER_SPACING,
-                            (lcd.height() - lcdPrevSliderValue[i]) - (LCD_TEXT_LINE_SPACING + 2),
-                            LCD_SLIDER_WIDTH,
-                            lcdPrevSliderValue[i] - lcdSliderValue[i],
-                            LCD_COLOUR_SLIDERS_BCKGND);
-            }
-
-          } //if (i < LCD_SLIDER_DICTATOR_INDEX)
-
-          //=========================================================================
-          //if one of the horizontal sliders
-          else
-          {
-            //number of pixels for 1 MIDI value
-            float midiToPixelVal = LCD_HORZ_SLIDER_LENGTH / 127.0;
-
-            uint8_t sliderYPos = (i == LCD_SLIDER_DICTATOR_INDEX) ? LCD_DICT_SLIDER_Y_POS : LCD_MIX_SLIDER_Y_POS;
-
-            //if slider value has increased
-            if (lcdSliderValue[i] > lcdPrevSliderValue[i])
-            {
-              //increase the 'value' of the slider by drawing the value difference to the right
-              lcd.fillRect ((lcd.width() - LCD_HORZ_SLIDER_LENGTH) + (lcdPrevSliderValue[i] * midiToPixelVal),
-                            sliderYPos,
-                            (lcdSliderValue[i] - lcdPrevSliderValue[i]) * midiToPixelVal,
-                            LCD_SLIDER_WIDTH,
-                            LCD_COLOUR_SLIDERS_VALUE);
-            }
-            //if slider value has decreased
-            else
-            {
-              //decrease the 'value' of the slider by 'clearing' the value difference to the left
-              lcd.fillRect ((lcd.width() - LCD_HORZ_SLIDER_LENGTH) + (lcdSliderValue[i] * midiToPixelVal),
-                            sliderYPos,
-                            (lcdPrevSliderValue[i] - lcdSliderValue[i]) * midiToPixelVal,
-                            LCD_SLIDER_WIDTH,
-                            LCD_COLOUR_SLIDERS_BCKGND);
-            }
-
-          } //else (horizontal slider)
-
-          lcdPrevSliderValue[i] = lcdSliderValue[i];
-
-        } //if (lcdSliderValue[i] != lcdPrevSliderValue[i])
-
-      } //for (uint8_t i = 0; i < LCD_NUM_OF_SLIDERS; i++)
-
-      //=========================================================================
-      //update text in top bar if changed
-      //FIXME: don't need to be updating label text - just values
-
-      if (lcdTopBarChannelChanged)
+      lcdDrawSliderValueChange (i);
+
+      if ((micros() - frameStartTime) > LCD_FRAME_BUDGET_US)
       {
-        lcd.fillRect (LCD_TOP_BAR_TEXT_CHAN_X_POS,
-                      LCD_TOP_BAR_TEXT_Y_POS,
-                      100,
-                      LCD_TEXT_LINE_SPACING - LCD_TOP_BAR_TEXT_Y_POS,
-                      LCD_COLOUR_TEXT);
+        frameBudgetUsed = true;
+        break;
+      }
 
-        lcd.setTextColor (LCD_COLOUR_BCKGND);
+    } //if (lcdDrawState.sliderValues[i] != lcdDrawnState.sliderValues[i])
 
-        lcd.setCursor (LCD_TOP_BAR_TEXT_CHAN_X_POS, LCD_TOP_BAR_TEXT_Y_POS);
-        lcd.print ("Chan:");
-        lcd.print (settingsData[SETTINGS_GLOBAL].paramData[PARAM_INDEX_MIDI_CHAN].value);
+  } //for (uint8_t count = 0; count < LCD_NUM_OF_SLIDERS; count++)
 
-        lcdTopBarChannelChanged = false;
+  //=========================================================================
+  //update text in top bar if changed
+  //FIXME: don't need to be updating label text - just values
 
-      } //if (lcdTopBarChannelChanged)
+  if (!frameBudgetUsed && lcdDrawState.channel != lcdDrawnState.channel)
+  {
+    lcd.fillRect (LCD_TOP_BAR_TEXT_CHAN_X_POS,
+                  LCD_TOP_BAR_TEXT_Y_POS,
+                  100,
+                  LCD_TEXT_LINE_SPACING - LCD_TOP_BAR_TEXT_Y_POS,
+                  LCD_COLOUR_TEXT);
 
-      if (lcdTopBarProgramChanged)
-      {
-        lcd.fillRect (LCD_TOP_BAR_TEXT_PRGM_X_POS,
-                      LCD_TOP_BAR_TEXT_Y_POS,
-                      100,
-                      LCD_TEXT_LINE_SPACING - LCD_TOP_BAR_TEXT_Y_POS,
-                      LCD_COLOUR_TEXT);
+    lcd.setTextColor (LCD_COLOUR_BCKGND);
+
+    lcd.setCursor (LCD_TOP_BAR_TEXT_CHAN_X_POS, LCD_TOP_BAR_TEXT_Y_POS);
+    lcd.print ("Chan:");
+    lcd.print (lcdDrawState.channel);
+
+    lcdDrawnState.channel = lcdDrawState.channel;
+
+  } //if (!frameBudgetUsed && lcdDrawState.channel != lcdDrawnState.channel)
+
+  if (!frameBudgetUsed && lcdDrawState.program != lcdDrawnState.program)
+  {
+    lcd.fillRect (LCD_TOP_BAR_TEXT_PRGM_X_POS,
+                  LCD_TOP_BAR_TEXT_Y_POS,
+                  100,
+                  LCD_TEXT_LINE_SPACING - LCD_TOP_BAR_TEXT_Y_POS,
+                  LCD_COLOUR_TEXT);
+
+    lcd.setTextColor (LCD_COLOUR_BCKGND);
+
+    lcd.setCursor (LCD_TOP_BAR_TEXT_PRGM_X_POS, LCD_TOP_BAR_TEXT_Y_POS);
+    lcd.print ("Prgm:");
+    lcd.print (lcdDrawState.program);
+
+    lcdDrawnState.program = lcdDrawState.program;
+
+  } //if (!frameBudgetUsed && lcdDrawState.program != lcdDrawnState.program)
+
+  if (!frameBudgetUsed && lcdDrawState.preset != lcdDrawnState.preset)
+  {
+    lcd.fillRect (LCD_TOP_BAR_TEXT_PRESET_X_POS,
+                  LCD_TOP_BAR_TEXT_Y_POS,
+                  LCD_TOP_BAR_TEXT_PRGM_X_POS - LCD_TOP_BAR_TEXT_PRESET_X_POS,
+                  LCD_TEXT_LINE_SPACING - LCD_TOP_BAR_TEXT_Y_POS,
+                  LCD_COLOUR_TEXT);
+
+    lcd.setTextColor (LCD_COLOUR_BCKGND);
+    lcdPrintTopBarPreset (lcdDrawState.preset);
+
+  } //if (!frameBudgetUsed && lcdDrawState.preset != lcdDrawnState.preset)
+
+  //=========================================================================
+
+  lcd.endFrame();
+
+  //Set the interval until the next frame so that drawing only uses up to a set share of the loop time.
+  //The draw cost follows increases straight away but only decays slowly, so a single cheap frame
+  //doesn't let a run of expensive frames through.
+  uint32_t frameCost = micros() - frameStartTime;
+
+  if (frameCost > lcdDrawCost)
+    lcdDrawCost = frameCost;
+  else
+    lcdDrawCost -= (lcdDrawCost - frameCost) / 8;
+
+  lcdFrameInterval = max (LCD_MIN_FRAME_INTERVAL_US, (lcdDrawCost * 100) / LCD_MAX_DRAW_DUTY_PERCENT);
+
+  lcdPreviousFrameTime = tickTime;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool lcdControlsDisplayNeedsUpdating()
+{
+  return memcmp (&lcdDrawState, &lcdDrawnState, sizeof (LcdDisplayState)) != 0;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool lcdProcessEvents (uint32_t frameStartTime)
+{
+  //Draws the queued display changes, stopping once the frame budget has been used up.
+  //Returns true if there are no more events to draw.
+
+  if (lcdRedrawRequested)
+  {
+    lcdRedrawRequested = false;
+    lcdEventQueueTail = lcdEventQueueHead;
+
+    if (lcdDisplayMode == LCD_DISPLAY_MODE_CONTROLS)
+    {
+      lcdReadDisplayState (lcdDrawState);
+      lcdDisplayControls();
+    }
+    else
+    {
+      lcdDisplayCompleteMenu (lcdCurrentlySelectedMenu, lcdCurrentSelectedMenuParam);
+    }
+
+    return false;
+
+  } //if (lcdRedrawRequested)
+
+  while (lcdEventQueueTail != lcdEventQueueHead)
+  {
+    lcdMemoryBarrier();
+    LcdEvent event = lcdEventQueue[lcdEventQueueTail % LCD_EVENT_QUEUE_SIZE];
+    lcdMemoryBarrier();
+    lcdEventQueueTail = lcdEventQueueTail + 1;
+
+    switch (event.type)
+    {
+      case LCD_EVENT_SHOW_CONTROLS:
+        lcdReadDisplayState (lcdDrawState);
+        lcdDisplayControls();
+        break;
+
+      case LCD_EVENT_SHOW_MENU:
+        lcdDisplayCompleteMenu (event.menu, event.param);
+        break;
+
+      default:
+        //menu changes are only drawn if the menu is being displayed
+        if (lcdDrawnDisplayMode == LCD_DISPLAY_MODE_SETTINGS_MENU)
+        {
+          if (event.type == LCD_EVENT_MENU_SELECTED)
+            lcdUpdateMenusDisplay (event.prev, event.menu, event.param);
+          else if (event.type == LCD_EVENT_PARAM_SELECTED)
+            lcdUpdateMenuParamsAndValuesDisplay (event.menu, event.prev, event.param);
+          else if (event.type == LCD_EVENT_VALUE_CHANGED)
+            lcdUpdateMenuSelectedValue (event.menu, event.param);
+          else if (event.type == LCD_EVENT_MENU_VALUES_CHANGED)
+            lcdDisplayMenuParamsAndValues (event.menu, event.param);
+        }
+        break;
+
+    } //switch (event.type)
+
+    if ((micros() - frameStartTime) > LCD_FRAME_BUDGET_US)
+      return false;
+
+  } //while (lcdEventQueueTail != lcdEventQueueHead)
+
+  return true;
+}
 
-        lcd.setTextColor (LCD_COLOUR_BCKGND);
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void lcdDrawSliderValueChange (uint8_t i)
+{
+  PROFILE_SCOPE (PROFILE_LCD_SLIDER_DRAW);
 
-        lcd.setCursor (LCD_TOP_BAR_TEXT_PRGM_X_POS, LCD_TOP_BAR_TEXT_Y_POS);
-        lcd.print ("Prgm:");
-        lcd.print (currentMidiProgramNumber);
+  //=========================================================================
+  //if one of the vertical knob controller sliders
+  if (i < LCD_SLIDER_DICTATOR_INDEX)
+  {
+    //if slider value has increased
+    if (lcdDrawState.sliderValues[i] > lcdDrawnState.sliderValues[i])
+    {
+      //increase the 'value' of the slider by drawing the value difference on the top
+      lcd.fillRect (i * LCD_VERT_SLIDER_SPACING,
+                    (lcd.height() - lcdDrawState.sliderValues[i]) - (LCD_TEXT_LINE_SPACING + 2),
+                    LCD_SLIDER_WIDTH,
+                    lcdDrawState.sliderValues[i] - lcdDrawnState.sliderValues[i],
+                    LCD_COLOUR_SLIDERS_VALUE);
+    }
+    //if slider value has decreased
+    else
+    {
+      //decrease the 'value' of the slider by 'clearing' the value difference from the top
+      lcd.fillRect (i * LCD_VERT_SLIDER_SPACING,
+                    (lcd.height() - lcdDrawnState.sliderValues[i]) - (LCD_TEXT_LINE_SPACING + 2),
+                    LCD_SLIDER_WIDTH,
+                    lcdDrawnState.sliderValues[i] - lcdDrawState.sliderValues[i],
+                    LCD_COLOUR_SLIDERS_BCKGND);
+    }
 
-        lcdTopBarProgramChanged = false;
+  } //if (i < LCD_SLIDER_DICTATOR_INDEX)
 
-      } //if (lcdTopBarProgramChanged)
+  //=========================================================================
+  //if one of the horizontal sliders
+  else
+  {
+    //number of pixels for 1 MIDI value
+    float midiToPixelVal = LCD_HORZ_SLIDER_LENGTH / 127.0;
 
-      //=========================================================================
+    uint8_t sliderYPos = (i == LCD_SLIDER_DICTATOR_INDEX) ? LCD_DICT_SLIDER_Y_POS : LCD_MIX_SLIDER_Y_POS;
 
-    } //if (lcdDisplayMode == LCD_DISPLAY_MODE_CONTROLS)
+    //if slider value has increased
+    if (lcdDrawState.sliderValues[i] > lcdDrawnState.sliderValues[i])
+    {
+      //increase the 'value' of the slider by drawing the value difference to the right
+      lcd.fillRect ((lcd.width() - LCD_HORZ_SLIDER_LENGTH) + (lcdDrawnState.sliderValues[i] * midiToPixelVal),
+                    sliderYPos,
+                    (lcdDrawState.sliderValues[i] - lcdDrawnState.sliderValues[i]) * midiToPixelVal,
+                    LCD_SLIDER_WIDTH,
+                    LCD_COLOUR_SLIDERS_VALUE);
+    }
+    //if slider value has decreased
+    else
+    {
+      //decrease the 'value' of the slider by 'clearing' the value difference to the left
+      lcd.fillRect ((lcd.width() - LCD_HORZ_SLIDER_LENGTH) + (lcdDrawState.sliderValues[i] * midiToPixelVal),
+                    sliderYPos,
+                    (lcdDrawnState.sliderValues[i] - lcdDrawState.sliderValues[i]) * midiToPixelVal,
+                    LCD_SLIDER_WIDTH,
+                    LCD_COLOUR_SLIDERS_BCKGND);
+    }
 
-    lcdPreviousMillis = millis();
+  } //else (horizontal slider)
 
-  } //if ((millis() - lcdPreviousMillis) > (1000.0 / (float)LCD_FRAME_RATE))
+  lcdDrawnState.sliderValues[i] = lcdDrawState.sliderValues[i];
 }
 
 //=========================================================================
@@ -220,9 +513,9 @@ void lcdSetDisplayMode (uint8_t mode)
     lcdDisplayMode = mode;
 
     if (lcdDisplayMode == LCD_DISPLAY_MODE_CONTROLS)
-      lcdDisplayControls();
+      lcdQueueEvent (LCD_EVENT_SHOW_CONTROLS);
     else
-      lcdDisplayCompleteMenu();
+      lcdQueueEvent (LCD_EVENT_SHOW_MENU);
 
   } //if (mode != lcdDisplayMode)
 }
@@ -240,8 +533,12 @@ void lcdToggleDisplayMode()
 //=========================================================================
 void lcdDisplayControls()
 {
+  //Draws the whole controls display from lcdDrawState
+
   //FIXME: would be better if the controls display was drawn using positions relative to the LCD size, rather than using absolute values.
 
+  lcd.beginFrame();
+
   lcd.fillScreen (LCD_COLOUR_BCKGND);
   lcd.setTextColor (LCD_COLOUR_TEXT);
   lcd.setTextSize (2);
@@ -254,14 +551,14 @@ void lcdDisplayControls()
     lcd.fillRect (i * LCD_VERT_SLIDER_SPACING,
                   (lcd.height() - LCD_VERT_SLIDER_LENGTH) - (LCD_TEXT_LINE_SPACING + 2),
                   LCD_SLIDER_WIDTH,
-                  LCD_VERT_SLIDER_LENGTH - lcdSliderValue[i],
+                  LCD_VERT_SLIDER_LENGTH - lcdDrawState.sliderValues[i],
                   LCD_COLOUR_SLIDERS_BCKGND);
 
     //draw 'value' section of the slider
     lcd.fillRect (i * LCD_VERT_SLIDER_SPACING,
-                  (lcd.height() - lcdSliderValue[i]) - (LCD_TEXT_LINE_SPACING + 2),
+                  (lcd.height() - lcdDrawState.sliderValues[i]) - (LCD_TEXT_LINE_SPACING + 2),
                   LCD_SLIDER_WIDTH,
-                  lcdSliderValue[i],
+                  lcdDrawState.sliderValues[i],
                   LCD_COLOUR_SLIDERS_VALUE);
 
     lcd.setCursor ((i * LCD_VERT_SLIDER_SPACING) + 5, lcd.height() - LCD_TEXT_LINE_SPACING);
@@ -286,9 +583,9 @@ void lcdDisplayControls()
     uint8_t sliderYPos = (i == LCD_SLIDER_DICTATOR_INDEX) ? LCD_DICT_SLIDER_Y_POS : LCD_MIX_SLIDER_Y_POS;
 
     //draw 'no value' section of the slider
-    lcd.fillRect ((lcd.width() - LCD_HORZ_SLIDER_LENGTH) + (lcdSliderValue[i] * midiToPixelVal),
+    lcd.fillRect ((lcd.width() - LCD_HORZ_SLIDER_LENGTH) + (lcdDrawState.sliderValues[i] * midiToPixelVal),
                   sliderYPos,
-                  LCD_HORZ_SLIDER_LENGTH - (lcdSliderValue[i] * midiToPixelVal),
+                  LCD_HORZ_SLIDER_LENGTH - (lcdDrawState.sliderValues[i] * midiToPixelVal),
                   LCD_SLIDER_WIDTH,
                   LCD_COLOUR_SLIDERS_BCKGND);
 
@@ -309,7 +606,7 @@ void lcdDisplayControls()
     //draw 'value' section of the slider
     lcd.fillRect (lcd.width() - LCD_HORZ_SLIDER_LENGTH,
                   sliderYPos,
-                  lcdSliderValue[i] * midiToPixelVal,
+                  lcdDrawState.sliderValues[i] * midiToPixelVal,
                   LCD_SLIDER_WIDTH,
                   LCD_COLOUR_SLIDERS_VALUE);
 
@@ -324,13 +621,35 @@ void lcdDisplayControls()
 
   lcd.setCursor (LCD_TOP_BAR_TEXT_CHAN_X_POS, LCD_TOP_BAR_TEXT_Y_POS);
   lcd.print ("Chan:");
-  lcd.print (settingsData[SETTINGS_GLOBAL].paramData[PARAM_INDEX_MIDI_CHAN].value);
-  lcdTopBarChannelChanged = false;
+  lcd.print (lcdDrawState.channel);
 
   lcd.setCursor (LCD_TOP_BAR_TEXT_PRGM_X_POS, LCD_TOP_BAR_TEXT_Y_POS);
   lcd.print ("Prgm:");
-  lcd.print (currentMidiProgramNumber);
-  lcdTopBarProgramChanged = false;
+  lcd.print (lcdDrawState.program);
+
+  lcdPrintTopBarPreset (lcdDrawState.preset);
+
+  lcd.endFrame();
+  lcdTraceFrameStats (LCD_DISPLAY_MODE_CONTROLS);
+
+  lcdDrawnState = lcdDrawState;
+  lcdDrawnDisplayMode = LCD_DISPLAY_MODE_CONTROLS;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void lcdPrintTopBarPreset (int8_t preset)
+{
+  lcd.setCursor (LCD_TOP_BAR_TEXT_PRESET_X_POS, LCD_TOP_BAR_TEXT_Y_POS);
+  lcd.print ("Pre:");
+
+  if (preset == PRESET_NONE)
+    lcd.print ("--");
+  else
+    lcd.print (preset + 1);
+
+  lcdDrawnState.preset = preset;
 }
 
 //=========================================================================
@@ -344,78 +663,85 @@ void lcdSetSliderValue (uint8_t sliderNum, uint8_t paramMidiVal)
 //=========================================================================
 //=========================================================================
 //=========================================================================
-void lcdDisplayMenus()
+void lcdDisplayMenus (int8_t menu)
 {
   for (auto i = 0; i < SETTINGS_NUM_OF_CATS; i++)
   {
-    if (i == lcdCurrentlySelectedMenu)
+    if (i == menu)
       lcd.setTextColor (LCD_COLOUR_BCKGND, LCD_COLOUR_TEXT);
     else
       lcd.setTextColor (LCD_COLOUR_TEXT);
 
     lcd.setCursor (0, i * LCD_TEXT_LINE_SPACING);
-    lcd.println (settingsData[i].name);
+    lcd.println (settingsCategorySchema[i].name);
 
   }//for (auto i = 0; i < SETTINGS_NUM_OF_CATS; i++)
 }
 //=========================================================================
 //=========================================================================
 //=========================================================================
-void lcdDisplayMenuParamsAndValues()
+void lcdDisplayMenuParamsAndValues (int8_t menu, int8_t param)
 {
   lcd.fillRect (120, 0, 105, lcd.height(), LCD_COLOUR_BCKGND);
   lcd.fillRect (240, 0, 80, lcd.height(), LCD_COLOUR_BCKGND);
 
-  for (auto i = 0; i < settingsData[lcdCurrentlySelectedMenu].numOfParams; i++)
+  for (auto i = 0; i < settingsCategorySchema[menu].numOfParams; i++)
   {
-    if (i == lcdCurrentSelectedMenuParam)
+    if (i == param)
       lcd.setTextColor (LCD_COLOUR_BCKGND, LCD_COLOUR_TEXT);
     else
       lcd.setTextColor (LCD_COLOUR_TEXT);
 
     lcd.setCursor (120, i * LCD_TEXT_LINE_SPACING);
-    lcd.println (settingsData[lcdCurrentlySelectedMenu].paramData[i].name);
+    lcd.println (settingsGetParamSchema (menu, i).name);
 
     lcd.setCursor (240, i * LCD_TEXT_LINE_SPACING);
-    lcdPrintParamValueToDisplay (lcdCurrentlySelectedMenu, i);
+    lcdPrintParamValueToDisplay (menu, i);
 
-  } //for (auto i = 0; i < settingsData[lcdCurrentlySelectedMenu].numOfParams; i++)
+  } //for (auto i = 0; i < settingsCategorySchema[menu].numOfParams; i++)
 }
 
 //=========================================================================
 //=========================================================================
 //=========================================================================
-void lcdDisplayCompleteMenu()
+void lcdDisplayCompleteMenu (int8_t menu, int8_t param)
 {
   //FIXME: would be better if the menu display was drawn using positions relative to the LCD size, rather than using absolute values.
 
+  lcd.beginFrame();
+
   lcd.fillScreen (LCD_COLOUR_BCKGND);
   lcd.setTextSize (2);
 
-  lcdDisplayMenus();
-  lcdDisplayMenuParamsAndValues();
+  lcdDisplayMenus (menu);
+  lcdDisplayMenuParamsAndValues (menu, param);
 
   lcd.fillRect (105, 0, 2, lcd.height(), LCD_COLOUR_TEXT);
   lcd.fillRect (225, 0, 2, lcd.height(), LCD_COLOUR_TEXT);
+
+  lcd.endFrame();
+  lcdTraceFrameStats (LCD_DISPLAY_MODE_SETTINGS_MENU);
+
+  lcdDrawnDisplayMode = LCD_DISPLAY_MODE_SETTINGS_MENU;
 }
 
 //=========================================================================
 //=========================================================================
 //=========================================================================
-void lcdUpdateMenusDisplay()
+void lcdUpdateMenusDisplay (int8_t prevMenu, int8_t menu, int8_t param)
 {
-  if (lcdCurrentlySelectedMenu != lcdPrevSelectedMenu)
+  if (menu != prevMenu)
   {
     for (auto i = 0; i < SETTINGS_NUM_OF_CATS; i++)
     {
       bool updateText = false;
 
-      if (i == lcdPrevSelectedMenu)
+      if (i == prevMenu)
       {
         updateText = true;
         lcd.setTextColor (LCD_COLOUR_TEXT, LCD_COLOUR_BCKGND);
       }
-      if (i == lcdCurrentlySelectedMenu)
+      if (i == menu)
       {
         updateText = true;
         lcd.setTextColor (LCD_COLOUR_BCKGND, LCD_COLOUR_TEXT);
@@ -424,66 +750,67 @@ void lcdUpdateMenusDisplay()
       if (updateText)
       {
         lcd.setCursor (0, i * LCD_TEXT_LINE_SPACING);
-        lcd.println (settingsData[i].name);
+        lcd.println (settingsCategorySchema[i].name);
 
-        lcdDisplayMenuParamsAndValues();
+        lcdDisplayMenuParamsAndValues (menu, param);
       }
 
     } //for (auto i = 0; i < SETTINGS_NUM_OF_CATS; i++)
 
-  } //if (lcdCurrentlySelectedMenu != lcdPrevSelectedMenu)
+  } //if (menu != prevMenu)
 }
 
 //=========================================================================
 //=========================================================================
 //=========================================================================
-void lcdUpdateMenuParamsAndValuesDisplay()
+void lcdUpdateMenuParamsAndValuesDisplay (int8_t menu, int8_t prevParam, int8_t param)
 {
-  if (lcdCurrentSelectedMenuParam != lcdPrevSelectedMenuParam)
+  if (param != prevParam)
   {
-    lcd.fillRect (120, 0, 105, lcd.height(), LCD_COLOUR_BCKGND);
-    lcd.fillRect (240, 0, 80, lcd.height(), LCD_COLOUR_BCKGND);
-
-    for (auto i = 0; i < settingsData[lcdCurrentlySelectedMenu].numOfParams; i++)
+    for (auto i = 0; i < settingsCategorySchema[menu].numOfParams; i++)
     {
       bool updateText = false;
 
-      if (i == lcdPrevSelectedMenuParam)
+      if (i == prevParam)
       {
         updateText = true;
         lcd.setTextColor (LCD_COLOUR_TEXT, LCD_COLOUR_BCKGND);
       }
-      if (i == lcdCurrentSelectedMenuParam)
+      if (i == param)
       {
         updateText = true;
         lcd.setTextColor (LCD_COLOUR_BCKGND, LCD_COLOUR_TEXT);
       }
 
+      //(only the rows that change are cleared, as the rest of the params and values stay as they are)
       if (updateText)
       {
+        lcd.fillRect (120, i * LCD_TEXT_LINE_SPACING, 105, LCD_TEXT_LINE_SPACING, LCD_COLOUR_BCKGND);
+        lcd.fillRect (240, i * LCD_TEXT_LINE_SPACING, 80, LCD_TEXT_LINE_SPACING, LCD_COLOUR_BCKGND);
+
         lcd.setCursor (120, i * LCD_TEXT_LINE_SPACING);
-        lcd.println (settingsData[lcdCurrentlySelectedMenu].paramData[i].name);
+        lcd.println (settingsGetParamSchema (menu, i).name);
 
         lcd.setCursor (240, i * LCD_TEXT_LINE_SPACING);
-        lcdPrintParamValueToDisplay (lcdCurrentlySelectedMenu, i);
+        lcdPrintParamValueToDisplay (menu, i);
       }
 
-    } //for (auto i = 0; i < settingsData[lcdCurrentlySelectedMenu].numOfParams; i++)
+    } //for (auto i = 0; i < settingsCategorySchema[menu].numOfParams; i++)
 
-  } //if (lcdCurrentSelectedMenuParam != lcdPrevSelectedMenuParam)
+  } //if (param != prevParam)
 }
 
 //=========================================================================
 //=========================================================================
 //=========================================================================
-void lcdUpdateMenuSelectedValue()
+void lcdUpdateMenuSelectedValue (int8_t menu, int8_t param)
 {
-  lcd.fillRect (240, lcdCurrentSelectedMenuParam * LCD_TEXT_LINE_SPACING, 80, LCD_TEXT_LINE_SPACING, LCD_COLOUR_BCKGND);
+  lcd.fillRect (240, param * LCD_TEXT_LINE_SPACING, 80, LCD_TEXT_LINE_SPACING, LCD_COLOUR_BCKGND);
 
   lcd.setTextColor (LCD_COLOUR_BCKGND, LCD_COLOUR_TEXT);
-  lcd.setCursor (240, lcdCurrentSelectedMenuParam * LCD_TEXT_LINE_SPACING);
+  lcd.setCursor (240, param * LCD_TEXT_LINE_SPACING);
 
-  lcdPrintParamValueToDisplay (lcdCurrentlySelectedMenu, lcdCurrentSelectedMenuParam);
+  lcdPrintParamValueToDisplay (menu, param);
 }
 
 //=========================================================================
@@ -493,13 +820,25 @@ void lcdPrintParamValueToDisplay (uint8_t menu, uint8_t param)
 {
   if (param == PARAM_INDEX_MIDI_CHAN &&
       menu != SETTINGS_GLOBAL &&
-      settingsData[menu].paramData[param].value == 0)
+      settingsGetValue (menu, param) == 0)
   {
     lcd.println ("Global");
   }
+  else if (menu == SETTINGS_GLOBAL && param == PARAM_INDEX_MOD_SYNC)
+  {
+    lcd.println (modulationSyncModeNames[settingsGetValue (menu, param)]);
+  }
+  else if (param == PARAM_INDEX_MOD_SOURCE)
+  {
+    lcd.println (modulationSourceNames[settingsGetValue (menu, param)]);
+  }
+  else if (param == PARAM_INDEX_MSG_TYPE)
+  {
+    lcd.println (messageMapGetMsgTypeName (menu, settingsGetValue (menu, param)));
+  }
   else
   {
-    lcd.println (settingsData[menu].paramData[param].value);
+    lcd.println (settingsGetValue (menu, param));
   }
 }
 
@@ -517,7 +856,11 @@ void lcdSetSelectedMenu (int8_t incVal)
 
     if (lcdCurrentlySelectedMenu != lcdPrevSelectedMenu)
     {
-      lcdUpdateMenusDisplay();
+      //the menus don't all have the same number of params, so keep the selected param within the new menu
+      lcdCurrentSelectedMenuParam = min (lcdCurrentSelectedMenuParam, (int8_t)(settingsCategorySchema[lcdCurrentlySelectedMenu].numOfParams - 1));
+      lcdPrevSelectedMenuParam = lcdCurrentSelectedMenuParam;
+
+      lcdQueueEvent (LCD_EVENT_MENU_SELECTED, lcdPrevSelectedMenu);
       lcdPrevSelectedMenu = lcdCurrentlySelectedMenu;
     }
   } //if (lcdDisplayMode = LCD_DISPLAY_MODE_SETTINGS_MENU || lcdAutoSwitchToMenuDisplay)
@@ -533,11 +876,11 @@ void lcdSetSelectedParam (int8_t incVal)
     if (lcdDisplayMode != LCD_DISPLAY_MODE_SETTINGS_MENU)
       lcdSetDisplayMode (LCD_DISPLAY_MODE_SETTINGS_MENU);
 
-    lcdCurrentSelectedMenuParam = constrain (lcdCurrentSelectedMenuParam + incVal, 0, settingsData[lcdCurrentlySelectedMenu].numOfParams - 1);
+    lcdCurrentSelectedMenuParam = constrain (lcdCurrentSelectedMenuParam + incVal, 0, settingsCategorySchema[lcdCurrentlySelectedMenu].numOfParams - 1);
 
     if (lcdCurrentSelectedMenuParam != lcdPrevSelectedMenuParam)
     {
-      lcdUpdateMenuParamsAndValuesDisplay();
+      lcdQueueEvent (LCD_EVENT_PARAM_SELECTED, lcdPrevSelectedMenuParam);
       lcdPrevSelectedMenuParam = lcdCurrentSelectedMenuParam;
     }
 
@@ -554,45 +897,35 @@ void lcdSetSelectedParamValue (int8_t incVal)
     if (lcdDisplayMode != LCD_DISPLAY_MODE_SETTINGS_MENU)
       lcdSetDisplayMode (LCD_DISPLAY_MODE_SETTINGS_MENU);
 
-    uint8_t currentVal = settingsData[lcdCurrentlySelectedMenu].paramData[lcdCurrentSelectedMenuParam].value;
-    uint8_t minVal = settingsData[lcdCurrentlySelectedMenu].paramData[lcdCurrentSelectedMenuParam].minVal;
-    uint8_t maxVal = settingsData[lcdCurrentlySelectedMenu].paramData[lcdCurrentSelectedMenuParam].maxVal;
+    uint8_t currentVal = settingsGetValue (lcdCurrentlySelectedMenu, lcdCurrentSelectedMenuParam);
+    uint8_t minVal = settingsGetParamSchema (lcdCurrentlySelectedMenu, lcdCurrentSelectedMenuParam).minVal;
+    uint8_t maxVal = settingsGetParamSchema (lcdCurrentlySelectedMenu, lcdCurrentSelectedMenuParam).maxVal;
 
     uint8_t newVal = constrain (currentVal + incVal, minVal, maxVal);
 
     if (newVal != currentVal)
     {
-      settingsData[lcdCurrentlySelectedMenu].paramData[lcdCurrentSelectedMenuParam].value = newVal;
-      lcdUpdateMenuSelectedValue();
+      //set the new value, flagging that it needs saving to EEPROM
+      settingsSetValue (lcdCurrentlySelectedMenu, lcdCurrentSelectedMenuParam, newVal);
+      lcdQueueEvent (LCD_EVENT_VALUE_CHANGED);
 
-      //flag that the new value needs saving to EEPROM
-      settingsData[lcdCurrentlySelectedMenu].paramData[lcdCurrentSelectedMenuParam].needsSavingToEeprom = true;
-
-      //if changing any of the MIDI channel settings
+      //if changing any of the MIDI channel settings, switch the controls to the stored values of their new channel
       if (lcdCurrentSelectedMenuParam == PARAM_INDEX_MIDI_CHAN)
-      {
-        //for each device param
-        for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
-        {
-          //if changing the global MIDI channel and this param uses the global MIDI channel,
-          //or changing the MIDI channel for this param
-          if ((lcdCurrentlySelectedMenu == SETTINGS_GLOBAL && settingsData[i + 1].paramData[PARAM_INDEX_MIDI_CHAN].value == 0) ||
-              lcdCurrentlySelectedMenu == i + 1)
-          {
-            //set the device param value to be the stored one
-            if (i < DEVICE_PARAM_INDEX_MIX)
-              setKnobControllerBaseValue (i, deviceParamValuesForMidiChannel[newVal - 1][i], false);
-            else
-              setMixControllerValue (deviceParamValuesForMidiChannel[newVal - 1][i], false);
-          }
-
-        } //for (uint8_t i = 0; i < NUM_OF_ACTUAL_KNOB_CONTROLLERS; i++)
-
-      } //if (lcdCurrentSelectedMenuParam == PARAM_INDEX_MIDI_CHAN)
+        updateMidiChannelViews (false);
 
     } //if (newVal != currentVal)
 
   } //if (lcdDisplayMode = LCD_DISPLAY_MODE_SETTINGS_MENU || lcdAutoSwitchToMenuDisplay)
 }
 
-
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void lcdTraceFrameStats (uint8_t displayMode)
+{
+  //The frame hash of a complete redraw only depends on the state being displayed,
+  //so can be noted down and compared against as a reference for that state.
+  //(The running totals of each drawing operation are printed with the task stats - see SerialCommands.h)
+  TRACE (TRACE_LCD_FRAME, displayMode, min (lcd.getFrameStats().calls, (uint32_t)INT16_MAX), lcd.getFrameMicros());
+  TRACE (TRACE_LCD_FRAME_HASH, 0, 0, lcd.getFrameHash());
+}
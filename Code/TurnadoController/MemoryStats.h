@@ -0,0 +1,198 @@
+#include <malloc.h>
+
+//=========================================================================
+//RAM usage.
+//
+//Shows how the RAM is used, so that the effect of adding buffers and tables can be seen on an actual unit:
+//- The size of the static RAM of each module against its budget, with a compile time check for the Teensy that
+//  each module and the total are within budget (so a change that takes a module over budget doesn't build).
+//  The host build's sizes are bigger (its pointers are 8 bytes), so it checks them with a test instead
+//  (see Code/Host/Tests/MemoryBudgetTest.cpp).
+//- Heap use (everything allocated with new, e.g. the controls in setupControls())
+//- The deepest the stack has reached, including any interrupts and nested callbacks. The free RAM between the
+//  heap and the stack is painted with a pattern at startup (memoryPaintStack(), which is called first thing in
+//  setup()), and the lowest word of it that has been written over marks the deepest point of the stack.
+//
+//The stats are printed over USB serial a line at a time when an 'm' is received (see SerialCommands.h).
+
+//Static RAM of the modules below - half of the 256KB of RAM, leaving the rest
+//for the Teensy core, the heap and the stack
+#define MEMORY_STATIC_RAM_BUDGET (128 * 1024)
+
+#define MEMORY_STACK_PAINT_PATTERN 0xA5A5A5A5
+#define MEMORY_STACK_PAINT_MARGIN 256 //bytes below the stack pointer left unpainted, for memoryPaintStack()'s own use
+
+//Teensy core and linker symbols
+extern unsigned long _sdata; //start of static RAM
+extern unsigned long _ebss; //end of static RAM, and start of the heap
+extern unsigned long _estack; //top of the stack (the end of RAM)
+extern char *__brkval; //top of the heap
+
+struct MemoryModuleSize
+{
+  const char *name;
+  uint32_t size;
+  uint32_t budget;
+};
+
+constexpr MemoryModuleSize memoryModuleSizes[] =
+{
+  {"Settings", sizeof (settingsValues) + sizeof (joystickCalibration) + sizeof (journalCompactHeader), 512},
+  {"Presets", sizeof (presetsStore) + sizeof (presetsStoreBuffer), 2 * 1024},
+  {"Program cache", sizeof (programCache), 24 * 1024},
+  {"MIDI channel state", sizeof (midiChannelState) + sizeof (deviceParamChannelIndex), 512},
+  {"MIDI-out queues", sizeof (midiOutPerformancePackets) + sizeof (midiOutPerformanceQueueTimes) +
+                      sizeof (midiOutBulkPackets) + sizeof (midiOutBulkQueueTimes) + sizeof (midiOutQueues), 4 * 1024},
+  {"Message map", sizeof (messageMapCode) + sizeof (messageMapStart), 512},
+  {"LCD", sizeof (lcd) + sizeof (lcdPublishedState) + sizeof (lcdDrawState) + sizeof (lcdDrawnState) +
+          sizeof (lcdEventQueue) + sizeof (lcdSliderValue), 1024},
+  {"Controls", sizeof (encoderDecoder) + sizeof (knobControllerData) + sizeof (knobControllersEncoders) +
+               sizeof (knobControllersJoysticks) + sizeof (lcdEncoders), 2 * 1024},
+  {"Modulation", sizeof (modulationState) + sizeof (modulationRateIncrements) + sizeof (modulationSineTable), 1536},
+  {"Gesture looper", sizeof (gestureLooperLanes), 40 * 1024},
+  {"Scene morph", sizeof (sceneMorphScenes) + sizeof (sceneMorphPairs) + sizeof (sceneMorphValues), 512},
+  {"Task scheduler", sizeof (scheduler), 1024},
+#ifndef DISABLE_PROFILER
+  {"Profiler", sizeof (profileStats), 2 * 1024},
+#endif
+#ifdef DEBUG
+  {"Debug trace", sizeof (traceRing), 4 * 1024},
+#endif
+#ifdef ENABLE_INPUT_TRACE
+  {"Input trace", sizeof (inputTraceRecords) + sizeof (inputTraceStartState) + sizeof (inputTraceLiveState) +
+                  sizeof (inputTraceStartBlocks) + sizeof (inputTraceLiveBlocks) + sizeof (inputTraceSavePool), 48 * 1024},
+#endif
+};
+
+#define MEMORY_NUM_OF_MODULES (sizeof (memoryModuleSizes) / sizeof (MemoryModuleSize))
+
+//a heading, a line per module, the total, the heap and the stack
+#define MEMORY_NUM_OF_STATS_LINES (MEMORY_NUM_OF_MODULES + 4)
+
+constexpr uint32_t memoryGetStaticRamTotal()
+{
+  uint32_t total = 0;
+
+  for (uint8_t i = 0; i < MEMORY_NUM_OF_MODULES; i++)
+    total += memoryModuleSizes[i].size;
+
+  return total;
+}
+
+constexpr bool memoryModulesAreWithinBudget()
+{
+  for (uint8_t i = 0; i < MEMORY_NUM_OF_MODULES; i++)
+  {
+    if (memoryModuleSizes[i].size > memoryModuleSizes[i].budget)
+      return false;
+  }
+
+  return true;
+}
+
+#ifndef HOST_BUILD
+static_assert (memoryModulesAreWithinBudget(), "Static RAM of a module is over its budget (see memoryModuleSizes)");
+static_assert (memoryGetStaticRamTotal() <= MEMORY_STATIC_RAM_BUDGET, "Static RAM of the modules is over budget (see memoryModuleSizes)");
+#endif
+
+uint32_t *memoryStackPaintTop = NULL; //the end of the painted RAM
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void memoryPaintStack()
+{
+  //Paints the free RAM between the top of the heap and just below the stack pointer
+  uint8_t stackMarker;
+
+  uint32_t *paintPos = (uint32_t*)(((uintptr_t)__brkval + 3) & ~3);
+  uint32_t *paintEnd = (uint32_t*)(((uintptr_t)&stackMarker - MEMORY_STACK_PAINT_MARGIN) & ~3);
+
+  if (paintEnd <= paintPos)
+    return;
+
+  memoryStackPaintTop = paintEnd;
+
+  while (paintPos < paintEnd)
+    *paintPos++ = MEMORY_STACK_PAINT_PATTERN;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+uint32_t memoryGetMaxStackDepth()
+{
+  //Returns the deepest the stack has reached since startup, in bytes, by finding the lowest painted word
+  //that has been written over (searching up from the top of the heap, as the heap may have grown into the
+  //bottom of the painted RAM since). Returns 0 if the RAM wasn't painted.
+  if (memoryStackPaintTop == NULL)
+    return 0;
+
+  uint32_t *pos = (uint32_t*)(((uintptr_t)__brkval + 3) & ~3);
+
+  while (pos < memoryStackPaintTop && *pos == MEMORY_STACK_PAINT_PATTERN)
+    pos++;
+
+  return (uintptr_t)&_estack - (uintptr_t)pos;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void memoryPrintStats (uint8_t line)
+{
+  //Prints a line (0 to MEMORY_NUM_OF_STATS_LINES - 1) of the stats
+  if (line == 0)
+  {
+    Serial.println ("Static RAM:");
+  }
+
+  else if (line <= MEMORY_NUM_OF_MODULES)
+  {
+    const MemoryModuleSize &module = memoryModuleSizes[line - 1];
+
+    Serial.print ("  ");
+    Serial.print (module.name);
+    Serial.print (": ");
+    Serial.print (module.size);
+    Serial.print ("/");
+    Serial.print (module.budget);
+    Serial.println (" bytes budgeted");
+  }
+
+  else if (line == MEMORY_NUM_OF_MODULES + 1)
+  {
+    Serial.print ("  Total: ");
+    Serial.print (memoryGetStaticRamTotal());
+    Serial.print ("/");
+    Serial.print (MEMORY_STATIC_RAM_BUDGET);
+    Serial.print (" bytes budgeted, ");
+    Serial.print ((uintptr_t)&_ebss - (uintptr_t)&_sdata);
+    Serial.println (" bytes in all (including the Teensy core)");
+  }
+
+  else if (line == MEMORY_NUM_OF_MODULES + 2)
+  {
+    struct mallinfo heapInfo = mallinfo();
+
+    Serial.print ("Heap: ");
+    Serial.print (heapInfo.uordblks);
+    Serial.print (" bytes in use, ");
+    Serial.print ((uintptr_t)__brkval - (uintptr_t)&_ebss);
+    Serial.println (" bytes reserved");
+  }
+
+  else
+  {
+    uint8_t stackMarker;
+    uint32_t maxStackDepth = memoryGetMaxStackDepth();
+
+    Serial.print ("Stack: ");
+    Serial.print ((uintptr_t)&_estack - (uintptr_t)&stackMarker);
+    Serial.print (" bytes now, ");
+    Serial.print (maxStackDepth);
+    Serial.print (" bytes max, ");
+    Serial.print ((uintptr_t)&_estack - maxStackDepth - (uintptr_t)__brkval);
+    Serial.println (" bytes never used between the heap and stack");
+  }
+}
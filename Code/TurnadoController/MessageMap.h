@@ -0,0 +1,227 @@
+//=========================================================================
+//Assignable MIDI-out messages.
+//
+//What each control sends is set by its Msg Type, MIDI channel and CC Num settings. Rather than looking these up
+//(and branching on them) every time a control sends, each control's messages are compiled into a short program
+//of instructions whenever the settings change, which messageMapSend() then just steps through with the value.
+//
+//An instruction is a single MIDI message with a fixed channel and data bytes, where either data byte can instead
+//be the control's value. A control can therefore send a sequence of messages (e.g. the randomise CC pair of
+//127 then 0). Pitch bend is sent with the value scaled to 14 bits, with 64 sent as the 8192 centre exactly (see
+//messageMapGetPitchBendValue()), so that a centred control doesn't leave a small bend on.
+//
+//Size: 4 bytes per instruction, with at most 2 messages (plus an end) per control.
+
+enum MessageMapControls
+{
+  //knob controllers, dictator and mix - these match the device param indexes
+  MESSAGE_MAP_MIX = DEVICE_PARAM_INDEX_MIX,
+  MESSAGE_MAP_RANDOMISE,
+  MESSAGE_MAP_PROGRAM,
+
+  NUM_OF_MESSAGE_MAP_CONTROLS
+};
+
+enum MessageMapOps
+{
+  MSG_OP_END = 0,
+  MSG_OP_CC,
+  MSG_OP_PROGRAM_CHANGE,
+  MSG_OP_NOTE_ON,
+  MSG_OP_NOTE_OFF,
+  MSG_OP_PITCH_BEND,
+  MSG_OP_CHANNEL_PRESSURE
+};
+
+#define MSG_DATA_VALUE 0x80 //a data byte that is replaced with the control's value
+#define MESSAGE_MAP_MAX_INSTRUCTIONS_PER_CONTROL 3
+#define MESSAGE_MAP_CODE_SIZE (NUM_OF_MESSAGE_MAP_CONTROLS * MESSAGE_MAP_MAX_INSTRUCTIONS_PER_CONTROL)
+
+struct MessageMapInstruction
+{
+  uint8_t op;
+  uint8_t channel; //0-15
+  uint8_t data1;
+  uint8_t data2;
+};
+
+//names for the settings menu, which has room for 6 characters
+const char* const continuousMsgTypeNames[NUM_OF_CONTINUOUS_MSG_TYPES] = {"CC", "PBend", "ChPres"};
+const char* const triggerMsgTypeNames[NUM_OF_TRIGGER_MSG_TYPES] = {"CC x2", "CC", "Note", "Prog"};
+
+MessageMapInstruction messageMapCode[MESSAGE_MAP_CODE_SIZE];
+uint8_t messageMapStart[NUM_OF_MESSAGE_MAP_CONTROLS]; //index of the first instruction of each control
+
+bool messageMapNeedsCompiling = true;
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void messageMapInvalidate()
+{
+  //The map is recompiled the next time a control sends, so that a whole preset of changes only compiles it once
+  messageMapNeedsCompiling = true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void messageMapEmit (uint8_t &pos, uint8_t op, uint8_t channel, uint8_t data1, uint8_t data2)
+{
+  messageMapCode[pos++] = {op, channel, data1, data2};
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void messageMapCompile()
+{
+  uint8_t pos = 0;
+
+  for (uint8_t control = 0; control < NUM_OF_MESSAGE_MAP_CONTROLS; control++)
+  {
+    //the settings categories of the controls are in the same order, after the global category
+    uint8_t cat = control + 1;
+    uint8_t channel = settingsGetMidiChannel (cat) - 1;
+
+    messageMapStart[control] = pos;
+
+    if (control == MESSAGE_MAP_PROGRAM)
+    {
+      messageMapEmit (pos, MSG_OP_PROGRAM_CHANGE, channel, MSG_DATA_VALUE, 0);
+    }
+
+    else if (control == MESSAGE_MAP_RANDOMISE)
+    {
+      uint8_t number = settingsGetValue (cat, PARAM_INDEX_CC_NUM);
+
+      switch (settingsGetValue (cat, PARAM_INDEX_MSG_TYPE))
+      {
+        case MSG_TYPE_CC_PAIR:
+          //The Turnado randomise button needs a CC value change to trigger it (sending the same CC value won't do anything).
+          //Therefore need to send two CC's here each with a different value.
+          messageMapEmit (pos, MSG_OP_CC, channel, number, 127);
+          messageMapEmit (pos, MSG_OP_CC, channel, number, 0);
+          break;
+
+        case MSG_TYPE_CC_SINGLE:
+          messageMapEmit (pos, MSG_OP_CC, channel, number, 127);
+          break;
+
+        case MSG_TYPE_NOTE:
+          messageMapEmit (pos, MSG_OP_NOTE_ON, channel, number, 127);
+          messageMapEmit (pos, MSG_OP_NOTE_OFF, channel, number, 0);
+          break;
+
+        case MSG_TYPE_PROGRAM_CHANGE:
+          messageMapEmit (pos, MSG_OP_PROGRAM_CHANGE, channel, number, 0);
+          break;
+
+        default:
+          break;
+
+      } //switch (settingsGetValue (cat, PARAM_INDEX_MSG_TYPE))
+    }
+
+    else
+    {
+      switch (settingsGetValue (cat, PARAM_INDEX_MSG_TYPE))
+      {
+        case MSG_TYPE_CC:
+          messageMapEmit (pos, MSG_OP_CC, channel, settingsGetValue (cat, PARAM_INDEX_CC_NUM), MSG_DATA_VALUE);
+          break;
+
+        case MSG_TYPE_PITCH_BEND:
+          messageMapEmit (pos, MSG_OP_PITCH_BEND, channel, MSG_DATA_VALUE, 0);
+          break;
+
+        case MSG_TYPE_CHANNEL_PRESSURE:
+          messageMapEmit (pos, MSG_OP_CHANNEL_PRESSURE, channel, MSG_DATA_VALUE, 0);
+          break;
+
+        default:
+          break;
+
+      } //switch (settingsGetValue (cat, PARAM_INDEX_MSG_TYPE))
+    }
+
+    messageMapEmit (pos, MSG_OP_END, 0, 0, 0);
+
+  } //for (uint8_t control = 0; control < NUM_OF_MESSAGE_MAP_CONTROLS; control++)
+
+  messageMapNeedsCompiling = false;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+uint16_t messageMapGetPitchBendValue (uint8_t value)
+{
+  //Scales a 7-bit value to a 14-bit pitch bend value, where 0 is 0, 64 is the 8192 centre and 127 is 16383,
+  //by scaling each side of the centre separately (as the 7-bit range has fewer values above the centre)
+  if (value <= 64)
+    return value << 7;
+  else
+    return 8192 + (((value - 64) * 8191) / 63);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void messageMapSend (uint8_t control, uint8_t value)
+{
+  //Sends the messages of a control, with the given value (0-127) where the messages use it
+
+  if (messageMapNeedsCompiling)
+    messageMapCompile();
+
+  //knob controller CCs are marked as such so that their loopback can be ignored
+  int8_t deviceParamIndex = (control < NUM_OF_DEVICE_PARAMS) ? control : -1;
+
+  for (const MessageMapInstruction *instruction = &messageMapCode[messageMapStart[control]]; instruction->op != MSG_OP_END; instruction++)
+  {
+    byte channel = instruction->channel + 1;
+    byte data1 = (instruction->data1 == MSG_DATA_VALUE) ? value : instruction->data1;
+    byte data2 = (instruction->data2 == MSG_DATA_VALUE) ? value : instruction->data2;
+
+    switch (instruction->op)
+    {
+      case MSG_OP_CC:
+        sendMidiCcMessage (channel, data1, data2, deviceParamIndex);
+        break;
+
+      case MSG_OP_PROGRAM_CHANGE:
+        sendMidiProgramChangeMessage (channel, data1);
+        break;
+
+      case MSG_OP_NOTE_ON:
+        sendMidiNoteOnMessage (channel, data1, data2);
+        break;
+
+      case MSG_OP_NOTE_OFF:
+        sendMidiNoteOffMessage (channel, data1, data2);
+        break;
+
+      case MSG_OP_PITCH_BEND:
+        sendMidiPitchBendMessage (channel, messageMapGetPitchBendValue (data1));
+        break;
+
+      case MSG_OP_CHANNEL_PRESSURE:
+        sendMidiChannelPressureMessage (channel, data1);
+        break;
+
+      default:
+        break;
+
+    } //switch (instruction->op)
+
+  } //for (...)
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+const char* messageMapGetMsgTypeName (uint8_t cat, uint8_t msgType)
+{
+  return (cat == SETTINGS_RANDOMISE) ? triggerMsgTypeNames[msgType] : continuousMsgTypeNames[msgType];
+}
@@ -0,0 +1,199 @@
+#include "MeteredLcd.h"
+
+MeteredLcd::MeteredLcd (uint8_t csPin, uint8_t dcPin)
+  : ILI9341_t3 (csPin, dcPin)
+{
+}
+
+void MeteredLcd::begin()
+{
+  ILI9341_t3::begin();
+  addDraw (DRAW_OP_CONFIG, 0, SPI_BYTES_INIT);
+}
+
+void MeteredLcd::setRotation (uint8_t rotation)
+{
+  ILI9341_t3::setRotation (rotation);
+
+  addToHash (0xF0000000UL | rotation);
+  addDraw (DRAW_OP_CONFIG, 0, SPI_BYTES_ROTATION);
+}
+
+void MeteredLcd::fillScreen (uint16_t color)
+{
+  ILI9341_t3::fillScreen (color);
+
+  uint32_t pixels = (uint32_t)_width * _height;
+
+  addToHash (0xF1000000UL | color);
+  addDraw (DRAW_OP_FILL_SCREEN, pixels, SPI_BYTES_ADDR_WINDOW + (pixels * 2));
+}
+
+void MeteredLcd::fillRect (int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  ILI9341_t3::fillRect (x, y, w, h, color);
+
+  //apply the same clipping as ILI9341_t3 so that only pixels actually sent are counted
+  if (x >= _width || y >= _height)
+    return;
+  if ((x + w - 1) >= _width)
+    w = _width - x;
+  if ((y + h - 1) >= _height)
+    h = _height - y;
+  if (w <= 0 || h <= 0)
+    return;
+
+  uint32_t pixels = (uint32_t)w * h;
+
+  addToHash (((uint32_t)(uint16_t)x << 16) | (uint16_t)y);
+  addToHash (((uint32_t)(uint16_t)w << 16) | (uint16_t)h);
+  addToHash (0xF2000000UL | color);
+  addDraw (DRAW_OP_FILL_RECT, pixels, SPI_BYTES_ADDR_WINDOW + (pixels * 2));
+}
+
+size_t MeteredLcd::write (uint8_t c)
+{
+  //capture the character position before ILI9341_t3 moves the cursor on
+  int16_t charX = cursor_x;
+  int16_t charY = cursor_y;
+
+  size_t result = ILI9341_t3::write (c);
+
+  //new lines and carriage returns only move the cursor
+  if (c != '\n' && c != '\r')
+  {
+    uint32_t cellPixels = (uint32_t)textsize * textsize;
+
+    addToHash (((uint32_t)(uint16_t)charX << 16) | (uint16_t)charY);
+    addToHash (((uint32_t)c << 24) | ((uint32_t)textsize << 16) | textcolor);
+    addToHash (textbgcolor);
+
+    if (textcolor != textbgcolor)
+    {
+      //opaque - the whole character cell is drawn as a single window
+      uint32_t pixels = CHAR_CELLS_WIDTH * CHAR_CELLS_HEIGHT * cellPixels;
+      addDraw (DRAW_OP_CHAR, pixels, SPI_BYTES_ADDR_WINDOW + (pixels * 2));
+    }
+    else
+    {
+      //transparent - each set glyph cell is drawn as its own rect, so count the worst case
+      uint32_t pixels = CHAR_GLYPH_CELLS * cellPixels;
+      addDraw (DRAW_OP_CHAR, pixels, (CHAR_GLYPH_CELLS * SPI_BYTES_ADDR_WINDOW) + (pixels * 2));
+    }
+
+  } //if (c != '\n' && c != '\r')
+
+  return result;
+}
+
+void MeteredLcd::beginFrame()
+{
+  if (frameDepth == 0)
+  {
+    currentFrameStats = DrawStats();
+    currentFrameHash = FNV_HASH_INIT;
+    currentFrameStartTime = micros();
+  }
+
+  frameDepth++;
+}
+
+void MeteredLcd::endFrame()
+{
+  if (frameDepth == 0)
+    return;
+
+  frameDepth--;
+
+  //only store frames that actually drew something
+  if (frameDepth == 0 && currentFrameStats.calls > 0)
+  {
+    lastFrameMicros = micros() - currentFrameStartTime;
+    lastFrameStats = currentFrameStats;
+    lastFrameHash = currentFrameHash;
+    numOfFrames++;
+  }
+}
+
+const MeteredLcd::DrawStats& MeteredLcd::getOpStats (uint8_t op)
+{
+  return opStats[op];
+}
+
+const MeteredLcd::DrawStats& MeteredLcd::getFrameStats()
+{
+  return lastFrameStats;
+}
+
+uint32_t MeteredLcd::getFrameHash()
+{
+  return lastFrameHash;
+}
+
+uint32_t MeteredLcd::getFrameMicros()
+{
+  return lastFrameMicros;
+}
+
+uint32_t MeteredLcd::getNumOfFrames()
+{
+  return numOfFrames;
+}
+
+void MeteredLcd::resetStats()
+{
+  for (uint8_t i = 0; i < NUM_OF_DRAW_OPS; i++)
+    opStats[i] = DrawStats();
+
+  numOfFrames = 0;
+}
+
+void MeteredLcd::printStats (Print &out, uint8_t line)
+{
+  const char *opNames[NUM_OF_DRAW_OPS] = {"fillRect", "fillScreen", "char", "config"};
+
+  if (line < NUM_OF_DRAW_OPS)
+  {
+    out.print (opNames[line]);
+    out.print (": calls ");
+    out.print (opStats[line].calls);
+    out.print (", pixels ");
+    out.print (opStats[line].pixels);
+    out.print (", SPI bytes ");
+    out.println (opStats[line].spiBytes);
+    return;
+  }
+
+  out.print ("Frame ");
+  out.print (numOfFrames);
+  out.print (": calls ");
+  out.print (lastFrameStats.calls);
+  out.print (", pixels ");
+  out.print (lastFrameStats.pixels);
+  out.print (", SPI bytes ");
+  out.print (lastFrameStats.spiBytes);
+  out.print (", time ");
+  out.print (lastFrameMicros);
+  out.print ("us, hash ");
+  out.println (lastFrameHash, HEX);
+}
+
+void MeteredLcd::addDraw (uint8_t op, uint32_t pixels, uint32_t spiBytes)
+{
+  opStats[op].calls++;
+  opStats[op].pixels += pixels;
+  opStats[op].spiBytes += spiBytes;
+
+  if (frameDepth > 0)
+  {
+    currentFrameStats.calls++;
+    currentFrameStats.pixels += pixels;
+    currentFrameStats.spiBytes += spiBytes;
+  }
+}
+
+void MeteredLcd::addToHash (uint32_t value)
+{
+  //(lowest byte first, as the Teensy is little-endian)
+  currentFrameHash = fnvHash (currentFrameHash, &value, sizeof (value));
+}
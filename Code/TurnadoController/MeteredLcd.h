@@ -0,0 +1,124 @@
+/*
+  MeteredLcd.h - ILI9341_t3 display driver that meters the drawing
+  work it is asked to do.
+*/
+
+#ifndef MeteredLcd_h
+#define MeteredLcd_h
+
+#include "Arduino.h"
+#include "ILI9341_t3.h"
+#include "FnvHash.h"
+
+/**
+    A drop-in replacement for the ILI9341_t3 class that accounts for the cost of everything drawn to the display.
+    Features:
+    - Counts calls, pixels and SPI bytes for each type of drawing operation (fillRect, fillScreen, text characters)
+    - Groups drawing into frames (beginFrame() / endFrame()) and keeps per-frame stats and draw time
+    - Produces a hash of each frame's drawing command stream, so that a frame can be compared against a known good
+      ('golden') reference frame without needing a copy of the display memory
+
+    SPI byte counts are based on how ILI9341_t3 talks to the display - 11 bytes to set the address window
+    and RAMWR command, followed by 2 bytes per RGB565 pixel. Opaque text characters are drawn as a single
+    window of 6x8 cells, whereas transparent text characters are drawn cell-by-cell, so for these the
+    worst case (every cell of the 5x7 glyph set) is counted.
+
+    To use, create an instance of this class instead of ILI9341_t3 and wrap any drawing code that makes
+    up a display frame with beginFrame() and endFrame().
+*/
+class MeteredLcd : public ILI9341_t3
+{
+  public:
+
+    enum DrawOps
+    {
+      DRAW_OP_FILL_RECT = 0,
+      DRAW_OP_FILL_SCREEN,
+      DRAW_OP_CHAR,
+      DRAW_OP_CONFIG, //begin() and setRotation()
+
+      NUM_OF_DRAW_OPS
+    };
+
+    //a line per draw op, followed by the last frame
+    static const uint8_t NUM_OF_STATS_LINES = NUM_OF_DRAW_OPS + 1;
+
+    struct DrawStats
+    {
+      uint32_t calls = 0;
+      uint32_t pixels = 0;
+      uint32_t spiBytes = 0;
+    };
+
+    MeteredLcd (uint8_t csPin, uint8_t dcPin);
+
+    void begin();
+    void setRotation (uint8_t rotation);
+    void fillScreen (uint16_t color);
+    void fillRect (int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    size_t write (uint8_t c) override;
+    using Print::write;
+
+    /** Marks the start of a display frame. Frames can be nested, in which case
+        the outer most beginFrame() / endFrame() pair defines the frame.
+    */
+    void beginFrame();
+
+    /** Marks the end of a display frame, storing the stats of the frame
+        if anything was drawn within it.
+    */
+    void endFrame();
+
+    /** Returns the total stats for a drawing operation since the last call to resetStats()
+    */
+    const DrawStats& getOpStats (uint8_t op);
+
+    /** Returns the stats of the last completed frame
+    */
+    const DrawStats& getFrameStats();
+
+    /** Returns the command stream hash of the last completed frame
+    */
+    uint32_t getFrameHash();
+
+    /** Returns the time taken to draw the last completed frame, in microseconds
+    */
+    uint32_t getFrameMicros();
+
+    /** Returns the number of frames that have been completed since the last call to resetStats()
+    */
+    uint32_t getNumOfFrames();
+
+    void resetStats();
+
+    /** Prints a line (0 to NUM_OF_STATS_LINES - 1) of the totals and last frame stats as human readable text
+    */
+    void printStats (Print &out, uint8_t line);
+
+  private:
+
+    void addDraw (uint8_t op, uint32_t pixels, uint32_t spiBytes);
+    void addToHash (uint32_t value);
+
+    //Bytes needed to set the address window (CASET + 4, PASET + 4) followed by RAMWR
+    static const uint8_t SPI_BYTES_ADDR_WINDOW = 11;
+    //Bytes sent by the ILI9341 initialisation sequence in begin()
+    static const uint8_t SPI_BYTES_INIT = 88;
+    static const uint8_t SPI_BYTES_ROTATION = 2;
+    static const uint8_t CHAR_CELLS_WIDTH = 6;
+    static const uint8_t CHAR_CELLS_HEIGHT = 8;
+    static const uint8_t CHAR_GLYPH_CELLS = 5 * 7;
+
+    DrawStats opStats[NUM_OF_DRAW_OPS];
+
+    DrawStats currentFrameStats;
+    DrawStats lastFrameStats;
+    uint32_t currentFrameHash = FNV_HASH_INIT;
+    uint32_t lastFrameHash = FNV_HASH_INIT;
+    uint32_t currentFrameStartTime = 0;
+    uint32_t lastFrameMicros = 0;
+    uint32_t numOfFrames = 0;
+    uint8_t frameDepth = 0;
+};
+
+#endif //MeteredLcd_h
@@ -7,12 +7,144 @@
 //FIXME: make the below a global setting
 const uint16_t MIDI_CC_LOOPBACK_TIMEOUT = 250;
 
-long prevKnobControllerMidiSendTime[NUM_OF_KNOB_CONTROLLERS] = {0};
+uint32_t prevKnobControllerMidiSendTime[NUM_OF_KNOB_CONTROLLERS] = {0};
+
+//MIDI-in is drained a burst at a time (e.g. the knob CCs that Turnado sends when loading a preset), with the
+//knob CC values folded straight into the device param state and each knob controller that has changed only
+//being recomputed and redisplayed once at the end of the drain (see midiInApplyPendingCcs()).
+//The number of messages read per drain is limited so that a flood of MIDI-in can't hold up the realtime tick.
+const uint8_t MIDI_IN_MAX_MESSAGES_PER_DRAIN = 64;
+
+uint16_t midiInPendingParamsMask = 0; //the device params changed by MIDI-in CCs since the last drain
+
+//counts of the knob CCs that changed a value (each of which used to be recomputed and redisplayed),
+//and of the recomputes actually done, to show how much work coalescing removes
+uint32_t midiInNumOfKnobCcChanges = 0;
+uint32_t midiInNumOfParamUpdates = 0;
+
+//Where MIDI-out messages go. The null sink just counts messages, so that the
+//code that sends them can be run (e.g. benchmarked) without flooding USB MIDI.
+enum MidiOutSinks
+{
+  MIDI_OUT_SINK_USB = 0,
+  MIDI_OUT_SINK_NULL
+};
+
+uint8_t midiOutSink = MIDI_OUT_SINK_USB;
+uint32_t midiOutNumOfMessages = 0;
+
+//hash of every MIDI-out message sent, whichever the sink, for checking that an input trace replays the same
+uint32_t midiOutHash = FNV_HASH_INIT;
+
+//=========================================================================
+//USB MIDI cables, so that a host doesn't have to pick these apart from a single stream:
+//- Performance - output only, everything the controls send
+//- Feedback and sync - input only, the knob CCs that Turnado sends back, and MIDI clock. Knob CCs and clock
+//  received on any other cable are ignored.
+//- Bulk - SysEx settings dumps (see midiSysExUpdateDump()), sent in answer to a dump request received on this cable
+//
+//Each output cable has its own queue of USB MIDI event packets. The performance queue is sent in full at the end
+//of every realtime tick (see midiOutUpdate()), whereas only MIDI_OUT_BULK_PACKETS_PER_TICK bulk packets are sent
+//per MIDI IO tick, leaving most of each USB frame for the performance cable, so a bulk transfer never holds up
+//a joystick CC.
+//
+//The cables need a USB type with multiple MIDI cables (e.g. "Serial + MIDIx4"). With a single cable USB type,
+//everything is sent and received on that one cable, as before.
+enum MidiCables
+{
+  MIDI_CABLE_PERFORMANCE = 0,
+  MIDI_CABLE_FEEDBACK,
+  MIDI_CABLE_BULK,
+
+  NUM_OF_MIDI_CABLES
+};
+
+const char* const midiCableNames[NUM_OF_MIDI_CABLES] = {"Performance", "Feedback", "Bulk"};
+
+enum MidiOutQueues
+{
+  MIDI_OUT_QUEUE_PERFORMANCE = 0,
+  MIDI_OUT_QUEUE_BULK,
+
+  NUM_OF_MIDI_OUT_QUEUES
+};
+
+//queue sizes, which must be powers of 2
+#define MIDI_OUT_QUEUE_SIZE_PERFORMANCE 64
+#define MIDI_OUT_QUEUE_SIZE_BULK 256 //10 settings dump messages
+
+//a USB frame (1ms) fits 16 packets
+const uint8_t MIDI_OUT_BULK_PACKETS_PER_TICK = 4;
+
+struct MidiOutQueue
+{
+  uint8_t cable;
+  uint32_t *packets;
+  uint32_t *queueTimes; //micros() when each packet was queued
+  uint16_t sizeMask;
+
+  //the positions run freely, and are wrapped into the queue when used
+  volatile uint16_t writePos;
+  volatile uint16_t readPos;
+
+  uint32_t numOfPackets;
+  uint16_t maxDepth;
+  uint32_t maxLatency; //the longest time a packet has been queued for, in microseconds
+};
+
+uint32_t midiOutPerformancePackets[MIDI_OUT_QUEUE_SIZE_PERFORMANCE];
+uint32_t midiOutPerformanceQueueTimes[MIDI_OUT_QUEUE_SIZE_PERFORMANCE];
+uint32_t midiOutBulkPackets[MIDI_OUT_QUEUE_SIZE_BULK];
+uint32_t midiOutBulkQueueTimes[MIDI_OUT_QUEUE_SIZE_BULK];
+
+MidiOutQueue midiOutQueues[NUM_OF_MIDI_OUT_QUEUES] =
+{
+  {MIDI_CABLE_PERFORMANCE, midiOutPerformancePackets, midiOutPerformanceQueueTimes, MIDI_OUT_QUEUE_SIZE_PERFORMANCE - 1, 0, 0, 0, 0, 0},
+  {MIDI_CABLE_BULK, midiOutBulkPackets, midiOutBulkQueueTimes, MIDI_OUT_QUEUE_SIZE_BULK - 1, 0, 0, 0, 0, 0}
+};
+
+//=========================================================================
+//SysEx settings dump. A dump request, received on the bulk cable:
+//  F0 7D 54 01 F7
+//(0x7D being the manufacturer ID for non-commercial use, and 0x54 the ID of this controller) is answered on the
+//bulk cable with a message holding the current settings values, followed by one for each preset:
+//  F0 7D 54 02 <slot> <layout version> <values> F7
+//where the slot is 0x7F for the current settings or the preset number (0-63), the layout version is
+//SETTINGS_LAYOUT_VERSION (as it sets the order of the values), and there are SETTINGS_NUM_OF_PARAMS values.
+
+const uint8_t MIDI_SYSEX_MANUFACTURER_ID = 0x7D;
+const uint8_t MIDI_SYSEX_DEVICE_ID = 0x54;
+const uint8_t MIDI_SYSEX_DUMP_REQUEST = 0x01;
+const uint8_t MIDI_SYSEX_DUMP = 0x02;
+const uint8_t MIDI_SYSEX_DUMP_SLOT_CURRENT_SETTINGS = 0x7F;
+
+const uint8_t MIDI_SYSEX_DUMP_HEADER_SIZE = 6;
+const uint8_t MIDI_SYSEX_DUMP_SIZE = MIDI_SYSEX_DUMP_HEADER_SIZE + SETTINGS_NUM_OF_PARAMS + 1;
+
+//the next dump message to queue - 0 for the current settings, and 1 onwards for each preset - or -1 if not dumping
+int8_t midiSysExDumpNextMessage = -1;
 
 //=========================================================================
 void ProcessMidiControlChange (byte channel, byte control, byte value);
+void midiInControlChange (byte channel, byte control, byte value);
+void midiInClock();
+void midiInStart();
+void midiInSysEx (uint8_t *data, unsigned int length);
+void modulationProcessMidiClock();
+void modulationProcessMidiStart();
+void gestureLooperProcessMidiClock();
+void gestureLooperProcessMidiStart();
+void midiInApplyPendingCcs();
 void sendMidiCcMessage (byte channel, byte control, byte value, int8_t deviceParamIndex);
 void sendMidiProgramChangeMessage (byte channel, byte program);
+void sendMidiNoteOnMessage (byte channel, byte note, byte velocity);
+void sendMidiNoteOffMessage (byte channel, byte note, byte velocity);
+void sendMidiPitchBendMessage (byte channel, uint16_t value);
+void sendMidiChannelPressureMessage (byte channel, byte pressure);
+void midiOutSendMessage (byte status, byte data1, byte data2);
+bool midiOutQueuePacket (uint8_t queueIndex, uint32_t packet);
+uint16_t midiOutSendQueued (uint8_t queueIndex, uint16_t maxNumOfPackets);
+void midiSysExUpdateDump();
 
 //=========================================================================
 //=========================================================================
@@ -20,19 +152,94 @@ void sendMidiProgramChangeMessage (byte channel, byte program);
 void setupMidiIO()
 {
 #ifndef DISABLE_USB_MIDI
-  usbMIDI.setHandleControlChange (ProcessMidiControlChange);
+  usbMIDI.setHandleControlChange (midiInControlChange);
+  usbMIDI.setHandleClock (midiInClock);
+  usbMIDI.setHandleStart (midiInStart);
+  usbMIDI.setHandleSystemExclusive (midiInSysEx);
 #endif
 }
 
 //=========================================================================
 //=========================================================================
 //=========================================================================
-void updateMidiIO()
+void updateMidiIO (uint32_t tickTime)
 {
+  PROFILE_SCOPE (PROFILE_TASK_MIDI_IO);
+
 #ifndef DISABLE_USB_MIDI
-  //Read from USB MIDI-in
-  usbMIDI.read();
+  //Read from USB MIDI-in, draining whatever has arrived
+  for (uint8_t i = 0; i < MIDI_IN_MAX_MESSAGES_PER_DRAIN; i++)
+  {
+    if (!usbMIDI.read())
+      break;
+  }
 #endif
+
+  midiInApplyPendingCcs();
+
+  //send a few bulk packets, if there are any waiting
+  midiSysExUpdateDump();
+
+  if (midiOutSendQueued (MIDI_OUT_QUEUE_BULK, MIDI_OUT_BULK_PACKETS_PER_TICK) > 0)
+    usbMIDI.send_now();
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool midiInIsFromCable (uint8_t cable)
+{
+  //Returns whether the MIDI-in message being read came in on a cable
+  //(always true with a single cable USB type, where everything is on the one cable)
+  return MIDI_NUM_CABLES < NUM_OF_MIDI_CABLES || usbMIDI.getCable() == cable;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void midiInControlChange (byte channel, byte control, byte value)
+{
+  if (midiInIsFromCable (MIDI_CABLE_FEEDBACK))
+    ProcessMidiControlChange (channel, control, value);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void midiInClock()
+{
+  if (midiInIsFromCable (MIDI_CABLE_FEEDBACK))
+  {
+    modulationProcessMidiClock();
+    gestureLooperProcessMidiClock();
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void midiInStart()
+{
+  if (midiInIsFromCable (MIDI_CABLE_FEEDBACK))
+  {
+    modulationProcessMidiStart();
+    gestureLooperProcessMidiStart();
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void midiInSysEx (uint8_t *data, unsigned int length)
+{
+  const uint8_t dumpRequest[] = {0xF0, MIDI_SYSEX_MANUFACTURER_ID, MIDI_SYSEX_DEVICE_ID, MIDI_SYSEX_DUMP_REQUEST, 0xF7};
+
+  if (!midiInIsFromCable (MIDI_CABLE_BULK))
+    return;
+
+  //a request while a dump is being sent starts it again
+  if (length == sizeof (dumpRequest) && memcmp (data, dumpRequest, length) == 0)
+    midiSysExDumpNextMessage = 0;
 }
 
 //=========================================================================
@@ -40,46 +247,86 @@ void updateMidiIO()
 //=========================================================================
 void ProcessMidiControlChange (byte channel, byte control, byte value)
 {
+  PROFILE_SCOPE (PROFILE_MIDI_IN_CC);
+
   //If a Turnado knob CC (the only MIDI-in CCs we care about)
   //Would be great if Turnado sent MIDI out for dictator and mix controls. Maybe one day...
   if (control >= 1 && control <= 8)
   {
     //if received outside of a certain time frame since this controller sent out a CC to control the same knob,
     //assume it isn't a looped back MIDI CC (that we want to ignore) and process it.
-    if (millis() - prevKnobControllerMidiSendTime[control - 1] > MIDI_CC_LOOPBACK_TIMEOUT)
+    if (controlTime - prevKnobControllerMidiSendTime[control - 1] > MIDI_CC_LOOPBACK_TIMEOUT)
     {
 
-#ifdef DEBUG
-      Serial.print ("MIDI-in CC: ");
-      Serial.print (channel);
-      Serial.print (" ");
-      Serial.print (control);
-      Serial.print (" ");
-      Serial.println (value);
-#endif
-
-      byte knobControllerChan = settingsData[control].paramData[PARAM_INDEX_MIDI_CHAN].value;
-      if (knobControllerChan == 0)
-        knobControllerChan = settingsData[SETTINGS_GLOBAL].paramData[PARAM_INDEX_MIDI_CHAN].value;
+      TRACE (TRACE_MIDI_IN_CC, channel, control, value);
 
       //if the CC channel matches that of the knob controller channel
-      if (channel == knobControllerChan)
+      if (channel - 1 == deviceParamChannelIndex[control - 1])
       {
-        //set knob controller value (base value only)
-        setKnobControllerBaseValue (control - 1, value, false);
+        //set knob controller value (base value only), leaving the knob controller to be updated
+        //once all the MIDI-in that has arrived has been read
+        if (value != deviceParamValue (control - 1))
+        {
+          deviceParamValue (control - 1) = value;
+          midiInPendingParamsMask |= (1 << (control - 1));
+          midiInNumOfKnobCcChanges++;
+        }
       }
 
-      //Store the MIDI-in CC value for this channel, so that if changing
+      //Otherwise just store the MIDI-in CC value for this channel, so that if changing
       //the channel of a knob controller (either directly or through changing global channel)
-      //the base value (and LCD display) for the knob controller is updated with the stored value.
-      deviceParamValuesForMidiChannel[channel - 1][control - 1] = value;
+      //the knob controller (and LCD display) picks up the stored value.
+      else
+      {
+        midiChannelState.deviceParamValues[channel - 1][control - 1] = value;
+      }
 
-    } //if (millis() - prevKnobControllerMidiSendTime[control - 1] > MIDI_CC_LOOPBACK_TIMEOUT)
+    } //if (controlTime - prevKnobControllerMidiSendTime[control - 1] > MIDI_CC_LOOPBACK_TIMEOUT)
 
   } //if (control >= 1 && control <= 8)
 
 }
 
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void midiInApplyPendingCcs()
+{
+  //Updates the combined value and LCD display (but doesn't send any MIDI) of each
+  //knob controller whose base value has been changed by MIDI-in CCs
+  while (midiInPendingParamsMask)
+  {
+    uint8_t index = __builtin_ctz (midiInPendingParamsMask);
+    midiInPendingParamsMask &= ~(1 << index);
+
+    setKnobControllerCombinedMidiValue (index, false);
+    midiInNumOfParamUpdates++;
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void midiInPrintStats (Print &out)
+{
+  out.print ("MIDI-in: ");
+  out.print (midiInNumOfKnobCcChanges);
+  out.print (" knob CC changes, ");
+  out.print (midiInNumOfParamUpdates);
+  out.print (" knob updates (");
+  out.print (midiInNumOfKnobCcChanges - midiInNumOfParamUpdates);
+  out.println (" coalesced)");
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void midiInResetStats()
+{
+  midiInNumOfKnobCcChanges = 0;
+  midiInNumOfParamUpdates = 0;
+}
+
 //=========================================================================
 //=========================================================================
 //=========================================================================
@@ -88,19 +335,11 @@ void sendMidiCcMessage (byte channel, byte control, byte value, int8_t devicePar
   //FIXME: should I only be sending MIDI-out messages at a certain rate (e.g. only output the latest value for each CC number every x ms?)
   //The output of Turnado/Ableton seems like they do this.
 
-  //if sending a CC for one of the device parameters
-  if (deviceParamIndex != -1)
-  {
-    //if from one of the knob controllers store the time of transmission (for ignoring the possible looped back CC)
-    if (deviceParamIndex < DEVICE_PARAM_INDEX_DICTATOR)
-      prevKnobControllerMidiSendTime[deviceParamIndex] = millis();
+  //if from one of the knob controllers store the time of transmission (for ignoring the possible looped back CC)
+  if (deviceParamIndex != -1 && deviceParamIndex < DEVICE_PARAM_INDEX_DICTATOR)
+    prevKnobControllerMidiSendTime[deviceParamIndex] = controlTime;
 
-    //store the value being sent out (for handling control MIDI channel switching)
-    deviceParamValuesForMidiChannel[channel - 1][deviceParamIndex] = value;
-    
-  } //if (deviceParamIndex != -1)
-  
-  usbMIDI.sendControlChange (control, value, channel);
+  midiOutSendMessage (0xB0 | (channel - 1), control, value);
 }
 
 //=========================================================================
@@ -108,5 +347,240 @@ void sendMidiCcMessage (byte channel, byte control, byte value, int8_t devicePar
 //=========================================================================
 void sendMidiProgramChangeMessage (byte channel, byte program)
 {
-  usbMIDI.sendProgramChange (program, channel);
+  midiOutSendMessage (0xC0 | (channel - 1), program, 0);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void sendMidiNoteOnMessage (byte channel, byte note, byte velocity)
+{
+  midiOutSendMessage (0x90 | (channel - 1), note, velocity);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void sendMidiNoteOffMessage (byte channel, byte note, byte velocity)
+{
+  midiOutSendMessage (0x80 | (channel - 1), note, velocity);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void sendMidiPitchBendMessage (byte channel, uint16_t value)
+{
+  //value is 0-16383 with 8192 as the centre
+  midiOutSendMessage (0xE0 | (channel - 1), value & 0x7F, value >> 7);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void sendMidiChannelPressureMessage (byte channel, byte pressure)
+{
+  midiOutSendMessage (0xD0 | (channel - 1), pressure, 0);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void midiOutSendMessage (byte status, byte data1, byte data2)
+{
+  //Sends a channel message from the controls (status byte with the channel, followed by 1 or 2 data bytes,
+  //where any unused data byte is 0), counting it whichever the sink
+  const byte message[3] = {status, data1, data2};
+
+  midiOutNumOfMessages++;
+  midiOutHash = fnvHash (midiOutHash, message, sizeof (message));
+
+  if (midiOutSink == MIDI_OUT_SINK_USB)
+  {
+    //a USB MIDI event packet - code index number (the same as the status nibble for channel messages),
+    //then the 3 MIDI bytes (the cable number is added when queued)
+    uint32_t packet = (status >> 4) | (status << 8) | ((uint32_t)data1 << 16) | ((uint32_t)data2 << 24);
+
+    //if the queue is full (more than a queue's worth of messages in a single tick), send it straight away
+    if (!midiOutQueuePacket (MIDI_OUT_QUEUE_PERFORMANCE, packet))
+    {
+      midiOutSendQueued (MIDI_OUT_QUEUE_PERFORMANCE, MIDI_OUT_QUEUE_SIZE_PERFORMANCE);
+      midiOutQueuePacket (MIDI_OUT_QUEUE_PERFORMANCE, packet);
+    }
+
+  } //if (midiOutSink == MIDI_OUT_SINK_USB)
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+uint16_t midiOutGetQueueSpace (uint8_t queueIndex)
+{
+  const MidiOutQueue &queue = midiOutQueues[queueIndex];
+  return (queue.sizeMask + 1) - (uint16_t)(queue.writePos - queue.readPos);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool midiOutQueuePacket (uint8_t queueIndex, uint32_t packet)
+{
+  //Queues a USB MIDI event packet to be sent on a queue's cable, returning false if the queue is full.
+  //Each queue must only be added to from either the loop or the realtime tasks, not both.
+  MidiOutQueue &queue = midiOutQueues[queueIndex];
+  uint16_t depth = queue.writePos - queue.readPos;
+
+  if (depth > queue.sizeMask)
+    return false;
+
+  //with a single cable USB type, all cables are sent on the one cable
+  if (MIDI_NUM_CABLES >= NUM_OF_MIDI_CABLES)
+    packet |= queue.cable << 4;
+
+  queue.packets[queue.writePos & queue.sizeMask] = packet;
+  queue.queueTimes[queue.writePos & queue.sizeMask] = micros();
+  queue.writePos++;
+
+  if (depth + 1 > queue.maxDepth)
+    queue.maxDepth = depth + 1;
+
+  return true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool midiOutQueueSysEx (const uint8_t *data, uint16_t length)
+{
+  //Queues a complete SysEx message (including the 0xF0 and 0xF7) on the bulk cable, returning false
+  //if there isn't room for all of it (in which case none of it is queued). Must be called from the realtime tasks.
+  uint16_t numOfPackets = (length + 2) / 3;
+
+  if (length < 2 || numOfPackets > midiOutGetQueueSpace (MIDI_OUT_QUEUE_BULK))
+    return false;
+
+  for (uint16_t pos = 0; pos < length; pos += 3)
+  {
+    uint8_t numOfBytes = min (length - pos, 3);
+
+    //code index number - 0x4 for a packet that starts or continues the message, or 0x5-0x7 for
+    //a packet that ends it with 1-3 bytes
+    uint32_t packet = (pos + 3 < length) ? 0x4 : (0x4 + numOfBytes);
+
+    for (uint8_t i = 0; i < numOfBytes; i++)
+      packet |= (uint32_t)data[pos + i] << ((i + 1) * 8);
+
+    midiOutQueuePacket (MIDI_OUT_QUEUE_BULK, packet);
+  }
+
+  return true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void midiSysExUpdateDump()
+{
+  //Queues as many of the messages of a requested settings dump as there is room for on the bulk cable
+  if (midiSysExDumpNextMessage < 0)
+    return;
+
+  while (midiSysExDumpNextMessage <= presetsNumOfPresets)
+  {
+    uint8_t message[MIDI_SYSEX_DUMP_SIZE] = {0xF0, MIDI_SYSEX_MANUFACTURER_ID, MIDI_SYSEX_DEVICE_ID, MIDI_SYSEX_DUMP};
+
+    if (midiSysExDumpNextMessage == 0)
+    {
+      message[4] = MIDI_SYSEX_DUMP_SLOT_CURRENT_SETTINGS;
+      memcpy (&message[MIDI_SYSEX_DUMP_HEADER_SIZE], settingsValues, SETTINGS_NUM_OF_PARAMS);
+    }
+    else
+    {
+      message[4] = midiSysExDumpNextMessage - 1;
+      presetsGetValues (midiSysExDumpNextMessage - 1, &message[MIDI_SYSEX_DUMP_HEADER_SIZE]);
+    }
+
+    message[5] = SETTINGS_LAYOUT_VERSION;
+    message[MIDI_SYSEX_DUMP_SIZE - 1] = 0xF7;
+
+    if (!midiOutQueueSysEx (message, MIDI_SYSEX_DUMP_SIZE))
+      return;
+
+    midiSysExDumpNextMessage++;
+
+  } //while (midiSysExDumpNextMessage <= presetsNumOfPresets)
+
+  midiSysExDumpNextMessage = -1;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+uint16_t midiOutSendQueued (uint8_t queueIndex, uint16_t maxNumOfPackets)
+{
+  //Sends up to maxNumOfPackets of the packets in a queue, returning the number sent
+  MidiOutQueue &queue = midiOutQueues[queueIndex];
+  uint16_t numOfPackets = 0;
+
+  while (queue.readPos != queue.writePos && numOfPackets < maxNumOfPackets)
+  {
+    uint32_t latency = micros() - queue.queueTimes[queue.readPos & queue.sizeMask];
+
+    if (latency > queue.maxLatency)
+      queue.maxLatency = latency;
+
+#ifndef DISABLE_USB_MIDI
+    usb_midi_write_packed (queue.packets[queue.readPos & queue.sizeMask]);
+#endif
+
+    queue.readPos++;
+    numOfPackets++;
+  }
+
+  queue.numOfPackets += numOfPackets;
+
+  return numOfPackets;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void midiOutUpdate()
+{
+  //Sends everything queued on the performance cable, straight away rather than waiting for
+  //USB MIDI to send a partly filled USB packet itself.
+  //Called at the end of each realtime tick.
+  if (midiOutSendQueued (MIDI_OUT_QUEUE_PERFORMANCE, MIDI_OUT_QUEUE_SIZE_PERFORMANCE) > 0)
+    usbMIDI.send_now();
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void midiOutPrintStats (Print &out, uint8_t queueIndex)
+{
+  const MidiOutQueue &queue = midiOutQueues[queueIndex];
+
+  out.print ("MIDI-out ");
+  out.print (midiCableNames[queue.cable]);
+  out.print (" cable: ");
+  out.print (queue.numOfPackets);
+  out.print (" packets, max queued ");
+  out.print (queue.maxDepth);
+  out.print (", max latency ");
+  out.print (queue.maxLatency);
+  out.println ("us");
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void midiOutResetStats()
+{
+  for (uint8_t i = 0; i < NUM_OF_MIDI_OUT_QUEUES; i++)
+  {
+    midiOutQueues[i].numOfPackets = 0;
+    midiOutQueues[i].maxDepth = 0;
+    midiOutQueues[i].maxLatency = 0;
+  }
 }
@@ -0,0 +1,267 @@
+//=========================================================================
+//Knob controller modulation.
+//
+//Each knob controller (including the dictator) can have a modulation source, set by its Mod Src, Mod Rate and
+//Mod Depth settings - an LFO (sine, triangle, saw or square), a random sample and hold, or an attack-release
+//envelope that is triggered by the knob controller's encoder switch. A source's output is added to the joystick
+//value to give the knob controller's relative value, so it is combined with the base value and sent in the
+//same way as moving the joystick (only when the combined MIDI value actually changes).
+//
+//Sources are run on a fixed rate tick of MODULATION_TICK_US. Each has a 32-bit phase accumulator that is advanced
+//by an increment looked up from its rate, and the LFO shapes are worked out from the top bits of the phase
+//(from a wavetable for the sine). If the task runs late the missed ticks are caught up in one go, so rates stay
+//exact. When the global Mod Sync is set to MIDI clock, the LFOs are instead advanced by the MIDI clock pulses
+//received since the last tick, with the rate selecting the cycle length, and a MIDI start resets their phase.
+//
+//All of this is integer maths, so a tick has a small, fixed cost - see the modulation benchmark (Benchmarks.h)
+//and the modulation task profile stats.
+
+#define MODULATION_TICK_US 1000
+#define MODULATION_NUM_OF_RATES 128
+#define MODULATION_WAVETABLE_SIZE 256
+#define MODULATION_ENVELOPE_ATTACK_SPEEDUP 4 //the envelope attack is this much quicker than its release
+#define MODULATION_MAX_CATCH_UP_TICKS 1000 //a longer stall than this loses the LFO timing rather than jumping ahead
+
+//free running rates go from MODULATION_MIN_RATE_HZ to MODULATION_RATE_RANGE times that, evenly spaced in log frequency
+const float MODULATION_MIN_RATE_HZ = 0.02;
+const float MODULATION_RATE_RANGE = 1000.0;
+
+//MIDI clock synced rates, as the number of MIDI clock pulses (24 per beat) in a cycle - 1/16 note up to 4 bars
+const uint16_t modulationClockPulsesPerCycle[] = {6, 12, 24, 48, 96, 192, 384};
+
+#define MODULATION_NUM_OF_CLOCK_RATES (sizeof (modulationClockPulsesPerCycle) / sizeof (modulationClockPulsesPerCycle[0]))
+
+enum ModulationEnvelopeStages
+{
+  MOD_ENVELOPE_IDLE = 0,
+  MOD_ENVELOPE_ATTACK,
+  MOD_ENVELOPE_RELEASE
+};
+
+struct ModulationSourceState
+{
+  uint32_t phase; //the envelope level for envelopes
+  int8_t sampleAndHoldValue;
+  uint8_t envelopeStage;
+};
+
+ModulationSourceState modulationState[NUM_OF_KNOB_CONTROLLERS];
+uint32_t modulationRandomState = 1;
+
+uint32_t modulationPrevTickTime = 0;
+uint16_t modulationPendingClockPulses = 0; //MIDI clock pulses received since the last tick
+
+//called for every tick, so that input traces can replay them (see InputTrace.h)
+void (*modulationOnTick) (uint16_t numOfTicks, uint8_t numOfClockPulses) = nullptr;
+
+//phase increments per tick for each free running rate, and the sine wavetable - both worked out at startup
+uint32_t modulationRateIncrements[MODULATION_NUM_OF_RATES];
+int8_t modulationSineTable[MODULATION_WAVETABLE_SIZE];
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void setupModulation()
+{
+  for (uint8_t rate = 0; rate < MODULATION_NUM_OF_RATES; rate++)
+  {
+    float rateHz = MODULATION_MIN_RATE_HZ * powf (MODULATION_RATE_RANGE, (float)rate / (MODULATION_NUM_OF_RATES - 1));
+    modulationRateIncrements[rate] = rateHz * (MODULATION_TICK_US / 1000000.0) * 4294967296.0;
+  }
+
+  for (uint16_t i = 0; i < MODULATION_WAVETABLE_SIZE; i++)
+    modulationSineTable[i] = round (127.0 * sin ((2.0 * PI * i) / MODULATION_WAVETABLE_SIZE));
+
+  modulationPrevTickTime = micros();
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void modulationProcessMidiClock()
+{
+  modulationPendingClockPulses++;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void modulationProcessMidiStart()
+{
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+    modulationState[i].phase = 0;
+
+  modulationPendingClockPulses = 0;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void modulationTriggerEnvelope (uint8_t index)
+{
+  //(re)starts the attack from the envelope's current level
+  modulationState[index].envelopeStage = MOD_ENVELOPE_ATTACK;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+int8_t modulationGetRandomValue()
+{
+  //xorshift32
+  modulationRandomState ^= modulationRandomState << 13;
+  modulationRandomState ^= modulationRandomState >> 17;
+  modulationRandomState ^= modulationRandomState << 5;
+
+  return (int8_t)(modulationRandomState >> 24);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+int8_t modulationUpdateEnvelope (ModulationSourceState &state, uint32_t increment, uint32_t numOfTicks)
+{
+  //Returns the envelope level (0-127), where the level is kept in the phase
+  uint64_t step = (uint64_t)increment * numOfTicks;
+
+  if (state.envelopeStage == MOD_ENVELOPE_ATTACK)
+  {
+    uint64_t level = state.phase + (step * MODULATION_ENVELOPE_ATTACK_SPEEDUP);
+
+    if (level >= UINT32_MAX)
+    {
+      level = UINT32_MAX;
+      state.envelopeStage = MOD_ENVELOPE_RELEASE;
+    }
+
+    state.phase = level;
+  }
+
+  else if (state.envelopeStage == MOD_ENVELOPE_RELEASE)
+  {
+    if (step >= state.phase)
+    {
+      state.phase = 0;
+      state.envelopeStage = MOD_ENVELOPE_IDLE;
+    }
+    else
+    {
+      state.phase -= step;
+    }
+  }
+
+  return state.phase >> 25;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+int8_t modulationUpdateLfo (ModulationSourceState &state, uint8_t source, uint64_t phaseStep)
+{
+  //Returns the LFO value (-128 to 127)
+  uint64_t phase = state.phase + phaseStep;
+
+  //a new random value for every cycle
+  if (source == MOD_SOURCE_SAMPLE_AND_HOLD && (phase >> 32))
+    state.sampleAndHoldValue = modulationGetRandomValue();
+
+  state.phase = phase;
+
+  switch (source)
+  {
+    case MOD_SOURCE_SINE:
+      return modulationSineTable[state.phase >> 24];
+
+    case MOD_SOURCE_TRIANGLE:
+    {
+      int16_t position = state.phase >> 23; //0-511
+      return (position < 256) ? position - 128 : 383 - position;
+    }
+
+    case MOD_SOURCE_SAW:
+      return (int16_t)(state.phase >> 24) - 128;
+
+    case MOD_SOURCE_SQUARE:
+      return (state.phase < 0x80000000UL) ? 127 : -128;
+
+    case MOD_SOURCE_SAMPLE_AND_HOLD:
+      return state.sampleAndHoldValue;
+
+    default:
+      return 0;
+
+  } //switch (source)
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool modulationTick (uint16_t numOfTicks, uint8_t numOfClockPulses)
+{
+  //Advances every modulation source by a number of ticks (or MIDI clock pulses if synced to MIDI clock),
+  //returning whether any source is running (or has just been turned off)
+  bool syncToClock = (settingsGetValue (SETTINGS_GLOBAL, PARAM_INDEX_MOD_SYNC) == MOD_SYNC_MIDI_CLOCK);
+  bool isRunning = false;
+
+  for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+  {
+    //the knob controller settings categories are in the same order, after the global category
+    uint8_t cat = i + 1;
+    uint8_t source = settingsGetValue (cat, PARAM_INDEX_MOD_SOURCE);
+    int16_t value = 0;
+
+    if (source != MOD_SOURCE_OFF)
+    {
+      isRunning = true;
+
+      uint8_t rate = settingsGetValue (cat, PARAM_INDEX_MOD_RATE);
+
+      if (source == MOD_SOURCE_ENVELOPE)
+        value = modulationUpdateEnvelope (modulationState[i], modulationRateIncrements[rate], numOfTicks);
+
+      else if (syncToClock)
+        value = modulationUpdateLfo (modulationState[i], source,
+                                     (0x100000000ULL / modulationClockPulsesPerCycle[(rate * MODULATION_NUM_OF_CLOCK_RATES) / MODULATION_NUM_OF_RATES]) * numOfClockPulses);
+
+      else
+        value = modulationUpdateLfo (modulationState[i], source, (uint64_t)modulationRateIncrements[rate] * numOfTicks);
+
+      value = (value * settingsGetValue (cat, PARAM_INDEX_MOD_DEPTH)) >> 7;
+
+    } //if (source != MOD_SOURCE_OFF)
+
+    if (value != knobControllerData[i].modulationValue)
+    {
+      knobControllerData[i].modulationValue = value;
+      setKnobControllerRelativeValue (i);
+      isRunning = true;
+    }
+
+  } //for (uint8_t i = 0; i < NUM_OF_KNOB_CONTROLLERS; i++)
+
+  return isRunning;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void updateModulation (uint32_t tickTime)
+{
+  PROFILE_SCOPE (PROFILE_TASK_MODULATION);
+
+  uint32_t numOfTicks = (tickTime - modulationPrevTickTime) / MODULATION_TICK_US;
+
+  if (numOfTicks == 0)
+    return;
+
+  modulationPrevTickTime += numOfTicks * MODULATION_TICK_US;
+
+  numOfTicks = min (numOfTicks, (uint32_t)MODULATION_MAX_CATCH_UP_TICKS);
+  uint8_t numOfClockPulses = min (modulationPendingClockPulses, (uint16_t)UINT8_MAX);
+  modulationPendingClockPulses = 0;
+
+  modulationTick (numOfTicks, numOfClockPulses);
+
+  if (modulationOnTick)
+    modulationOnTick (numOfTicks, numOfClockPulses);
+}
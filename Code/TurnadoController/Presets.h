@@ -0,0 +1,249 @@
+//=========================================================================
+//Internal settings presets.
+//
+//A preset is a copy of every settings param value (i.e. a whole channel/CC map), so that the
+//settings can be switched between songs in one go. Presets are kept in RAM only in the encoded form that they
+//are stored in EEPROM as part of the settings image (see SettingsJournal.h), where the first preset is stored in
+//full and every other preset is stored as the differences from the first one:
+//  [preset 1 values...] [preset 2 changed mask (a bit per param)][preset 2 changed values...] ...
+//A preset is decoded when it is recalled, by walking the encoded presets up to it, and saving a preset
+//re-encodes all of them (as they all depend on preset 1).
+//
+//Capacity: PRESETS_STORE_SIZE allows for at least PRESETS_GUARANTEED_NUM presets where every value differs
+//from preset 1, and PRESETS_MAX_NUM presets where each differs by PRESETS_TYPICAL_NUM_OF_CHANGED_VALUES values
+//(e.g. the channel and a couple of CCs, which with the 8 byte mask of 64 params takes 11 bytes).
+
+#define PRESETS_MAX_NUM 64
+#define PRESETS_STORE_SIZE 768
+#define PRESETS_TYPICAL_NUM_OF_CHANGED_VALUES 3
+#define PRESET_DELTA_MASK_SIZE_FOR(numOfParams) (((numOfParams) + 7) / 8)
+#define PRESET_DELTA_MASK_SIZE PRESET_DELTA_MASK_SIZE_FOR (SETTINGS_NUM_OF_PARAMS)
+#define PRESETS_GUARANTEED_NUM (1 + ((PRESETS_STORE_SIZE - SETTINGS_NUM_OF_PARAMS) / (PRESET_DELTA_MASK_SIZE + SETTINGS_NUM_OF_PARAMS)))
+#define PRESETS_TYPICAL_NUM (1 + ((PRESETS_STORE_SIZE - SETTINGS_NUM_OF_PARAMS) / (PRESET_DELTA_MASK_SIZE + PRESETS_TYPICAL_NUM_OF_CHANGED_VALUES)))
+#define PRESET_NONE -1
+
+static_assert (SETTINGS_NUM_OF_PARAMS <= PRESET_DELTA_MASK_SIZE * 8, "Preset delta mask is too small for the number of settings params");
+static_assert (PRESETS_TYPICAL_NUM >= PRESETS_MAX_NUM, "Preset store is too small for PRESETS_MAX_NUM typical presets");
+
+uint8_t presetsStore[PRESETS_STORE_SIZE]; //the encoded presets
+uint16_t presetsStoreLength = 0;
+uint8_t presetsNumOfPresets = 0;
+int8_t presetsActivePreset = PRESET_NONE;
+
+//buffer for the encoded presets when reading/writing the settings image (a compaction writes from a copy,
+//as a preset can be saved while it is in progress)
+uint8_t presetsStoreBuffer[PRESETS_STORE_SIZE];
+
+uint32_t presetsLastRecallTime = 0; //in microseconds
+
+//=========================================================================
+void settingsJournalRequestCompaction();
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool presetsDecodeNext (const uint8_t *store, uint16_t length, uint16_t &pos, const uint8_t *firstValues, uint8_t *values)
+{
+  //Decodes the preset at pos of the encoded presets into values, and moves pos on to the next preset, where
+  //firstValues is the decoded first preset (or NULL when decoding the first preset).
+  //Returns false if the preset runs past length.
+
+  if (firstValues == NULL)
+  {
+    if (pos + SETTINGS_NUM_OF_PARAMS > length)
+      return false;
+
+    memcpy (values, &store[pos], SETTINGS_NUM_OF_PARAMS);
+    pos += SETTINGS_NUM_OF_PARAMS;
+    return true;
+  }
+
+  if (pos + PRESET_DELTA_MASK_SIZE > length)
+    return false;
+
+  uint64_t mask = 0;
+
+  for (uint8_t b = 0; b < PRESET_DELTA_MASK_SIZE; b++)
+    mask |= (uint64_t)store[pos++] << (b * 8);
+
+  for (uint8_t i = 0; i < SETTINGS_NUM_OF_PARAMS; i++)
+  {
+    if (mask & (1ULL << i))
+    {
+      if (pos >= length)
+        return false;
+
+      values[i] = store[pos++];
+    }
+    else
+    {
+      values[i] = firstValues[i];
+    }
+  }
+
+  return true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool presetsEncodeNext (uint8_t *store, uint16_t &pos, const uint8_t *firstValues, const uint8_t *values)
+{
+  //Encodes a preset's values at pos of the encoded presets, and moves pos on past it, where firstValues is
+  //the values of the first preset (or NULL when encoding the first preset).
+  //Returns false if there isn't room for the preset in PRESETS_STORE_SIZE.
+
+  if (firstValues == NULL)
+  {
+    if (pos + SETTINGS_NUM_OF_PARAMS > PRESETS_STORE_SIZE)
+      return false;
+
+    memcpy (&store[pos], values, SETTINGS_NUM_OF_PARAMS);
+    pos += SETTINGS_NUM_OF_PARAMS;
+    return true;
+  }
+
+  uint16_t maskPos = pos;
+  uint64_t mask = 0;
+  pos += PRESET_DELTA_MASK_SIZE;
+
+  for (uint8_t i = 0; i < SETTINGS_NUM_OF_PARAMS; i++)
+  {
+    if (values[i] != firstValues[i])
+    {
+      if (pos >= PRESETS_STORE_SIZE)
+        return false;
+
+      mask |= (1ULL << i);
+      store[pos++] = values[i];
+    }
+  }
+
+  if (pos > PRESETS_STORE_SIZE)
+    return false;
+
+  for (uint8_t b = 0; b < PRESET_DELTA_MASK_SIZE; b++)
+    store[maskPos + b] = (mask >> (b * 8)) & 0xFF;
+
+  return true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+uint16_t presetsGetTotalEncodedSize()
+{
+  return presetsStoreLength;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool presetsGetValues (uint8_t preset, uint8_t *values)
+{
+  //Decodes a stored preset into values
+  uint8_t firstValues[SETTINGS_NUM_OF_PARAMS];
+  uint16_t pos = 0;
+
+  if (preset >= presetsNumOfPresets || !presetsDecodeNext (presetsStore, presetsStoreLength, pos, NULL, firstValues))
+    return false;
+
+  if (preset == 0)
+  {
+    memcpy (values, firstValues, SETTINGS_NUM_OF_PARAMS);
+    return true;
+  }
+
+  for (uint8_t i = 1; i <= preset; i++)
+  {
+    if (!presetsDecodeNext (presetsStore, presetsStoreLength, pos, firstValues, values))
+      return false;
+  }
+
+  return true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool presetsLoad (const uint8_t *store, uint16_t length, uint8_t numOfPresets)
+{
+  //Loads the encoded presets of a settings image, checking that every preset decodes within length
+  uint8_t firstValues[SETTINGS_NUM_OF_PARAMS];
+  uint8_t values[SETTINGS_NUM_OF_PARAMS];
+  uint16_t pos = 0;
+
+  presetsNumOfPresets = 0;
+  presetsStoreLength = 0;
+
+  if (numOfPresets > PRESETS_MAX_NUM)
+    return false;
+
+  for (uint8_t preset = 0; preset < numOfPresets; preset++)
+  {
+    if (!presetsDecodeNext (store, length, pos, (preset == 0) ? NULL : firstValues, (preset == 0) ? firstValues : values))
+      return false;
+  }
+
+  memcpy (presetsStore, store, pos);
+  presetsStoreLength = pos;
+  presetsNumOfPresets = numOfPresets;
+  return true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool presetsSaveCurrentSettings()
+{
+  //Saves the current settings to the active preset, or to a new preset if there isn't an active preset.
+  //Returns false if there isn't room to store the preset.
+
+  int8_t preset = presetsActivePreset;
+
+  if (preset == PRESET_NONE)
+  {
+    if (presetsNumOfPresets >= PRESETS_MAX_NUM)
+      return false;
+
+    preset = presetsNumOfPresets;
+  }
+
+  uint8_t numOfPresets = (preset == presetsNumOfPresets) ? (presetsNumOfPresets + 1) : presetsNumOfPresets;
+
+  //Re-encode every preset into a new store, so that the stored presets are left as they were if there isn't room
+  uint8_t newStore[PRESETS_STORE_SIZE];
+  uint16_t newPos = 0;
+  uint16_t pos = 0;
+
+  uint8_t firstValues[SETTINGS_NUM_OF_PARAMS];
+  uint8_t newFirstValues[SETTINGS_NUM_OF_PARAMS];
+  uint8_t values[SETTINGS_NUM_OF_PARAMS];
+
+  for (uint8_t i = 0; i < numOfPresets; i++)
+  {
+    if (i < presetsNumOfPresets)
+      presetsDecodeNext (presetsStore, presetsStoreLength, pos, (i == 0) ? NULL : firstValues, (i == 0) ? firstValues : values);
+
+    const uint8_t *newValues = (i == preset) ? settingsValues : ((i == 0) ? firstValues : values);
+
+    if (!presetsEncodeNext (newStore, newPos, (i == 0) ? NULL : newFirstValues, newValues))
+      return false;
+
+    if (i == 0)
+      memcpy (newFirstValues, newValues, SETTINGS_NUM_OF_PARAMS);
+
+  } //for (uint8_t i = 0; i < numOfPresets; i++)
+
+  memcpy (presetsStore, newStore, newPos);
+  presetsStoreLength = newPos;
+  presetsNumOfPresets = numOfPresets;
+  presetsActivePreset = preset;
+
+  //Presets are part of the settings image, so queue the writing of a new image
+  settingsJournalRequestCompaction();
+
+  TRACE (TRACE_PRESET_SAVE, preset + 1, 0, presetsGetTotalEncodedSize());
+
+  return true;
+}
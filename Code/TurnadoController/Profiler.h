@@ -0,0 +1,243 @@
+//=========================================================================
+//Loop profiler.
+//
+//Records the cost in CPU cycles of each top-level task and of a few key inner functions, using the DWT cycle
+//counter (a single register read). For each profile point the min, mean and max are kept, along with a
+//histogram of log2 cycle counts from which a 99th percentile is estimated (to within a factor of 2).
+//The number of loop iterations per second is also recorded.
+//
+//The stats are printed over USB serial when a 'p' is received ('r' resets them - see SerialCommands.h).
+//They are printed a line at a time from a background task, and only when there is room in the USB serial
+//buffer, so that reading them doesn't hold up the loop.
+//
+//Define DISABLE_PROFILER (see Globals.h) to remove the profiler completely.
+
+enum ProfilePoints
+{
+  PROFILE_TASK_MIDI_IO = 0,
+  PROFILE_TASK_CONTROLS,
+  PROFILE_TASK_MODULATION,
+  PROFILE_TASK_GESTURE_LOOPER,
+  PROFILE_TASK_LCD,
+  PROFILE_TASK_EEPROM,
+  PROFILE_MIDI_IN_CC,
+  PROFILE_KNOB_COMBINED_MIDI_VALUE,
+  PROFILE_LCD_SLIDER_DRAW,
+  PROFILE_SCENE_MORPH,
+
+  NUM_OF_PROFILE_POINTS
+};
+
+#ifndef DISABLE_PROFILER
+
+#define PROFILER_NUM_OF_BUCKETS 32
+#define PROFILER_MIN_SERIAL_SPACE 64 //a whole USB packet free in the serial transmit buffer
+
+const char* const profilePointNames[NUM_OF_PROFILE_POINTS] =
+{
+  "MIDI IO task",
+  "Controls task",
+  "Modulation task",
+  "Gesture looper task",
+  "LCD task",
+  "EEPROM task",
+  "MIDI-in CC",
+  "Knob combined value",
+  "LCD slider draw",
+  "Scene morph"
+};
+
+struct ProfileStats
+{
+  uint32_t count;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+  uint32_t histogram[PROFILER_NUM_OF_BUCKETS]; //bucket n counts cycle counts of 2^n to 2^(n+1) - 1
+};
+
+ProfileStats profileStats[NUM_OF_PROFILE_POINTS];
+
+uint32_t profilerLoopCount = 0;
+uint32_t profilerLoopsPerSecond = 0;
+uint32_t profilerLoopWindowStartTime = 0;
+
+//the next line of stats to print, where -1 means not printing
+int8_t profilerPrintLine = -1;
+
+//=========================================================================
+void profilerRecord (uint8_t point, uint32_t cycles);
+
+//Records the cycles taken from its creation until it goes out of scope
+struct ProfilerScope
+{
+  ProfilerScope (uint8_t profilePoint) : point (profilePoint), startCycles (ARM_DWT_CYCCNT) {}
+  ~ProfilerScope() { profilerRecord (point, ARM_DWT_CYCCNT - startCycles); }
+
+  const uint8_t point;
+  const uint32_t startCycles;
+};
+
+#define PROFILE_SCOPE(point) ProfilerScope profilerScope (point)
+
+#else
+
+#define PROFILE_SCOPE(point)
+
+#endif //DISABLE_PROFILER
+
+//=========================================================================
+void profilerResetStats();
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void setupProfiler()
+{
+#ifndef DISABLE_PROFILER
+  //enable the cycle counter
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+
+  profilerResetStats();
+#endif
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void profilerCountLoop (uint32_t tickTime)
+{
+#ifndef DISABLE_PROFILER
+  profilerLoopCount++;
+
+  if ((tickTime - profilerLoopWindowStartTime) >= 1000000)
+  {
+    profilerLoopsPerSecond = profilerLoopCount;
+    profilerLoopCount = 0;
+    profilerLoopWindowStartTime = tickTime;
+  }
+#endif
+}
+
+#ifndef DISABLE_PROFILER
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void profilerResetStats()
+{
+  for (uint8_t i = 0; i < NUM_OF_PROFILE_POINTS; i++)
+  {
+    memset (&profileStats[i], 0, sizeof (ProfileStats));
+    profileStats[i].minCycles = UINT32_MAX;
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void profilerRecord (uint8_t point, uint32_t cycles)
+{
+  ProfileStats &stats = profileStats[point];
+
+  stats.count++;
+  stats.totalCycles += cycles;
+
+  if (cycles < stats.minCycles)
+    stats.minCycles = cycles;
+  if (cycles > stats.maxCycles)
+    stats.maxCycles = cycles;
+
+  uint8_t bucket = (cycles == 0) ? 0 : 31 - __builtin_clz (cycles);
+  stats.histogram[bucket]++;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+uint32_t profilerGetPercentile (uint8_t point, uint8_t percent)
+{
+  //Returns the top of the histogram bucket that the percentile falls in (capped to the max)
+  const ProfileStats &stats = profileStats[point];
+
+  uint32_t target = (((uint64_t)stats.count * percent) + 99) / 100;
+  uint32_t total = 0;
+
+  for (uint8_t bucket = 0; bucket < PROFILER_NUM_OF_BUCKETS; bucket++)
+  {
+    total += stats.histogram[bucket];
+
+    if (total >= target)
+    {
+      uint32_t bucketTop = (bucket == 31) ? UINT32_MAX : (2UL << bucket) - 1;
+      return min (bucketTop, stats.maxCycles);
+    }
+  }
+
+  return stats.maxCycles;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void profilerPrintPointStats (uint8_t point)
+{
+  const ProfileStats &stats = profileStats[point];
+
+  Serial.print (profilePointNames[point]);
+  Serial.print (": n ");
+  Serial.print (stats.count);
+
+  if (stats.count > 0)
+  {
+    Serial.print (", min ");
+    Serial.print (stats.minCycles);
+    Serial.print (", mean ");
+    Serial.print ((uint32_t)(stats.totalCycles / stats.count));
+    Serial.print (", p99 <");
+    Serial.print (profilerGetPercentile (point, 99));
+    Serial.print (", max ");
+    Serial.print (stats.maxCycles);
+    Serial.print (" cycles (max ");
+    Serial.print (stats.maxCycles / (F_CPU / 1000000));
+    Serial.print ("us)");
+  }
+
+  Serial.println();
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void profilerStartPrinting()
+{
+  if (profilerPrintLine < 0)
+    profilerPrintLine = 0;
+}
+
+#endif //DISABLE_PROFILER
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void profilerUpdate (uint32_t tickTime)
+{
+#ifndef DISABLE_PROFILER
+  //print a line at a time, and only if it will fit in the USB serial buffer without waiting
+  if (profilerPrintLine < 0 || Serial.availableForWrite() < PROFILER_MIN_SERIAL_SPACE)
+    return;
+
+  if (profilerPrintLine < NUM_OF_PROFILE_POINTS)
+  {
+    profilerPrintPointStats (profilerPrintLine);
+    profilerPrintLine++;
+  }
+  else
+  {
+    Serial.print ("Loops per second: ");
+    Serial.println (profilerLoopsPerSecond);
+    profilerPrintLine = -1;
+  }
+#endif
+}
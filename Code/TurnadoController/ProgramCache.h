@@ -0,0 +1,69 @@
+//=========================================================================
+//Program snapshot cache.
+//
+//Keeps the last known values of the device params for each program on each MIDI channel, so that when the
+//program is changed the controls (and display) can be set straight away to the values the new program had,
+//rather than waiting for Turnado to send back CCs for its knobs (which it doesn't do for the dictator and
+//mix params anyway). Any CCs that are received afterwards still correct the values.
+//
+//A program's values are cached when changing away from it, and a valid bit is kept for each program,
+//so a program that hasn't been used yet is a miss and the controls keep their current values.
+//
+//Size: NUM_OF_DEVICE_PARAMS bytes + 1 bit for each of the 128 programs, so ~1.3KB per channel.
+
+#define PROGRAM_CACHE_NUM_OF_PROGRAMS 128
+
+struct ProgramCache
+{
+  uint8_t deviceParamValues[NUM_OF_MIDI_CHANNELS][PROGRAM_CACHE_NUM_OF_PROGRAMS][NUM_OF_DEVICE_PARAMS];
+  uint8_t validBits[NUM_OF_MIDI_CHANNELS][PROGRAM_CACHE_NUM_OF_PROGRAMS / 8];
+};
+
+ProgramCache programCache;
+
+uint32_t programCacheNumOfHits = 0;
+uint32_t programCacheNumOfMisses = 0;
+
+//called before a program's values are stored over (used by the input trace, see InputTrace.h)
+void (*programCacheOnStore) (uint8_t channelIndex, uint8_t program) = nullptr;
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void programCacheStore (uint8_t channelIndex)
+{
+  //Stores the current device param values of a channel as the values of its current program
+  uint8_t program = midiChannelState.programNumbers[channelIndex];
+
+  if (programCacheOnStore)
+    programCacheOnStore (channelIndex, program);
+
+  memcpy (programCache.deviceParamValues[channelIndex][program],
+          midiChannelState.deviceParamValues[channelIndex],
+          NUM_OF_DEVICE_PARAMS);
+
+  programCache.validBits[channelIndex][program / 8] |= (1 << (program % 8));
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool programCacheRecall (uint8_t channelIndex)
+{
+  //Sets the device param values of a channel to the cached values of its current program,
+  //returning false (and leaving the values alone) if the program isn't in the cache
+  uint8_t program = midiChannelState.programNumbers[channelIndex];
+
+  if ((programCache.validBits[channelIndex][program / 8] & (1 << (program % 8))) == 0)
+  {
+    programCacheNumOfMisses++;
+    return false;
+  }
+
+  memcpy (midiChannelState.deviceParamValues[channelIndex],
+          programCache.deviceParamValues[channelIndex][program],
+          NUM_OF_DEVICE_PARAMS);
+
+  programCacheNumOfHits++;
+  return true;
+}
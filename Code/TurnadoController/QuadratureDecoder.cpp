@@ -0,0 +1,109 @@
+#include "QuadratureDecoder.h"
+
+//Counting up is B leading A (00 -> 10 -> 11 -> 01 -> 00, as (B << 1) | A), which matches the direction of the
+//Teensy Encoder library with pin 1 as A. Indexes 3, 6, 9 and 12 are where both pins have changed.
+const int8_t QuadratureDecoder::TRANSITION_TABLE[16] =
+{
+  0, 1, -1, 0,
+  -1, 0, 0, 1,
+  1, 0, 0, -1,
+  0, -1, 1, 0
+};
+
+QuadratureDecoder::QuadratureDecoder()
+{
+}
+
+int8_t QuadratureDecoder::addEncoder (uint8_t pinA, uint8_t pinB)
+{
+  if (numOfEncoders >= MAX_NUM_OF_ENCODERS)
+    return -1;
+
+  pinMode (pinA, INPUT_PULLUP);
+  pinMode (pinB, INPUT_PULLUP);
+
+  //let the pullups settle before reading the starting state
+  delayMicroseconds (2000);
+
+  Encoder &encoder = encoders[numOfEncoders];
+
+  encoder.pinARegister = (volatile uint32_t*)portInputRegister (pinA);
+  encoder.pinAMask = digitalPinToBitMask (pinA);
+  encoder.pinBRegister = (volatile uint32_t*)portInputRegister (pinB);
+  encoder.pinBMask = digitalPinToBitMask (pinB);
+
+  encoder.pinState = readPinState (encoder);
+  encoder.count = 0;
+
+  return numOfEncoders++;
+}
+
+uint8_t QuadratureDecoder::readPinState (const Encoder &encoder)
+{
+  return ((*encoder.pinARegister & encoder.pinAMask) ? 1 : 0) |
+         ((*encoder.pinBRegister & encoder.pinBMask) ? 2 : 0);
+}
+
+void QuadratureDecoder::sample()
+{
+  numOfSamples++;
+
+  for (uint8_t i = 0; i < numOfEncoders; i++)
+  {
+    Encoder &encoder = encoders[i];
+
+    uint8_t pinState = readPinState (encoder);
+
+    if (pinState == encoder.pinState)
+      continue;
+
+    int8_t step = TRANSITION_TABLE[(pinState << 2) | encoder.pinState];
+    encoder.pinState = pinState;
+
+    if (step == 0)
+    {
+      numOfInvalidTransitions++;
+      continue;
+    }
+
+    encoder.count += step;
+
+  } //for (uint8_t i = 0; i < numOfEncoders; i++)
+}
+
+int32_t QuadratureDecoder::getCount (uint8_t encoder)
+{
+  return encoders[encoder].count;
+}
+
+uint8_t QuadratureDecoder::getNumOfEncoders()
+{
+  return numOfEncoders;
+}
+
+uint32_t QuadratureDecoder::getNumOfSamples()
+{
+  return numOfSamples;
+}
+
+uint32_t QuadratureDecoder::getNumOfInvalidTransitions()
+{
+  return numOfInvalidTransitions;
+}
+
+void QuadratureDecoder::resetStats()
+{
+  numOfSamples = 0;
+  numOfInvalidTransitions = 0;
+}
+
+void QuadratureDecoder::printStats (Print &out)
+{
+  out.print ("Quadrature decoder: ");
+  out.print (numOfEncoders);
+  out.print (" encoders, ");
+  out.print (numOfSamples);
+  out.print (" samples, ");
+  out.print (numOfInvalidTransitions);
+  out.println (" invalid transitions (missed samples)");
+}
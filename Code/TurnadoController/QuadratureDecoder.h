@@ -0,0 +1,101 @@
+/*
+  QuadratureDecoder.h - Timer-polled decoder for a set of quadrature
+  rotary encoders.
+*/
+
+#ifndef QuadratureDecoder_h
+#define QuadratureDecoder_h
+
+#include "Arduino.h"
+
+/**
+    Decodes the counts of a set of quadrature encoders by sampling all of their pins at a fixed rate,
+    rather than with an interrupt on every pin change.
+    Features:
+    - A fixed CPU load however many encoders are turning, and however fast (unlike pin change interrupts, which
+      can storm when several encoders are spun fast)
+    - Pins are read straight from the port input registers, and each encoder is decoded with a single lookup of
+      its previous and new pin states in a state transition table
+    - Counts are kept whole, 4 per detent, so a caller can take whole detents and keep any part of a detent
+    - Transitions where both pins have changed since the last sample (a missed sample, so no way of telling the
+      direction) are ignored and counted, rather than being guessed at
+
+    To use, create an instance of this class, add each encoder with addEncoder(), and call sample() from a timer
+    interrupt (e.g. an IntervalTimer) at a rate of at least twice the fastest expected count rate.
+    Counts can be read from code that is interrupted by the timer (each count is read in a single access).
+*/
+class QuadratureDecoder
+{
+    //=====================================================
+  public:
+
+    static const uint8_t MAX_NUM_OF_ENCODERS = 16;
+    static const uint8_t COUNTS_PER_DETENT = 4;
+
+    QuadratureDecoder();
+
+    /** Adds an encoder, setting its pins to inputs with pullups. Encoders must be added before sampling starts.
+
+        @param pinA - Encoder pin A
+        @param pinB - Encoder pin B
+        @return the index of the encoder, or -1 if there isn't room for any more encoders
+    */
+    int8_t addEncoder (uint8_t pinA, uint8_t pinB);
+
+    /** Samples the pins of every encoder and decodes any changes.
+
+        Call this from a timer interrupt.
+    */
+    void sample();
+
+    /** Returns the count of an encoder, which counts up in the same direction as the Teensy Encoder library
+        (with pin A as pin 1). The count wraps around.
+    */
+    int32_t getCount (uint8_t encoder);
+
+    uint8_t getNumOfEncoders();
+
+    /** Returns the number of samples taken
+    */
+    uint32_t getNumOfSamples();
+
+    /** Returns the number of transitions ignored because both pins of an encoder had changed between samples
+    */
+    uint32_t getNumOfInvalidTransitions();
+
+    void resetStats();
+
+    /** Prints the stats as human readable text
+    */
+    void printStats (Print &out);
+
+    //=====================================================
+  private:
+
+    struct Encoder
+    {
+      //as with the Teensy Encoder library, a pin is read as a register and mask (on the Teensy 3.x the register
+      //is the pin's bit-band alias, so the mask is just 1)
+      volatile uint32_t *pinARegister;
+      uint32_t pinAMask;
+      volatile uint32_t *pinBRegister;
+      uint32_t pinBMask;
+
+      uint8_t pinState; //(B << 1) | A
+      volatile int32_t count;
+    };
+
+    //the count change for each transition, indexed by (new pin state << 2) | previous pin state,
+    //where 0 is no change or an invalid transition
+    static const int8_t TRANSITION_TABLE[16];
+
+    uint8_t readPinState (const Encoder &encoder);
+
+    Encoder encoders[MAX_NUM_OF_ENCODERS];
+    uint8_t numOfEncoders = 0;
+
+    volatile uint32_t numOfSamples = 0;
+    volatile uint32_t numOfInvalidTransitions = 0;
+};
+
+#endif //QuadratureDecoder_h
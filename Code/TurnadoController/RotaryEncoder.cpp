@@ -1,8 +1,9 @@
 #include "RotaryEncoder.h"
 
-RotaryEncoder::RotaryEncoder (uint8_t encPin1, uint8_t encPin2, int8_t switchPin)
+RotaryEncoder::RotaryEncoder (QuadratureDecoder &decoder_, uint8_t encPin1, uint8_t encPin2, int8_t switchPin)
+  : decoder (decoder_)
 {
-  encoder = new Encoder (encPin1, encPin2);
+  decoderEncoder = decoder.addEncoder (encPin1, encPin2);
 
   if (switchPin >= 0)
   {
@@ -17,72 +18,101 @@ RotaryEncoder::RotaryEncoder (uint8_t encPin1, uint8_t encPin2, int8_t switchPin
 
 RotaryEncoder::~RotaryEncoder()
 {
-  delete encoder;
-
   if (switchEnabled)
     delete switchDebouncer;
 }
 
 void RotaryEncoder::update()
 {
-  //Check for encoder turn
+  update (millis());
+}
 
-  int env_val = encoder->read();
+void RotaryEncoder::update (uint32_t time)
+{
+  //Check for encoder turn - only whole detents are processed, and any part of a detent is kept
+  //for the next update, so slowly turning the encoder (or turning it back) never loses counts.
 
-  //If there is an encoder value change
-  if (env_val >= 4 || env_val <= - 4)
+  if (decoderEncoder >= 0)
   {
-    if (accelerationEnabled)
-    {
-      //get time interval between this change and previous change
-      currentTime = millis();
-      revolutionTime = currentTime - prevTime;
-      prevTime = currentTime;
+    int32_t countChange = decoder.getCount (decoderEncoder) - processedCount;
+    int env_val = countChange - (countChange % QuadratureDecoder::COUNTS_PER_DETENT);
 
-      // trigger acceleration only when encoder speed is sufficiently high (small time value)
-      if (revolutionTime < revTimeThreshold)
-      {
-        rev = revTimeThreshold - revolutionTime;
-        b = (int)a * rev + c; //slope of a line equation
-        env_val = env_val * b; //apply acceleration
-      }
-
-    } //if (accelerationEnabled)
-
-    env_val /= 4;
+    //If there is an encoder value change
+    if (env_val != 0)
+    {
+      processedCount += env_val;
 
-    //constrain value to expected range to get rid of occasional incorrect large encoder readings
-    env_val = constrain (env_val, -4, 4);
+      processEncoderCount (env_val, time);
 
-    if (shouldSendEncoderValue (env_val))
-    {
-      this->handle_encoder_change (*this, env_val);
-    }
+      if (this->handle_raw_input != NULL)
+        this->handle_raw_input (*this, RAW_INPUT_ENCODER_COUNT, env_val);
 
-    encoder->write(0);
+    } //if (env_val != 0)
 
-  } //if (env_val >= 4 || env_val <= - 4)
+  } //if (decoderEncoder >= 0)
 
   if (switchEnabled)
   {
     //Check for switch state change
     switchDebouncer->update();
 
+    int8_t newSwitchState = -1;
+
     if (switchDebouncer->risingEdge())
-    {
-      switchState = 0;
-      this->handle_switch_change (*this);
-    }
+      newSwitchState = 0;
     else if (switchDebouncer->fallingEdge())
+      newSwitchState = 1;
+
+    if (newSwitchState >= 0)
     {
-      switchState = 1;
-      this->handle_switch_change (*this);
+      processSwitchState (newSwitchState);
+
+      if (this->handle_raw_input != NULL)
+        this->handle_raw_input (*this, RAW_INPUT_SWITCH_STATE, newSwitchState);
     }
 
   }//if (switchEnabled)
 
 }
 
+void RotaryEncoder::processEncoderCount (int env_val, uint32_t time)
+{
+  if (accelerationEnabled)
+  {
+    //get time interval between this change and previous change
+    currentTime = time;
+    revolutionTime = currentTime - prevTime;
+    prevTime = currentTime;
+
+    // trigger acceleration only when encoder speed is sufficiently high (small time value)
+    if (revolutionTime < revTimeThreshold)
+    {
+      rev = revTimeThreshold - revolutionTime;
+      b = (int)a * rev + c; //slope of a line equation
+      env_val = env_val * b; //apply acceleration
+    }
+
+  } //if (accelerationEnabled)
+
+  env_val /= 4;
+
+  //constrain value to limit the acceleration
+  env_val = constrain (env_val, -4, 4);
+
+  this->handle_encoder_change (*this, env_val);
+}
+
+void RotaryEncoder::processSwitchState (uint8_t state)
+{
+  switchState = state;
+  this->handle_switch_change (*this);
+}
+
+void RotaryEncoder::resetProcessingState()
+{
+  prevTime = 0;
+}
+
 uint8_t RotaryEncoder::getSwitchState()
 {
   return switchState;
@@ -98,6 +128,11 @@ void RotaryEncoder::onSwitchChange( void (*function)(RotaryEncoder&) )
   this->handle_switch_change = function;
 }
 
+void RotaryEncoder::onRawInput( void (*function)(RotaryEncoder&, uint8_t, int) )
+{
+  this->handle_raw_input = function;
+}
+
 bool RotaryEncoder::operator==(RotaryEncoder& b)
 {
   return (this == &b);
@@ -107,52 +142,3 @@ void RotaryEncoder::enableAcceleration (bool shouldEnable)
 {
   accelerationEnabled = shouldEnable;
 }
-
-bool RotaryEncoder::shouldSendEncoderValue (int incVal)
-{
-  //Only send the encoder value if it's the first turn after a certain time period or if
-  //the direction is the same as with the previous x amount of turns.
-  //This is done to prevent stray sets of positive values within fast negative turns from being processed.
-
-  bool shouldSend = false;
-
-  //if the first encoder turn after a certain time period
-  if (millis() - prevIncTime >= 50)
-  {
-    shouldSend = true;
-
-    //set all prevIncDirs to match incVal to reset process of checking previous values
-    for (uint8_t i = 0; i < NUM_OF_PREV_VALS; i++)
-      incVal > 0 ? prevIncDirs[i] = 1 : prevIncDirs[i] = -1;
-  }
-
-  //else if the value direction matches that of the previous set of values
-  else if (doesValDirMatchPrevVals (incVal))
-  {
-    shouldSend = true;
-
-    //move all values in prevIncDirs backward (removing end/oldest value)
-    //and add new value based on incVal at the beginning
-
-    for (uint8_t i = NUM_OF_PREV_VALS - 1; i > 0; i--)
-      prevIncDirs[i] = prevIncDirs[i - 1];
-
-    incVal > 0 ? prevIncDirs[0] = 1 : prevIncDirs[0] = -1;
-  }
-
-  prevIncTime = millis();
-  return shouldSend;
-}
-
-bool RotaryEncoder::doesValDirMatchPrevVals (int incVal)
-{
-  int8_t valDir = incVal > 0 ? 1 : -1;
-
-  for (uint8_t i = 0; i < NUM_OF_PREV_VALS; i++)
-  {
-    if (valDir != prevIncDirs[i])
-      return false;
-  }
-
-  return true;
-}
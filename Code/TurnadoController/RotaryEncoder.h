@@ -1,6 +1,6 @@
 /*
   RotaryEncoder.h - Class for processing switched rotary encoders,
-  built on top of the Teensy Encoder and Bounce classes.
+  built on top of the QuadratureDecoder and Teensy Bounce classes.
 
   Created by Liam Lacey, September 2018.
 */
@@ -9,7 +9,7 @@
 #define RotaryEncoder_h
 
 #include "Arduino.h"
-#include <Encoder.h>
+#include "QuadratureDecoder.h"
 #include <Bounce.h>
 
 /**
@@ -17,6 +17,7 @@
     Features:
     - Processes encoder turns and push switch state changes
     - Provides encoder values as stateless values - +1 for clockwise or -1 for anticlockwise
+    - Only whole detents are processed, with any part of a detent kept until the encoder is turned further
     - Callback functions for all value changes
     - Switch debouncer
     - Coming soon - encoder acceleration
@@ -31,11 +32,12 @@ class RotaryEncoder
 
     /** Initialises the object to work with a switched rotary encoder.
 
+        @param decoder - The decoder that samples the encoder's pins (which the encoder is added to)
         @param encPin1 - Encoder pin 1
         @param encPin2 - Encoder pin 2
         @param switchPin - Switch pin. Set to -1 if not using the switch.
     */
-    RotaryEncoder (uint8_t encPin1, uint8_t encPin2, int8_t switchPin);
+    RotaryEncoder (QuadratureDecoder &decoder, uint8_t encPin1, uint8_t encPin2, int8_t switchPin);
     ~RotaryEncoder();
 
     /** Reads and updates all control values.
@@ -44,6 +46,32 @@ class RotaryEncoder
     */
     void update();
 
+    /** As update(), but using the given time (in milliseconds) for encoder acceleration and
+        filtering rather than reading millis().
+    */
+    void update (uint32_t time);
+
+    /** Processes an encoder count change of whole detents (4 counts per detent).
+        update() calls this with the counts read from the decoder, however it can also be
+        called directly to process recorded counts (e.g. when replaying an input trace).
+
+        @param count - The encoder count
+        @param time - The time of the count in milliseconds
+    */
+    void processEncoderCount (int count, uint32_t time);
+
+    /** Processes a debounced switch state change. As with processEncoderCount(), this is called
+        from update() but can be called directly.
+
+        @param state - The new switch state (0-1)
+    */
+    void processSwitchState (uint8_t state);
+
+    /** Resets the encoder acceleration state, so that processing a
+        set of counts always gives the same encoder values.
+    */
+    void resetProcessingState();
+
     /** Assigns the function you want to be called when the encoder is turned.
 
         @param enc - The instance of this class that has detected a change
@@ -58,6 +86,21 @@ class RotaryEncoder
     */
     void onSwitchChange( void (*)(RotaryEncoder &enc) );
 
+    enum RawInputTypes
+    {
+      RAW_INPUT_ENCODER_COUNT = 0,
+      RAW_INPUT_SWITCH_STATE
+    };
+
+    /** Assigns a function to be called with each raw input value that update() has processed,
+        e.g. for recording the input.
+
+        @param enc - The instance of this class that has processed the value
+        @param inputType - RAW_INPUT_ENCODER_COUNT or RAW_INPUT_SWITCH_STATE
+        @param value - The encoder count or switch state
+    */
+    void onRawInput( void (*)(RotaryEncoder &enc, uint8_t inputType, int value) );
+
     /** Returns the current state of the switch (0-1)
     */
     uint8_t getSwitchState();
@@ -75,13 +118,13 @@ class RotaryEncoder
     //=====================================================
   private:
 
-    bool shouldSendEncoderValue (int incVal);
-    bool doesValDirMatchPrevVals (int incVal);
-
     void (*handle_encoder_change)(RotaryEncoder &enc, int enc_value) = NULL;
     void (*handle_switch_change)(RotaryEncoder &enc) = NULL;
+    void (*handle_raw_input)(RotaryEncoder &enc, uint8_t inputType, int value) = NULL;
 
-    Encoder *encoder;
+    QuadratureDecoder &decoder;
+    int8_t decoderEncoder;
+    int32_t processedCount = 0; //the decoder count up to the last whole detent processed
     Bounce *switchDebouncer;
 
     //Encoder acceleration variables.
@@ -98,10 +141,6 @@ class RotaryEncoder
 
     bool accelerationEnabled = true;
 
-    #define NUM_OF_PREV_VALS 5
-    int8_t prevIncDirs[NUM_OF_PREV_VALS] = {1, 1, 1, 1, 1}; //1 = positive/clockwise, -1 = negative/anti-clockwise
-    unsigned long prevIncTime = 0;
-
     bool switchEnabled = true;
     const int DEBOUNCE_TIME = 10;
     uint8_t switchState = 0;
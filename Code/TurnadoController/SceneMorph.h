@@ -0,0 +1,147 @@
+//=========================================================================
+//Scene morphing.
+//
+//A scene is a snapshot of the base values of all the device params (the knob controllers, dictator and mix).
+//Up to SCENE_MORPH_MAX_NUM_OF_SCENES scenes can be captured, by holding the LCD control switch and pressing the
+//encoder switch of knob controller 1-4. Holding the LCD control switch and pressing the dictator encoder switch
+//then turns morphing on or off, where the dictator joystick morphs between the captured scenes (in order, from
+//fully down to fully up) instead of controlling the dictator. Scenes are only kept in RAM.
+//
+//Morphed values are worked out for all of the device params at once, as a weighted sum of the two scenes either
+//side of the morph position. Each device param's values in each pair of neighbouring scenes are packed into the
+//two halves of a 32-bit word when scenes are captured, so that on the Teensy each value takes a single SMUAD
+//(dual 16-bit multiply and add) against the packed weights. A scalar version is used elsewhere (and benchmarked
+//against). Only the device params whose morphed value has changed are set, so only they send MIDI.
+
+#define SCENE_MORPH_MAX_NUM_OF_SCENES 4
+#define SCENE_MORPH_WEIGHT_ONE 256 //weights are 8.8 fixed point
+
+uint8_t sceneMorphScenes[SCENE_MORPH_MAX_NUM_OF_SCENES][NUM_OF_DEVICE_PARAMS];
+uint8_t sceneMorphCapturedMask = 0;
+bool sceneMorphEnabled = false;
+
+//the captured scenes in order, with each pair of neighbouring scenes packed as (second << 16) | first
+uint32_t sceneMorphPairs[SCENE_MORPH_MAX_NUM_OF_SCENES - 1][NUM_OF_DEVICE_PARAMS];
+uint8_t sceneMorphNumOfScenes = 0;
+
+//the last morphed values, so that only changes are set
+uint8_t sceneMorphValues[NUM_OF_DEVICE_PARAMS];
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+inline uint32_t sceneMorphSmuad (uint32_t x, uint32_t y)
+{
+  //Returns (x.low * y.low) + (x.high * y.high), as signed 16-bit halves
+#if defined (__ARM_FEATURE_DSP)
+  int32_t result;
+  asm ("smuad %0, %1, %2" : "=r" (result) : "r" (x), "r" (y));
+  return result;
+#else
+  return ((int16_t)x * (int16_t)y) + ((int16_t)(x >> 16) * (int16_t)(y >> 16));
+#endif
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void sceneMorphKernel (const uint32_t *pairs, uint16_t weight, uint8_t *values)
+{
+  //Works out the morphed value of every device param from a packed scene pair,
+  //where a weight of 0 gives the first scene and SCENE_MORPH_WEIGHT_ONE the second
+  uint32_t weights = ((uint32_t)weight << 16) | (SCENE_MORPH_WEIGHT_ONE - weight);
+
+  for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
+    values[i] = (sceneMorphSmuad (pairs[i], weights) + (SCENE_MORPH_WEIGHT_ONE / 2)) >> 8;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void sceneMorphKernelScalar (const uint8_t *firstScene, const uint8_t *secondScene, uint16_t weight, uint8_t *values)
+{
+  for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
+    values[i] = ((firstScene[i] * (SCENE_MORPH_WEIGHT_ONE - weight)) + (secondScene[i] * weight) + (SCENE_MORPH_WEIGHT_ONE / 2)) >> 8;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void sceneMorphPackScenes()
+{
+  //Packs each pair of neighbouring captured scenes for the morph kernel
+  const uint8_t *scenes[SCENE_MORPH_MAX_NUM_OF_SCENES];
+  sceneMorphNumOfScenes = 0;
+
+  for (uint8_t scene = 0; scene < SCENE_MORPH_MAX_NUM_OF_SCENES; scene++)
+  {
+    if (sceneMorphCapturedMask & (1 << scene))
+      scenes[sceneMorphNumOfScenes++] = sceneMorphScenes[scene];
+  }
+
+  for (uint8_t pair = 0; pair + 1 < sceneMorphNumOfScenes; pair++)
+  {
+    for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
+      sceneMorphPairs[pair][i] = ((uint32_t)scenes[pair + 1][i] << 16) | scenes[pair][i];
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void sceneMorphCapture (uint8_t scene)
+{
+  for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
+    sceneMorphScenes[scene][i] = deviceParamValue (i);
+
+  sceneMorphCapturedMask |= (1 << scene);
+  sceneMorphPackScenes();
+
+  TRACE (TRACE_SCENE_CAPTURE, scene + 1);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void sceneMorphToggle()
+{
+  //Morphing needs at least two scenes
+  sceneMorphEnabled = !sceneMorphEnabled && sceneMorphNumOfScenes >= 2;
+
+  //start from the current values, so that only the device params that the morph changes are set
+  for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
+    sceneMorphValues[i] = deviceParamValue (i);
+
+  TRACE (TRACE_SCENE_MORPH, sceneMorphEnabled);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void sceneMorphSetPosition (int16_t joystickValue)
+{
+  //Morphs the device params to a position set by a joystick value (-128 to 127), going from the first
+  //captured scene to the last. Must only be called when enabled.
+  PROFILE_SCOPE (PROFILE_SCENE_MORPH);
+
+  uint32_t position = ((uint32_t)(joystickValue + 128) * (sceneMorphNumOfScenes - 1) * SCENE_MORPH_WEIGHT_ONE) / 255;
+  uint8_t pair = min (position / SCENE_MORPH_WEIGHT_ONE, (uint32_t)(sceneMorphNumOfScenes - 2));
+  uint16_t weight = position - (pair * SCENE_MORPH_WEIGHT_ONE);
+
+  uint8_t values[NUM_OF_DEVICE_PARAMS];
+  sceneMorphKernel (sceneMorphPairs[pair], weight, values);
+
+  for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
+  {
+    if (values[i] != sceneMorphValues[i])
+    {
+      sceneMorphValues[i] = values[i];
+
+      if (i == DEVICE_PARAM_INDEX_MIX)
+        setMixControllerValue (values[i], true);
+      else
+        setKnobControllerBaseValue (i, values[i], true);
+    }
+
+  } //for (uint8_t i = 0; i < NUM_OF_DEVICE_PARAMS; i++)
+}
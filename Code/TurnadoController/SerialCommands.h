@@ -0,0 +1,179 @@
+//=========================================================================
+//Single character commands received over USB serial, for the dev tools.
+//
+//The stats reports ('j' and 'm') are printed a line per run of the task, and only when there is room in the
+//USB serial buffer, so that reading them doesn't hold up the loop (as with the profiler stats - see Profiler.h).
+//A report asked for while another is being printed is ignored.
+
+#define SERIAL_COMMANDS_MIN_SERIAL_SPACE 64 //a whole USB packet free in the serial transmit buffer
+
+enum SerialCommandsReports
+{
+  SERIAL_COMMANDS_REPORT_NONE = 0,
+  SERIAL_COMMANDS_REPORT_TASKS, //'j'
+  SERIAL_COMMANDS_REPORT_MEMORY //'m'
+};
+
+uint8_t serialCommandsReport = SERIAL_COMMANDS_REPORT_NONE;
+uint8_t serialCommandsReportLine = 0;
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool serialCommandsPrintTaskStats (uint8_t line)
+{
+  //Prints a line of the task stats, followed by the encoder decoder, MIDI and LCD drawing stats.
+  //Returns false if there is no such line.
+  if (line < scheduler.getNumOfTasks())
+  {
+    scheduler.printStats (Serial, line);
+    return true;
+  }
+
+  line -= scheduler.getNumOfTasks();
+
+  if (line == 0)
+    encoderDecoder.printStats (Serial);
+  else if (line == 1)
+    midiInPrintStats (Serial);
+  else if (line < 2 + NUM_OF_MIDI_OUT_QUEUES)
+    midiOutPrintStats (Serial, line - 2);
+  else if (line < 2 + NUM_OF_MIDI_OUT_QUEUES + MeteredLcd::NUM_OF_STATS_LINES)
+    lcd.printStats (Serial, line - 2 - NUM_OF_MIDI_OUT_QUEUES);
+  else
+    return false;
+
+  return true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void serialCommandsStartReport (uint8_t report)
+{
+  if (serialCommandsReport == SERIAL_COMMANDS_REPORT_NONE)
+  {
+    serialCommandsReport = report;
+    serialCommandsReportLine = 0;
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void serialCommandsPrintReportLine()
+{
+  //print a line at a time, and only if it will fit in the USB serial buffer without waiting
+  if (serialCommandsReport == SERIAL_COMMANDS_REPORT_NONE ||
+      Serial.availableForWrite() < SERIAL_COMMANDS_MIN_SERIAL_SPACE)
+    return;
+
+  bool printed;
+
+  if (serialCommandsReport == SERIAL_COMMANDS_REPORT_TASKS)
+  {
+    printed = serialCommandsPrintTaskStats (serialCommandsReportLine);
+  }
+  else
+  {
+    printed = (serialCommandsReportLine < MEMORY_NUM_OF_STATS_LINES);
+
+    if (printed)
+      memoryPrintStats (serialCommandsReportLine);
+  }
+
+  if (printed)
+    serialCommandsReportLine++;
+  else
+    serialCommandsReport = SERIAL_COMMANDS_REPORT_NONE;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void updateSerialCommands (uint32_t tickTime)
+{
+  while (Serial.available() > 0)
+  {
+    char command = Serial.read();
+
+    switch (command)
+    {
+      //start or stop learning the joystick calibration
+      case 'c':
+        toggleJoystickCalibration();
+        break;
+
+      //print the task stats, where the "max late" of the realtime tasks is their worst case jitter,
+      //and the encoder decoder, MIDI and LCD drawing stats
+      case 'j':
+        serialCommandsStartReport (SERIAL_COMMANDS_REPORT_TASKS);
+        break;
+
+      //print the static RAM, heap and stack use
+      case 'm':
+        serialCommandsStartReport (SERIAL_COMMANDS_REPORT_MEMORY);
+        break;
+
+#ifndef DISABLE_PROFILER
+      //print profiler stats
+      case 'p':
+        profilerStartPrinting();
+        break;
+#endif
+
+      //reset profiler and task stats
+      case 'r':
+#ifndef DISABLE_PROFILER
+        profilerResetStats();
+#endif
+        scheduler.resetStats();
+        encoderDecoder.resetStats();
+        midiInResetStats();
+        midiOutResetStats();
+        lcd.resetStats();
+        break;
+
+#ifdef DEBUG
+      //read the debug trace records in the flight recorder
+      case 'g':
+        traceStartDrain();
+        break;
+
+      //start or stop streaming the debug trace
+      case 'l':
+        traceToggleStreaming();
+        break;
+#endif
+
+#ifdef ENABLE_INPUT_TRACE
+      //start recording an input trace
+      case 't':
+        inputTraceStartRecording();
+        break;
+
+      //stop recording an input trace
+      case 's':
+        inputTraceStopRecording();
+        break;
+
+      //replay the input trace
+      case 'x':
+        inputTraceReplay();
+        break;
+
+      //dump the input trace
+      case 'd':
+        inputTraceStartDump();
+        break;
+#endif
+
+      default:
+        break;
+
+    } //switch (command)
+
+  } //while (Serial.available() > 0)
+
+  serialCommandsPrintReportLine();
+}
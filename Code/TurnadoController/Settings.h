@@ -20,163 +20,352 @@ enum SettingsCategories
   SETTINGS_NUM_OF_CATS
 };
 
-#define SETTINGS_MAX_NUM_PARAMS 16
+#define SETTINGS_MAX_NUM_PARAMS 16 //per category, which sets the param IDs used in EEPROM
+#define SETTINGS_NUM_OF_PARAMS 64 //total number of params across all categories
 
 #define PARAM_INDEX_MIDI_CHAN 0
-#define PARAM_INDEX_CC_NUM 1
+#define PARAM_INDEX_MOD_SYNC 1 //global only
+#define PARAM_INDEX_CC_NUM 1 //also the note or program number for controls set to send those
 #define PARAM_INDEX_START_NUM 1
+#define PARAM_INDEX_MSG_TYPE 2
+#define PARAM_INDEX_MOD_SOURCE 3 //knob controllers (including dictator) only
+#define PARAM_INDEX_MOD_RATE 4
+#define PARAM_INDEX_MOD_DEPTH 5
+
+//Param IDs match the param's address in the original fixed EEPROM layout
+#define SETTINGS_PARAM_ID(cat, param) ((uint8_t)(((cat) * SETTINGS_MAX_NUM_PARAMS) + (param)))
+
+static_assert (SETTINGS_NUM_OF_PARAMS <= 64, "Settings dirty mask is too small for the number of settings params");
+
+//The number of params of each category in the original fixed EEPROM layout (see settingsLoadLegacyLayoutFromEeprom()),
+//where the addresses of any params added since hold nothing.
+const uint8_t settingsLayoutVersion0CatNumOfParams[SETTINGS_NUM_OF_CATS] = {1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2};
 
 //=========================================================================
+//The MIDI messages that a control can be set to send (see MessageMap.h).
+//Continuous controls are the knob controllers, dictator and mix, and trigger controls are the randomise button.
 
-struct ParamData
+enum ContinuousMsgTypes
 {
-  const char name[16];
-  const uint8_t minVal;
-  const uint8_t maxVal;
-  const uint8_t memAddrOffset; //I dont think I need this, as the offset is the index of ParamData in an array
+  MSG_TYPE_CC = 0,
+  MSG_TYPE_PITCH_BEND,
+  MSG_TYPE_CHANNEL_PRESSURE,
+
+  NUM_OF_CONTINUOUS_MSG_TYPES
+};
+
+enum TriggerMsgTypes
+{
+  MSG_TYPE_CC_PAIR = 0, //127 followed by 0, as Turnado needs a value change to trigger
+  MSG_TYPE_CC_SINGLE,
+  MSG_TYPE_NOTE,
+  MSG_TYPE_PROGRAM_CHANGE,
+
+  NUM_OF_TRIGGER_MSG_TYPES
+};
 
-  uint8_t defaultValue;
-  uint8_t value;
+//=========================================================================
+//Modulation sources of the knob controllers, and what the modulation rates are synced to (see Modulation.h)
 
-  bool needsSavingToEeprom = false;
+enum ModulationSources
+{
+  MOD_SOURCE_OFF = 0,
+  MOD_SOURCE_SINE,
+  MOD_SOURCE_TRIANGLE,
+  MOD_SOURCE_SAW,
+  MOD_SOURCE_SQUARE,
+  MOD_SOURCE_SAMPLE_AND_HOLD,
+  MOD_SOURCE_ENVELOPE, //triggered by the knob controller's encoder switch
+
+  NUM_OF_MOD_SOURCES
 };
 
-const ParamData paramDataTemplateChannelGlobal = {"Channel", .minVal = 1, .maxVal = 16, .memAddrOffset = PARAM_INDEX_MIDI_CHAN, .defaultValue = 0, .value = 0, .needsSavingToEeprom = false};
-const ParamData paramDataTemplateChannelControl = {"Channel", .minVal = 0, .maxVal = 16, .memAddrOffset = PARAM_INDEX_MIDI_CHAN, .defaultValue = 16, .value = 0, .needsSavingToEeprom = false};
-const ParamData paramDataTemplateCcNumber = {"CC Num", .minVal = 0, .maxVal = 127, .memAddrOffset = PARAM_INDEX_CC_NUM, .defaultValue = 1, .value = 0, .needsSavingToEeprom = false};
-const ParamData paramDataTemplatePrgmStartNumber = {"1st Prgm", .minVal = 0, .maxVal = 127, .memAddrOffset = PARAM_INDEX_START_NUM, .defaultValue = 0, .value = 0, .needsSavingToEeprom = false};
+enum ModulationSyncModes
+{
+  MOD_SYNC_OFF = 0,
+  MOD_SYNC_MIDI_CLOCK,
+
+  NUM_OF_MOD_SYNC_MODES
+};
 
-struct SettingsCategoryData
+//names for the settings menu, which has room for 6 characters
+const char* const modulationSourceNames[NUM_OF_MOD_SOURCES] = {"Off", "Sine", "Tri", "Saw", "Square", "S&H", "Env"};
+const char* const modulationSyncModeNames[NUM_OF_MOD_SYNC_MODES] = {"Off", "Clock"};
+
+//=========================================================================
+//Settings schema - everything about a param apart from its value, which is constant and so kept in flash.
+//Params are stored as a single list in category and param order, with each category pointing
+//to its first param. Param values (in RAM) and presets use the same order.
+
+struct ParamSchema
+{
+  const char name[16];
+  const uint8_t minVal;
+  const uint8_t maxVal;
+  const uint8_t defaultValue;
+  const uint8_t eepromId; //the ID of the param's records in the EEPROM journal
+};
+
+struct SettingsCategorySchema
 {
   const char name[16];
   const uint8_t numOfParams;
+  const uint8_t firstParam; //index into settingsParamSchema / settingsValues
+};
+
+constexpr ParamSchema paramSchemaChannelGlobal()
+{
+  return {"Channel", .minVal = 1, .maxVal = 16, .defaultValue = 1, .eepromId = SETTINGS_PARAM_ID (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN)};
+}
+
+//A control channel of 0 means the control uses the global channel
+constexpr ParamSchema paramSchemaChannelControl (uint8_t cat)
+{
+  return {"Channel", .minVal = 0, .maxVal = 16, .defaultValue = 0, .eepromId = SETTINGS_PARAM_ID (cat, PARAM_INDEX_MIDI_CHAN)};
+}
 
-  ParamData paramData[SETTINGS_MAX_NUM_PARAMS];
+constexpr ParamSchema paramSchemaPrgmStartNumber (uint8_t cat)
+{
+  return {"1st Prgm", .minVal = 0, .maxVal = 127, .defaultValue = 0, .eepromId = SETTINGS_PARAM_ID (cat, PARAM_INDEX_START_NUM)};
+}
+
+//Knob CCs default to 1-8, as these are the CCs that Turnado sends for its knobs (see ProcessMidiControlChange()).
+//The remaining controls default to the CCs following these.
+constexpr ParamSchema paramSchemaCcNumber (uint8_t cat, uint8_t defaultCcNum)
+{
+  return {"CC Num", .minVal = 0, .maxVal = 127, .defaultValue = defaultCcNum, .eepromId = SETTINGS_PARAM_ID (cat, PARAM_INDEX_CC_NUM)};
+}
+
+constexpr ParamSchema paramSchemaMsgTypeContinuous (uint8_t cat)
+{
+  return {"Msg Type", .minVal = 0, .maxVal = NUM_OF_CONTINUOUS_MSG_TYPES - 1, .defaultValue = MSG_TYPE_CC, .eepromId = SETTINGS_PARAM_ID (cat, PARAM_INDEX_MSG_TYPE)};
+}
+
+constexpr ParamSchema paramSchemaMsgTypeTrigger (uint8_t cat)
+{
+  return {"Msg Type", .minVal = 0, .maxVal = NUM_OF_TRIGGER_MSG_TYPES - 1, .defaultValue = MSG_TYPE_CC_PAIR, .eepromId = SETTINGS_PARAM_ID (cat, PARAM_INDEX_MSG_TYPE)};
+}
+
+constexpr ParamSchema paramSchemaModSync()
+{
+  return {"Mod Sync", .minVal = 0, .maxVal = NUM_OF_MOD_SYNC_MODES - 1, .defaultValue = MOD_SYNC_OFF, .eepromId = SETTINGS_PARAM_ID (SETTINGS_GLOBAL, PARAM_INDEX_MOD_SYNC)};
+}
+
+constexpr ParamSchema paramSchemaModSource (uint8_t cat)
+{
+  return {"Mod Src", .minVal = 0, .maxVal = NUM_OF_MOD_SOURCES - 1, .defaultValue = MOD_SOURCE_OFF, .eepromId = SETTINGS_PARAM_ID (cat, PARAM_INDEX_MOD_SOURCE)};
+}
+
+constexpr ParamSchema paramSchemaModRate (uint8_t cat)
+{
+  return {"Mod Rate", .minVal = 0, .maxVal = 127, .defaultValue = 64, .eepromId = SETTINGS_PARAM_ID (cat, PARAM_INDEX_MOD_RATE)};
+}
+
+constexpr ParamSchema paramSchemaModDepth (uint8_t cat)
+{
+  return {"Mod Depth", .minVal = 0, .maxVal = 127, .defaultValue = 64, .eepromId = SETTINGS_PARAM_ID (cat, PARAM_INDEX_MOD_DEPTH)};
+}
+
+constexpr ParamSchema settingsParamSchema[SETTINGS_NUM_OF_PARAMS] =
+{
+  paramSchemaChannelGlobal(),
+  paramSchemaModSync(),
+
+  paramSchemaChannelControl (SETTINGS_KNOB_1),
+  paramSchemaCcNumber (SETTINGS_KNOB_1, 1),
+  paramSchemaMsgTypeContinuous (SETTINGS_KNOB_1),
+  paramSchemaModSource (SETTINGS_KNOB_1),
+  paramSchemaModRate (SETTINGS_KNOB_1),
+  paramSchemaModDepth (SETTINGS_KNOB_1),
+
+  paramSchemaChannelControl (SETTINGS_KNOB_2),
+  paramSchemaCcNumber (SETTINGS_KNOB_2, 2),
+  paramSchemaMsgTypeContinuous (SETTINGS_KNOB_2),
+  paramSchemaModSource (SETTINGS_KNOB_2),
+  paramSchemaModRate (SETTINGS_KNOB_2),
+  paramSchemaModDepth (SETTINGS_KNOB_2),
+
+  paramSchemaChannelControl (SETTINGS_KNOB_3),
+  paramSchemaCcNumber (SETTINGS_KNOB_3, 3),
+  paramSchemaMsgTypeContinuous (SETTINGS_KNOB_3),
+  paramSchemaModSource (SETTINGS_KNOB_3),
+  paramSchemaModRate (SETTINGS_KNOB_3),
+  paramSchemaModDepth (SETTINGS_KNOB_3),
+
+  paramSchemaChannelControl (SETTINGS_KNOB_4),
+  paramSchemaCcNumber (SETTINGS_KNOB_4, 4),
+  paramSchemaMsgTypeContinuous (SETTINGS_KNOB_4),
+  paramSchemaModSource (SETTINGS_KNOB_4),
+  paramSchemaModRate (SETTINGS_KNOB_4),
+  paramSchemaModDepth (SETTINGS_KNOB_4),
+
+  paramSchemaChannelControl (SETTINGS_KNOB_5),
+  paramSchemaCcNumber (SETTINGS_KNOB_5, 5),
+  paramSchemaMsgTypeContinuous (SETTINGS_KNOB_5),
+  paramSchemaModSource (SETTINGS_KNOB_5),
+  paramSchemaModRate (SETTINGS_KNOB_5),
+  paramSchemaModDepth (SETTINGS_KNOB_5),
+
+  paramSchemaChannelControl (SETTINGS_KNOB_6),
+  paramSchemaCcNumber (SETTINGS_KNOB_6, 6),
+  paramSchemaMsgTypeContinuous (SETTINGS_KNOB_6),
+  paramSchemaModSource (SETTINGS_KNOB_6),
+  paramSchemaModRate (SETTINGS_KNOB_6),
+  paramSchemaModDepth (SETTINGS_KNOB_6),
+
+  paramSchemaChannelControl (SETTINGS_KNOB_7),
+  paramSchemaCcNumber (SETTINGS_KNOB_7, 7),
+  paramSchemaMsgTypeContinuous (SETTINGS_KNOB_7),
+  paramSchemaModSource (SETTINGS_KNOB_7),
+  paramSchemaModRate (SETTINGS_KNOB_7),
+  paramSchemaModDepth (SETTINGS_KNOB_7),
+
+  paramSchemaChannelControl (SETTINGS_KNOB_8),
+  paramSchemaCcNumber (SETTINGS_KNOB_8, 8),
+  paramSchemaMsgTypeContinuous (SETTINGS_KNOB_8),
+  paramSchemaModSource (SETTINGS_KNOB_8),
+  paramSchemaModRate (SETTINGS_KNOB_8),
+  paramSchemaModDepth (SETTINGS_KNOB_8),
+
+  paramSchemaChannelControl (SETTINGS_DICTATOR),
+  paramSchemaCcNumber (SETTINGS_DICTATOR, 9),
+  paramSchemaMsgTypeContinuous (SETTINGS_DICTATOR),
+  paramSchemaModSource (SETTINGS_DICTATOR),
+  paramSchemaModRate (SETTINGS_DICTATOR),
+  paramSchemaModDepth (SETTINGS_DICTATOR),
+
+  paramSchemaChannelControl (SETTINGS_MIX),
+  paramSchemaCcNumber (SETTINGS_MIX, 10),
+  paramSchemaMsgTypeContinuous (SETTINGS_MIX),
+
+  paramSchemaChannelControl (SETTINGS_RANDOMISE),
+  paramSchemaCcNumber (SETTINGS_RANDOMISE, 11),
+  paramSchemaMsgTypeTrigger (SETTINGS_RANDOMISE),
+
+  paramSchemaChannelControl (SETTINGS_PRESET),
+  paramSchemaPrgmStartNumber (SETTINGS_PRESET),
 };
 
-SettingsCategoryData settingsData[SETTINGS_NUM_OF_CATS] =
+constexpr SettingsCategorySchema settingsCategorySchema[SETTINGS_NUM_OF_CATS] =
 {
-  {
-    "Global",
-    .numOfParams = 1,
-    {
-      paramDataTemplateChannelGlobal
-    },
-  },
+  {"Global", .numOfParams = 2, .firstParam = 0},
+  {"Knob1", .numOfParams = 6, .firstParam = 2},
+  {"Knob2", .numOfParams = 6, .firstParam = 8},
+  {"Knob3", .numOfParams = 6, .firstParam = 14},
+  {"Knob4", .numOfParams = 6, .firstParam = 20},
+  {"Knob5", .numOfParams = 6, .firstParam = 26},
+  {"Knob6", .numOfParams = 6, .firstParam = 32},
+  {"Knob7", .numOfParams = 6, .firstParam = 38},
+  {"Knob8", .numOfParams = 6, .firstParam = 44},
+  {"Dictator", .numOfParams = 6, .firstParam = 50},
+  {"Mix", .numOfParams = 3, .firstParam = 56},
+  {"Random", .numOfParams = 3, .firstParam = 59},
+  {"Preset", .numOfParams = 2, .firstParam = 62},
+};
 
-  {
-    "Knob1",
-    .numOfParams = 2,
-    {
-      paramDataTemplateChannelControl,
-      paramDataTemplateCcNumber,
-    },
-  },
+constexpr bool settingsSchemaIsValid()
+{
+  //every category's params must directly follow the previous category's, and have the IDs of their position
+  uint8_t index = 0;
 
+  for (uint8_t cat = 0; cat < SETTINGS_NUM_OF_CATS; cat++)
   {
-    "Knob2",
-    .numOfParams = 2,
-    {
-      paramDataTemplateChannelControl,
-      paramDataTemplateCcNumber,
-    },
-  },
+    if (settingsCategorySchema[cat].firstParam != index || settingsCategorySchema[cat].numOfParams > SETTINGS_MAX_NUM_PARAMS)
+      return false;
 
-  {
-    "Knob3",
-    .numOfParams = 2,
+    for (uint8_t param = 0; param < settingsCategorySchema[cat].numOfParams; param++)
     {
-      paramDataTemplateChannelControl,
-      paramDataTemplateCcNumber,
-    },
-  },
+      if (settingsParamSchema[index++].eepromId != SETTINGS_PARAM_ID (cat, param))
+        return false;
+    }
+  }
 
-  {
-    "Knob4",
-    .numOfParams = 2,
-    {
-      paramDataTemplateChannelControl,
-      paramDataTemplateCcNumber,
-    },
-  },
-  {
-    "Knob5",
-    .numOfParams = 2,
-    {
-      paramDataTemplateChannelControl,
-      paramDataTemplateCcNumber,
-    },
-  },
+  return index == SETTINGS_NUM_OF_PARAMS;
+}
 
-  {
-    "Knob6",
-    .numOfParams = 2,
-    {
-      paramDataTemplateChannelControl,
-      paramDataTemplateCcNumber,
-    },
-  },
+static_assert (settingsSchemaIsValid(), "Settings schema categories don't match the param list");
 
-  {
-    "Knob7",
-    .numOfParams = 2,
-    {
-      paramDataTemplateChannelControl,
-      paramDataTemplateCcNumber,
-    },
-  },
+//=========================================================================
+//Settings values (in RAM)
 
-  {
-    "Knob8",
-    .numOfParams = 2,
-    {
-      paramDataTemplateChannelControl,
-      paramDataTemplateCcNumber,
-    },
-  },
+uint8_t settingsValues[SETTINGS_NUM_OF_PARAMS];
+uint64_t settingsDirtyMask = 0; //a bit for each param value that has changed since it was last saved to EEPROM
 
-  {
-    "Dictator",
-    .numOfParams = 2,
-    {
-      paramDataTemplateChannelControl,
-      paramDataTemplateCcNumber,
-    },
-  },
+//=========================================================================
+void messageMapInvalidate();
 
-  {
-    "Mix",
-    .numOfParams = 2,
-    {
-      paramDataTemplateChannelControl,
-      paramDataTemplateCcNumber,
-    },
-  },
+//=========================================================================
+//=========================================================================
+//=========================================================================
+inline uint8_t settingsGetParamIndex (uint8_t cat, uint8_t param)
+{
+  return settingsCategorySchema[cat].firstParam + param;
+}
 
-  {
-    "Random",
-    .numOfParams = 2,
-    {
-      paramDataTemplateChannelControl,
-      paramDataTemplateCcNumber,
-    },
-  },
+//=========================================================================
+//=========================================================================
+//=========================================================================
+inline const ParamSchema& settingsGetParamSchema (uint8_t cat, uint8_t param)
+{
+  return settingsParamSchema[settingsGetParamIndex (cat, param)];
+}
 
+//=========================================================================
+//=========================================================================
+//=========================================================================
+inline uint8_t settingsGetValue (uint8_t cat, uint8_t param)
+{
+  return settingsValues[settingsGetParamIndex (cat, param)];
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void settingsSetValueAtIndex (uint8_t index, uint8_t value)
+{
+  //Sets a param value, flagging it to be saved to EEPROM if it has changed
+  if (settingsValues[index] != value)
   {
-    "Preset",
-    .numOfParams = 2,
-    {
-      paramDataTemplateChannelControl,
-      paramDataTemplatePrgmStartNumber,
-    },
-  },
+    settingsValues[index] = value;
+    settingsDirtyMask |= (1ULL << index);
 
-};
+    messageMapInvalidate();
+  }
+}
 
-long updateEepromTime = 0;
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void settingsSetValue (uint8_t cat, uint8_t param, uint8_t value)
+{
+  settingsSetValueAtIndex (settingsGetParamIndex (cat, param), value);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void settingsLoadDefaults()
+{
+  for (uint8_t i = 0; i < SETTINGS_NUM_OF_PARAMS; i++)
+    settingsValues[i] = settingsParamSchema[i].defaultValue;
+
+  settingsDirtyMask = 0;
+}
+
+uint32_t updateEepromTime = 0; //in microseconds
+bool settingsSaveRequested = false;
+
+//=========================================================================
+#include "Presets.h"
+#include "JoystickCalibration.h"
+#include "SettingsJournal.h"
+
+uint8_t settingsLoadSource = SETTINGS_LOADED_DEFAULTS;
+uint32_t settingsLoadTime = 0; //time taken to load and validate settings at boot, in microseconds
 
 //=========================================================================
 void settingsLoadAllFromEeprom();
+bool settingsLoadLegacyLayoutFromEeprom();
 void settingsClearEeprom();
 void settingsSaveToEeprom (bool deltaSave);
 
@@ -185,62 +374,64 @@ void settingsSaveToEeprom (bool deltaSave);
 //=========================================================================
 void setupSettings()
 {
-  //TODO: set param default values in settingsData
-
+  //Start with the default param values, which are kept for any
+  //param values that can't be loaded from EEPROM.
+  settingsLoadDefaults();
+  joystickCalibrationLoadDefaults();
   settingsLoadAllFromEeprom();
+
+  TRACE (TRACE_PRESETS_LOAD, presetsNumOfPresets, 0, presetsGetTotalEncodedSize());
 }
 
 //=========================================================================
 //=========================================================================
 //=========================================================================
-void settingsUpdateEeprom()
+uint8_t settingsGetMidiChannel (uint8_t cat)
 {
-  //Only save settings to EEPROM at certain time intervals (rather than directly after each value change)
-  //to prevent the number of writes to EEPROM (which there is a limited number of)
-  if ((millis() - updateEepromTime) > 5000)
-  {
-    settingsSaveToEeprom (true);
-    updateEepromTime = millis();
+  //Returns the MIDI channel used by a control, where a control channel of 0 means use the global channel
+  uint8_t channel = settingsGetValue (cat, PARAM_INDEX_MIDI_CHAN);
 
-  } //if ((millis() - updateEepromTime) > 5000)
+  if (channel == 0)
+    channel = settingsGetValue (SETTINGS_GLOBAL, PARAM_INDEX_MIDI_CHAN);
 
+  return channel;
 }
 
 //=========================================================================
 //=========================================================================
 //=========================================================================
-void settingsSaveToEeprom (bool deltaSave)
+void settingsUpdateEeprom (uint32_t tickTime)
 {
-  for (auto cat = 0; cat < SETTINGS_NUM_OF_CATS; cat++)
-  {
-    for (auto param = 0; param < settingsData[cat].numOfParams; param++)
-    {
-      //if the param value needs saving (it has recently changed), or we want to do a full save
-      if (settingsData[cat].paramData[param].needsSavingToEeprom || !deltaSave)
-      {
-        //Write the param value to EEPROM
-        EEPROM.write ((cat * SETTINGS_MAX_NUM_PARAMS) + param, settingsData[cat].paramData[param].value);
+  PROFILE_SCOPE (PROFILE_TASK_EEPROM);
 
-#ifdef DEBUG
-        Serial.print ("Writing to EEPROM: ");
-        Serial.print (settingsData[cat].name);
-        Serial.print (" ");
-        Serial.print (settingsData[cat].paramData[param].name);
-        Serial.print (" ");
-        Serial.print (settingsData[cat].paramData[param].value);
-        Serial.print (" (Address ");
-        Serial.print ((cat * SETTINGS_MAX_NUM_PARAMS) + param);
-        Serial.println (")");
-#endif
+  //Only start saving changed settings to EEPROM at certain time intervals (rather than directly after each value change)
+  //to prevent the number of writes to EEPROM (which there is a limited number of)
+  if ((tickTime - updateEepromTime) > 5000000)
+  {
+    if (settingsDirtyMask)
+      settingsSaveRequested = true;
 
-        //flag that the param value has been saved
-        settingsData[cat].paramData[param].needsSavingToEeprom = false;
+    updateEepromTime = tickTime;
 
-      } //if (settingsData[cat].paramData[param].needsSavingToEeprom || !deltaSave)
+  } //if ((tickTime - updateEepromTime) > 5000000)
 
-    } //for (auto param = 0; param < settingsData[cat].numOfParams; param++)
+  //Any queued writing is done a step at a time, so that it doesn't stall the controls
+  if (!settingsJournalWriteStep (settingsSaveRequested))
+    settingsSaveRequested = false;
+}
 
-  } //for (auto cat = 0; cat < SETTINGS_NUM_OF_CATS; cat++)
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void settingsSaveToEeprom (bool deltaSave)
+{
+  //Queues the saving of settings, which is then written by settingsUpdateEeprom().
+  //A delta save writes the params that have changed, whereas a full save is just a compaction
+  //of the journal, which writes the current value of every param.
+  if (deltaSave)
+    settingsSaveRequested = true;
+  else
+    settingsJournalRequestCompaction();
 }
 
 //=========================================================================
@@ -248,39 +439,74 @@ void settingsSaveToEeprom (bool deltaSave)
 //=========================================================================
 void settingsLoadAllFromEeprom()
 {
-#ifdef DEBUG
-  Serial.println ("Settings loaded from EEPROM: ");
-#endif
+  uint32_t loadStartTime = micros();
 
-  for (auto cat = 0; cat < SETTINGS_NUM_OF_CATS; cat++)
+  //If there is no valid settings journal in EEPROM the settings may be stored using the original fixed layout,
+  //otherwise (e.g. on a new unit) the default param values are kept.
+  if (!settingsJournalLoad (settingsLoadSource))
   {
-#ifdef DEBUG
-    Serial.print (settingsData[cat].name);
-    Serial.print (" - ");
-#endif
+    if (settingsLoadLegacyLayoutFromEeprom())
+      settingsLoadSource = SETTINGS_MIGRATED_FROM_LAYOUT_VERSION_0;
+    else
+      settingsLoadSource = SETTINGS_LOADED_DEFAULTS;
+  }
 
-    for (auto param = 0; param < settingsData[cat].numOfParams; param++)
-    {
-      //Load the param value from EEPROM
-      settingsData[cat].paramData[param].value = EEPROM.read ((cat * SETTINGS_MAX_NUM_PARAMS) + param);
+  settingsLoadTime = micros() - loadStartTime;
 
-#ifdef DEBUG
-      Serial.print (settingsData[cat].paramData[param].name);
-      Serial.print (": ");
-      Serial.print (settingsData[cat].paramData[param].value);
-      Serial.print (", ");
-#endif
-    } //for (auto param = 0; param < settingsData[cat].numOfParams; param++)
+  //Write settings that didn't come from a current layout image into one
+  if (settingsLoadSource != SETTINGS_LOADED_FROM_IMAGE)
+    settingsJournalCompact();
+
+  //(traced rather than printed, so that loading doesn't wait on USB serial - see Trace.h)
+  TRACE (TRACE_SETTINGS_LOAD, settingsLoadSource, 0, settingsLoadTime);
 
 #ifdef DEBUG
-    Serial.println ();
+  for (auto cat = 0; cat < SETTINGS_NUM_OF_CATS; cat++)
+  {
+    for (auto param = 0; param < settingsCategorySchema[cat].numOfParams; param++)
+      TRACE (TRACE_SETTINGS_VALUE, cat, param, settingsGetValue (cat, param));
+  }
 #endif
+}
 
-  } //for (auto cat = 0; cat < SETTINGS_NUM_OF_CATS; cat++)
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool settingsLoadLegacyLayoutFromEeprom()
+{
+  //The original layout stored each param value at a fixed address of (cat * SETTINGS_MAX_NUM_PARAMS) + param
+  uint8_t legacyData[SETTINGS_NUM_OF_CATS * SETTINGS_MAX_NUM_PARAMS];
+  eeprom_read_block (legacyData, (const void*)0, sizeof (legacyData));
 
-#ifdef DEBUG
-  Serial.println ();
-#endif
+  //An EEPROM that is all 0xFF (new) or all 0 (cleared) has never had settings saved to it
+  bool isBlank = true;
+
+  for (uint16_t i = 1; i < sizeof (legacyData) && isBlank; i++)
+    isBlank = (legacyData[i] == legacyData[0]);
+
+  if (isBlank && (legacyData[0] == 0xFF || legacyData[0] == 0))
+    return false;
+
+  //The unused address 1 holds a journal magic byte if this is actually a corrupted journal bank
+  if (legacyData[1] == JOURNAL_MAGIC_1)
+    return false;
+
+  for (uint8_t i = 0; i < SETTINGS_NUM_OF_PARAMS; i++)
+  {
+    uint8_t id = settingsParamSchema[i].eepromId;
+
+    //params added since the original layout keep their default value
+    if (id % SETTINGS_MAX_NUM_PARAMS >= settingsLayoutVersion0CatNumOfParams[id / SETTINGS_MAX_NUM_PARAMS])
+      continue;
+
+    uint8_t value = legacyData[id];
+
+    //keep the default value for anything out of range
+    if (settingsIsParamValueValid (i, value))
+      settingsValues[i] = value;
+  }
+
+  return true;
 }
 
 //=========================================================================
@@ -0,0 +1,512 @@
+//=========================================================================
+//Wear-levelled storage of settings in EEPROM.
+//
+//Settings are stored in one of two banks, where each bank starts with a CRC-protected image of all param values
+//and presets, followed by a journal of (param ID, value) records. Changed values are appended to the end of the
+//active bank's journal, so that repeated changes to the same param (e.g. the global MIDI channel) are spread across
+//the whole bank rather than wearing out a single EEPROM cell. When the active bank is full (or the presets change),
+//a new image of the current settings is written to the other bank (compaction), which then becomes the active bank.
+//
+//Bank layout (layout version 1):
+//  [magic 0][magic 1][generation][layout version][value 0]...[value n]
+//  [num of presets][preset data length lo][preset data length hi][joystick calibration...]
+//  [preset data...][CRC lo][CRC hi]
+//  [ID][value] [ID][value] ... [0xFF (empty)]
+//
+//A record's value is written before its ID, and a compacted bank's magic is written after the rest of the bank,
+//so an interrupted write only ever loses the record or compaction that was in progress. Writing is done a byte
+//at a time from the main loop (see settingsJournalWriteStep()), so that it never stalls the controls for long.
+//
+//Settings in the original layout (version 0), which has no banks and stores each value at a fixed address
+//of (cat * SETTINGS_MAX_NUM_PARAMS) + param, are migrated at boot.
+
+#define EEPROM_JOURNAL_START_ADDR 0
+#define EEPROM_JOURNAL_SIZE (E2END + 1)
+
+#define JOURNAL_NUM_OF_BANKS 2
+#define JOURNAL_BANK_SIZE (EEPROM_JOURNAL_SIZE / JOURNAL_NUM_OF_BANKS)
+#define JOURNAL_RECORD_SIZE 2
+#define JOURNAL_READ_CHUNK_SIZE 64
+#define JOURNAL_ERASE_SCAN_SIZE 64 //max number of cells checked for erasing per write step
+
+#define JOURNAL_MAGIC_0 'T'
+#define JOURNAL_MAGIC_1 'j'
+#define JOURNAL_EMPTY_ID 0xFF
+
+#define SETTINGS_LAYOUT_VERSION 1
+
+struct __attribute__((packed)) SettingsImageHeader
+{
+  uint8_t magic[2];
+  uint8_t generation;
+  uint8_t layoutVersion;
+  uint8_t values[SETTINGS_NUM_OF_PARAMS]; //in settingsParamSchema order
+  uint8_t numOfPresets;
+  uint8_t presetDataLength[2];
+  uint8_t joystickCalibration[JOYSTICK_CALIBRATION_STORE_SIZE];
+};
+
+#define SETTINGS_IMAGE_CRC_START 2 //the CRC covers everything after the magic
+#define SETTINGS_IMAGE_CRC_SIZE 2
+
+static_assert (sizeof (SettingsImageHeader) + PRESETS_STORE_SIZE + SETTINGS_IMAGE_CRC_SIZE < JOURNAL_BANK_SIZE / 2,
+               "Settings image leaves too little room in a bank for the journal");
+
+enum SettingsLoadSources
+{
+  SETTINGS_LOADED_FROM_IMAGE = 0,
+  SETTINGS_MIGRATED_FROM_LAYOUT_VERSION_0,
+  SETTINGS_LOADED_DEFAULTS,
+  SETTINGS_RECOVERED_FROM_PREVIOUS_IMAGE
+};
+
+enum JournalWriterStates
+{
+  JOURNAL_WRITER_IDLE = 0,
+  JOURNAL_WRITER_RECORD_VALUE,
+  JOURNAL_WRITER_RECORD_ID,
+  JOURNAL_WRITER_COMPACT_INVALIDATE,
+  JOURNAL_WRITER_COMPACT_ERASE,
+  JOURNAL_WRITER_COMPACT_IMAGE,
+  JOURNAL_WRITER_COMPACT_MAGIC_1,
+  JOURNAL_WRITER_COMPACT_MAGIC_0,
+  JOURNAL_WRITER_COMPACT_RETIRE
+};
+
+uint8_t journalActiveBank = 0;
+uint8_t journalGeneration = 0;
+uint16_t journalWritePos = sizeof (SettingsImageHeader);
+
+//write scheduler state
+uint8_t journalWriterState = JOURNAL_WRITER_IDLE;
+bool journalCompactionRequested = false;
+uint8_t journalRecordIndex = 0;
+uint8_t journalRecordValue = 0;
+uint8_t journalCompactBank = 0;
+uint16_t journalCompactPos = 0;
+uint16_t journalCompactCrcPos = 0;
+uint16_t journalCompactImageSize = 0;
+uint16_t journalCompactCrc = 0;
+SettingsImageHeader journalCompactHeader;
+
+//usage stats
+uint32_t journalNumOfRecordWrites = 0;
+uint16_t journalNumOfCompactions = 0;
+uint32_t journalNumOfWriteSteps = 0;
+uint32_t journalMaxWriteStepTime = 0; //worst case time taken by a single write step, in microseconds
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+uint16_t settingsJournalBankAddr (uint8_t bank)
+{
+  return EEPROM_JOURNAL_START_ADDR + (bank * JOURNAL_BANK_SIZE);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+uint16_t settingsCrc16 (uint16_t crc, const uint8_t *data, uint16_t length)
+{
+  //CRC-16/CCITT-FALSE (start with a crc of 0xFFFF)
+  for (uint16_t i = 0; i < length; i++)
+  {
+    crc ^= (uint16_t)data[i] << 8;
+
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+  }
+
+  return crc;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool settingsIsParamValueValid (uint8_t index, uint8_t value)
+{
+  return (value >= settingsParamSchema[index].minVal &&
+          value <= settingsParamSchema[index].maxVal);
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool settingsJournalApplyRecord (uint8_t id, uint8_t value)
+{
+  uint8_t cat = id / SETTINGS_MAX_NUM_PARAMS;
+  uint8_t param = id % SETTINGS_MAX_NUM_PARAMS;
+
+  if (cat >= SETTINGS_NUM_OF_CATS || param >= settingsCategorySchema[cat].numOfParams)
+    return false;
+
+  uint8_t index = settingsGetParamIndex (cat, param);
+
+  if (!settingsIsParamValueValid (index, value))
+    return false;
+
+  settingsValues[index] = value;
+  return true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void settingsJournalReplay (uint16_t bankAddr, uint16_t startPos)
+{
+  //Replay every record in a single pass, reading the bank in chunks - later records overwrite earlier ones.
+  uint8_t chunk[JOURNAL_READ_CHUNK_SIZE];
+
+  journalWritePos = startPos;
+
+  while (journalWritePos + JOURNAL_RECORD_SIZE <= JOURNAL_BANK_SIZE)
+  {
+    uint16_t chunkLength = min ((uint16_t)JOURNAL_READ_CHUNK_SIZE, (uint16_t)(JOURNAL_BANK_SIZE - journalWritePos));
+    chunkLength -= chunkLength % JOURNAL_RECORD_SIZE;
+
+    eeprom_read_block (chunk, (const void*)(uintptr_t)(bankAddr + journalWritePos), chunkLength);
+
+    for (uint16_t i = 0; i < chunkLength; i += JOURNAL_RECORD_SIZE)
+    {
+      if (chunk[i] == JOURNAL_EMPTY_ID)
+        return;
+
+      settingsJournalApplyRecord (chunk[i], chunk[i + 1]);
+      journalWritePos += JOURNAL_RECORD_SIZE;
+    }
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool settingsImageLoad (uint8_t bank, bool allowRetired, uint8_t &loadSource)
+{
+  //Reads and validates the image of a bank, and if valid loads the settings from it (including its journal).
+
+  uint16_t bankAddr = settingsJournalBankAddr (bank);
+
+  SettingsImageHeader header;
+  eeprom_read_block (&header, (const void*)(uintptr_t)bankAddr, sizeof (SettingsImageHeader));
+
+  //A bank that has been retired after a compaction only has its first magic byte erased,
+  //and still holds the settings as they were at the time of the compaction.
+  bool magicValid = (header.magic[0] == JOURNAL_MAGIC_0 || (allowRetired && header.magic[0] == JOURNAL_EMPTY_ID));
+
+  if (!magicValid || header.magic[1] != JOURNAL_MAGIC_1)
+    return false;
+
+  if (header.layoutVersion != SETTINGS_LAYOUT_VERSION)
+    return false;
+
+  uint16_t presetDataLength = header.presetDataLength[0] | (header.presetDataLength[1] << 8);
+
+  if (presetDataLength > PRESETS_STORE_SIZE)
+    return false;
+
+  eeprom_read_block (presetsStoreBuffer, (const void*)(uintptr_t)(bankAddr + sizeof (SettingsImageHeader)), presetDataLength);
+
+  uint16_t crc = settingsCrc16 (0xFFFF, (const uint8_t*)&header + SETTINGS_IMAGE_CRC_START, sizeof (SettingsImageHeader) - SETTINGS_IMAGE_CRC_START);
+  crc = settingsCrc16 (crc, presetsStoreBuffer, presetDataLength);
+  uint16_t storedCrcPos = sizeof (SettingsImageHeader) + presetDataLength;
+
+  uint16_t storedCrc = EEPROM.read (bankAddr + storedCrcPos) | (EEPROM.read (bankAddr + storedCrcPos + 1) << 8);
+
+  if (crc != storedCrc)
+    return false;
+
+  //The image is valid, so load it...
+
+  for (uint8_t i = 0; i < SETTINGS_NUM_OF_PARAMS; i++)
+  {
+    //keep the default value for anything out of range
+    if (settingsIsParamValueValid (i, header.values[i]))
+      settingsValues[i] = header.values[i];
+  }
+
+  if (presetDataLength > 0)
+    presetsLoad (presetsStoreBuffer, presetDataLength, header.numOfPresets);
+
+  joystickCalibrationDecode (header.joystickCalibration);
+
+  journalActiveBank = bank;
+  journalGeneration = header.generation;
+  settingsJournalReplay (bankAddr, storedCrcPos + SETTINGS_IMAGE_CRC_SIZE);
+
+  loadSource = allowRetired ? SETTINGS_RECOVERED_FROM_PREVIOUS_IMAGE : SETTINGS_LOADED_FROM_IMAGE;
+
+  return true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool settingsJournalLoad (uint8_t &loadSource)
+{
+  //Try each bank, newest first. If both banks are valid a compaction was interrupted after the new bank was committed,
+  //and if neither is valid the active bank has been corrupted, so fall back to the settings of the last compaction.
+
+  uint8_t gen0 = EEPROM.read (settingsJournalBankAddr (0) + offsetof (SettingsImageHeader, generation));
+  uint8_t gen1 = EEPROM.read (settingsJournalBankAddr (1) + offsetof (SettingsImageHeader, generation));
+
+  //generations wrap around, so compare using the signed difference
+  uint8_t newestBank = ((int8_t)(gen1 - gen0) > 0) ? 1 : 0;
+
+  for (uint8_t allowRetired = 0; allowRetired <= 1; allowRetired++)
+  {
+    for (uint8_t i = 0; i < JOURNAL_NUM_OF_BANKS; i++)
+    {
+      if (settingsImageLoad ((newestBank + i) % JOURNAL_NUM_OF_BANKS, allowRetired, loadSource))
+      {
+        TRACE (TRACE_JOURNAL_MOUNT, journalActiveBank, 0, journalGeneration);
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void settingsJournalRequestCompaction()
+{
+  journalCompactionRequested = true;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void settingsJournalStartCompaction()
+{
+  //Builds the image of the current settings in RAM, to be written to the other bank by the following write steps.
+  //The image holds the current value of every param, so nothing is left to append to the journal.
+
+  journalCompactBank = (journalActiveBank + 1) % JOURNAL_NUM_OF_BANKS;
+
+  journalCompactHeader.magic[0] = JOURNAL_MAGIC_0;
+  journalCompactHeader.magic[1] = JOURNAL_MAGIC_1;
+  journalCompactHeader.generation = journalGeneration + 1;
+  journalCompactHeader.layoutVersion = SETTINGS_LAYOUT_VERSION;
+
+  //the settings and presets are changed by the controls in the realtime timer interrupt, so are copied with
+  //interrupts disabled to get a consistent image (and to not lose a param that is made dirty while copying)
+  noInterrupts();
+
+  memcpy (journalCompactHeader.values, settingsValues, SETTINGS_NUM_OF_PARAMS);
+  settingsDirtyMask = 0;
+
+  //presetsStoreBuffer holds the image's preset data until the compaction has completed
+  uint16_t presetDataLength = presetsStoreLength;
+  memcpy (presetsStoreBuffer, presetsStore, presetDataLength);
+
+  interrupts();
+
+  joystickCalibrationEncode (journalCompactHeader.joystickCalibration);
+  journalCompactHeader.numOfPresets = presetsNumOfPresets;
+  journalCompactHeader.presetDataLength[0] = presetDataLength & 0xFF;
+  journalCompactHeader.presetDataLength[1] = presetDataLength >> 8;
+
+  journalCompactCrc = settingsCrc16 (0xFFFF, (const uint8_t*)&journalCompactHeader + SETTINGS_IMAGE_CRC_START, sizeof (SettingsImageHeader) - SETTINGS_IMAGE_CRC_START);
+  journalCompactCrc = settingsCrc16 (journalCompactCrc, presetsStoreBuffer, presetDataLength);
+
+  journalCompactCrcPos = sizeof (SettingsImageHeader) + presetDataLength;
+  journalCompactImageSize = journalCompactCrcPos + SETTINGS_IMAGE_CRC_SIZE;
+
+  journalCompactionRequested = false;
+  journalWriterState = JOURNAL_WRITER_COMPACT_INVALIDATE;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+uint8_t settingsJournalGetCompactImageByte (uint16_t pos)
+{
+  if (pos < sizeof (SettingsImageHeader))
+    return ((const uint8_t*)&journalCompactHeader)[pos];
+  else if (pos < journalCompactCrcPos)
+    return presetsStoreBuffer[pos - sizeof (SettingsImageHeader)];
+  else if (pos == journalCompactCrcPos)
+    return journalCompactCrc & 0xFF;
+  else
+    return journalCompactCrc >> 8;
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+bool settingsJournalWriteStep (bool saveDirtyParams)
+{
+  //Does the next step of any pending EEPROM writing, where each step writes at most one EEPROM byte (as each write
+  //can block for milliseconds). The steps follow the same order as a single blocking write would, so the EEPROM
+  //is just as safe to lose power part way through - the active bank stays valid until the new one is committed.
+  //
+  //The dirty mask is the queue of params to append to the journal, so a param that changes again before
+  //it's written is still only written once. Params are only appended if saveDirtyParams is set.
+  //Returns true if there is more writing pending.
+
+  uint32_t stepStartTime = micros();
+
+  if (journalWriterState == JOURNAL_WRITER_IDLE)
+  {
+    if (journalCompactionRequested)
+    {
+      settingsJournalStartCompaction();
+    }
+    else if (settingsDirtyMask && saveDirtyParams)
+    {
+      //The compacted bank will contain the current value of every param
+      if (journalWritePos + JOURNAL_RECORD_SIZE > JOURNAL_BANK_SIZE)
+      {
+        settingsJournalStartCompaction();
+      }
+      else
+      {
+        //(the 64-bit mask can't be changed atomically, and may be changed by the realtime timer interrupt)
+        noInterrupts();
+        journalRecordIndex = __builtin_ctzll (settingsDirtyMask);
+        settingsDirtyMask &= ~(1ULL << journalRecordIndex);
+        journalRecordValue = settingsValues[journalRecordIndex];
+        interrupts();
+        journalWriterState = JOURNAL_WRITER_RECORD_VALUE;
+      }
+    }
+    else
+    {
+      return false;
+    }
+
+  } //if (journalWriterState == JOURNAL_WRITER_IDLE)
+
+  uint16_t activeBankAddr = settingsJournalBankAddr (journalActiveBank);
+  uint16_t compactBankAddr = settingsJournalBankAddr (journalCompactBank);
+
+  switch (journalWriterState)
+  {
+    case JOURNAL_WRITER_RECORD_VALUE:
+    {
+      //write the value first, so that the record only becomes valid once the ID is written
+      EEPROM.write (activeBankAddr + journalWritePos + 1, journalRecordValue);
+      journalWriterState = JOURNAL_WRITER_RECORD_ID;
+      break;
+    }
+
+    case JOURNAL_WRITER_RECORD_ID:
+    {
+      EEPROM.write (activeBankAddr + journalWritePos, settingsParamSchema[journalRecordIndex].eepromId);
+      journalWritePos += JOURNAL_RECORD_SIZE;
+      journalNumOfRecordWrites++;
+      journalWriterState = JOURNAL_WRITER_IDLE;
+
+      TRACE (TRACE_JOURNAL_WRITE, journalRecordIndex, journalRecordValue, journalWritePos);
+
+      break;
+    }
+
+    case JOURNAL_WRITER_COMPACT_INVALIDATE:
+    {
+      EEPROM.update (compactBankAddr, JOURNAL_EMPTY_ID);
+      journalCompactPos = journalCompactImageSize;
+      journalWriterState = JOURNAL_WRITER_COMPACT_ERASE;
+      break;
+    }
+
+    case JOURNAL_WRITER_COMPACT_ERASE:
+    {
+      //erase the journal, only writing to cells that aren't already erased (reading is quick)
+      uint16_t scanEnd = min ((uint16_t)(journalCompactPos + JOURNAL_ERASE_SCAN_SIZE), (uint16_t)JOURNAL_BANK_SIZE);
+
+      while (journalCompactPos < scanEnd && EEPROM.read (compactBankAddr + journalCompactPos) == JOURNAL_EMPTY_ID)
+        journalCompactPos++;
+
+      if (journalCompactPos < scanEnd)
+      {
+        EEPROM.write (compactBankAddr + journalCompactPos, JOURNAL_EMPTY_ID);
+        journalCompactPos++;
+      }
+
+      if (journalCompactPos >= JOURNAL_BANK_SIZE)
+      {
+        journalCompactPos = SETTINGS_IMAGE_CRC_START;
+        journalWriterState = JOURNAL_WRITER_COMPACT_IMAGE;
+      }
+
+      break;
+    }
+
+    case JOURNAL_WRITER_COMPACT_IMAGE:
+    {
+      //write the image minus the magic
+      EEPROM.update (compactBankAddr + journalCompactPos, settingsJournalGetCompactImageByte (journalCompactPos));
+      journalCompactPos++;
+
+      if (journalCompactPos >= journalCompactImageSize)
+        journalWriterState = JOURNAL_WRITER_COMPACT_MAGIC_1;
+
+      break;
+    }
+
+    case JOURNAL_WRITER_COMPACT_MAGIC_1:
+    {
+      EEPROM.write (compactBankAddr + 1, JOURNAL_MAGIC_1);
+      journalWriterState = JOURNAL_WRITER_COMPACT_MAGIC_0;
+      break;
+    }
+
+    case JOURNAL_WRITER_COMPACT_MAGIC_0:
+    {
+      //commits the new bank
+      EEPROM.write (compactBankAddr, JOURNAL_MAGIC_0);
+      journalWriterState = JOURNAL_WRITER_COMPACT_RETIRE;
+      break;
+    }
+
+    case JOURNAL_WRITER_COMPACT_RETIRE:
+    {
+      EEPROM.write (activeBankAddr, JOURNAL_EMPTY_ID);
+
+      journalActiveBank = journalCompactBank;
+      journalGeneration++;
+      journalWritePos = journalCompactImageSize;
+      journalNumOfRecordWrites += SETTINGS_NUM_OF_PARAMS;
+      journalNumOfCompactions++;
+      journalWriterState = JOURNAL_WRITER_IDLE;
+
+      TRACE (TRACE_JOURNAL_COMPACTION, journalActiveBank, 0, journalGeneration);
+
+      break;
+    }
+
+    default:
+    {
+      break;
+    }
+
+  } //switch (journalWriterState)
+
+  uint32_t stepTime = micros() - stepStartTime;
+  journalNumOfWriteSteps++;
+
+  if (stepTime > journalMaxWriteStepTime)
+  {
+    journalMaxWriteStepTime = stepTime;
+
+    TRACE (TRACE_JOURNAL_MAX_WRITE_STEP, 0, 0, journalMaxWriteStepTime);
+  }
+
+  return (journalWriterState != JOURNAL_WRITER_IDLE || journalCompactionRequested || (settingsDirtyMask && saveDirtyParams));
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void settingsJournalCompact()
+{
+  //Compacts the journal in one go, blocking until it is complete. Only for use at boot, before the controls are running.
+  settingsJournalRequestCompaction();
+
+  while (settingsJournalWriteStep (false))
+  {
+  }
+}
@@ -15,23 +15,38 @@ void SwitchControl::update()
 {
   switchDebouncer->update();
 
+  int8_t newSwitchState = -1;
+
   if (switchDebouncer->risingEdge())
-  {
-    switchState = 0;
-    this->handle_switch_state_change (*this);
-  }
+    newSwitchState = 0;
   else if (switchDebouncer->fallingEdge())
+    newSwitchState = 1;
+
+  if (newSwitchState >= 0)
   {
-    switchState = 1;
-    this->handle_switch_state_change (*this);
+    processSwitchState (newSwitchState);
+
+    if (this->handle_raw_input != NULL)
+      this->handle_raw_input (*this, newSwitchState);
   }
 }
 
+void SwitchControl::processSwitchState (uint8_t state)
+{
+  switchState = state;
+  this->handle_switch_state_change (*this);
+}
+
 void SwitchControl::onSwitchStateChange( void (*function)(SwitchControl&) )
 {
   this->handle_switch_state_change = function;
 }
 
+void SwitchControl::onRawInput( void (*function)(SwitchControl&, uint8_t) )
+{
+  this->handle_raw_input = function;
+}
+
 uint8_t SwitchControl::getSwitchState()
 {
   return switchState;
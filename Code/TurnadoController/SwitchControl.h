@@ -38,12 +38,24 @@ class SwitchControl
     */
     void update();
 
+    /** Processes a debounced switch state change. update() calls this when the switch changes, however
+        it can also be called directly to process recorded changes (e.g. when replaying an input trace).
+
+        @param state - The new switch state (0-1)
+    */
+    void processSwitchState (uint8_t state);
+
     /** Assigns the function you want to be called when the switch state changes.
 
          @param SwitchControl - The instance of this class that has detected a change
     */
     void onSwitchStateChange( void (*)(SwitchControl &switchControl) );
 
+    /** Assigns a function to be called with each switch state change that update() has processed,
+        e.g. for recording the input.
+    */
+    void onRawInput( void (*)(SwitchControl &switchControl, uint8_t state) );
+
     /** Returns the current state of the switch, where 1 = on/pressed and 0 = off/released
     */
     uint8_t getSwitchState();
@@ -55,6 +67,7 @@ class SwitchControl
   private:
 
     void (*handle_switch_state_change)(SwitchControl &switchControl) = NULL;
+    void (*handle_raw_input)(SwitchControl &switchControl, uint8_t state) = NULL;
 
     Bounce *switchDebouncer;
 
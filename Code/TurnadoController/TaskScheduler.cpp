@@ -0,0 +1,206 @@
+#include "TaskScheduler.h"
+
+TaskScheduler::TaskScheduler()
+{
+}
+
+int8_t TaskScheduler::addTask (const char *name, TaskFunction function, uint32_t period, uint8_t priority, uint32_t budget)
+{
+  if (numOfTasks >= MAX_NUM_OF_TASKS)
+    return -1;
+
+  //keep the tasks ordered by priority, after any tasks of the same priority
+  uint8_t index = numOfTasks;
+
+  while (index > 0 && tasks[index - 1].priority > priority)
+  {
+    tasks[index] = tasks[index - 1];
+    index--;
+  }
+
+  tasks[index].name = name;
+  tasks[index].function = function;
+  tasks[index].period = period;
+  tasks[index].budget = budget;
+  tasks[index].priority = priority;
+  tasks[index].nextRunTime = micros();
+  tasks[index].lastRunTime = tasks[index].nextRunTime;
+  tasks[index].stats = TaskStats();
+
+  numOfTasks++;
+
+  return index;
+}
+
+void TaskScheduler::tick()
+{
+  tickRealtime();
+
+  runBackgroundTask (tickTime, true);
+}
+
+void TaskScheduler::tickRealtime()
+{
+  tickTime = micros();
+
+  if (realtimeTasksSuspended)
+    return;
+
+  for (uint8_t i = 0; i < numOfTasks && tasks[i].priority == TASK_PRIORITY_REALTIME; i++)
+  {
+    Task &task = tasks[i];
+
+    //compare using the signed difference, as the time wraps around
+    if ((int32_t)(tickTime - task.nextRunTime) < 0)
+      continue;
+
+    uint32_t lateness = tickTime - task.nextRunTime;
+
+    if (lateness > task.stats.maxLateness)
+      task.stats.maxLateness = lateness;
+
+    runTask (task, tickTime);
+
+    //Schedule from when the task was due rather than when it ran, so that the rate doesn't drift.
+    //If a whole period has been missed, start again from now rather than trying to catch up.
+    if (task.period > 0 && lateness >= task.period)
+    {
+      task.stats.missedDeadlines++;
+      task.nextRunTime = tickTime + task.period;
+    }
+    else
+    {
+      task.nextRunTime += task.period;
+    }
+
+  } //for (uint8_t i = 0; i < numOfTasks && tasks[i].priority == TASK_PRIORITY_REALTIME; i++)
+}
+
+void TaskScheduler::tickBackground()
+{
+  runBackgroundTask (micros(), false);
+}
+
+void TaskScheduler::suspendRealtimeTasks (bool suspend)
+{
+  realtimeTasksSuspended = suspend;
+}
+
+void TaskScheduler::runBackgroundTask (uint32_t time, bool onlyInGaps)
+{
+  //Runs the next background task that is due. If onlyInGaps is set, only a task whose budget fits in the time left
+  //before a realtime task is due is run, though a task that never fits is still run once it has waited for
+  //MAX_BACKGROUND_WAIT_US.
+
+  uint32_t now = micros();
+  uint32_t timeLeft = onlyInGaps ? getTimeUntilRealtimeTaskDue (now) : UINT32_MAX;
+
+  for (uint8_t count = 0; count < numOfTasks; count++)
+  {
+    uint8_t i = nextBackgroundTask;
+    nextBackgroundTask = (nextBackgroundTask + 1) % numOfTasks;
+
+    Task &task = tasks[i];
+
+    if (task.priority != TASK_PRIORITY_BACKGROUND || (int32_t)(time - task.nextRunTime) < 0)
+      continue;
+
+    if (task.budget > timeLeft && (now - task.lastRunTime) < MAX_BACKGROUND_WAIT_US)
+      continue;
+
+    runTask (task, time);
+    task.lastRunTime = time;
+    task.nextRunTime = time + task.period;
+    break;
+
+  } //for (uint8_t count = 0; count < numOfTasks; count++)
+}
+
+uint32_t TaskScheduler::getTickTime()
+{
+  return tickTime;
+}
+
+uint8_t TaskScheduler::getNumOfTasks()
+{
+  return numOfTasks;
+}
+
+const char* TaskScheduler::getTaskName (uint8_t task)
+{
+  return tasks[task].name;
+}
+
+const TaskScheduler::TaskStats& TaskScheduler::getTaskStats (uint8_t task)
+{
+  return tasks[task].stats;
+}
+
+void TaskScheduler::resetStats()
+{
+  for (uint8_t i = 0; i < numOfTasks; i++)
+    tasks[i].stats = TaskStats();
+}
+
+void TaskScheduler::printStats (Print &out, uint8_t task)
+{
+  out.print (tasks[task].name);
+  out.print (": runs ");
+  out.print (tasks[task].stats.runs);
+  out.print (", max ");
+  out.print (tasks[task].stats.maxRunTime);
+  out.print ("us (budget ");
+  out.print (tasks[task].budget);
+  out.print ("us, overruns ");
+  out.print (tasks[task].stats.overruns);
+  out.print (")");
+
+  if (tasks[task].priority == TASK_PRIORITY_REALTIME)
+  {
+    out.print (", max late ");
+    out.print (tasks[task].stats.maxLateness);
+    out.print ("us, missed ");
+    out.print (tasks[task].stats.missedDeadlines);
+  }
+
+  out.println();
+}
+
+void TaskScheduler::runTask (Task &task, uint32_t time)
+{
+  uint32_t startTime = micros();
+
+  task.function (time);
+
+  uint32_t runTime = micros() - startTime;
+
+  task.stats.runs++;
+
+  if (runTime > task.stats.maxRunTime)
+    task.stats.maxRunTime = runTime;
+
+  if (runTime > task.budget)
+    task.stats.overruns++;
+}
+
+uint32_t TaskScheduler::getTimeUntilRealtimeTaskDue (uint32_t time)
+{
+  uint32_t timeLeft = UINT32_MAX;
+
+  for (uint8_t i = 0; i < numOfTasks && tasks[i].priority == TASK_PRIORITY_REALTIME; i++)
+  {
+    //realtime tasks with no period are always due, so are just run once per tick
+    if (tasks[i].period == 0)
+      continue;
+
+    int32_t timeUntilDue = (int32_t)(tasks[i].nextRunTime - time);
+
+    if (timeUntilDue <= 0)
+      return 0;
+
+    if ((uint32_t)timeUntilDue < timeLeft)
+      timeLeft = timeUntilDue;
+  }
+
+  return timeLeft;
+}
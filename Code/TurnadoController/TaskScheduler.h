@@ -0,0 +1,136 @@
+/*
+  TaskScheduler.h - Static cooperative scheduler for running a sketch's
+  subsystems at set rates from loop().
+*/
+
+#ifndef TaskScheduler_h
+#define TaskScheduler_h
+
+#include "Arduino.h"
+
+/**
+    A small cooperative (non-preemptive) scheduler for a fixed set of tasks.
+    Features:
+    - Each task is registered with a period, priority and time budget
+    - All tasks run within a tick are given the same timestamp, captured once at the start of the tick
+    - Realtime tasks are run at their period (without drifting), before any background task
+    - Background tasks share whatever time is left over, one per tick, and only when their budget fits
+      in the time before the next realtime task is due. So that a long background task isn't starved
+      completely, it is run anyway once it has waited for MAX_BACKGROUND_WAIT_US.
+    - Per-task stats of run time, budget overruns, lateness and missed deadlines
+
+    The scheduler doesn't interrupt tasks, so each task must keep within its budget
+    (e.g. by doing its work in small steps and returning).
+
+    To use, create an instance of this class, register each task with addTask() in your setup() function,
+    and call tick() from your loop() function.
+
+    Alternatively the realtime tasks can be run preemptively, by calling tickRealtime() from a timer interrupt
+    and tickBackground() from your loop() function. Background tasks are then interrupted by the realtime tasks
+    rather than having to fit in the gaps between them, so are run whenever they are due, however any state
+    they share with the realtime tasks must then be safe to be changed by an interrupt.
+*/
+class TaskScheduler
+{
+    //=====================================================
+  public:
+
+    /** A task function, which is passed the timestamp of the current tick in microseconds
+    */
+    typedef void (*TaskFunction)(uint32_t tickTime);
+
+    enum TaskPriorities
+    {
+      TASK_PRIORITY_REALTIME = 0,
+      TASK_PRIORITY_BACKGROUND
+    };
+
+    struct TaskStats
+    {
+      uint32_t runs = 0;
+      uint32_t overruns = 0; //runs that took longer than the task's budget
+      uint32_t maxRunTime = 0;
+      uint32_t maxLateness = 0; //realtime tasks only - max time from when the task was due to when it was run
+      uint32_t missedDeadlines = 0; //realtime tasks only - runs that were a whole period or more late
+    };
+
+    TaskScheduler();
+
+    /** Registers a task. Tasks of the same priority are run in the order they were added.
+
+        @param name - Name of the task, for printing stats
+        @param function - The task function
+        @param period - Time between runs in microseconds. 0 runs the task every tick (realtime) or whenever there is time (background).
+        @param priority - TASK_PRIORITY_REALTIME or TASK_PRIORITY_BACKGROUND
+        @param budget - The longest time the task is expected to take to run, in microseconds
+        @return the index of the task, or -1 if there isn't room for any more tasks
+    */
+    int8_t addTask (const char *name, TaskFunction function, uint32_t period, uint8_t priority, uint32_t budget);
+
+    /** Runs any realtime tasks that are due, followed by a background task if there is time.
+
+        You must call this function from the loop() function in your sketch (unless using tickRealtime()
+        and tickBackground()).
+    */
+    void tick();
+
+    /** Runs any realtime tasks that are due. Call this from a timer interrupt that runs a few times per
+        realtime task period (the lateness of the realtime tasks will be up to the interrupt period).
+    */
+    void tickRealtime();
+
+    /** Runs the next background task that is due. Call this from the loop() function when calling
+        tickRealtime() from a timer interrupt.
+    */
+    void tickBackground();
+
+    /** Stops (or restarts) tickRealtime() running the realtime tasks, so that the loop can safely do something
+        that changes their state. Realtime tasks that became due while suspended are run straight away when
+        restarted (and counted as missed deadlines).
+    */
+    void suspendRealtimeTasks (bool suspend);
+
+    /** Returns the timestamp of the current (or last) tick in microseconds
+    */
+    uint32_t getTickTime();
+
+    uint8_t getNumOfTasks();
+    const char* getTaskName (uint8_t task);
+    const TaskStats& getTaskStats (uint8_t task);
+
+    void resetStats();
+
+    /** Prints the stats of a task as a line of human readable text
+    */
+    void printStats (Print &out, uint8_t task);
+
+    //=====================================================
+  private:
+
+    struct Task
+    {
+      const char *name;
+      TaskFunction function;
+      uint32_t period;
+      uint32_t budget;
+      uint8_t priority;
+      uint32_t nextRunTime;
+      uint32_t lastRunTime;
+      TaskStats stats;
+    };
+
+    void runTask (Task &task, uint32_t time);
+    void runBackgroundTask (uint32_t time, bool onlyInGaps);
+    uint32_t getTimeUntilRealtimeTaskDue (uint32_t time);
+
+    static const uint8_t MAX_NUM_OF_TASKS = 12;
+    static const uint32_t MAX_BACKGROUND_WAIT_US = 20000;
+
+    Task tasks[MAX_NUM_OF_TASKS];
+    uint8_t numOfTasks = 0;
+    uint8_t nextBackgroundTask = 0;
+    uint32_t tickTime = 0;
+    volatile bool realtimeTasksSuspended = false;
+};
+
+#endif //TaskScheduler_h
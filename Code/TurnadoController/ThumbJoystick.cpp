@@ -1,8 +1,14 @@
 #include "ThumbJoystick.h"
 
+//the full 10-bit range that was assumed before calibration, at 12 bits
+const ThumbJoystick::Calibration ThumbJoystick::DEFAULT_CALIBRATION = {4, 2048, 4092};
+
 ThumbJoystick::ThumbJoystick (uint8_t yAxisPin_)
 {
   yAxisPin = yAxisPin_;
+
+  setCalibration (DEFAULT_CALIBRATION);
+  resetProcessingState();
 }
 
 ThumbJoystick::~ThumbJoystick()
@@ -14,19 +20,38 @@ void ThumbJoystick::update()
 {
   int16_t value = analogRead (yAxisPin);
 
+  if (calibrating)
+  {
+    if (value < learntCalibration.minValue)
+      learntCalibration.minValue = value;
+    if (value > learntCalibration.maxValue)
+      learntCalibration.maxValue = value;
+
+    return;
+  }
+
+  if (processYAxisSample (value) && this->handle_raw_input != NULL)
+    this->handle_raw_input (*this, value);
+}
+
+bool ThumbJoystick::processYAxisSample (int16_t value)
+{
+  //Samples past the calibrated ends are treated as being at the ends
+  value = constrain (value, (int16_t)calibration.minValue, (int16_t)calibration.maxValue);
+
   //Create a plateau around the centre point.
-  if ((value > 512 - (JS_CENTRE_PLATEAU_VAL / 2)) &&
-      (value < 512 + (JS_CENTRE_PLATEAU_VAL / 2)))
+  if ((value > yAxisLowerStartValue) &&
+      (value < yAxisUpperStartValue))
   {
-    value = 512;
+    value = calibration.centreValue;
   }
 
   //if we've got a new Y-axis raw value within a range of +/-hysteresis_val, or a new centre or end value
   if ((value - JS_Y_HYSTERESIS_VAL > yAxisRawValue) ||
       (value + JS_Y_HYSTERESIS_VAL < yAxisRawValue) ||
-      (value == 512 && yAxisRawValue != 512) ||
-      (value == yAxisMinValue && yAxisRawValue != yAxisMinValue) ||
-      (value == yAxisMaxValue && yAxisRawValue != yAxisMaxValue))
+      (value == calibration.centreValue && yAxisRawValue != calibration.centreValue) ||
+      (value == calibration.minValue && yAxisRawValue != calibration.minValue) ||
+      (value == calibration.maxValue && yAxisRawValue != calibration.maxValue))
   {
     yAxisRawValue = value;
 
@@ -34,11 +59,12 @@ void ThumbJoystick::update()
     //Serial.print(": ");
     //Serial.println(yAxisRawValue);
 
-    //map and contrain raw value to user value of +/-127 with plateau values at each end
-    if (value > 512)
-      value = map (value, 512 + (JS_CENTRE_PLATEAU_VAL / 2), yAxisMaxValue - JS_EDGE_PLATEAU_VAL, 0, 127);
-    else if (value < 512)
-      value = map (value, yAxisMinValue + JS_EDGE_PLATEAU_VAL, 512 - (JS_CENTRE_PLATEAU_VAL / 2), -128, 0);
+    //map and contrain raw value to user value of +/-127 with plateau values at each end,
+    //scaling the distance from the centre plateau by the precomputed calibration scale factors
+    if (value > (int16_t)calibration.centreValue)
+      value = ((int32_t)(value - yAxisUpperStartValue) * yAxisUpperScale) >> 16;
+    else if (value < (int16_t)calibration.centreValue)
+      value = -(((int32_t)(yAxisLowerStartValue - value) * yAxisLowerScale) >> 16);
     else
       value = 0;
 
@@ -50,7 +76,83 @@ void ThumbJoystick::update()
       this->handle_joystick_change (*this, true);
     }
 
+    return true;
+
   } //if (new Y axis value)
+
+  return false;
+}
+
+void ThumbJoystick::resetProcessingState()
+{
+  yAxisRawValue = calibration.centreValue - 1;
+  yAxisUserValue = 0;
+}
+
+bool ThumbJoystick::setCalibration (const Calibration &calibration_)
+{
+  if (!isCalibrationValid (calibration_))
+    return false;
+
+  calibration = calibration_;
+
+  yAxisUpperStartValue = calibration.centreValue + (JS_CENTRE_PLATEAU_VAL / 2);
+  yAxisLowerStartValue = calibration.centreValue - (JS_CENTRE_PLATEAU_VAL / 2);
+
+  //rounded up so that the ends of the travel reach the ends of the joystick value
+  int32_t upperTravel = (calibration.maxValue - JS_EDGE_PLATEAU_VAL) - yAxisUpperStartValue;
+  int32_t lowerTravel = yAxisLowerStartValue - (calibration.minValue + JS_EDGE_PLATEAU_VAL);
+
+  yAxisUpperScale = ((127L << 16) + upperTravel - 1) / upperTravel;
+  yAxisLowerScale = ((128L << 16) + lowerTravel - 1) / lowerTravel;
+
+  return true;
+}
+
+const ThumbJoystick::Calibration& ThumbJoystick::getCalibration()
+{
+  return calibration;
+}
+
+bool ThumbJoystick::isCalibrationValid (const Calibration &calibration)
+{
+  return (calibration.maxValue <= MAX_SAMPLE_VALUE &&
+          (calibration.maxValue - JS_EDGE_PLATEAU_VAL) - (calibration.centreValue + (JS_CENTRE_PLATEAU_VAL / 2)) >= JS_MIN_CALIBRATED_TRAVEL &&
+          (calibration.centreValue - (JS_CENTRE_PLATEAU_VAL / 2)) - (calibration.minValue + JS_EDGE_PLATEAU_VAL) >= JS_MIN_CALIBRATED_TRAVEL);
+}
+
+void ThumbJoystick::startCalibration()
+{
+  uint32_t total = 0;
+
+  for (uint8_t i = 0; i < JS_CALIBRATION_CENTRE_SAMPLES; i++)
+    total += analogRead (yAxisPin);
+
+  learntCalibration.centreValue = total / JS_CALIBRATION_CENTRE_SAMPLES;
+  learntCalibration.minValue = learntCalibration.centreValue;
+  learntCalibration.maxValue = learntCalibration.centreValue;
+
+  calibrating = true;
+
+  //hold the joystick value at the centre while calibrating
+  yAxisRawValue = calibration.centreValue;
+
+  if (yAxisUserValue != 0)
+  {
+    yAxisUserValue = 0;
+    this->handle_joystick_change (*this, true);
+  }
+}
+
+bool ThumbJoystick::stopCalibration()
+{
+  calibrating = false;
+
+  bool calibrated = setCalibration (learntCalibration);
+
+  yAxisRawValue = calibration.centreValue;
+
+  return calibrated;
 }
 
 void ThumbJoystick::onJoystickChange( void (*function)(ThumbJoystick &thumbJoystick, bool isYAxis) )
@@ -58,6 +160,11 @@ void ThumbJoystick::onJoystickChange( void (*function)(ThumbJoystick &thumbJoyst
   this->handle_joystick_change = function;
 }
 
+void ThumbJoystick::onRawInput( void (*function)(ThumbJoystick &thumbJoystick, int16_t value) )
+{
+  this->handle_raw_input = function;
+}
+
 int16_t ThumbJoystick::getYAxisValue()
 {
   return yAxisUserValue;
@@ -19,6 +19,11 @@
     - Hysteresis to create stable value changes
     - Central plateau so that joystick always centres properly
     - End plateau's so that joystick always reaches the min and max values
+    - Per-joystick calibration of the min, centre and max samples, which can be learnt by moving the joystick
+      (see startCalibration()). The samples are mapped using scale factors worked out when the calibration
+      is set, so the calibration doesn't add to the cost of processing a sample.
+
+    Samples are 12-bit, so the ADC must be set to a resolution of SAMPLE_RESOLUTION (see analogReadResolution()).
 
     To use, simply created instances of the class in your Teensy sketch, assign a callback function
     to the on...() function, and call the update() function within your loop() function.
@@ -26,13 +31,69 @@
 class ThumbJoystick
 {
   public:
+
+    static const uint8_t SAMPLE_RESOLUTION = 12;
+    static const uint16_t MAX_SAMPLE_VALUE = (1 << SAMPLE_RESOLUTION) - 1;
+
+    /** The Y-axis samples at each end of the joystick's travel, and at rest in the centre
+    */
+    struct Calibration
+    {
+      uint16_t minValue;
+      uint16_t centreValue;
+      uint16_t maxValue;
+    };
+
+    static const Calibration DEFAULT_CALIBRATION;
+
     ThumbJoystick (uint8_t yAxisPin);
     ~ThumbJoystick();
 
     void update();
 
+    /** Processes a Y-axis sample (0 to MAX_SAMPLE_VALUE). update() calls this with the value read from the pin,
+        however it can also be called directly to process recorded samples (e.g. when replaying an input trace).
+
+        @return true if the sample was used, or false if it was ignored due to hysteresis
+    */
+    bool processYAxisSample (int16_t value);
+
+    /** Resets the joystick to its centre state, so that processing a set of samples
+        always gives the same values.
+    */
+    void resetProcessingState();
+
+    /** Sets the calibration used to map samples to the joystick value.
+
+        @return false (keeping the current calibration) if the calibration isn't valid
+    */
+    bool setCalibration (const Calibration &calibration);
+    const Calibration& getCalibration();
+
+    /** Returns whether a calibration gives enough travel either side of the centre plateau to map samples to
+        the full range of joystick values.
+    */
+    static bool isCalibrationValid (const Calibration &calibration);
+
+    /** Starts learning the calibration, taking the current position as the centre, so the joystick must be at rest.
+        The min and max are then learnt from the samples read by update() while the joystick is moved to both ends,
+        and the joystick value is held at the centre until stopCalibration() is called.
+    */
+    void startCalibration();
+
+    /** Stops learning the calibration, using the learnt calibration if it is valid.
+
+        @return true if the learnt calibration is valid and is now being used
+    */
+    bool stopCalibration();
+
     void onJoystickChange( void (*)(ThumbJoystick &thumbJoystick, bool isYAxis) );
 
+    /** Assigns a function to be called with each sample that update() has used
+        (samples ignored due to hysteresis have no effect, so aren't passed on), e.g. for recording the input.
+    */
+    void onRawInput( void (*)(ThumbJoystick &thumbJoystick, int16_t value) );
+
     int16_t getYAxisValue();
 
     bool operator==(ThumbJoystick& t);
@@ -40,24 +101,38 @@ class ThumbJoystick
   private:
 
     void (*handle_joystick_change)(ThumbJoystick &thumbJoystick, bool isYAxis) = NULL;
+    void (*handle_raw_input)(ThumbJoystick &thumbJoystick, int16_t value) = NULL;
 
     //Joystick hysteresis value.
     //Used to prevent the analogue values bouncing, but reduces resolution.
     //This could also be considered as a 'sensitivity' value.
-    const int JS_Y_HYSTERESIS_VAL = 4;
+    static const int JS_Y_HYSTERESIS_VAL = 16;
     //Joystick centre plateau value.
     //Increase to add more dead space around the centre if joystick isn't centring.
-    const int JS_CENTRE_PLATEAU_VAL = 40;
+    static const int JS_CENTRE_PLATEAU_VAL = 160;
     //Joystick edge plateau value.
     //Increase to add more dead space at the edge if joystick isn't reaching end values.
-    const int JS_EDGE_PLATEAU_VAL = 0;
+    static const int JS_EDGE_PLATEAU_VAL = 0;
+    //The least travel allowed between the centre plateau and either end of a calibration
+    //(which also keeps the scaled samples within 32 bits).
+    static const int JS_MIN_CALIBRATED_TRAVEL = MAX_SAMPLE_VALUE / 8;
+    //The number of samples averaged to find the centre when starting calibration
+    static const uint8_t JS_CALIBRATION_CENTRE_SAMPLES = 16;
 
     uint8_t yAxisPin;
-    uint16_t yAxisRawValue = 511;
-    int16_t yAxisUserValue = 0; 
-
-    uint16_t yAxisMinValue = 1;
-    uint16_t yAxisMaxValue = 1023;
+    uint16_t yAxisRawValue = 0;
+    int16_t yAxisUserValue = 0;
+
+    Calibration calibration = DEFAULT_CALIBRATION;
+    bool calibrating = false;
+    Calibration learntCalibration;
+
+    //worked out from the calibration (see setCalibration()) - the samples either side of the centre plateau,
+    //and the scale factors from the sample distance past them to the joystick value, as 16.16 fixed point
+    int16_t yAxisUpperStartValue;
+    int16_t yAxisLowerStartValue;
+    int32_t yAxisUpperScale;
+    int32_t yAxisLowerScale;
 };
 
 #endif //ThumbJoystick_h
@@ -0,0 +1,204 @@
+//=========================================================================
+//Binary trace.
+//
+//Debug events (control changes, MIDI-in, EEPROM writes, etc) are traced by pushing a fixed-size binary record
+//into a RAM ring, which only takes the time to copy a few words, so tracing doesn't change the timing of the code
+//being traced (unlike printing each event over USB serial from inside the control callbacks).
+//
+//The ring is a flight recorder - it keeps the latest TRACE_RING_SIZE records (counting any older records
+//that are overwritten) until they are read. The records are read by sending a 'g' over USB serial, which drains
+//the records in the ring, or an 'l', which turns on streaming of new records as they are traced ('l' again turns
+//it off) - see SerialCommands.h. Records are written from a background task, and only when there is room in
+//the USB serial buffer, so that reading them doesn't hold up the loop.
+//
+//Each record is written as a 0xFF byte followed by the 12 bytes of the record (little-endian), which can't be
+//confused with the text that is also printed over USB serial, as that is only ever ASCII.
+//Code/Tools/decode_trace.py turns a capture of the USB serial output into a readable log, passing the text
+//through and decoding the records using the formats in the comments of TraceEvents below (so an event
+//and its format are only defined here).
+//
+//Tracing is only compiled in when DEBUG is defined (see Globals.h) - TRACE() compiles to nothing otherwise.
+
+//The events that can be traced, each with the format used to decode it, where {a}, {b} and {c}
+//are the record's args (new events must be added to the end, and their format kept on the same line)
+enum TraceEvents
+{
+  TRACE_KNOB_ENCODER = 0, //Knob controller {a} encoder: {b}
+  TRACE_MIX_ENCODER, //Mix encoder: {b}
+  TRACE_LCD_ENCODER, //LCD encoder {a} (0 = CTRL, 1 = Param, 2 = Value): {b}
+  TRACE_KNOB_ENCODER_SWITCH, //Knob controller {a} encoder switch: {b}
+  TRACE_LCD_CTRL_ENCODER_SWITCH, //LCD CTRL encoder switch: {b}
+  TRACE_PRESET_UP_BUTTON, //Preset Up Button: {b}
+  TRACE_PRESET_DOWN_BUTTON, //Preset Down Button: {b}
+  TRACE_RANDOMISE_BUTTON, //Randomise Button: {b}
+  TRACE_KNOB_JOYSTICK, //Knob Controller {a} joystick: {b}
+  TRACE_MIDI_IN_CC, //MIDI-in CC: {a} {b} {c}
+  TRACE_PROGRAM_CHANGE, //Program change to {a} (program cache hits: {c}, misses: {b})
+  TRACE_PRESET_RECALL, //Recalled preset {a} in {c}us
+  TRACE_PRESET_SAVE, //Saved preset {a} - {c} preset bytes used
+  TRACE_SCENE_CAPTURE, //Captured scene {a}
+  TRACE_SCENE_MORPH, //Scene morph: {a} (1 = on, 0 = off)
+  TRACE_GESTURE_LOOP, //Gesture loop {a}: {b} bytes for {c} ticks
+  TRACE_JOURNAL_WRITE, //Written to EEPROM: param {a} {b} (Journal position {c})
+  TRACE_JOURNAL_MOUNT, //Settings journal: bank {a}, generation {c}
+  TRACE_JOURNAL_COMPACTION, //Settings journal compacted into bank {a}, generation {c}
+  TRACE_JOURNAL_MAX_WRITE_STEP, //Settings journal: new worst case write step of {c}us
+  TRACE_SETTINGS_LOAD, //Settings loaded from {a} (0 = image, 1 = layout version 0, 2 = defaults, 3 = previous image) in {c}us
+  TRACE_SETTINGS_VALUE, //Settings category {a} param {b}: {c}
+  TRACE_PRESETS_LOAD, //Presets: {a} stored using {c} bytes
+  TRACE_LCD_FRAME, //LCD complete redraw of {a} (0 = controls, 1 = menu): {b} draw calls in {c}us
+  TRACE_LCD_FRAME_HASH, //LCD frame hash: {c}
+
+  NUM_OF_TRACE_EVENTS
+};
+
+#ifdef DEBUG
+
+#define TRACE_RING_SIZE 256 //must be a power of 2
+#define TRACE_RECORD_SYNC_BYTE 0xFF
+#define TRACE_MIN_SERIAL_SPACE 64 //a whole USB packet free in the serial transmit buffer
+
+struct TraceRecord
+{
+  uint32_t time; //micros()
+  uint8_t event;
+  uint8_t a;
+  int16_t b;
+  int32_t c;
+};
+
+TraceRecord traceRing[TRACE_RING_SIZE];
+
+//the positions run freely, and are wrapped into the ring when used
+volatile uint16_t traceWritePos = 0;
+volatile uint16_t traceReadPos = 0;
+volatile uint32_t traceNumOfOverwrittenRecords = 0;
+
+uint32_t traceNumOfReportedOverwrittenRecords = 0;
+bool traceStreaming = false;
+uint16_t traceNumOfRecordsToDrain = 0;
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void tracePush (uint8_t event, uint8_t a = 0, int16_t b = 0, int32_t c = 0)
+{
+  //Can be called from the loop or the realtime tasks, however not with interrupts disabled.
+  //micros() is read first, as it briefly disables interrupts itself.
+  uint32_t time = micros();
+
+  noInterrupts();
+
+  TraceRecord &record = traceRing[traceWritePos & (TRACE_RING_SIZE - 1)];
+  record.time = time;
+  record.event = event;
+  record.a = a;
+  record.b = b;
+  record.c = c;
+
+  traceWritePos++;
+
+  //if the ring was full, the oldest record has just been overwritten
+  if ((uint16_t)(traceWritePos - traceReadPos) > TRACE_RING_SIZE)
+  {
+    traceReadPos++;
+    traceNumOfOverwrittenRecords++;
+  }
+
+  interrupts();
+}
+
+#define TRACE(...) tracePush (__VA_ARGS__)
+
+#else
+
+#define TRACE(...)
+
+#endif //DEBUG
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void traceStartDrain()
+{
+#ifdef DEBUG
+  noInterrupts();
+  traceNumOfRecordsToDrain = traceWritePos - traceReadPos;
+  interrupts();
+
+  Serial.print ("Trace: ");
+  Serial.print (traceNumOfRecordsToDrain);
+  Serial.print (" records (");
+  Serial.print (traceNumOfOverwrittenRecords);
+  Serial.println (" overwritten)");
+
+  traceNumOfReportedOverwrittenRecords = traceNumOfOverwrittenRecords;
+#endif
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void traceToggleStreaming()
+{
+#ifdef DEBUG
+  traceStreaming = !traceStreaming;
+
+  Serial.print ("Trace streaming: ");
+  Serial.println (traceStreaming ? "on" : "off");
+#endif
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void traceUpdate (uint32_t tickTime)
+{
+#ifdef DEBUG
+  if (!traceStreaming && traceNumOfRecordsToDrain == 0)
+    return;
+
+  //if records have been overwritten since the last report (which can only happen while streaming
+  //if the host isn't reading fast enough), note it in the output so the gap is known about
+  if (traceNumOfOverwrittenRecords != traceNumOfReportedOverwrittenRecords && Serial.availableForWrite() >= TRACE_MIN_SERIAL_SPACE)
+  {
+    Serial.print ("Trace: ");
+    Serial.print (traceNumOfOverwrittenRecords - traceNumOfReportedOverwrittenRecords);
+    Serial.println (" records overwritten");
+
+    traceNumOfReportedOverwrittenRecords = traceNumOfOverwrittenRecords;
+  }
+
+  //write as many records as will fit in the USB serial buffer without waiting
+  while (Serial.availableForWrite() >= TRACE_MIN_SERIAL_SPACE)
+  {
+    uint8_t frame[1 + sizeof (TraceRecord)];
+    frame[0] = TRACE_RECORD_SYNC_BYTE;
+
+    noInterrupts();
+
+    if (traceReadPos == traceWritePos)
+    {
+      interrupts();
+      traceNumOfRecordsToDrain = 0;
+      break;
+    }
+
+    memcpy (&frame[1], &traceRing[traceReadPos & (TRACE_RING_SIZE - 1)], sizeof (TraceRecord));
+    traceReadPos++;
+
+    interrupts();
+
+    Serial.write (frame, sizeof (frame));
+
+    if (traceNumOfRecordsToDrain > 0)
+    {
+      traceNumOfRecordsToDrain--;
+
+      if (traceNumOfRecordsToDrain == 0 && !traceStreaming)
+        break;
+    }
+
+  } //while (Serial.availableForWrite() >= TRACE_MIN_SERIAL_SPACE)
+#endif
+}
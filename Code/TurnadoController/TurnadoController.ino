@@ -1,44 +1,216 @@
 #include "Globals.h"
+#include "TaskScheduler.h"
+#include "Profiler.h"
+#include "Trace.h"
+
+TaskScheduler scheduler;
+
+//=========================================================================
+//The time in milliseconds used by the control logic (encoder acceleration, ignoring looped back MIDI CCs).
+//This is set once per realtime tick, so that all the control logic within a tick sees the same time,
+//and is set from the trace when replaying an input trace (see InputTrace.h).
+uint32_t controlTime = 0;
 
 //=========================================================================
-//FIXME: make the below an array for each MIDI channel, where the index is set by the current MIDI channel of the program change buttons.
-//This will involve needing to update the program display on the LCD top bar every time the program change buttons MIDI channel is changed.
-int16_t currentMidiProgramNumber = 0;
+//MIDI channel state - the last known value of each device param, and the current program number, for
+//each MIDI channel. Each device param (and the program change buttons) views the state of a single channel
+//through a channel index, so changing a channel just changes the index (see updateMidiChannelViews()).
+
+#define NUM_OF_MIDI_CHANNELS 16
+
+struct MidiChannelState
+{
+  uint8_t deviceParamValues[NUM_OF_MIDI_CHANNELS][NUM_OF_DEVICE_PARAMS]; //the base value of knob controllers
+  uint8_t programNumbers[NUM_OF_MIDI_CHANNELS];
+};
+
+MidiChannelState midiChannelState;
+
+//the index (0-15) of the MIDI channel currently used by each device param, and by the program change buttons
+uint8_t deviceParamChannelIndex[NUM_OF_DEVICE_PARAMS] = {0};
+uint8_t programChannelIndex = 0;
 
-//FIXME: could the below be replaced by knobControllerData and mixControllerData as arrays for each MIDI channel?
-uint8_t deviceParamValuesForMidiChannel[16][NUM_OF_DEVICE_PARAMS] = {{0}};
+//the value of a device param on its current channel
+inline uint8_t& deviceParamValue (uint8_t param)
+{
+  return midiChannelState.deviceParamValues[deviceParamChannelIndex[param]][param];
+}
+
+inline uint8_t& currentMidiProgramNumber()
+{
+  return midiChannelState.programNumbers[programChannelIndex];
+}
 
 //=========================================================================
 #include "PinAllocations.h"
 #include "Settings.h"
+#include "ProgramCache.h"
 
 void setKnobControllerBaseValue (uint8_t index, uint8_t value, bool sendToMidiOut);
+void setKnobControllerCombinedMidiValue (uint8_t index, bool sendToMidiOut);
 void setMixControllerValue (uint8_t value, bool sendToMidiOut);
+void updateMidiChannelViews (bool updateAll);
+void modulationTriggerEnvelope (uint8_t index);
+void gestureLooperToggle (uint8_t index);
 
 #include "MidiIO.h"
+#include "MessageMap.h"
 #include "Lcd.h"
+#include "SceneMorph.h"
 #include "Controls.h"
+#include "GestureLooper.h"
+#include "Modulation.h"
+#include "Benchmarks.h"
+#include "InputTrace.h"
+#include "MemoryStats.h"
+#include "SerialCommands.h"
+
+//=========================================================================
+//Task scheduling - inputs and MIDI are run at a set rate from a timer interrupt, and the LCD and EEPROM
+//share the time left over in loop() (each of these does its work in small steps). As the realtime tasks
+//preempt the loop, a slow LCD frame or EEPROM write can't hold up the inputs, so the input jitter is just
+//the timer period plus the time spent in higher priority interrupts - see the "max late" stat of the
+//Controls task (printed with the 'j' serial command).
+//
+//The timer interrupt is below the USB interrupt priority, so usbMIDI can be used from the realtime tasks.
+//State that the loop reads from the realtime tasks is handed over safely - the LCD through a seqlock
+//(see lcdPublishDisplayState()), and the EEPROM save with interrupts briefly disabled.
+
+const uint32_t TASK_TIMER_PERIOD_US = 100;
+const uint8_t TASK_TIMER_PRIORITY = 192; //0 (highest) to 255, in steps of 16
+
+const uint32_t TASK_PERIOD_MIDI_IO_US = 1000;
+const uint32_t TASK_PERIOD_CONTROLS_US = 1000;
+const uint32_t TASK_PERIOD_MODULATION_US = MODULATION_TICK_US;
+const uint32_t TASK_PERIOD_GESTURE_LOOPER_US = GESTURE_LOOPER_TICK_US;
+
+//Background tasks are only run when their budget fits in the gap between the realtime tasks
+const uint32_t TASK_BUDGET_MIDI_IO_US = 250;
+const uint32_t TASK_BUDGET_CONTROLS_US = 500;
+const uint32_t TASK_BUDGET_MODULATION_US = 100;
+const uint32_t TASK_BUDGET_GESTURE_LOOPER_US = 100;
+const uint32_t TASK_BUDGET_LCD_US = LCD_FRAME_BUDGET_US + 200; //the frame budget can be overrun by the last draw
+const uint32_t TASK_BUDGET_EEPROM_US = 500; //a single EEPROM write step, though one that needs a flash erase takes a few ms
+
+const uint32_t TASK_PERIOD_SERIAL_COMMANDS_US = 10000;
+const uint32_t TASK_BUDGET_SERIAL_COMMANDS_US = 50;
+
+#ifndef DISABLE_PROFILER
+const uint32_t TASK_PERIOD_PROFILER_US = 10000;
+const uint32_t TASK_BUDGET_PROFILER_US = 200; //printing a single line of stats
+#endif
+
+#ifdef ENABLE_INPUT_TRACE
+const uint32_t TASK_BUDGET_INPUT_TRACE_US = 200; //printing a single line of a trace dump
+#endif
+
+#ifdef DEBUG
+const uint32_t TASK_BUDGET_DEBUG_TRACE_US = 200; //writing the debug trace records that fit in the USB serial buffer
+#endif
+
+#ifndef DISABLE_TIMER_TASKS
+IntervalTimer taskTimer;
+#endif
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void taskTimerTick()
+{
+  controlTime = millis();
+
+  scheduler.tickRealtime();
+
+  midiOutUpdate();
+  lcdPublishDisplayState();
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void setupFailed (const char *message)
+{
+  //Stops with the error shown on the LCD, and printed over USB serial every second (so it's seen whenever
+  //a serial monitor is opened), rather than carrying on with part of the controller not running
+  lcd.fillScreen (ILI9341_RED);
+  lcd.setTextColor (ILI9341_WHITE);
+  lcd.setTextSize (2);
+  lcd.setCursor (0, 0);
+  lcd.println ("Setup failed:");
+  lcd.println (message);
+
+  while (true)
+  {
+    Serial.print ("Setup failed: ");
+    Serial.println (message);
+    delay (1000);
+  }
+}
+
+//=========================================================================
+//=========================================================================
+//=========================================================================
+void setupAddTask (const char *name, TaskScheduler::TaskFunction function, uint32_t period, uint8_t priority, uint32_t budget)
+{
+  //a task that doesn't fit in the scheduler would silently never run
+  if (scheduler.addTask (name, function, period, priority, budget) < 0)
+    setupFailed ("too many scheduler tasks (see TaskScheduler::MAX_NUM_OF_TASKS)");
+}
 
 //=========================================================================
 //=========================================================================
 //=========================================================================
 void setup()
 {
+  //done before anything else uses the stack, so the stack stats cover all of it
+  memoryPaintStack();
+
 #ifdef DEBUG
   Serial.begin(9600);
   delay(500);
 #endif
 
+  setupProfiler();
   setupSettings();
   setupLcd();
   setupControls();
   setupMidiIO();
+  setupModulation();
+  setupGestureLooper();
 
-  for (uint8_t chan = 0; chan < 16; chan++)
-  {
-    //assume mix value always starts at 127, and the rest start at 0.
-    deviceParamValuesForMidiChannel[chan][DEVICE_PARAM_INDEX_MIX] = 127;
-  }
+#ifdef ENABLE_INPUT_TRACE
+  setupInputTrace();
+#endif
+
+  setupAddTask ("MIDI IO", updateMidiIO, TASK_PERIOD_MIDI_IO_US, TaskScheduler::TASK_PRIORITY_REALTIME, TASK_BUDGET_MIDI_IO_US);
+  setupAddTask ("Controls", updateControls, TASK_PERIOD_CONTROLS_US, TaskScheduler::TASK_PRIORITY_REALTIME, TASK_BUDGET_CONTROLS_US);
+  setupAddTask ("Modulation", updateModulation, TASK_PERIOD_MODULATION_US, TaskScheduler::TASK_PRIORITY_REALTIME, TASK_BUDGET_MODULATION_US);
+  setupAddTask ("Gesture looper", updateGestureLooper, TASK_PERIOD_GESTURE_LOOPER_US, TaskScheduler::TASK_PRIORITY_REALTIME, TASK_BUDGET_GESTURE_LOOPER_US);
+  setupAddTask ("LCD", updateLcd, 0, TaskScheduler::TASK_PRIORITY_BACKGROUND, TASK_BUDGET_LCD_US);
+  setupAddTask ("EEPROM", settingsUpdateEeprom, 0, TaskScheduler::TASK_PRIORITY_BACKGROUND, TASK_BUDGET_EEPROM_US);
+
+  setupAddTask ("Serial commands", updateSerialCommands, TASK_PERIOD_SERIAL_COMMANDS_US, TaskScheduler::TASK_PRIORITY_BACKGROUND, TASK_BUDGET_SERIAL_COMMANDS_US);
+
+#ifndef DISABLE_PROFILER
+  setupAddTask ("Profiler", profilerUpdate, TASK_PERIOD_PROFILER_US, TaskScheduler::TASK_PRIORITY_BACKGROUND, TASK_BUDGET_PROFILER_US);
+#endif
+
+#ifdef ENABLE_INPUT_TRACE
+  setupAddTask ("Input trace", inputTraceUpdate, 0, TaskScheduler::TASK_PRIORITY_BACKGROUND, TASK_BUDGET_INPUT_TRACE_US);
+#endif
+
+#ifdef DEBUG
+  setupAddTask ("Debug trace", traceUpdate, 0, TaskScheduler::TASK_PRIORITY_BACKGROUND, TASK_BUDGET_DEBUG_TRACE_US);
+#endif
+
+#ifdef RUN_BENCHMARKS
+  runBenchmarks();
+#endif
+
+#ifndef DISABLE_TIMER_TASKS
+  taskTimer.priority (TASK_TIMER_PRIORITY);
+  taskTimer.begin (taskTimerTick, TASK_TIMER_PERIOD_US);
+#endif
 }
 
 //=========================================================================
@@ -46,8 +218,18 @@ void setup()
 //=========================================================================
 void loop()
 {
-  updateMidiIO();
-  updateControls();
-  updateLcd();
-  settingsUpdateEeprom();
+#ifndef DISABLE_TIMER_TASKS
+  scheduler.tickBackground();
+#else
+  controlTime = millis();
+
+  scheduler.tick();
+
+  midiOutUpdate();
+  lcdPublishDisplayState();
+#endif
+
+#ifndef DISABLE_PROFILER
+  profilerCountLoop (micros());
+#endif
 }